@@ -62,16 +62,20 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/CLArgs.h"
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/FileDownloader.h"
+#include "Engine/FrameLockstep.h"
 #include "Engine/GroupOutput.h"
 #include "Engine/DiskCacheNode.h"
 #include "Engine/ProjectSerialization.h"
 #include "Engine/Node.h"
 #include "Engine/NodeSerialization.h"
+#include "Engine/OutputSchedulerThread.h"
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
 #include "Engine/ProcessHandler.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RenderServer.h"
 #include "Engine/Settings.h"
+#include "Engine/Timer.h"
 #include "Engine/WriteNode.h"
 
 NATRON_NAMESPACE_ENTER
@@ -170,6 +174,9 @@ public:
 
     ProjectBeingLoadedInfo projectBeingLoaded;
 
+    // Blocking renders of several writers are frame-interleaved
+    bool parallelWriters;
+
     AppInstancePrivate(int appID,
                        AppInstance* app)
 
@@ -188,6 +195,7 @@ public:
         , invalidExprKnobsMutex()
         , invalidExprKnobs()
         , projectBeingLoaded()
+        , parallelWriters(false)
     {
     }
 
@@ -577,6 +585,8 @@ AppInstance::loadInternal(const CLArgs& cl,
         return;
     }
 
+    _imp->parallelWriters = cl.areWritersRenderedInParallel();
+
     executeCommandLinePythonCommands(cl);
 
     QString exportDocPath = cl.getExportDocsPath();
@@ -660,7 +670,11 @@ AppInstance::loadInternal(const CLArgs& cl,
         }
 
         ///launch renders
-        if ( !writersWork.empty() ) {
+        if ( !cl.getRenderServerName().isEmpty() ) {
+            // keep the project loaded and render the jobs received on the local socket
+            RenderServer server( shared_from_this(), scriptFilename, extraOnProjectCreatedScript, cl.areRenderStatsEnabled() );
+            server.run( cl.getRenderServerName() );
+        } else if ( !writersWork.empty() ) {
             startWritersRendering(false, writersWork);
         } else {
             std::list<std::string> writers;
@@ -1810,8 +1824,34 @@ AppInstance::startWritersRendering(bool doBlockingRender,
     }
 
     if (appPTR->isBackground() || doBlockingRender) {
+        // Render the writers frame-interleaved so that the nodes they share are computed once per frame
+        FrameLockstepPtr lockstep;
+        if ( _imp->parallelWriters && (itemsToQueue.size() > 1) ) {
+            lockstep = boost::make_shared<FrameLockstep>();
+            for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
+                it->work.writer->getRenderEngine()->setFrameLockstep(lockstep);
+            }
+        }
+
         //blocking call, we don't want this function to return pre-maturely, in which case it would kill the app
         QtConcurrent::blockingMap( itemsToQueue, boost::bind(&AppInstancePrivate::startRenderingFullSequence, _imp.get(), true, _1) );
+
+        if (lockstep) {
+            bool useRenderStats = false;
+            for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
+                it->work.writer->getRenderEngine()->setFrameLockstep( FrameLockstepPtr() );
+                useRenderStats |= it->work.useRenderStats;
+            }
+            if (useRenderStats) {
+                int nbNodeRenders, nbSharedNodeRenders;
+                double timeSaved;
+                lockstep->getSharedWorkStats(&nbNodeRenders, &nbSharedNodeRenders, &timeSaved);
+                std::cout << tr("Parallel writers: %1 of %2 node renders were computed by another writer and served from the cache, saving %3 of rendering.")
+                    .arg(nbSharedNodeRenders)
+                    .arg(nbNodeRenders)
+                    .arg( Timer::printAsTime(timeSaved, false) ).toStdString() << std::endl;
+            }
+        }
     } else {
         bool isQueuingEnabled = appPTR->getCurrentSettings()->isRenderQueuingEnabled();
         if (isQueuingEnabled) {
@@ -54,6 +54,7 @@
 #include <cstring> // for std::memcpy
 #include <sstream> // stringstream
 #include <locale>
+#include <limits>
 
 #include <QtCore/QtGlobal> // for Q_OS_*
 #if defined(Q_OS_LINUX)
@@ -106,6 +107,7 @@
 
 #include "Engine/AppInstance.h"
 #include "Engine/Backdrop.h"
+#include "Engine/BufferPool.h"
 #include "Engine/CLArgs.h"
 #include "Engine/DiskCacheNode.h"
 #include "Engine/Dot.h"
@@ -439,6 +441,7 @@ StrUtils::ensureLastPathSeparator(QString& path)
 bool
 AppManager::loadFromArgs(const CLArgs& cl)
 {
+    _imp->verbose = cl.isVerbose();
 
 #ifdef DEBUG
     for (std::size_t i = 0; i < _imp->commandLineArgsUtf8.size(); ++i) {
@@ -458,8 +461,10 @@ AppManager::loadFromArgs(const CLArgs& cl)
     // on Linux, X11 will create a context that would corrupt
     // the XUniqueContext created by Qt
     // scoped_ptr
+    TimeLapse timer;
     _imp->renderingContextPool.reset( new GPUContextPool() );
     initializeOpenGLFunctionsOnce(true);
+    printStartupTime( "OpenGL initialization", timer.getTimeElapsedReset() );
 
     //  QCoreApplication will hold a reference to that appManagerArgc integer until it dies.
     //  Thus ensure that the QCoreApplication is destroyed when returning this function.
@@ -468,6 +473,7 @@ AppManager::loadFromArgs(const CLArgs& cl)
     // resizing to a smaller size doesn't free/move memory, so the data pointer remains valid
     assert(_imp->nArgs <= (int)_imp->commandLineArgsUtf8.size());
     _imp->commandLineArgsUtf8.resize(_imp->nArgs); // Qt may have reduced the numlber of args
+    printStartupTime( "Qt initialization", timer.getTimeElapsedReset() );
 
 #ifdef QT_CUSTOM_THREADPOOL
     // Set the global thread pool (pointed is owned and deleted by QThreadPool at exit)
@@ -503,8 +509,10 @@ AppManager::loadFromArgs(const CLArgs& cl)
 
         return false;
     }
+    printStartupTime( "Python initialization", timer.getTimeElapsedReset() );
 
     _imp->idealThreadCount = QThread::idealThreadCount();
+    _imp->taskScheduler.reset( new TaskScheduler(_imp->idealThreadCount) );
 
 
     QThreadPool::globalInstance()->setExpiryTimeout(-1); //< make threads never exit on their own
@@ -593,6 +601,7 @@ AppManager::~AppManager()
 
     ///Caches may have launched some threads to delete images, wait for them to be done
     QThreadPool::globalInstance()->waitForDone();
+    _imp->taskScheduler.reset();
 
     ///Kill caches now because decreaseNCacheFilesOpened can be called
     _imp->_nodeCache->waitForDeleterThread();
@@ -850,6 +859,7 @@ AppManager::loadInternal(const CLArgs& cl)
 # endif
 
 
+    TimeLapse timer;
     _imp->_settings = boost::make_shared<Settings>();
     _imp->_settings->initializeKnobsPublic();
 
@@ -900,6 +910,8 @@ AppManager::loadInternal(const CLArgs& cl)
         }
     }
 
+    printStartupTime( "Settings", timer.getTimeElapsedReset() );
+
     ///basically show a splashScreen load fonts etc...
     return initGui(cl);
 } // loadInternal
@@ -1067,13 +1079,25 @@ AppManager::initGui(const CLArgs& cl)
 bool
 AppManager::loadInternalAfterInitGui(const CLArgs& cl)
 {
+    TimeLapse timer;
     try {
         size_t maxCacheRAM = _imp->_settings->getRamMaximumPercent() * getSystemTotalRAM();
         U64 viewerCacheSize = _imp->_settings->getMaximumViewerDiskCacheSize();
         U64 maxDiskCacheNode = _imp->_settings->getMaximumDiskCacheNodeSize();
 
-        _imp->_nodeCache = boost::make_shared<Cache<Image> >("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1.);
-        _imp->_diskCache = boost::make_shared<Cache<Image> >("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0.);
+        // Split the image caches so that parallel renders do not all serialize on a single lock.
+        int nCacheShards = _imp->_settings->getNumberOfCacheShards();
+        if (nCacheShards <= 0) {
+            nCacheShards = 1;
+            while ( nCacheShards < QThread::idealThreadCount() && nCacheShards < NATRON_CACHE_MAX_SHARDS ) {
+                nCacheShards *= 2;
+            }
+        }
+
+        _imp->_nodeCache = boost::make_shared<Cache<Image> >("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1., nCacheShards);
+        // The image buffers freed by the node cache are kept for reuse within the headroom it leaves below its maximum size
+        BufferPool::setMaximumIdleSize( maxCacheRAM * (1. - NATRON_CACHE_LIMIT_PERCENT) );
+        _imp->_diskCache = boost::make_shared<Cache<Image> >("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0., nCacheShards);
         _imp->_viewerCache = boost::make_shared<Cache<FrameEntry> >("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0.);
         _imp->setViewerCacheTileSize();
     } catch (std::logic_error&) {
@@ -1098,6 +1122,8 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         _imp->restoreCaches();
     }
 
+    printStartupTime( "Image caches", timer.getTimeElapsedReset() );
+
     setLoadingStatus( tr("Loading plugin cache...") );
 
 
@@ -1119,6 +1145,7 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
     if ( isBackground() && !cl.getIPCPipeName().isEmpty() ) {
         _imp->initProcessInputChannel( cl.getIPCPipeName() );
     }
+    printStartupTime( "Ready", timer.getTimeElapsedReset() );
 
 
     if ( cl.isInterpreterMode() ) {
@@ -1211,9 +1238,11 @@ AppManagerPrivate::setViewerCacheTileSize()
     ImageBitDepthEnum viewerDepth = _settings->getViewersBitDepth();
     switch (viewerDepth) {
         case eImageBitDepthFloat:
-        case eImageBitDepthHalf:
             tileSize *= sizeof(float);
             break;
+        case eImageBitDepthHalf:
+            tileSize *= sizeof(unsigned short);
+            break;
         default:
             break;
     }
@@ -1384,6 +1413,7 @@ AppManager::clearNodeCache()
         (*it)->clearAllLastRenderedImages();
     }
     _imp->_nodeCache->clear();
+    BufferPool::releaseIdleMemory( std::numeric_limits<std::size_t>::max() );
 }
 
 void
@@ -1433,6 +1463,8 @@ AppManager::wipeAndCreateDiskCacheStructure()
 
     assert(_imp->_diskCache);
     _imp->cleanUpCacheDiskStructure( _imp->_diskCache->getCachePath(), false );
+    // The journal was removed along with the cache folder
+    _imp->_diskCache->compactJournal();
     assert(_imp->_viewerCache);
     _imp->cleanUpCacheDiskStructure( _imp->_viewerCache->getCachePath() , true);
 }
@@ -1457,6 +1489,23 @@ AppManager::isLoaded() const
     return _imp->_loaded;
 }
 
+bool
+AppManager::isVerbose() const
+{
+    return _imp->verbose;
+}
+
+void
+AppManager::printStartupTime(const std::string& step,
+                             double seconds) const
+{
+    if (!_imp->verbose) {
+        return;
+    }
+    std::cout << "Startup: " << step << ": " << seconds << " s (total "
+              << _imp->startupTimer.getTimeSinceCreation() << " s)" << std::endl;
+}
+
 void
 AppManager::abortAnyProcessing()
 {
@@ -1497,6 +1546,7 @@ AppManager::setApplicationsCachesMaximumMemoryPercent(double p)
 
     _imp->_nodeCache->setMaximumCacheSize(maxCacheRAM);
     _imp->_nodeCache->setMaximumInMemorySize(1);
+    BufferPool::setMaximumIdleSize( maxCacheRAM * (1. - NATRON_CACHE_LIMIT_PERCENT) );
 }
 
 void
@@ -1517,17 +1567,23 @@ AppManager::loadAllPlugins()
     assert( _imp->_plugins.empty() );
     assert( _imp->_formats.empty() );
 
+    TimeLapse timer;
+
     // Load plug-ins bundled into Natron
     loadBuiltinNodePlugins(&_imp->readerPlugins, &_imp->writerPlugins);
+    printStartupTime( "Built-in plug-ins", timer.getTimeElapsedReset() );
 
     // Load OpenFX plug-ins
     _imp->ofxHost->loadOFXPlugins( &_imp->readerPlugins, &_imp->writerPlugins);
+    printStartupTime( "OpenFX plug-ins", timer.getTimeElapsedReset() );
 
     // Load PyPlugs and init.py & initGui.py scripts
     // Should be done after settings are declared
     loadPythonGroups();
+    printStartupTime( "PyPlugs and init scripts", timer.getTimeElapsedReset() );
 
     _imp->_settings->restorePluginSettings();
+    printStartupTime( "Plug-in settings", timer.getTimeElapsedReset() );
 
 
     onAllPluginsLoaded();
@@ -2893,6 +2949,12 @@ AppManager::checkCacheFreeMemoryIsGoodEnough()
     size_t systemRAMToKeepFree = getSystemTotalRAM() * appPTR->getCurrentSettings()->getUnreachableRamPercent();
     size_t totalFreeRAM = getAmountFreePhysicalRAM();
 
+    if (totalFreeRAM <= systemRAMToKeepFree) {
+        // Give back the buffers kept for reuse before evicting images
+        BufferPool::releaseIdleMemory(systemRAMToKeepFree - totalFreeRAM);
+        totalFreeRAM = getAmountFreePhysicalRAM();
+    }
+
     while (totalFreeRAM <= systemRAMToKeepFree) {
 #ifdef NATRON_DEBUG_CACHE
         qDebug() << "Total system free RAM is below the threshold:" << printAsRAM(totalFreeRAM)
@@ -3717,6 +3779,12 @@ AppManager::getAppTLS() const
     return &_imp->globalTLS;
 }
 
+TaskScheduler*
+AppManager::getTaskScheduler() const
+{
+    return _imp->taskScheduler.get();
+}
+
 
 QString
 AppManager::getBoostVersion() const
@@ -4108,24 +4176,26 @@ NATRON_PYTHON_NAMESPACE::interpretPythonScript(const std::string& script,
     }
 } // NATRON_PYTHON_NAMESPACE::interpretPythonScript
 
-#if 0 // dead code
-void
+PyObject*
 NATRON_PYTHON_NAMESPACE::compilePyScript(const std::string& script,
-                                         PyObject** code)
+                                         int start)
 {
     ///Must be locked
     assert( PyThreadState_Get() );
 
-    *code = (PyObject*)Py_CompileString(script.c_str(), "<string>", Py_file_input);
-    if (PyErr_Occurred() || !*code) {
+    PyObject* code = Py_CompileString(script.c_str(), "<string>", start);
+    if ( PyErr_Occurred() || !code ) {
 #ifdef DEBUG
         PyErr_Print();
 #endif
-        throw std::runtime_error("failed to compile the script");
+        PyErr_Clear();
+        Py_XDECREF(code);
+
+        return 0;
     }
-}
 
-#endif
+    return code;
+}
 
 static std::string
 makeNameScriptFriendlyInternal(const std::string& str,
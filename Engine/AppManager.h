@@ -153,6 +153,16 @@ public:
 
     bool isLoaded() const;
 
+    /**
+     * @brief True if --verbose was passed on the command-line, in which case the startup steps are timed.
+     **/
+    bool isVerbose() const;
+
+    /**
+     * @brief If verbose, prints the time taken by a startup step and the time since the application was created.
+     **/
+    void printStartupTime(const std::string& step, double seconds) const;
+
     AppInstancePtr newAppInstance(const CLArgs& cl, bool makeEmptyInstance);
     AppInstancePtr newBackgroundInstance(const CLArgs& cl, bool makeEmptyInstance);
 
@@ -498,6 +508,7 @@ public:
     OFX::Host::ImageEffect::Descriptor* getPluginContextAndDescribe(OFX::Host::ImageEffect::ImageEffectPlugin* plugin,
                                                                     ContextEnum* ctx);
     AppTLS* getAppTLS() const;
+    TaskScheduler* getTaskScheduler() const;
     const OfxHost* getOFXHost() const;
     GPUContextPool* getGPUContextPool() const;
 
@@ -775,7 +786,13 @@ PyObject* getMainModule();
 bool interpretPythonScript(const std::string& script, std::string* error, std::string* output);
 
 
-//void compilePyScript(const std::string& script,PyObject** code);
+/**
+ * @brief Compiles the given python script once so that it can be evaluated many times with PyEval_EvalCode.
+ * The GIL must be held.
+ * @param start Py_eval_input for a single expression, Py_file_input for a sequence of statements.
+ * @returns A new reference to the code object, or NULL if the script has a syntax error.
+ **/
+PyObject* compilePyScript(const std::string& script, int start);
 
 std::string PyStringToStdString(PyObject* obj);
 std::string makeNameScriptFriendlyWithDots(const std::string& str);
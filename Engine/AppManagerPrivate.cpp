@@ -114,6 +114,7 @@ AppManagerPrivate::AppManagerPrivate()
     , nThreadsToRender(0)
     , nThreadsPerEffect(0)
     , useThreadPool(true)
+    , taskScheduler()
     , nThreadsMutex()
     , runningThreadsCount()
     , lastProjectLoadedCreatedDuringRC2Or3(false)
@@ -137,6 +138,9 @@ AppManagerPrivate::AppManagerPrivate()
     , openGLFunctionsMutex()
     , renderingContextPool()
     , openGLRenderers()
+    , _qApp()
+    , verbose(false)
+    , startupTimer()
 {
     setMaxCacheFiles();
 
@@ -316,6 +320,14 @@ template <typename T>
 void
 saveCache(Cache<T>* cache)
 {
+    if ( !cache->isTileCache() ) {
+        // The disk portion is journaled as it changes: just move the entries stored on disk to it and compact the journal
+        cache->clearInMemoryPortion(false);
+        cache->compactJournal();
+
+        return;
+    }
+
     std::string cacheRestoreFilePath = cache->getRestoreFilePath();
     FStreamsSupport::ofstream ofile;
     FStreamsSupport::open(&ofile, cacheRestoreFilePath);
@@ -354,32 +366,48 @@ restoreCache(AppManagerPrivate* p,
              Cache<T>* cache)
 {
     if ( p->checkForCacheDiskStructure( cache->getCachePath(), cache->isTileCache() ) ) {
+        typename Cache<T>::CacheTOC tableOfContents;
         std::string settingsFilePath = cache->getRestoreFilePath();
-        FStreamsSupport::ifstream ifile;
-        FStreamsSupport::open(&ifile, settingsFilePath);
-        if (!ifile) {
-            std::cerr << "Failure to open cache restore file at: " << settingsFilePath << std::endl;
+        CacheJournal::ReadStatusEnum journalStatus = CacheJournal::eReadStatusMissing;
+        if ( !cache->isTileCache() ) {
+            journalStatus = cache->readJournal(&tableOfContents);
+            if (journalStatus == CacheJournal::eReadStatusInvalid) {
+                p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
+                cache->compactJournal();
 
-            return;
+                return;
+            }
         }
-        typename Cache<T>::CacheTOC tableOfContents;
-        unsigned int cacheVersion = 0x1; //< default to 1 before NATRON_CACHE_VERSION was introduced
-        try {
-            boost::archive::binary_iarchive iArchive(ifile);
-            if (cache->cacheVersion() >= NATRON_CACHE_VERSION) {
-                iArchive >> cacheVersion;
+
+        // Caches written before the journal was introduced only have a table of contents saved on exit
+        if (journalStatus == CacheJournal::eReadStatusMissing) {
+            FStreamsSupport::ifstream ifile;
+            FStreamsSupport::open(&ifile, settingsFilePath);
+            if (!ifile) {
+                std::cerr << "Failure to open cache restore file at: " << settingsFilePath << std::endl;
+                cache->compactJournal();
+
+                return;
             }
-            //Only load caches with same version, otherwise wipe it!
-            if ( cacheVersion == cache->cacheVersion() ) {
-                iArchive >> tableOfContents;
-            } else {
+            unsigned int cacheVersion = 0x1; //< default to 1 before NATRON_CACHE_VERSION was introduced
+            try {
+                boost::archive::binary_iarchive iArchive(ifile);
+                if (cache->cacheVersion() >= NATRON_CACHE_VERSION) {
+                    iArchive >> cacheVersion;
+                }
+                //Only load caches with same version, otherwise wipe it!
+                if ( cacheVersion == cache->cacheVersion() ) {
+                    iArchive >> tableOfContents;
+                } else {
+                    p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
+                }
+            } catch (const std::exception & e) {
+                qDebug() << "Exception when reading disk cache TOC:" << e.what();
                 p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
-            }
-        } catch (const std::exception & e) {
-            qDebug() << "Exception when reading disk cache TOC:" << e.what();
-            p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
+                cache->compactJournal();
 
-            return;
+                return;
+            }
         }
 
         QFile restoreFile( QString::fromUtf8( settingsFilePath.c_str() ) );
@@ -387,6 +415,9 @@ restoreCache(AppManagerPrivate* p,
 
         cache->restore(tableOfContents);
     }
+
+    // Start a new journal containing the restored entries
+    cache->compactJournal();
 }
 
 void
@@ -404,9 +435,11 @@ AppManagerPrivate::checkForCacheDiskStructure(const QString & cachePath, bool is
     if ( !settingsFilePath.endsWith( QChar::fromLatin1('/') ) ) {
         settingsFilePath += QChar::fromLatin1('/');
     }
+    QString journalFilePath = settingsFilePath + QString::fromUtf8("journal." NATRON_CACHE_FILE_EXT);
     settingsFilePath += QString::fromUtf8("restoreFile." NATRON_CACHE_FILE_EXT);
 
-    if ( !QFile::exists(settingsFilePath) ) {
+    // Non-tiled caches are journaled, the table of contents is only written by older versions
+    if ( !QFile::exists(settingsFilePath) && ( isTiled || !QFile::exists(journalFilePath) ) ) {
         cleanUpCacheDiskStructure(cachePath, isTiled);
 
         return false;
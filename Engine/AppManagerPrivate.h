@@ -60,6 +60,8 @@
 #include "Engine/GPUContextPool.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
 #include "Engine/TLSHolder.h"
+#include "Engine/ThreadPool.h"
+#include "Engine/Timer.h"
 
 // include breakpad after Engine, because it includes /usr/include/AssertMacros.h on OS X which defines a check(x) macro, which conflicts with boost
 #ifdef NATRON_USE_BREAKPAD
@@ -122,7 +124,8 @@ public:
     int idealThreadCount; // return value of QThread::idealThreadCount() cached here
     int nThreadsToRender; // the value held by the corresponding Knob in the Settings, stored here for faster access (3 RW lock vs 1 mutex here)
     int nThreadsPerEffect;  // the value held by the corresponding Knob in the Settings, stored here for faster access (3 RW lock vs 1 mutex here)
-    bool useThreadPool; // whether the multi-thread suite should use the global thread pool (of QtConcurrent) or not
+    bool useThreadPool; // whether the multi-thread suite should use the task scheduler or not
+    boost::scoped_ptr<TaskScheduler> taskScheduler; // runs the parallel loops of the renders, see ThreadPool.h
     mutable QMutex nThreadsMutex; // protects nThreadsToRender & nThreadsPerEffect & useThreadPool
 
     //The idea here is to keep track of the number of threads launched by Natron (except the ones of the global thread pool of QtConcurrent)
@@ -207,6 +210,10 @@ public:
     std::list<OpenGLRendererInfo> openGLRenderers;
     boost::scoped_ptr<QCoreApplication> _qApp;
 
+    // --verbose: time of the startup steps
+    bool verbose;
+    TimeLapse startupTimer;
+
 public:
     AppManagerPrivate();
 
@@ -0,0 +1,279 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "BufferPool.h"
+
+#include <cstdlib> // malloc, free, posix_memalign
+#include <map>
+#include <set>
+#include <vector>
+#include <new> // std::bad_alloc
+
+#ifdef __NATRON_LINUX__
+#include <sys/mman.h> // madvise
+#endif
+
+#include <QtCore/QMutex>
+
+#if defined(__NATRON_LINUX__) && defined(MADV_HUGEPAGE)
+#define NATRON_BUFFER_POOL_HAS_HUGE_PAGES
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct BufferPoolPrivate
+{
+    QMutex lock;
+
+    // The idle buffers of each size class
+    std::map<std::size_t, std::vector<void*> > idleBuffers;
+
+    // The buffers, used or idle, backed by huge pages
+    std::set<void*> hugePagesBuffers;
+    BufferPoolStats stats;
+    std::size_t maximumIdleSize;
+    bool hugePagesEnabled;
+
+    BufferPoolPrivate()
+        : lock()
+        , idleBuffers()
+        , hugePagesBuffers()
+        , stats()
+        , maximumIdleSize(NATRON_BUFFER_POOL_DEFAULT_MAX_IDLE_SIZE)
+        , hugePagesEnabled(false)
+    {
+    }
+};
+
+BufferPoolPrivate&
+getPool()
+{
+    // Never destroyed: buffers may be given back by static objects destroyed after this one would be
+    static BufferPoolPrivate* pool = new BufferPoolPrivate;
+
+    return *pool;
+}
+
+std::size_t
+getSizeClass(std::size_t size)
+{
+    return ( (size + NATRON_BUFFER_POOL_SIZE_CLASS_GRANULARITY - 1) / NATRON_BUFFER_POOL_SIZE_CLASS_GRANULARITY ) * NATRON_BUFFER_POOL_SIZE_CLASS_GRANULARITY;
+}
+
+// Must be called with the lock held, the buffer is freed after the lock is released
+void
+removeHugePagesBuffer(BufferPoolPrivate& pool,
+                      void* buffer,
+                      std::size_t sizeClass)
+{
+    std::set<void*>::iterator found = pool.hugePagesBuffers.find(buffer);
+
+    if ( found != pool.hugePagesBuffers.end() ) {
+        pool.hugePagesBuffers.erase(found);
+        pool.stats.hugePagesSize -= sizeClass;
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void*
+BufferPool::allocate(std::size_t size)
+{
+    if (size < NATRON_BUFFER_POOL_MIN_SIZE) {
+        void* ret = std::malloc(size);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+
+        return ret;
+    }
+
+    BufferPoolPrivate& pool = getPool();
+    const std::size_t sizeClass = getSizeClass(size);
+    bool hugePages = false;
+    {
+        QMutexLocker k(&pool.lock);
+        std::map<std::size_t, std::vector<void*> >::iterator found = pool.idleBuffers.find(sizeClass);
+        if ( ( found != pool.idleBuffers.end() ) && !found->second.empty() ) {
+            // Reuse the most recently freed buffer, it is the most likely to still be in the CPU caches
+            void* ret = found->second.back();
+            found->second.pop_back();
+            pool.stats.idleSize -= sizeClass;
+            pool.stats.usedSize += sizeClass;
+            ++pool.stats.nReused;
+
+            return ret;
+        }
+        hugePages = pool.hugePagesEnabled && sizeClass >= NATRON_BUFFER_POOL_HUGE_PAGE_SIZE;
+    }
+
+    void* ret = 0;
+#ifdef NATRON_BUFFER_POOL_HAS_HUGE_PAGES
+    if (hugePages) {
+        if (posix_memalign(&ret, NATRON_BUFFER_POOL_HUGE_PAGE_SIZE, sizeClass) != 0) {
+            ret = 0;
+        } else {
+            // Only a hint: the kernel falls back on regular pages if it cannot find huge ones
+            madvise(ret, sizeClass, MADV_HUGEPAGE);
+        }
+    } else
+#endif
+    {
+        ret = std::malloc(sizeClass);
+    }
+    if (!ret) {
+        // Give back what the pool holds and try again
+        releaseIdleMemory( (std::size_t)-1 );
+        ret = std::malloc(sizeClass);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+        hugePages = false;
+    }
+
+    QMutexLocker k(&pool.lock);
+    pool.stats.usedSize += sizeClass;
+    ++pool.stats.nAllocated;
+    if (hugePages) {
+        pool.hugePagesBuffers.insert(ret);
+        pool.stats.hugePagesSize += sizeClass;
+    }
+
+    return ret;
+} // BufferPool::allocate
+
+void
+BufferPool::deallocate(void* buffer,
+                       std::size_t size)
+{
+    if (!buffer) {
+        return;
+    }
+    if (size < NATRON_BUFFER_POOL_MIN_SIZE) {
+        std::free(buffer);
+
+        return;
+    }
+
+    BufferPoolPrivate& pool = getPool();
+    const std::size_t sizeClass = getSizeClass(size);
+    {
+        QMutexLocker k(&pool.lock);
+        pool.stats.usedSize -= sizeClass;
+        if (pool.stats.idleSize + sizeClass <= pool.maximumIdleSize) {
+            pool.idleBuffers[sizeClass].push_back(buffer);
+            pool.stats.idleSize += sizeClass;
+
+            return;
+        }
+        removeHugePagesBuffer(pool, buffer, sizeClass);
+    }
+    std::free(buffer);
+}
+
+std::size_t
+BufferPool::releaseIdleMemory(std::size_t size)
+{
+    BufferPoolPrivate& pool = getPool();
+    std::vector<void*> toFree;
+    std::size_t released = 0;
+    {
+        QMutexLocker k(&pool.lock);
+        // Release the largest buffers first, they are the least likely to be reused
+        std::map<std::size_t, std::vector<void*> >::reverse_iterator it = pool.idleBuffers.rbegin();
+        while ( released < size && it != pool.idleBuffers.rend() ) {
+            while ( released < size && !it->second.empty() ) {
+                void* buffer = it->second.back();
+                it->second.pop_back();
+                removeHugePagesBuffer(pool, buffer, it->first);
+                pool.stats.idleSize -= it->first;
+                released += it->first;
+                toFree.push_back(buffer);
+            }
+            ++it;
+        }
+    }
+    for (std::vector<void*>::const_iterator it = toFree.begin(); it != toFree.end(); ++it) {
+        std::free(*it);
+    }
+
+    return released;
+}
+
+void
+BufferPool::setMaximumIdleSize(std::size_t size)
+{
+    std::size_t idleSize;
+    {
+        BufferPoolPrivate& pool = getPool();
+        QMutexLocker k(&pool.lock);
+        pool.maximumIdleSize = size;
+        idleSize = pool.stats.idleSize;
+    }
+    if (idleSize > size) {
+        releaseIdleMemory(idleSize - size);
+    }
+}
+
+std::size_t
+BufferPool::getIdleSize()
+{
+    BufferPoolPrivate& pool = getPool();
+    QMutexLocker k(&pool.lock);
+
+    return pool.stats.idleSize;
+}
+
+void
+BufferPool::setHugePagesEnabled(bool enabled)
+{
+    BufferPoolPrivate& pool = getPool();
+    QMutexLocker k(&pool.lock);
+
+    pool.hugePagesEnabled = enabled && isHugePagesSupported();
+}
+
+bool
+BufferPool::isHugePagesSupported()
+{
+#ifdef NATRON_BUFFER_POOL_HAS_HUGE_PAGES
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+BufferPool::getStats(BufferPoolStats* stats)
+{
+    BufferPoolPrivate& pool = getPool();
+    QMutexLocker k(&pool.lock);
+
+    *stats = pool.stats;
+}
+
+NATRON_NAMESPACE_EXIT
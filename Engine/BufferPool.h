@@ -0,0 +1,113 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_BufferPool_h
+#define Natron_Engine_BufferPool_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef> // std::size_t
+
+#include "Global/GlobalDefines.h"
+
+// Buffers smaller than this are not pooled
+#define NATRON_BUFFER_POOL_MIN_SIZE (64 * 1024)
+
+// Pooled buffer sizes are rounded up to a multiple of this, so that buffers of about the same size share a class
+#define NATRON_BUFFER_POOL_SIZE_CLASS_GRANULARITY (64 * 1024)
+
+// Size classes at least this large may be backed by transparent huge pages
+#define NATRON_BUFFER_POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// The default maximum amount of memory kept by the pool in freed buffers
+#define NATRON_BUFFER_POOL_DEFAULT_MAX_IDLE_SIZE (512 * 1024 * 1024)
+
+NATRON_NAMESPACE_ENTER
+
+struct BufferPoolStats
+{
+    std::size_t usedSize; // bytes in buffers handed out by the pool
+    std::size_t idleSize; // bytes in freed buffers kept for reuse
+    std::size_t hugePagesSize; // bytes, used or idle, in buffers backed by huge pages
+    U64 nReused; // allocations served by an idle buffer
+    U64 nAllocated; // allocations that went to the system
+
+    BufferPoolStats()
+        : usedSize(0)
+        , idleSize(0)
+        , hugePagesSize(0)
+        , nReused(0)
+        , nAllocated(0)
+    {
+    }
+};
+
+/**
+ * @brief The allocator of the image buffers (@see RamBuffer).
+ * During playback and tile rendering, many buffers of the same size are allocated and freed in a row:
+ * instead of going back to the system, which fragments the heap, freed buffers are kept in
+ * per-size-class free lists and handed out again to the next allocation of the same class.
+ * The memory kept idle is bounded by setMaximumIdleSize(), and the caches release it before evicting entries.
+ * All functions are thread-safe.
+ **/
+class BufferPool
+{
+public:
+
+    /**
+     * @brief Returns a buffer of at least size bytes. Throws std::bad_alloc on failure.
+     **/
+    static void* allocate(std::size_t size);
+
+    /**
+     * @brief Gives back a buffer returned by allocate(), size must be the one passed to allocate().
+     **/
+    static void deallocate(void* buffer, std::size_t size);
+
+    /**
+     * @brief Frees idle buffers until at least size bytes were released, or no idle buffer is left.
+     * Returns the number of bytes released.
+     **/
+    static std::size_t releaseIdleMemory(std::size_t size);
+
+    static void setMaximumIdleSize(std::size_t size);
+
+    static std::size_t getIdleSize();
+
+    /**
+     * @brief When enabled, the buffers of the size classes larger than a huge page are aligned on
+     * huge pages and advised to be backed by transparent huge pages. Only implemented on Linux.
+     * It affects buffers allocated from now on.
+     **/
+    static void setHugePagesEnabled(bool enabled);
+
+    static bool isHugePagesSupported();
+
+    static void getStats(BufferPoolStats* stats);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Natron_Engine_BufferPool_h
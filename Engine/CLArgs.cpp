@@ -62,11 +62,14 @@ public:
     bool useDefaultSettings;
     bool clearCacheOnLaunch;
     QString ipcPipe;
+    QString renderServerName;
     int error;
     bool isInterpreterMode;
     std::list<std::pair<int, std::pair<int, int> > > frameRanges;
     bool rangeSet;
     bool enableRenderStats;
+    bool parallelWriters;
+    bool verbose;
     bool isEmpty;
     mutable QString imageFilename;
     QString breakpadPipeFilePath;
@@ -89,11 +92,14 @@ public:
         , useDefaultSettings(false)
         , clearCacheOnLaunch(false)
         , ipcPipe()
+        , renderServerName()
         , error(0)
         , isInterpreterMode(false)
         , frameRanges()
         , rangeSet(false)
         , enableRenderStats(false)
+        , parallelWriters(false)
+        , verbose(false)
         , isEmpty(true)
         , imageFilename()
         , breakpadPipeFilePath()
@@ -225,11 +231,14 @@ CLArgs::operator=(const CLArgs& other)
     _imp->settingCommands = other._imp->settingCommands;
     _imp->isBackground = other._imp->isBackground;
     _imp->ipcPipe = other._imp->ipcPipe;
+    _imp->renderServerName = other._imp->renderServerName;
     _imp->error = other._imp->error;
     _imp->isInterpreterMode = other._imp->isInterpreterMode;
     _imp->frameRanges = other._imp->frameRanges;
     _imp->rangeSet = other._imp->rangeSet;
     _imp->enableRenderStats = other._imp->enableRenderStats;
+    _imp->parallelWriters = other._imp->parallelWriters;
+    _imp->verbose = other._imp->verbose;
     _imp->isEmpty = other._imp->isEmpty;
     _imp->imageFilename = other._imp->imageFilename;
     _imp->exportDocsPath = other._imp->exportDocsPath;
@@ -284,6 +293,9 @@ CLArgs::printUsage(const std::string& programName)
         "    init.py script is loaded.\n"
         "  --clear-cache\n"
         "    Clears the cache on startup.\n"
+        "  --verbose\n"
+        "    Print the time taken by each step of the startup, such as loading\n"
+        "    the OpenFX plug-ins and their cache.\n"
         "  --no-settings\n"
         "    When passed on the command-line, the %1 settings will not be restored\n"
         "    from the preferences file on disk so that %1 uses the default ones.\n"
@@ -340,7 +352,25 @@ CLArgs::printUsage(const std::string& programName)
         "     breakdown contains information about each nodes, render times etc...\n"
         "     This option is useful for debugging purposes or to control that a render\n"
         "     is working correctly.\n"
-        "     **Please note** that it does not work when writing video files."
+        "     **Please note** that it does not work when writing video files.\n"
+        "  --parallel-writers\n"
+        "    Render all the Write nodes at the same time, frame by frame, so that the\n"
+        "    nodes they share are only computed once per frame and read from the cache\n"
+        "    by the other Write nodes. With -s, the work that was shared is reported.\n"
+        "  --server <name>\n"
+        "    Keep the project loaded after startup and serve render jobs on the local\n"
+        "    socket <name> instead of rendering and exiting. Each job is a line:\n"
+        "      render <frameRange> [<Writer node script name> ...]\n"
+        "        Render the given frames (same syntax as for -w) with the named\n"
+        "        writers, or all the writers of the project. Replies \"done\".\n"
+        "      load <project file path>\n"
+        "        Render subsequent jobs from another project. Replies \"ok\".\n"
+        "      quit\n"
+        "        Stop the server. Replies \"bye\".\n"
+        "    The project is reloaded only when the content of its file changed, so\n"
+        "    that consecutive jobs share the loaded plug-ins and the image cache.\n"
+        "    Errors are reported as \"error <message>\".\n"
+        "    It cannot be combined with -w, -i, -o or a frame range.\n"
         "Sample uses:\n"
         "  %1 /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "  %1 -b -w MyWriter /Users/Me/MyNatronProjects/MyProject.ntp\n"
@@ -348,6 +378,7 @@ CLArgs::printUsage(const std::string& programName)
         "  %1Renderer -w MyWriter /FastDisk/Pictures/sequence'###'.exr 1-100 /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "  %1Renderer -w MyWriter -w MySecondWriter 1-10 /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "  %1Renderer -w MyWriter 1-10 -l /Users/Me/Scripts/onProjectLoaded.py /Users/Me/MyNatronProjects/MyProject.ntp\n"
+        "  %1Renderer --server MyRenderSlot /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "\n"
         /* Text must hold in 80 columns ************************************************/
         "Options for the execution of Python scripts:\n"
@@ -513,12 +544,30 @@ CLArgs::getIPCPipeName() const
     return _imp->ipcPipe;
 }
 
+const QString&
+CLArgs::getRenderServerName() const
+{
+    return _imp->renderServerName;
+}
+
 bool
 CLArgs::areRenderStatsEnabled() const
 {
     return _imp->enableRenderStats;
 }
 
+bool
+CLArgs::areWritersRenderedInParallel() const
+{
+    return _imp->parallelWriters;
+}
+
+bool
+CLArgs::isVerbose() const
+{
+    return _imp->verbose;
+}
+
 bool
 CLArgs::isPythonScript() const
 {
@@ -730,6 +779,15 @@ tryParseMultipleFrameRanges(const QString& args,
     return added;
 }
 
+bool
+CLArgs::parseFrameRanges(const QString& str,
+                         std::list<std::pair<int, std::pair<int, int> > >* frameRanges)
+{
+    assert(frameRanges);
+
+    return tryParseMultipleFrameRanges(str, *frameRanges);
+}
+
 void
 CLArgsPrivate::parse()
 {
@@ -765,6 +823,14 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("verbose"), QString() );
+        if ( it != args.end() ) {
+            verbose = true;
+            args.erase(it);
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8("no-settings"), QString() );
         if ( it != args.end() ) {
@@ -800,6 +866,14 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("parallel-writers"), QString() );
+        if ( it != args.end() ) {
+            parallelWriters = true;
+            args.erase(it);
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8(NATRON_BREAKPAD_PROCESS_PID), QString() );
         if ( it != args.end() ) {
@@ -912,6 +986,22 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("server"), QString() );
+        if ( it != args.end() ) {
+            ++it;
+            if ( it != args.end() ) {
+                renderServerName = *it;
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the render server name").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8("onload"), QString::fromUtf8("l") );
         if ( it != args.end() ) {
@@ -1227,6 +1317,28 @@ CLArgsPrivate::parse()
 
         return;
     }
+
+    // Each render job names its writers and frames, and a project reloaded by the server would lose the reader filenames
+    if ( !renderServerName.isEmpty() ) {
+        if ( !writers.empty() ) {
+            std::cout << tr("You cannot use the -w or -o options with --server: each render job names the Write nodes it renders").toStdString() << std::endl;
+            error = 1;
+
+            return;
+        }
+        if (rangeSet) {
+            std::cout << tr("You cannot specify a frame range with --server: each render job specifies the frames it renders").toStdString() << std::endl;
+            error = 1;
+
+            return;
+        }
+        if ( !readers.empty() ) {
+            std::cout << tr("You cannot use the -i option with --server").toStdString() << std::endl;
+            error = 1;
+
+            return;
+        }
+    }
 } // CLArgsPrivate::parse
 
 void
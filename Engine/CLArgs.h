@@ -135,10 +135,25 @@ public:
     const QString& getDefaultOnProjectLoadedScript() const;
     const QString& getIPCPipeName() const;
 
+    /*
+     * @brief Name of the local socket on which render jobs are served (--server), empty if not a render server.
+     */
+    const QString& getRenderServerName() const;
+
     bool isPythonScript() const;
 
     bool areRenderStatsEnabled() const;
 
+    /*
+     * @brief Should the Write nodes be rendered frame-interleaved (--parallel-writers) ?
+     */
+    bool areWritersRenderedInParallel() const;
+
+    /*
+     * @brief Should the time taken by each startup step be printed ?
+     */
+    bool isVerbose() const;
+
     const QString& getBreakpadProcessExecutableFilePath() const;
 
     qint64 getBreakpadProcessPID() const;
@@ -149,6 +164,12 @@ public:
     const QString& getBreakpadComPipeFilePath() const;
     const QString& getExportDocsPath() const;
 
+    /*
+     * @brief Parses frame ranges in the command-line syntax, e.g: 1-10:2,20,30-40
+     * @returns True if at least one range was parsed.
+     */
+    static bool parseFrameRanges(const QString& str, std::list<std::pair<int, std::pair<int, int> > >* frameRanges);
+
 private:
 
     boost::scoped_ptr<CLArgsPrivate> _imp;
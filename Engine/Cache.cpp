@@ -28,7 +28,19 @@
 #include <cassert>
 #include <stdexcept>
 
+#include "Engine/CacheSerialization.h"
+#include "Engine/FrameEntry.h"
+#include "Engine/Image.h"
+
 NATRON_NAMESPACE_ENTER
+
+// The journal is updated by code that only includes Cache.h: instantiate the journaling here, where
+// the serialization of the entries is available.
+template void Cache<Image>::appendEntryToJournal(const Cache<Image>::EntryTypePtr& entry) const;
+template void Cache<FrameEntry>::appendEntryToJournal(const Cache<FrameEntry>::EntryTypePtr& entry) const;
+template void Cache<Image>::compactJournal();
+template void Cache<FrameEntry>::compactJournal();
+
 NATRON_NAMESPACE_EXIT
 
 NATRON_NAMESPACE_USING
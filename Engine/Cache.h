@@ -51,14 +51,18 @@ GCC_DIAG_OFF(deprecated)
 #include <QtCore/QObject>
 #include <QtCore/QBuffer>
 #include <QtCore/QRunnable>
+#include <QtCore/QAtomicInt>
 GCC_DIAG_ON(deprecated)
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/atomic.hpp>
 #endif
 
 #include "Engine/AppManager.h" //for access to settings
 #include "Engine/CacheEntry.h"
+#include "Engine/CacheJournal.h"
 #include "Engine/ImageLocker.h"
 #include "Engine/LRUHashTable.h"
 #include "Engine/MemoryInfo.h" // getSystemTotalRAM
@@ -465,24 +469,49 @@ public:
 
 private:
 
+    /**
+     * @brief A shard owns the entries of the cache whose hash falls in its partition.
+     * Each shard has its own LRU containers and its own locks, so that threads looking up
+     * entries of different shards do not contend with each other.
+     * With a single shard, the cache behaves exactly like a single LRU protected by one lock.
+     **/
+    struct CacheShard
+    {
+        mutable QMutex lock; //protects memoryCache & diskCache
+        mutable QMutex getLock;  //prevents get() and getOrCreate() to be called simultaneously for entries of this shard
+
+        /*These 2 are mutable because we need to modify the LRU list even
+             when we call get() and we want this function to be const.*/
+        mutable CacheContainer memoryCache;
+        mutable CacheContainer diskCache;
+
+        CacheShard()
+            : lock()
+            , getLock()
+            , memoryCache()
+            , diskCache()
+        {
+        }
+    };
+
 
     std::size_t _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
     std::size_t _maximumCacheSize;     // maximum size allowed for the cache
 
     /*mutable because we need to change modify it in the sealEntryInternal function which
          is called by an external object that have a const ref to the cache.
+       These are atomics so that the size accounting done by entries does not serialize on a lock.
      */
-    mutable std::size_t _memoryCacheSize;     // current size of the cache in bytes
-    mutable std::size_t _diskCacheSize;
-    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize
-    mutable QMutex _lock; //protects _memoryCache & _diskCache
-    mutable QMutex _getLock;  //prevents get() and getOrCreate() to be called simultaneously
+    mutable boost::atomic<std::size_t> _memoryCacheSize;     // current size of the cache in bytes
+    mutable boost::atomic<std::size_t> _diskCacheSize;
+    mutable QMutex _sizeLock; // protects _maximumInMemorySize & _maximumCacheSize and _memoryFullCondition
 
+    // The entries of the cache are hash-partitioned across these shards
+    const std::size_t _nShards;
+    boost::scoped_array<CacheShard> _shards;
 
-    /*These 2 are mutable because we need to modify the LRU list even
-         when we call get() and we want this function to be const.*/
-    mutable CacheContainer _memoryCache;
-    mutable CacheContainer _diskCache;
+    // Index of the next shard to evict from, see tryEvictInMemoryEntry()
+    mutable QAtomicInt _evictionCursor;
     const std::string _cacheName;
     const unsigned int _version;
 
@@ -493,6 +522,11 @@ private:
     ///Store the system physical total RAM in a member
     std::size_t _maxPhysicalRAM;
     bool _tearingDown;
+
+    // Log of the disk portion, updated as entries are moved to it or removed from the disk. Declared before
+    // the threads so that it outlives entries they destroy.
+    // Only used for non-tiled caches: tiles of the disk portion are freed and may be reused at any time.
+    mutable CacheJournal _journal;
     mutable DeleterThread<EntryType> _deleterThread;
     mutable QWaitCondition _memoryFullCondition; //< protected by _sizeLock
     mutable CacheCleanerThread _cleanerThread;
@@ -518,7 +552,8 @@ public:
     Cache(const std::string & cacheName,
           unsigned int version,
           U64 maximumCacheSize,      // total size
-          double maximumInMemoryPercentage //how much should live in RAM
+          double maximumInMemoryPercentage, //how much should live in RAM
+          std::size_t nShards = 1 // in how many partitions the entries are split, each having its own lock
           )
         : CacheAPI()
         , _maximumInMemorySize(maximumCacheSize * maximumInMemoryPercentage)
@@ -526,15 +561,15 @@ public:
         , _memoryCacheSize(0)
         , _diskCacheSize(0)
         , _sizeLock()
-        , _lock()
-        , _getLock()
-        , _memoryCache()
-        , _diskCache()
+        , _nShards( std::max( (std::size_t)1, std::min( (std::size_t)NATRON_CACHE_MAX_SHARDS, nShards ) ) )
+        , _shards()
+        , _evictionCursor(0)
         , _cacheName(cacheName)
         , _version(version)
         , _signalEmitter()
         , _maxPhysicalRAM( getSystemTotalRAM() )
         , _tearingDown(false)
+        , _journal()
         , _deleterThread(this)
         , _memoryFullCondition()
         , _cleanerThread(this)
@@ -546,16 +581,18 @@ public:
         , _nextAvailableCacheFile()
         , _nextAvailableCacheFileIndex(-1)
     {
+        _shards.reset(new CacheShard[_nShards]);
         _signalEmitter = boost::make_shared<CacheSignalEmitter>();
     }
 
     virtual ~Cache()
     {
-        QMutexLocker locker(&_lock);
-
         _tearingDown = true;
-        _memoryCache.clear();
-        _diskCache.clear();
+        for (std::size_t i = 0; i < _nShards; ++i) {
+            QMutexLocker locker(&_shards[i].lock);
+            _shards[i].memoryCache.clear();
+            _shards[i].diskCache.clear();
+        }
     }
 
     virtual bool isTileCache() const OVERRIDE FINAL
@@ -582,6 +619,11 @@ public:
         _tileByteSize = tileByteSize;
     }
 
+    // const data member: no need to take the lock
+    std::size_t getNumShards() const
+    {
+        return _nShards;
+    }
 
     void waitForDeleterThread()
     {
@@ -603,18 +645,47 @@ public:
     bool get(const typename EntryType::key_type & key,
              std::list<EntryTypePtr>* returnValue) const
     {
-        ///Be atomic, so it cannot be created by another thread in the meantime
-        QMutexLocker getlocker(&_getLock);
+        CacheShard& shard = getShard( key.getHash() );
+        bool ret;
+        bool reopenedFromDisk = false;
+        {
+            ///Be atomic, so it cannot be created by another thread in the meantime
+            QMutexLocker getlocker(&shard.getLock);
 
-        ///lock the cache before reading it.
-        QMutexLocker locker(&_lock);
+            ///lock the shard before reading it.
+            QMutexLocker locker(&shard.lock);
 
-        return getInternal(key, returnValue);
+            ret = getInternal(shard, key, returnValue, &reopenedFromDisk);
+        }
+        if (reopenedFromDisk) {
+            evictInMemoryEntriesToFit();
+        }
+
+        return ret;
     } // get
 
 private:
 
+    static void subtractClamped(boost::atomic<std::size_t>& value,
+                                std::size_t amount)
+    {
+        ///Avoid overflows, the size may not always fallback to 0
+        std::size_t cur = value.load(boost::memory_order_relaxed);
+
+        while ( !value.compare_exchange_weak(cur, amount > cur ? 0 : cur - amount, boost::memory_order_relaxed) ) {
+        }
+    }
 
+    CacheShard& getShard(hash_type hash) const
+    {
+        // Hash keys are already well distributed, folding the high bits is enough to pick a shard
+        return _shards[ (std::size_t)( hash ^ (hash >> 32) ) % _nShards ];
+    }
+
+    std::size_t nextEvictionShard() const
+    {
+        return (std::size_t)( (unsigned int)_evictionCursor.fetchAndAddRelaxed(1) ) % _nShards;
+    }
 
     virtual TileCacheFilePtr getTileCacheFile(const std::string& filepath, std::size_t dataOffset) OVERRIDE FINAL WARN_UNUSED_RETURN
     {
@@ -772,12 +843,13 @@ private:
     }
 
 
-    void createInternal(const typename EntryType::key_type & key,
+    void createInternal(CacheShard& shard,
+                        const typename EntryType::key_type & key,
                         const ParamsTypePtr & params,
                         ImageLockerHelper<EntryType>* entryLocker,
                         EntryTypePtr* returnValue) const
     {
-        //_lock must not be taken here
+        //shard.lock must not be taken here
 
         ///Before allocating the memory check that there's enough space to fit in memory
         appPTR->checkCacheFreeMemoryIsGoodEnough();
@@ -799,11 +871,10 @@ private:
         U64 memoryCacheSize, maximumInMemorySize;
         {
             QMutexLocker k(&_sizeLock);
-            memoryCacheSize = _memoryCacheSize;
+            memoryCacheSize = _memoryCacheSize.load();
             maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
         }
         {
-            QMutexLocker locker(&_lock);
             std::list<EntryTypePtr> entriesToBeDeleted;
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             ///While the current cache size can't fit the new entry, erase the last recently used entries.
@@ -834,24 +905,23 @@ private:
         {
             //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
             QMutexLocker k(&_sizeLock);
-            double occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+            double occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize.load() / _maximumCacheSize;
 
             //_memoryCacheSize member will get updated while images are being destroyed by the parallel thread.
             //we wait for cache memory occupation to be < 100% to be sure we don't hit swap here
             while ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
                 _memoryFullCondition.wait(&_sizeLock);
-                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize.load() / _maximumCacheSize;
             }
         }
         if (_isTiled) {
 
-            QMutexLocker locker(&_lock);
             // For tiled caches, we insert directly into the disk cache, so make sure there is room for it
             std::list<EntryTypePtr> entriesToBeDeleted;
             U64 diskCacheSize, maximumDiskCacheSize;
             {
                 QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
+                diskCacheSize = _diskCacheSize.load();
                 maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
             }
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
@@ -878,7 +948,7 @@ private:
 
         }
         {
-            QMutexLocker locker(&_lock);
+            QMutexLocker locker(&shard.lock);
 
             try {
                 returnValue->reset( new EntryType(key, params, this ) );
@@ -897,7 +967,7 @@ private:
                 if (entryLocker) {
                     entryLocker->lock(*returnValue);
                 }
-                sealEntry(*returnValue, _isTiled ? false : true);
+                sealEntry(shard, *returnValue, _isTiled ? false : true);
             }
         }
     } // createInternal
@@ -907,13 +977,14 @@ public:
     void swapOrInsert(const EntryTypePtr& entryToBeEvicted,
                       const EntryTypePtr& newEntry)
     {
-        QMutexLocker locker(&_lock);
-
         const typename EntryType::key_type& key = entryToBeEvicted->getKey();
         typename EntryType::hash_type hash = entryToBeEvicted->getHashKey();
+        CacheShard& shard = getShard(hash);
+        QMutexLocker locker(&shard.lock);
+
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache(hash);
-        if ( memoryCached != _memoryCache.end() ) {
+        CacheIterator memoryCached = shard.memoryCache(hash);
+        if ( memoryCached != shard.memoryCache.end() ) {
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
             for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( ( (*it)->getKey() == key ) && ( (*it)->getParams() == entryToBeEvicted->getParams() ) ) {
@@ -925,8 +996,8 @@ public:
             ret.push_back(newEntry);
         } else {
             ///Look in disk cache
-            CacheIterator diskCached = _diskCache(hash);
-            if ( diskCached != _diskCache.end() ) {
+            CacheIterator diskCached = shard.diskCache(hash);
+            if ( diskCached != shard.diskCache.end() ) {
                 ///Remove the old entry
                 std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
@@ -937,7 +1008,7 @@ public:
                 }
             }
             ///Insert in mem cache
-            _memoryCache.insert(hash, newEntry);
+            shard.memoryCache.insert(hash, newEntry);
         }
     }
 
@@ -975,15 +1046,20 @@ public:
     {
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
+        CacheShard& shard = getShard( key.getHash() );
 
         {
             ///Be atomic, so it cannot be created by another thread in the meantime
-            QMutexLocker getlocker(&_getLock);
+            QMutexLocker getlocker(&shard.getLock);
             std::list<EntryTypePtr> entries;
             bool didGetSucceed;
+            bool reopenedFromDisk = false;
             {
-                QMutexLocker locker(&_lock);
-                didGetSucceed = getInternal(key, &entries);
+                QMutexLocker locker(&shard.lock);
+                didGetSucceed = getInternal(shard, key, &entries, &reopenedFromDisk);
+            }
+            if (reopenedFromDisk) {
+                evictInMemoryEntriesToFit();
             }
             if (didGetSucceed) {
                 for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
@@ -995,7 +1071,7 @@ public:
                 }
             }
 
-            createInternal(key, params, locker, returnValue);
+            createInternal(shard, key, params, locker, returnValue);
 
             return false;
         } // getlocker
@@ -1017,13 +1093,16 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
-                evictedFromMemory.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _nShards; ++i) {
+            CacheShard& shard = _shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
+                    evictedFromMemory.second->removeAnyBackingFile();
+                }
+                evictedFromMemory = shard.memoryCache.evict();
             }
-            evictedFromMemory = _memoryCache.evict();
         }
 
         if (_signalEmitter) {
@@ -1047,19 +1126,22 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-
-        /// An entry which has a use_count greater than 1 is not removable:
-        /// The backing file must not be removed because it might be read/written to
-        /// at the same time. The best we can do is just let it here in the cache.
-        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        while (evictedFromDisk.second) {
-            if (!_isTiled) {
-                evictedFromDisk.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _nShards; ++i) {
+            CacheShard& shard = _shards[i];
+            QMutexLocker locker(&shard.lock);
+
+            /// An entry which has a use_count greater than 1 is not removable:
+            /// The backing file must not be removed because it might be read/written to
+            /// at the same time. The best we can do is just let it here in the cache.
+            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            while (evictedFromDisk.second) {
+                if (!_isTiled) {
+                    evictedFromDisk.second->removeAnyBackingFile();
+                }
+                evictedFromDisk = shard.diskCache.evict();
             }
-            evictedFromDisk = _diskCache.evict();
         }
 
 
@@ -1076,51 +1158,50 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            // Move back the entry on disk if it can be store on disk
-            // For tiled caches, the tile is sharing the same file with other entries
-            // so we cannot close it, just remove the entry
-            if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
-                evictedFromMemory.second->deallocate();
-                /*insert it back into the disk portion */
-
-                U64 diskCacheSize, maximumCacheSize;
-                {
-                    QMutexLocker k(&_sizeLock);
-                    diskCacheSize = _diskCacheSize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
-
-                /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-                while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
-                    {
-                        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-                        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-                        //we'll let the user of these entries purge the extra entries left in the cache later on
-                        if (!evictedFromDisk.second) {
-                            break;
+        for (std::size_t i = 0; i < _nShards; ++i) {
+            CacheShard& shard = _shards[i];
+            std::list<EntryTypePtr> movedToDisk;
+            {
+                QMutexLocker locker(&shard.lock);
+                std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+                while (evictedFromMemory.second) {
+                    // Move back the entry on disk if it can be store on disk
+                    // For tiled caches, the tile is sharing the same file with other entries
+                    // so we cannot close it, just remove the entry
+                    if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
+                        evictedFromMemory.second->deallocate();
+
+                        /*insert it back into the disk portion */
+                        CacheIterator existingDiskCacheEntry = shard.diskCache( evictedFromMemory.second->getHashKey() );
+                        /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                        if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                            shard.diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
                         }
-                        ///Erase the file from the disk if we reach the limit.
-                        evictedFromDisk.second->removeAnyBackingFile();
-                    }
-                    {
-                        QMutexLocker k(&_sizeLock);
-                        diskCacheSize = _diskCacheSize;
-                        maximumCacheSize = _maximumCacheSize;
+                        movedToDisk.push_back(evictedFromMemory.second);
                     }
-                }
 
-                /*update the disk cache size*/
-                CacheIterator existingDiskCacheEntry = _diskCache( evictedFromMemory.second->getHashKey() );
-                /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-                if ( existingDiskCacheEntry == _diskCache.end() ) {
-                    _diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
+                    evictedFromMemory = shard.memoryCache.evict();
                 }
             }
 
-            evictedFromMemory = _memoryCache.evict();
+            // Journal out of the shard lock: each record is flushed to the disk
+            for (typename std::list<EntryTypePtr>::const_iterator it = movedToDisk.begin(); it != movedToDisk.end(); ++it) {
+                appendEntryToJournal(*it);
+            }
+            bool hasMovedToDisk = !movedToDisk.empty();
+            // Entries in use cannot be evicted
+            movedToDisk.clear();
+
+            /*we need to clear the disk cache if it exceeds the maximum size allowed*/
+            if (hasMovedToDisk) {
+                std::size_t maximumCacheSize;
+                {
+                    QMutexLocker k(&_sizeLock);
+                    maximumCacheSize = _maximumCacheSize;
+                }
+                std::list<EntryTypePtr> entriesToBeDeleted;
+                evictDiskEntriesToFit(maximumCacheSize, entriesToBeDeleted);
+            }
         }
 
         _signalEmitter->blockSignals(false);
@@ -1136,11 +1217,10 @@ public:
         std::list<EntryTypePtr> entriesToBeDeleted;
 
         {
-            QMutexLocker locker(&_lock);
             U64 memoryCacheSize, maximumInMemorySize;
             {
                 QMutexLocker k(&_sizeLock);
-                memoryCacheSize = _memoryCacheSize;
+                memoryCacheSize = _memoryCacheSize.load();
                 maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
             }
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
@@ -1162,7 +1242,7 @@ public:
             U64 diskCacheSize, maximumDiskCacheSize;
             {
                 QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
+                diskCacheSize = _diskCacheSize.load();
                 maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
             }
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
@@ -1178,7 +1258,7 @@ public:
                 }
                 diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             }
-            
+
 
         }
     }
@@ -1190,15 +1270,18 @@ public:
      **/
     void getCopy(std::list<EntryTypePtr>* copy) const
     {
-        QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _nShards; ++i) {
+            CacheShard& shard = _shards[i];
+            QMutexLocker locker(&shard.lock);
 
-        for (CacheIterator it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
-        }
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
+            for (CacheIterator it = shard.memoryCache.begin(); it != shard.memoryCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
+            for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
         }
     }
 
@@ -1212,13 +1295,8 @@ public:
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         std::list<EntryTypePtr> entriesToBeDeleted;
-        bool ret;
-        {
-            QMutexLocker locker(&_lock);
-            ret = tryEvictInMemoryEntry(entriesToBeDeleted);
-        }
 
-        return ret;
+        return tryEvictInMemoryEntry(entriesToBeDeleted);
     }
 
     /**
@@ -1228,9 +1306,8 @@ public:
      **/
     bool evictLRUDiskEntry() const
     {
-
-        QMutexLocker locker(&_lock);
         std::list<EntryTypePtr> entriesToBeDeleted;
+
         return tryEvictDiskEntry(entriesToBeDeleted);
     }
 
@@ -1241,22 +1318,15 @@ public:
     virtual void notifyEntrySizeChanged(std::size_t oldSize,
                                         std::size_t newSize) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache
-        QMutexLocker k(&_sizeLock);
-
         ///This function can only be called for RAM buffers or while a memory mapped file is mapped into the RAM, so
         ///we just have to modify the RAM size.
-
-        ///Avoid overflows, _memoryCacheSize may not always fallback to 0
-        qint64 diff = (qint64)newSize - (qint64)oldSize;
-
-        if (diff < 0) {
-            _memoryCacheSize = diff > (qint64)_memoryCacheSize ? 0 : _memoryCacheSize + diff;
+        if (newSize < oldSize) {
+            subtractClamped(_memoryCacheSize, oldSize - newSize);
         } else {
-            _memoryCacheSize += diff;
+            _memoryCacheSize.fetch_add(newSize - oldSize, boost::memory_order_relaxed);
         }
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
     }
 
@@ -1267,27 +1337,23 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache, hence the
-        ///lock should already be taken.
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeDisk) {
             if (_isTiled) {
                 // For tile caches, we do not control which portion of the cache is in memory, so just keep track of the disk portion
-                _diskCacheSize += size;
+                _diskCacheSize.fetch_add(size, boost::memory_order_relaxed);
             } else {
-                _memoryCacheSize += size;
+                _memoryCacheSize.fetch_add(size, boost::memory_order_relaxed);
                 appPTR->increaseNCacheFilesOpened();
             }
         } else {
-            _memoryCacheSize += size;
+            _memoryCacheSize.fetch_add(size, boost::memory_order_relaxed);
         }
 
         _signalEmitter->emitAddedEntry(time);
 
 
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
     }
 
@@ -1298,17 +1364,15 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            subtractClamped(_memoryCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
         } else if (storage == eStorageModeDisk) {
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            subtractClamped(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
         }
 
@@ -1337,33 +1401,32 @@ public:
         if (_tearingDown) {
             return;
         }
-        QMutexLocker k(&_sizeLock);
 
         assert(oldStorage != newStorage);
         assert(newStorage != eStorageModeNone);
         if (oldStorage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
-            _diskCacheSize += size;
+            subtractClamped(_memoryCacheSize, size);
+            _diskCacheSize.fetch_add(size, boost::memory_order_relaxed);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
             ///We switched from RAM to DISK that means the MemoryFile object has been destroyed hence the file has been closed.
             appPTR->decreaseNCacheFilesOpened();
         } else if (oldStorage == eStorageModeDisk) {
-            _memoryCacheSize += size;
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            _memoryCacheSize.fetch_add(size, boost::memory_order_relaxed);
+            subtractClamped(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
             ///We switched from DISK to RAM that means the MemoryFile object has been created and the file opened
             appPTR->increaseNCacheFilesOpened();
         } else {
             if (newStorage == eStorageModeRAM) {
-                _memoryCacheSize += size;
+                _memoryCacheSize.fetch_add(size, boost::memory_order_relaxed);
             } else if (newStorage == eStorageModeDisk) {
-                _diskCacheSize += size;
+                _diskCacheSize.fetch_add(size, boost::memory_order_relaxed);
             }
         }
 
@@ -1376,6 +1439,12 @@ public:
         appPTR->decreaseNCacheFilesOpened();
     }
 
+    virtual void notifyEntryBackingFileRemoved(const std::string& filePath,
+                                               std::size_t dataOffset) const OVERRIDE FINAL
+    {
+        _journal.appendEntryRemoved(filePath, dataOffset);
+    }
+
     // const data member: no need to take the lock
     const std::string & cacheName() const
     {
@@ -1412,6 +1481,16 @@ public:
         return newCachePath.toStdString();
     }
 
+    std::string getJournalFilePath() const
+    {
+        QString newCachePath( getCachePath() );
+        StrUtils::ensureLastPathSeparator(newCachePath);
+
+        newCachePath.append( QString::fromUtf8("journal." NATRON_CACHE_FILE_EXT) );
+
+        return newCachePath.toStdString();
+    }
+
     void setMaximumCacheSize(U64 newSize)
     {
         QMutexLocker k(&_sizeLock);
@@ -1442,16 +1521,12 @@ public:
 
     std::size_t getMemoryCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _memoryCacheSize;
+        return _memoryCacheSize.load();
     }
 
     std::size_t getDiskCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _diskCacheSize;
+        return _diskCacheSize.load();
     }
 
     CacheSignalEmitterPtr activateSignalEmitter() const
@@ -1471,9 +1546,10 @@ public:
         std::list<EntryTypePtr> toRemove;
 
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( entry->getHashKey() );
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard( entry->getHashKey() );
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( entry->getHashKey() );
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( (*it)->getKey() == entry->getKey() ) {
@@ -1483,11 +1559,11 @@ public:
                     }
                 }
                 if ( ret.empty() ) {
-                    _memoryCache.erase(existingEntry);
+                    shard.memoryCache.erase(existingEntry);
                 }
             } else {
-                existingEntry = _diskCache( entry->getHashKey() );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( entry->getHashKey() );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         if ( (*it)->getKey() == entry->getKey() ) {
@@ -1497,11 +1573,11 @@ public:
                         }
                     }
                     if ( ret.empty() ) {
-                        _diskCache.erase(existingEntry);
+                        shard.diskCache.erase(existingEntry);
                     }
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
 
@@ -1515,25 +1591,26 @@ public:
     {
         std::list<EntryTypePtr> toRemove;
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( hash);
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard(hash);
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( hash);
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     toRemove.push_back(*it);
                 }
-                _memoryCache.erase(existingEntry);
+                shard.memoryCache.erase(existingEntry);
             } else {
-                existingEntry = _diskCache( hash );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( hash );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         toRemove.push_back(*it);
                     }
-                    _diskCache.erase(existingEntry);
+                    shard.diskCache.erase(existingEntry);
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
 
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
@@ -1552,6 +1629,18 @@ public:
     /*Restores the cache from disk.*/
     void restore(const CacheTOC & tableOfContents);
 
+    /**
+     * @brief Replays the journal of the disk portion left by a previous session, even if it did not exit cleanly.
+     * Entries whose backing file does not exist anymore are skipped.
+     **/
+    CacheJournal::ReadStatusEnum readJournal(CacheTOC* tableOfContents) const;
+
+    /**
+     * @brief Rewrites the journal with the entries currently in the disk portion and starts journaling changes to it.
+     * This does nothing for tiled caches. This is instantiated in Cache.cpp.
+     **/
+    void compactJournal();
+
 
     void removeAllEntriesWithDifferentNodeHashForHolderPublic(const CacheEntryHolder* holder,
                                                               U64 nodeHash)
@@ -1577,29 +1666,33 @@ public:
         *diskOccupied = 0;
 
         std::string holderID = holder->getCacheID();
-        QMutexLocker locker(&_lock);
 
-        for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+        for (std::size_t i = 0; i < _nShards; ++i) {
+            CacheShard& shard = _shards[i];
+            QMutexLocker locker(&shard.lock);
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *ramOccupied += (*it)->size();
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
+
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *ramOccupied += (*it)->size();
+                        }
                     }
                 }
             }
-        }
 
-        for (CacheIterator memIt = _diskCache.begin(); memIt != _diskCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = shard.diskCache.begin(); memIt != shard.diskCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *diskOccupied += (*it)->size();
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *diskOccupied += (*it)->size();
+                        }
                     }
                 }
             }
@@ -1608,16 +1701,29 @@ public:
 
 private:
 
+    /**
+     * @brief Describes the entries of the disk portion that are stored on disk
+     **/
+    void getDiskPortionTableOfContents(CacheTOC* tableOfContents) const;
+
+    /**
+     * @brief Journals an entry that was just moved to the disk portion.
+     * This is defined in CacheSerialization.h and instantiated in Cache.cpp.
+     **/
+    void appendEntryToJournal(const EntryTypePtr& entry) const;
+
     virtual void removeAllEntriesWithDifferentNodeHashForHolderPrivate(const std::string & holderID,
                                                                        U64 nodeHash,
                                                                        bool removeAll) OVERRIDE FINAL
     {
         std::list<EntryTypePtr> toDelete;
-        CacheContainer newMemCache, newDiskCache;
-        {
-            QMutexLocker locker(&_lock);
 
-            for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
+        for (std::size_t i = 0; i < _nShards; ++i) {
+            CacheShard& shard = _shards[i];
+            CacheContainer newMemCache, newDiskCache;
+            QMutexLocker locker(&shard.lock);
+
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1634,7 +1740,7 @@ private:
                 }
             }
 
-            for (CacheIterator dIt = _diskCache.begin(); dIt != _diskCache.end(); ++dIt) {
+            for (CacheIterator dIt = shard.diskCache.begin(); dIt != shard.diskCache.end(); ++dIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1651,9 +1757,9 @@ private:
                 }
             }
 
-            _memoryCache = newMemCache;
-            _diskCache = newDiskCache;
-        } // QMutexLocker locker(&_lock);
+            shard.memoryCache = newMemCache;
+            shard.diskCache = newDiskCache;
+        } // for all shards
 
         if ( !toDelete.empty() ) {
             _deleterThread.appendToQueue(toDelete);
@@ -1664,16 +1770,23 @@ private:
         }
     } // removeAllEntriesWithDifferentNodeHashForHolderPrivate
 
-    bool getInternal(const typename EntryType::key_type & key,
-                     std::list<EntryTypePtr>* returnValue) const
+    /**
+     * @brief Look-up the given shard for entries matching the key.
+     * If an entry was found in the disk portion and mapped back into RAM, reopenedFromDisk is set to true:
+     * the caller should then call evictInMemoryEntriesToFit() once the shard lock is released.
+     **/
+    bool getInternal(CacheShard& shard,
+                     const typename EntryType::key_type & key,
+                     std::list<EntryTypePtr>* returnValue,
+                     bool* reopenedFromDisk) const
     {
         ///Private should be locked
-        assert( !_lock.tryLock() );
+        assert( !shard.lock.tryLock() );
 
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache( key.getHash() );
+        CacheIterator memoryCached = shard.memoryCache( key.getHash() );
 
-        if ( memoryCached != _memoryCache.end() ) {
+        if ( memoryCached != shard.memoryCache.end() ) {
             ///we found something with a matching hash key. There may be several entries linked to
             ///this key, we need to find one with matching params
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
@@ -1692,9 +1805,9 @@ private:
             return returnValue->size() > 0;
         } else {
             ///fallback on the disk cache internal container
-            CacheIterator diskCached = _diskCache( key.getHash() );
+            CacheIterator diskCached = shard.diskCache( key.getHash() );
 
-            if ( diskCached == _diskCache.end() ) {
+            if ( diskCached == shard.diskCache.end() ) {
                 /*the entry was neither in memory or disk, just allocate a new one*/
                 return false;
             } else {
@@ -1726,31 +1839,12 @@ private:
                             }
 
                             //put it back into the RAM
-                            _memoryCache.insert( (*it)->getHashKey(), *it );
+                            shard.memoryCache.insert( (*it)->getHashKey(), *it );
 
-
-                            U64 memoryCacheSize, maximumInMemorySize;
-                            {
-                                QMutexLocker k(&_sizeLock);
-                                memoryCacheSize = _memoryCacheSize;
-                                maximumInMemorySize = _maximumInMemorySize;
-                            }
-                            std::list<EntryTypePtr> entriesToBeDeleted;
-
-                            //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
-                            while (memoryCacheSize > maximumInMemorySize) {
-                                if ( !tryEvictInMemoryEntry(entriesToBeDeleted) ) {
-                                    break;
-                                }
-
-                                {
-                                    QMutexLocker k(&_sizeLock);
-                                    memoryCacheSize = _memoryCacheSize;
-                                    maximumInMemorySize = _maximumInMemorySize;
-                                }
-                            }
+                            //the caller will clear extra entries from the memory cache so it doesn't exceed the RAM limit.
+                            *reopenedFromDisk = true;
                         }
-                        
+
                         returnValue->push_back(*it);
                         ///Q_EMIT the added signal otherwise when first reading something that's already cached
                         ///the timeline wouldn't update
@@ -1763,7 +1857,7 @@ private:
                             ret.erase(it);
 
                             ///Remove it from the disk cache
-                            _diskCache.erase(diskCached);
+                            shard.diskCache.erase(diskCached);
                         }
 
                         return true;
@@ -1780,25 +1874,26 @@ private:
     /** @brief Inserts into the cache an entry that was previously allocated by the createInternal()
      * function. This is called directly by createInternal() if the allocation was successful
      **/
-    void sealEntry(const EntryTypePtr & entry,
+    void sealEntry(CacheShard& shard,
+                   const EntryTypePtr & entry,
                    bool inMemory) const
     {
-        assert( !_lock.tryLock() );   // must be locked
+        assert( !shard.lock.tryLock() );   // must be locked
         typename EntryType::hash_type hash = entry->getHashKey();
 
         if (inMemory) {
             /*if the entry doesn't exist on the memory cache,make a new list and insert it*/
-            CacheIterator existingEntry = _memoryCache(hash);
-            if ( existingEntry == _memoryCache.end() ) {
-                _memoryCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.memoryCache(hash);
+            if ( existingEntry == shard.memoryCache.end() ) {
+                shard.memoryCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
             }
         } else {
-            CacheIterator existingEntry = _diskCache(hash);
-            if ( existingEntry == _diskCache.end() ) {
-                _diskCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.diskCache(hash);
+            if ( existingEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
@@ -1806,92 +1901,154 @@ private:
         }
     }
 
-    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    /**
+     * @brief Evict LRU in-memory entries until the in-memory portion fits in its maximum size.
+     * No shard lock must be held by the caller.
+     **/
+    void evictInMemoryEntriesToFit() const
     {
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        if (!evicted.second) {
-            return false;
+        std::list<EntryTypePtr> entriesToBeDeleted;
+        U64 memoryCacheSize, maximumInMemorySize;
+        {
+            QMutexLocker k(&_sizeLock);
+            memoryCacheSize = _memoryCacheSize.load();
+            maximumInMemorySize = _maximumInMemorySize;
         }
 
-        // If it is stored on disk, remove it from memory
-        // If the cache is tiled, the entry is sharing the same file with other entries so we cannot close the file.
-        // Just deallocate it
-        if ( !evicted.second->isStoredOnDisk()) {
-            entriesToBeDeleted.push_back(evicted.second);
-        } else {
-
-            assert( evicted.second.unique() );
-
-            ///This is EXPENSIVE! it calls msync
-            evicted.second->deallocate();
-
-            /*insert it back into the disk portion */
+        while (memoryCacheSize > maximumInMemorySize) {
+            if ( !tryEvictInMemoryEntry(entriesToBeDeleted) ) {
+                break;
+            }
 
-            U64 diskCacheSize, maximumCacheSize, maximumInMemorySize;
             {
                 QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
+                memoryCacheSize = _memoryCacheSize.load();
                 maximumInMemorySize = _maximumInMemorySize;
-                maximumCacheSize = _maximumCacheSize;
             }
+        }
+    }
+
+    /**
+     * @brief Evict LRU disk entries until the disk portion is below maximumDiskSize.
+     * No shard lock must be held by the caller.
+     **/
+    void evictDiskEntriesToFit(std::size_t maximumDiskSize,
+                               std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        std::size_t diskCacheSize = _diskCacheSize.load();
+
+        while (diskCacheSize >= maximumDiskSize) {
+            std::list<EntryTypePtr> deleted;
+            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            if ( !tryEvictDiskEntry(deleted) ) {
+                break;
+            }
+
+            for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
+                //The entry is not yet deleted for real since it's done in a separate thread when this function
+                ///size() will return 0 at this point, we have to recompute it
+                std::size_t fsize = (*it)->getElementsCountFromParams();
+                diskCacheSize = fsize > diskCacheSize ? 0 : diskCacheSize - fsize;
+                entriesToBeDeleted.push_back(*it);
+            }
+        }
+    }
+
+    /**
+     * @brief Evict the LRU entry of the in-memory portion.
+     * Each shard keeps its own LRU ordering: shards are visited in a rotating order so that each one gives away
+     * its least recently used entry in turn. Since entries are spread uniformly across shards by their hash,
+     * this approximates a global LRU policy.
+     * No shard lock must be held by the caller.
+     **/
+    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        const std::size_t firstShard = nextEvictionShard();
 
-            /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-            while ( ( diskCacheSize  + evicted.second->size() ) >= (maximumCacheSize - maximumInMemorySize) ) {
-                std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-                //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+        for (std::size_t i = 0; i < _nShards; ++i) {
+            CacheShard& shard = _shards[(firstShard + i) % _nShards];
+            EntryTypePtr movedToDisk;
+            {
+                QMutexLocker k(&shard.lock);
+                std::pair<hash_type, EntryTypePtr> evicted = shard.memoryCache.evict();
+                //if the shard couldn't evict that means all its entries are used somewhere and we shall not remove them!
                 //we'll let the user of these entries purge the extra entries left in the cache later on
-                if (!evictedFromDisk.second) {
-                    break;
+                if (!evicted.second) {
+                    continue;
                 }
 
-                ///Erase the file from the disk if we reach the limit.
-                evictedFromDisk.second->removeAnyBackingFile();
+                // If it is stored on disk, remove it from memory
+                // If the cache is tiled, the entry is sharing the same file with other entries so we cannot close the file.
+                // Just deallocate it
+                if ( !evicted.second->isStoredOnDisk() ) {
+                    entriesToBeDeleted.push_back(evicted.second);
+                } else {
+                    assert( evicted.second.unique() );
+
+                    ///This is EXPENSIVE! it calls msync
+                    evicted.second->deallocate();
+
+                    /*insert it back into the disk portion */
+                    CacheIterator existingDiskCacheEntry = shard.diskCache(evicted.first);
+                    /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                    if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                        shard.diskCache.insert(evicted.first, evicted.second);
+                    } else {   /*append to the existing list*/
+                        getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
+                    }
+                    movedToDisk = evicted.second;
+                }
+            } // QMutexLocker k(&shard.lock);
 
-                entriesToBeDeleted.push_back(evictedFromDisk.second);
+            /*we need to clear the disk cache if it now exceeds the maximum size allowed*/
+            if (movedToDisk) {
+                // Journal out of the shard lock: each record is flushed to the disk
+                appendEntryToJournal(movedToDisk);
+                // Entries in use cannot be evicted
+                movedToDisk.reset();
 
+                std::size_t maximumDiskSize;
                 {
                     QMutexLocker k(&_sizeLock);
-                    maximumInMemorySize = _maximumInMemorySize;
-                    maximumCacheSize = _maximumCacheSize;
+                    maximumDiskSize = _maximumCacheSize - _maximumInMemorySize;
                 }
-
-                //The entry is not yet deleted for real since it's done in a separate thread when this function
-                ///size() will return 0 at this point, we have to recompute it
-                std::size_t fsize = evictedFromDisk.second->getElementsCountFromParams();
-                diskCacheSize -= fsize;
+                evictDiskEntriesToFit(maximumDiskSize, entriesToBeDeleted);
             }
 
-            CacheIterator existingDiskCacheEntry = _diskCache(evicted.first);
-            /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-            if ( existingDiskCacheEntry == _diskCache.end() ) {
-                _diskCache.insert(evicted.first, evicted.second);
-            } else {   /*append to the existing list*/
-                getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
-            }
-        } // if (!evicted.second->isStoredOnDisk())
+            return true;
+        }
 
-        return true;
-    } // tryEvictEntry
+        return false;
+    } // tryEvictInMemoryEntry
 
+    /**
+     * @brief Evict the LRU entry of the disk portion, see tryEvictInMemoryEntry()
+     * No shard lock must be held by the caller.
+     **/
     bool tryEvictDiskEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
+        const std::size_t firstShard = nextEvictionShard();
 
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        if (!evicted.second) {
-            return false;
-        }
-        if (!_isTiled) {
-            // Erase the file from the disk if we reach the limit.
-            evicted.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _nShards; ++i) {
+            CacheShard& shard = _shards[(firstShard + i) % _nShards];
+            QMutexLocker k(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evicted = shard.diskCache.evict();
+            //if the shard couldn't evict that means all its entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            if (!evicted.second) {
+                continue;
+            }
+            if (!_isTiled) {
+                // Erase the file from the disk if we reach the limit.
+                evicted.second->removeAnyBackingFile();
+            }
+            entriesToBeDeleted.push_back(evicted.second);
+
+            return true;
         }
-        entriesToBeDeleted.push_back(evicted.second);
-        return true;
+
+        return false;
     }
 
 };
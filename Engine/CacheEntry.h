@@ -61,6 +61,7 @@
 #include <SequenceParsing.h> // for removePath
 #endif
 
+#include "Engine/BufferPool.h"
 #include "Engine/Hash64.h"
 #include "Engine/CacheEntryHolder.h"
 #include "Engine/MemoryFile.h"
@@ -115,35 +116,24 @@ public:
         if (size == 0) {
             return;
         }
+        clear();
+        // Throws std::bad_alloc on failure
+        data = (T*)BufferPool::allocate( size * sizeof(T) );
         count = size;
-        if (data) {
-            free(data);
-            data = 0;
-        }
-        if (count == 0) {
-            return;
-        }
-        data = (T*)malloc( size * sizeof(T) );
-        if (!data) {
-            throw std::bad_alloc();
-        }
     }
 
     void clear()
     {
-        count = 0;
         if (data) {
-            free(data);
+            BufferPool::deallocate( data, count * sizeof(T) );
             data = 0;
         }
+        count = 0;
     }
 
     ~RamBuffer()
     {
-        if (data) {
-            free(data);
-            data = 0;
-        }
+        clear();
     }
 };
 
@@ -208,6 +198,11 @@ public:
      **/
     virtual void backingFileClosed() const = 0;
 
+    /**
+     * @brief To be called when the backing file of an entry stored on disk has been removed
+     **/
+    virtual void notifyEntryBackingFileRemoved(const std::string& filePath, std::size_t dataOffset) const = 0;
+
     /**
      * @brief To be called whenever an entry is deallocated from memory and put back on disk or whenever
      * it is reallocated in the RAM.
@@ -1063,6 +1058,7 @@ public:
         if (hasRemovedFile) {
             _cache->backingFileClosed();
         }
+        _cache->notifyEntryBackingFileRemoved( getFilePath(), getOffsetInFile() );
         if (isAlloc) {
             _cache->notifyEntryDestroyed(getTime(), getElementsCountFromParams(), eStorageModeRAM);
         } else {
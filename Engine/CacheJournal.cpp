@@ -0,0 +1,371 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheJournal.h"
+
+#include <map>
+#include <cstdio> // rename
+#include <cstring> // memcmp, memcpy
+#include <iterator>
+#include <utility>
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+
+// Layout of the journal:
+// header: magic (8 bytes), format version (U32), cache version (U32)
+// record: type (U32), path length (U32), path, data offset (U64), payload length (U32), payload, checksum (U32)
+// The checksum is computed on all the bytes of the record that precede it.
+#define NATRON_CACHE_JOURNAL_MAGIC "NTRNCJNL"
+#define NATRON_CACHE_JOURNAL_MAGIC_SIZE 8
+#define NATRON_CACHE_JOURNAL_FORMAT_VERSION 1
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum JournalRecordTypeEnum
+{
+    eJournalRecordTypeEntryAdded = 1,
+    eJournalRecordTypeEntryRemoved = 2
+};
+
+// FNV-1a
+U32
+computeChecksum(const char* data,
+                std::size_t size)
+{
+    U32 hash = 2166136261u;
+
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+template <typename T>
+void
+appendPOD(std::string& buffer,
+          T value)
+{
+    buffer.append( (const char*)&value, sizeof(T) );
+}
+
+template <typename T>
+bool
+readPOD(const std::string& buffer,
+        std::size_t* pos,
+        T* value)
+{
+    if (buffer.size() - *pos < sizeof(T)) {
+        return false;
+    }
+    std::memcpy( value, buffer.data() + *pos, sizeof(T) );
+    *pos += sizeof(T);
+
+    return true;
+}
+
+bool
+readBytes(const std::string& buffer,
+          std::size_t* pos,
+          std::size_t size,
+          std::string* value)
+{
+    if (buffer.size() - *pos < size) {
+        return false;
+    }
+    value->assign(buffer, *pos, size);
+    *pos += size;
+
+    return true;
+}
+
+std::string
+makeHeader(unsigned int cacheVersion)
+{
+    std::string header(NATRON_CACHE_JOURNAL_MAGIC, NATRON_CACHE_JOURNAL_MAGIC_SIZE);
+
+    appendPOD<U32>(header, NATRON_CACHE_JOURNAL_FORMAT_VERSION);
+    appendPOD<U32>(header, cacheVersion);
+
+    return header;
+}
+
+std::string
+makeRecord(U32 type,
+           const std::string& filePath,
+           std::size_t dataOffset,
+           const std::string& payload)
+{
+    std::string record;
+
+    record.reserve(filePath.size() + payload.size() + 28);
+    appendPOD<U32>(record, type);
+    appendPOD<U32>( record, (U32)filePath.size() );
+    record.append(filePath);
+    appendPOD<U64>(record, (U64)dataOffset);
+    appendPOD<U32>( record, (U32)payload.size() );
+    record.append(payload);
+    appendPOD<U32>( record, computeChecksum( record.data(), record.size() ) );
+
+    return record;
+}
+
+bool
+replaceFile(const std::string& from,
+            const std::string& to)
+{
+#ifdef __NATRON_WIN32__
+    // QFile::rename() does not overwrite an existing file
+    QFile::remove( QString::fromUtf8( to.c_str() ) );
+
+    return QFile::rename( QString::fromUtf8( from.c_str() ), QString::fromUtf8( to.c_str() ) );
+#else
+    // rename() atomically replaces the journal: a crash leaves either the previous or the new one
+    return std::rename( from.c_str(), to.c_str() ) == 0;
+#endif
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+CacheJournal::CacheJournal()
+    : _lock()
+    , _file()
+    , _isOpen(false)
+    , _isResetting(false)
+    , _recordsAppendedDuringReset()
+{
+}
+
+CacheJournal::~CacheJournal()
+{
+    close();
+}
+
+CacheJournal::ReadStatusEnum
+CacheJournal::read(const std::string& journalFilePath,
+                   unsigned int cacheVersion,
+                   std::list<Record>* entries)
+{
+    FStreamsSupport::ifstream ifile;
+
+    FStreamsSupport::open(&ifile, journalFilePath, std::ios_base::in | std::ios_base::binary);
+    if (!ifile) {
+        return eReadStatusMissing;
+    }
+
+    std::string data( (std::istreambuf_iterator<char>(ifile)), std::istreambuf_iterator<char>() );
+    std::string header = makeHeader(cacheVersion);
+    if ( (data.size() < header.size()) || (std::memcmp( data.data(), header.data(), header.size() ) != 0) ) {
+        return eReadStatusInvalid;
+    }
+
+    // The live entries, indexed by their location on disk
+    typedef std::map<std::pair<std::string, std::size_t>, std::list<Record>::iterator> LiveEntriesMap;
+    LiveEntriesMap liveEntries;
+    std::size_t pos = header.size();
+    while (pos < data.size()) {
+        std::size_t recordStart = pos;
+        U32 type, pathSize, payloadSize, checksum;
+        U64 dataOffset;
+        Record record;
+        if ( !readPOD(data, &pos, &type) ||
+             !readPOD(data, &pos, &pathSize) ||
+             !readBytes(data, &pos, pathSize, &record.filePath) ||
+             !readPOD(data, &pos, &dataOffset) ||
+             !readPOD(data, &pos, &payloadSize) ||
+             !readBytes(data, &pos, payloadSize, &record.payload) ) {
+            qDebug() << "Cache journal" << journalFilePath.c_str() << "ends with a truncated record";
+            break;
+        }
+        std::size_t recordEnd = pos;
+        if ( !readPOD(data, &pos, &checksum) || ( checksum != computeChecksum(data.data() + recordStart, recordEnd - recordStart) ) ) {
+            qDebug() << "Cache journal" << journalFilePath.c_str() << "ends with a corrupted record";
+            break;
+        }
+        record.dataOffset = (std::size_t)dataOffset;
+
+        std::pair<std::string, std::size_t> location(record.filePath, record.dataOffset);
+        LiveEntriesMap::iterator found = liveEntries.find(location);
+        if ( found != liveEntries.end() ) {
+            entries->erase(found->second);
+            liveEntries.erase(found);
+        }
+        if (type == eJournalRecordTypeEntryAdded) {
+            entries->push_back(record);
+            liveEntries.insert( std::make_pair( location, --entries->end() ) );
+        }
+    }
+
+    return eReadStatusOK;
+} // CacheJournal::read
+
+void
+CacheJournal::beginReset()
+{
+    QMutexLocker k(&_lock);
+
+    _isResetting = true;
+    _recordsAppendedDuringReset.clear();
+}
+
+bool
+CacheJournal::reset(const std::string& journalFilePath,
+                    unsigned int cacheVersion,
+                    const std::list<Record>& entries)
+{
+    QMutexLocker k(&_lock);
+
+    if (_isOpen) {
+        _file.close();
+        _isOpen = false;
+    }
+
+    // The entries may already reflect some of these records: replaying a record twice gives the same entries
+    std::list<std::string> appendedRecords;
+    appendedRecords.swap(_recordsAppendedDuringReset);
+    _isResetting = false;
+
+    std::string tmpFilePath = journalFilePath + ".tmp";
+    {
+        FStreamsSupport::ofstream ofile;
+        FStreamsSupport::open(&ofile, tmpFilePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        if (!ofile) {
+            qDebug() << "Failed to write the cache journal" << tmpFilePath.c_str();
+
+            return false;
+        }
+        std::string header = makeHeader(cacheVersion);
+        ofile.write( header.data(), header.size() );
+        for (std::list<Record>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+            std::string record = makeRecord(eJournalRecordTypeEntryAdded, it->filePath, it->dataOffset, it->payload);
+            ofile.write( record.data(), record.size() );
+        }
+        for (std::list<std::string>::const_iterator it = appendedRecords.begin(); it != appendedRecords.end(); ++it) {
+            ofile.write( it->data(), it->size() );
+        }
+        ofile.flush();
+        if (!ofile) {
+            qDebug() << "Failed to write the cache journal" << tmpFilePath.c_str();
+            ofile.close();
+            QFile::remove( QString::fromUtf8( tmpFilePath.c_str() ) );
+
+            return false;
+        }
+    }
+
+    if ( !replaceFile(tmpFilePath, journalFilePath) ) {
+        qDebug() << "Failed to replace the cache journal" << journalFilePath.c_str();
+        QFile::remove( QString::fromUtf8( tmpFilePath.c_str() ) );
+
+        return false;
+    }
+
+    FStreamsSupport::open(&_file, journalFilePath, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+    _isOpen = (bool)_file;
+    if (!_isOpen) {
+        qDebug() << "Failed to open the cache journal" << journalFilePath.c_str();
+    }
+
+    return _isOpen;
+} // CacheJournal::reset
+
+bool
+CacheJournal::isAppendable() const
+{
+    QMutexLocker k(&_lock);
+
+    return _isOpen || _isResetting;
+}
+
+bool
+CacheJournal::isOpen() const
+{
+    QMutexLocker k(&_lock);
+
+    return _isOpen;
+}
+
+void
+CacheJournal::close()
+{
+    QMutexLocker k(&_lock);
+
+    if (_isOpen) {
+        _file.close();
+        _isOpen = false;
+    }
+    _isResetting = false;
+    _recordsAppendedDuringReset.clear();
+}
+
+void
+CacheJournal::appendEntryAdded(const std::string& filePath,
+                               std::size_t dataOffset,
+                               const std::string& payload)
+{
+    appendRecord(eJournalRecordTypeEntryAdded, filePath, dataOffset, payload);
+}
+
+void
+CacheJournal::appendEntryRemoved(const std::string& filePath,
+                                 std::size_t dataOffset)
+{
+    appendRecord( eJournalRecordTypeEntryRemoved, filePath, dataOffset, std::string() );
+}
+
+void
+CacheJournal::appendRecord(U32 type,
+                           const std::string& filePath,
+                           std::size_t dataOffset,
+                           const std::string& payload)
+{
+    std::string record = makeRecord(type, filePath, dataOffset, payload);
+    QMutexLocker k(&_lock);
+
+    if (_isResetting) {
+        _recordsAppendedDuringReset.push_back(record);
+    }
+    if (!_isOpen) {
+        return;
+    }
+
+    // Flush each record: the journal must be up to date if the process is killed
+    _file.write( record.data(), record.size() );
+    _file.flush();
+    if (!_file) {
+        // Entries moved to the disk portion from now on are orphans for the next session, which removes their files
+        qDebug() << "Failed to append to the cache journal, further changes of the disk cache are not journaled";
+        _file.close();
+        _isOpen = false;
+    }
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,127 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_CacheJournal_h
+#define Engine_CacheJournal_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <string>
+#include <cstddef>
+
+#include <QtCore/QMutex>
+
+#include "Global/FStreamsSupport.h"
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief An append-only log of the entries living in the disk portion of a cache.
+ * Each entry moved to the disk portion appends an "added" record holding its serialized table of contents entry,
+ * and each backing file removed from the disk appends a "removed" record. The journal is flushed after each record, so
+ * unlike a table of contents written on exit, it survives a crash or a kill of the process.
+ * Replaying it rebuilds the table of contents in O(records). A record torn by a crash is detected by its checksum
+ * and ends the replay.
+ **/
+class CacheJournal
+{
+public:
+
+    enum ReadStatusEnum
+    {
+        eReadStatusOK = 0, // the journal was replayed, possibly up to a torn record
+        eReadStatusMissing, // there is no journal
+        eReadStatusInvalid // the journal was written by another cache version or is not a journal
+    };
+
+    struct Record
+    {
+        std::string filePath;
+        std::size_t dataOffset;
+        std::string payload; // the serialized entry, opaque to the journal
+
+        Record()
+            : filePath()
+            , dataOffset(0)
+            , payload()
+        {
+        }
+    };
+
+    CacheJournal();
+
+    ~CacheJournal();
+
+    /**
+     * @brief Replays the journal at the given path. In output, entries contains the records of the entries
+     * that were added and not removed afterwards, in the order they were last added.
+     **/
+    static ReadStatusEnum read(const std::string& journalFilePath, unsigned int cacheVersion, std::list<Record>* entries);
+
+    /**
+     * @brief Starts keeping the records appended from now on, until reset() writes them after its entries.
+     * Entries listed after this call are thus passed to reset() without losing the changes made meanwhile.
+     **/
+    void beginReset();
+
+    /**
+     * @brief Replaces the journal at the given path by a journal containing only the given entries, followed by the
+     * records appended since beginReset(), and keeps it open to append records to it. The new journal is written aside
+     * and then renamed, so that a crash while compacting leaves the previous journal intact.
+     * @returns False if the journal could not be written, in which case it is closed.
+     **/
+    bool reset(const std::string& journalFilePath, unsigned int cacheVersion, const std::list<Record>& entries);
+
+    /**
+     * @brief Returns true if appended records are kept: the journal is open or being reset.
+     **/
+    bool isAppendable() const;
+
+    bool isOpen() const;
+
+    void close();
+
+    void appendEntryAdded(const std::string& filePath, std::size_t dataOffset, const std::string& payload);
+
+    void appendEntryRemoved(const std::string& filePath, std::size_t dataOffset);
+
+private:
+
+    void appendRecord(U32 type, const std::string& filePath, std::size_t dataOffset, const std::string& payload);
+
+    mutable QMutex _lock; // protects all data members
+    FStreamsSupport::ofstream _file;
+    bool _isOpen;
+    bool _isResetting;
+    std::list<std::string> _recordsAppendedDuringReset;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_CacheJournal_h
@@ -31,6 +31,7 @@
 #include <list>
 #include <set>
 #include <cstddef>
+#include <sstream> // istringstream, ostringstream
 #include <stdexcept>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
@@ -76,20 +77,22 @@ void
 Cache<EntryType>::save(CacheTOC* tableOfContents)
 {
     clearInMemoryPortion(false);
-    {
-        QMutexLocker l(&_lock);     // must be locked
+    getDiskPortionTableOfContents(tableOfContents);
+}
+
+template<typename EntryType>
+void
+Cache<EntryType>::getDiskPortionTableOfContents(CacheTOC* tableOfContents) const
+{
+    for (std::size_t i = 0; i < _nShards; ++i) {
+        CacheShard& shard = _shards[i];
+        QMutexLocker l(&shard.lock);     // must be locked
 
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
+        for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
             std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
             for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
                 if ( (*it2)->isStoredOnDisk() ) {
-                    SerializedEntry serialization;
-                    serialization.hash = (*it2)->getHashKey();
-                    serialization.params = (*it2)->getParams();
-                    serialization.key = (*it2)->getKey();
-                    serialization.size = (*it2)->dataSize();
-                    serialization.filePath = (*it2)->getFilePath();
-                    serialization.dataOffsetInFile = (*it2)->getOffsetInFile();
+                    SerializedEntry serialization(**it2);
 
                     (*it2)->syncBackingFile();
                     
@@ -105,6 +108,90 @@ Cache<EntryType>::save(CacheTOC* tableOfContents)
     }
 }
 
+template<typename EntryType>
+void
+Cache<EntryType>::appendEntryToJournal(const EntryTypePtr& entry) const
+{
+    if ( _isTiled || !_journal.isAppendable() ) {
+        return;
+    }
+
+    SerializedEntry serialization(*entry);
+    std::ostringstream ss;
+    try {
+        boost::archive::binary_oarchive oArchive(ss);
+        oArchive << serialization;
+    } catch (const std::exception & e) {
+        qDebug() << "Failed to serialize the cache entry:" << e.what();
+
+        return;
+    }
+    _journal.appendEntryAdded( serialization.filePath, serialization.dataOffsetInFile, ss.str() );
+}
+
+template<typename EntryType>
+CacheJournal::ReadStatusEnum
+Cache<EntryType>::readJournal(CacheTOC* tableOfContents) const
+{
+    std::list<CacheJournal::Record> records;
+    CacheJournal::ReadStatusEnum status = CacheJournal::read(getJournalFilePath(), cacheVersion(), &records);
+
+    if (status != CacheJournal::eReadStatusOK) {
+        return status;
+    }
+    for (std::list<CacheJournal::Record>::const_iterator it = records.begin(); it != records.end(); ++it) {
+        // The process may have been killed before journaling the removal of a file
+        if ( !CacheAPI::fileExists(it->filePath) ) {
+            continue;
+        }
+        SerializedEntry serialization;
+        try {
+            std::istringstream ss(it->payload);
+            boost::archive::binary_iarchive iArchive(ss);
+            iArchive >> serialization;
+        } catch (const std::exception & e) {
+            qDebug() << "Failed to read a cache journal entry:" << e.what();
+            continue;
+        }
+        tableOfContents->push_back(serialization);
+    }
+
+    return status;
+}
+
+template<typename EntryType>
+void
+Cache<EntryType>::compactJournal()
+{
+    if ( isTileCache() ) {
+        return;
+    }
+
+    // The entries moved to or removed from the disk portion while listing it are journaled after it
+    _journal.beginReset();
+
+    CacheTOC tableOfContents;
+    getDiskPortionTableOfContents(&tableOfContents);
+
+    std::list<CacheJournal::Record> records;
+    for (typename CacheTOC::const_iterator it = tableOfContents.begin(); it != tableOfContents.end(); ++it) {
+        CacheJournal::Record record;
+        record.filePath = it->filePath;
+        record.dataOffset = it->dataOffsetInFile;
+        try {
+            std::ostringstream ss;
+            boost::archive::binary_oarchive oArchive(ss);
+            oArchive << *it;
+            record.payload = ss.str();
+        } catch (const std::exception & e) {
+            qDebug() << "Failed to serialize the cache entry:" << e.what();
+            continue;
+        }
+        records.push_back(record);
+    }
+    _journal.reset(getJournalFilePath(), cacheVersion(), records);
+}
+
 /*Restores the cache from disk.*/
 template<typename EntryType>
 void
@@ -140,7 +227,7 @@ Cache<EntryType>::restore(const CacheTOC & tableOfContents)
 
         try {
             value = new EntryType(it->key, it->params, this);
-            if (it->size != getTileSizeBytes()) {
+            if ( _isTiled && (it->size != getTileSizeBytes()) ) {
                 delete value;
                 continue;
             }
@@ -154,8 +241,9 @@ Cache<EntryType>::restore(const CacheTOC & tableOfContents)
         const std::string& filePath = value->getFilePath();
         usedFilePaths.insert(QString::fromUtf8(filePath.c_str()));
         {
-            QMutexLocker locker(&_lock);
-            sealEntry(EntryTypePtr(value), false /*inMemory*/);
+            CacheShard& shard = getShard( value->getHashKey() );
+            QMutexLocker locker(&shard.lock);
+            sealEntry(shard, EntryTypePtr(value), false /*inMemory*/);
         }
     }
 
@@ -217,6 +305,16 @@ struct Cache<EntryType>::SerializedEntry
     {
     }
 
+    explicit SerializedEntry(const EntryType& entry)
+        : hash( entry.getHashKey() )
+          , key( entry.getKey() )
+          , params( entry.getParams() )
+          , size( entry.dataSize() )
+          , filePath( entry.getFilePath() )
+          , dataOffsetInFile( entry.getOffsetInFile() )
+    {
+    }
+
     template<class Archive>
     void serialize(Archive & ar,
                    const unsigned int /*version*/)
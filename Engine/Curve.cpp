@@ -33,10 +33,12 @@
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/math/special_functions/fpclassify.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#include <boost/make_shared.hpp>
 #endif
 #include "Engine/AppManager.h"
 
 #include "Engine/CurvePrivate.h"
+#include "Engine/Hash64.h"
 #include "Engine/Interpolation.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
@@ -305,6 +307,7 @@ Curve::setPeriodic(bool periodic)
     QMutexLocker k(&_imp->_lock);
     _imp->isPeriodic = periodic;
     _imp->keyFrames.clear();
+    _imp->invalidateSnapshot();
 }
 
 bool
@@ -325,6 +328,7 @@ Curve::clearKeyFrames()
     QMutexLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    _imp->invalidateSnapshot();
 }
 
 bool
@@ -889,91 +893,323 @@ interParams(const KeyFrameSet &keyFrames,
     }
 }
 
+/// Same as interParams() on a snapshot, up being the index of the first keyframe with time > t
+static void
+interParamsSnapshot(const CurveSnapshot& snapshot,
+                    double *t,
+                    std::size_t up,
+                    double *tcur,
+                    double *vcur,
+                    double *vcurDerivRight,
+                    KeyframeTypeEnum *interp,
+                    double *tnext,
+                    double *vnext,
+                    double *vnextDerivLeft,
+                    KeyframeTypeEnum *interpNext)
+{
+    const std::vector<double>& times = snapshot.times;
+    const std::vector<KeyFrame>& keyFrames = snapshot.keyFrames;
+
+    assert(keyFrames.size() >= 1);
+    assert( up == keyFrames.size() || *t < times[up] );
+    double period = snapshot.xMax - snapshot.xMin;
+    if (snapshot.isPeriodic) {
+        // if the curve is periodic, bring back t in the curve keyframes range
+        double minKeyFrameX = times.front() + snapshot.xMin;
+        assert(snapshot.xMin < snapshot.xMax);
+        if (*t < minKeyFrameX || *t > minKeyFrameX + period) {
+            // This will bring t either in minTime <= t <= maxTime or t in the range minTime - (maxTime - minTime) < t < minTime
+            *t = std::fmod(*t - minKeyFrameX, period ) + minKeyFrameX;
+            if (*t < minKeyFrameX) {
+                *t += period;
+            }
+            assert(*t >= minKeyFrameX && *t <= minKeyFrameX + period);
+        }
+        up = std::upper_bound(times.begin(), times.end(), *t) - times.begin();
+    }
+
+    const KeyFrame* cur;
+    const KeyFrame* next;
+    if (up == 0) {
+        // We are in the case where all keys have a greater time
+        // If periodic, we are in between xMin and the first keyframe
+        next = &keyFrames.front();
+        *tnext = next->getTime();
+        *vnext = next->getValue();
+        *vnextDerivLeft = next->getLeftDerivative();
+        *interpNext = next->getInterpolation();
+        if (snapshot.isPeriodic) {
+            cur = &keyFrames.back();
+            *tcur = cur->getTime() - period;
+            *vcur = cur->getValue();
+            *vcurDerivRight = cur->getRightDerivative();
+            *interp = cur->getInterpolation();
+        } else {
+            *tcur = *tnext - 1.;
+            *vcur = *vnext;
+            *vcurDerivRight = 0.;
+            *interp = eKeyframeTypeNone;
+        }
+    } else if ( up == keyFrames.size() ) {
+        // We are in the case where no key has a greater time
+        // If periodic, we are in-between the last keyframe and xMax
+        cur = &keyFrames.back();
+        *tcur = cur->getTime();
+        *vcur = cur->getValue();
+        *vcurDerivRight = cur->getRightDerivative();
+        *interp = cur->getInterpolation();
+        if (snapshot.isPeriodic) {
+            next = &keyFrames.front();
+            *tnext = next->getTime() + period;
+            *vnext = next->getValue();
+            *vnextDerivLeft = next->getLeftDerivative();
+            *interpNext = next->getInterpolation();
+        } else {
+            *tnext = *tcur + 1.;
+            *vnext = *vcur;
+            *vnextDerivLeft = 0.;
+            *interpNext = eKeyframeTypeNone;
+        }
+    } else {
+        // between two keyframes
+        cur = &keyFrames[up - 1];
+        next = &keyFrames[up];
+        assert(cur->getTime() <= *t);
+        *tcur = cur->getTime();
+        *vcur = cur->getValue();
+        *vcurDerivRight = cur->getRightDerivative();
+        *interp = cur->getInterpolation();
+        *tnext = next->getTime();
+        *vnext = next->getValue();
+        *vnextDerivLeft = next->getLeftDerivative();
+        *interpNext = next->getInterpolation();
+    }
+} // interParamsSnapshot
+
+/// The interpolated value of a snapshot with keyframes at t.
+/// up is the index of the first keyframe with time > t found for the previous time, it is updated for t.
+static double
+interpolateSnapshot(const CurveSnapshot& snapshot,
+                    double t,
+                    std::size_t* up)
+{
+    const std::vector<double>& times = snapshot.times;
+
+    if ( ( (*up > 0) && (t < times[*up - 1]) ) || ( (*up < times.size()) && (t >= times[*up]) ) ) {
+        // find the first keyframe with time greater than t
+        *up = std::upper_bound(times.begin(), times.end(), t) - times.begin();
+    }
+
+    // even when there is only one keyframe, there may be tangents!
+    double tcur, tnext;
+    double vcurDerivRight, vnextDerivLeft, vcur, vnext;
+    KeyframeTypeEnum interp, interpNext;
+    interParamsSnapshot(snapshot,
+                        &t,
+                        *up,
+                        &tcur,
+                        &vcur,
+                        &vcurDerivRight,
+                        &interp,
+                        &tnext,
+                        &vnext,
+                        &vnextDerivLeft,
+                        &interpNext);
+
+    return Interpolation::interpolate(tcur, vcur,
+                                      vcurDerivRight,
+                                      vnextDerivLeft,
+                                      tnext, vnext,
+                                      t,
+                                      interp,
+                                      interpNext);
+}
+
 double
 Curve::getValueAt(double t,
                   bool doClamp) const
 {
-    QMutexLocker l(&_imp->_lock);
+    double v;
 
-    if ( _imp->keyFrames.empty() ) {
+    getValuesAt(&t, &v, 1, doClamp);
+
+    return v;
+}
+
+void
+Curve::getValuesAt(const double* times,
+                   double* values,
+                   int n,
+                   bool doClamp) const
+{
+    // No lock: the snapshot stays valid even if the curve changes meanwhile
+    CurveSnapshotPtr snapshot = getSnapshot();
+
+    getSnapshotValuesAt(*snapshot, times, values, n, doClamp);
+}
+
+void
+Curve::getSnapshotValuesAt(const CurveSnapshot& snapshot,
+                           const double* times,
+                           double* values,
+                           int n,
+                           bool doClamp) const
+{
+    // PRIVATE - should not lock
+    if ( snapshot.keyFrames.empty() ) {
         //throw std::runtime_error("Curve has no control points!");
 
         // A curve with no control points is considered to be 0
         // this is to avoid returning StatFailed when KnobParametric::getValue() is called on a parametric curve without control point.
-        return 0.;
+        std::fill(values, values + n, 0.);
+
+        return;
 
         // There is no special case for a curve with one (1) keyframe: the result is a linear curve before and after the keyframe.
-    //} else if (_imp->keyFrames.size() == 1) {
-    //    return _imp->keyFrames.begin()->getValue();
     }
 
-    double v;
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double>::const_iterator foundCached = _imp->resultCache.find(t);
-    if ( foundCached != _imp->resultCache.end() ) {
-        v = foundCached->second;
-    } else
-#endif
-    {
-        // even when there is only one keyframe, there may be tangents!
-        //if (_imp->keyFrames.size() == 1) {
-        //    //if there's only 1 keyframe, don't bother interpolating
-        //    return (*_imp->keyFrames.begin()).getValue();
-        //}
-        double tcur, tnext;
-        double vcurDerivRight, vnextDerivLeft, vcur, vnext;
-        KeyframeTypeEnum interp, interpNext;
-        KeyFrame k(t, 0.);
-        // find the first keyframe with time greater than t
-        KeyFrameSet::const_iterator itup;
-        itup = _imp->keyFrames.upper_bound(k);
-        interParams(_imp->keyFrames,
-                    _imp->isPeriodic,
-                    _imp->xMin,
-                    _imp->xMax,
-                    &t,
-                    itup,
-                    &tcur,
-                    &vcur,
-                    &vcurDerivRight,
-                    &interp,
-                    &tnext,
-                    &vnext,
-                    &vnextDerivLeft,
-                    &interpNext);
+    const bool clamp = doClamp && snapshot.mustClamp;
+    YRange minmax( -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() );
+    if (clamp) {
+        minmax = getSnapshotYRange(snapshot);
+    }
 
-        v = Interpolation::interpolate(tcur, vcur,
-                                       vcurDerivRight,
-                                       vnextDerivLeft,
-                                       tnext, vnext,
-                                       t,
-                                       interp,
-                                       interpNext);
-#ifdef NATRON_CURVE_USE_CACHE
-        _imp->resultCache[t] = v;
-#endif
+    std::size_t up = 0;
+    for (int i = 0; i < n; ++i) {
+        double v = interpolateSnapshot(snapshot, times[i], &up);
+
+        if (clamp) {
+            if (v > minmax.max) {
+                v = minmax.max;
+            } else if (v < minmax.min) {
+                v = minmax.min;
+            }
+        }
+
+        switch (snapshot.type) {
+        case CurvePrivate::eCurveTypeString:
+        case CurvePrivate::eCurveTypeInt:
+            v = std::floor(v + 0.5);
+            break;
+        case CurvePrivate::eCurveTypeDouble:
+            break;
+        case CurvePrivate::eCurveTypeBool:
+            v = v >= 0.5 ? 1. : 0.;
+            break;
+        default:
+            break;
+        }
+        values[i] = v;
     }
+} // getSnapshotValuesAt
+
+CurveSnapshotPtr
+Curve::getSnapshot() const
+{
+    CurveSnapshotPtr snapshot = boost::atomic_load(&_imp->snapshot);
 
-    if ( doClamp && mustClamp() ) {
-        v = clampValueToCurveYRange(v);
+    if (snapshot) {
+        return snapshot;
     }
 
-    switch (_imp->type) {
-    case CurvePrivate::eCurveTypeString:
-    case CurvePrivate::eCurveTypeInt:
+    QMutexLocker l(&_imp->_lock);
+    // Another thread may have built it while we were waiting for the lock
+    snapshot = boost::atomic_load(&_imp->snapshot);
+    if (snapshot) {
+        return snapshot;
+    }
 
-        return std::floor(v + 0.5);
-    case CurvePrivate::eCurveTypeDouble:
+    boost::shared_ptr<CurveSnapshot> newSnapshot = boost::make_shared<CurveSnapshot>();
+    newSnapshot->times.reserve( _imp->keyFrames.size() );
+    newSnapshot->keyFrames.reserve( _imp->keyFrames.size() );
+    for (KeyFrameSet::const_iterator it = _imp->keyFrames.begin(); it != _imp->keyFrames.end(); ++it) {
+        newSnapshot->times.push_back( it->getTime() );
+        newSnapshot->keyFrames.push_back(*it);
+    }
+    newSnapshot->type = _imp->type;
+    newSnapshot->isPeriodic = _imp->isPeriodic;
+    newSnapshot->xMin = _imp->xMin;
+    newSnapshot->xMax = _imp->xMax;
+    newSnapshot->mustClamp = mustClamp();
+    newSnapshot->yMin = _imp->yMin;
+    newSnapshot->yMax = _imp->yMax;
+    newSnapshot->canBakeLUT = _imp->type == CurvePrivate::eCurveTypeDouble &&
+                              boost::math::isfinite(_imp->xMin) && boost::math::isfinite(_imp->xMax) && _imp->xMin < _imp->xMax;
+    for (std::vector<KeyFrame>::const_iterator it = newSnapshot->keyFrames.begin(); it != newSnapshot->keyFrames.end(); ++it) {
+        if (it->getInterpolation() == eKeyframeTypeConstant) {
+            // a step cannot be interpolated
+            newSnapshot->canBakeLUT = false;
+        }
+    }
+    snapshot = newSnapshot;
+    boost::atomic_store(&_imp->snapshot, snapshot);
 
-        return v;
-    case CurvePrivate::eCurveTypeBool:
+    return snapshot;
+}
+
+CurveLUTPtr
+Curve::getLUT() const
+{
+    CurveSnapshotPtr snapshot = getSnapshot();
 
-        return v >= 0.5 ? 1. : 0.;
-    default:
+    return getSnapshotLUT(*snapshot);
+}
+
+CurveLUTPtr
+Curve::getSnapshotLUT(const CurveSnapshot& snapshot) const
+{
+    // PRIVATE - should not lock
+    if (!snapshot.canBakeLUT) {
+        return CurveLUTPtr();
+    }
+    CurveLUTPtr lut = boost::atomic_load(&snapshot.lut);
+    if (lut) {
+        return lut;
+    }
+
+    // Threads baking the same snapshot concurrently produce identical tables, the last one stored wins
+    boost::shared_ptr<CurveLUT> newLUT = boost::make_shared<CurveLUT>();
+    newLUT->xMin = snapshot.xMin;
+    newLUT->xMax = snapshot.xMax;
+    newLUT->scale = (NATRON_CURVE_LUT_SIZE - 1) / (snapshot.xMax - snapshot.xMin);
+
+    std::vector<double> times(NATRON_CURVE_LUT_SIZE);
+    const double step = (snapshot.xMax - snapshot.xMin) / (NATRON_CURVE_LUT_SIZE - 1);
+    for (int i = 0; i < NATRON_CURVE_LUT_SIZE - 1; ++i) {
+        times[i] = snapshot.xMin + i * step;
+    }
+    times[NATRON_CURVE_LUT_SIZE - 1] = snapshot.xMax;
+    newLUT->values.resize(NATRON_CURVE_LUT_SIZE);
+    // clamping is done by getValueAtFromLUT(), since the range of the owner may change
+    getSnapshotValuesAt(snapshot, &times[0], &newLUT->values[0], NATRON_CURVE_LUT_SIZE, false);
+
+    lut = newLUT;
+    boost::atomic_store(&snapshot.lut, lut);
+
+    return lut;
+}
+
+double
+Curve::getValueAtFromLUT(double t) const
+{
+    CurveSnapshotPtr snapshot = getSnapshot();
+    CurveLUTPtr lut = getSnapshotLUT(*snapshot);
+    double v;
+
+    if ( !lut || (t < lut->xMin) || (t > lut->xMax) ) {
+        getSnapshotValuesAt(*snapshot, &t, &v, 1, true);
 
         return v;
     }
-} // getValueAt
+
+    v = lut->interpolate(t);
+    if (snapshot->mustClamp) {
+        YRange minmax = getSnapshotYRange(*snapshot);
+        v = std::max( minmax.min, std::min(minmax.max, v) );
+    }
+
+    return v;
+}
 
 double
 Curve::getDerivativeAt(double t) const
@@ -1196,6 +1432,15 @@ Curve::YRange Curve::getCurveYRange() const
         return YRange(_imp->yMin, _imp->yMax);
     }
 
+    return getCurveYRange_internal();
+}
+
+Curve::YRange
+Curve::getCurveYRange_internal() const
+{
+    // PRIVATE - should not lock
+    // The owner is set once for all by the constructor, its range has its own lock
+    assert(_imp->owner);
     KnobDoubleBase* isDouble = dynamic_cast<KnobDoubleBase*>(_imp->owner);
     KnobIntBase* isInt = dynamic_cast<KnobIntBase*>(_imp->owner);
     if (isDouble) {
@@ -1217,7 +1462,17 @@ Curve::YRange Curve::getCurveYRange() const
     } else {
         return YRange( -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() );
     }
+}
+
+Curve::YRange
+Curve::getSnapshotYRange(const CurveSnapshot& snapshot) const
+{
+    // PRIVATE - should not lock
+    if (!_imp->owner) {
+        return YRange(snapshot.yMin, snapshot.yMax);
+    }
 
+    return getCurveYRange_internal();
 }
 
 double
@@ -1253,6 +1508,7 @@ Curve::setXRange(double a,
 
     _imp->xMin = a;
     _imp->xMax = b;
+    _imp->invalidateSnapshot();
 }
 
 std::pair<double, double> Curve::getXRange() const
@@ -1278,6 +1534,38 @@ Curve::getKeyFrames_mt_safe() const
     return _imp->keyFrames;
 }
 
+KeyFrameSet
+Curve::getKeyFramesFromIndex_mt_safe(int index) const
+{
+    QMutexLocker l(&_imp->_lock);
+    KeyFrameSet ret;
+    KeyFrameSet::const_iterator it = _imp->keyFrames.end();
+
+    for (int i = (int)_imp->keyFrames.size(); i > std::max(index, 0); --i) {
+        --it;
+        // Inserting before the smallest keyframe so far takes constant time
+        ret.insert(ret.begin(), *it);
+    }
+
+    return ret;
+}
+
+void
+Curve::appendToHash(Hash64* hash) const
+{
+    QMutexLocker l(&_imp->_lock);
+
+    hash->append( (int)_imp->keyFrames.size() );
+    hash->append(_imp->isPeriodic);
+    for (KeyFrameSet::const_iterator it = _imp->keyFrames.begin(); it != _imp->keyFrames.end(); ++it) {
+        hash->append( it->getTime() );
+        hash->append( it->getValue() );
+        hash->append( it->getLeftDerivative() );
+        hash->append( it->getRightDerivative() );
+        hash->append( (int)it->getInterpolation() );
+    }
+}
+
 KeyFrameSet::iterator
 Curve::setKeyFrameValueAndTimeNoUpdate(double value,
                                        double time,
@@ -1818,6 +2106,7 @@ Curve::setYRange(double yMin,
 
     _imp->yMin = yMin;
     _imp->yMax = yMax;
+    _imp->invalidateSnapshot();
 }
 
 bool
@@ -1834,9 +2123,7 @@ Curve::onCurveChanged()
     if (_imp->owner) {
         _imp->owner->clearExpressionsResults(_imp->dimensionInOwner);
     }
-#ifdef NATRON_CURVE_USE_CACHE
-    _imp->resultCache.clear();
-#endif
+    _imp->invalidateSnapshot();
 }
 
 void
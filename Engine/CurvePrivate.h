@@ -28,6 +28,8 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #endif
@@ -40,10 +42,11 @@
 #include "Engine/KnobFile.h"
 #include "Engine/EngineFwd.h"
 
-//#define NATRON_CURVE_USE_CACHE
-
 NATRON_NAMESPACE_ENTER
 
+struct CurveSnapshot;
+typedef boost::shared_ptr<const CurveSnapshot> CurveSnapshotPtr;
+
 struct CurvePrivate
 {
     enum CurveTypeEnum
@@ -58,9 +61,9 @@ struct CurvePrivate
 
     KeyFrameSet keyFrames;
 
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double> resultCache; //< a cache for interpolations
-#endif
+    // What getValueAt() reads, built from the members above when it is first needed after a change.
+    // It is only accessed with boost::atomic_load/atomic_store, and reset under _lock whenever the curve changes.
+    CurveSnapshotPtr snapshot;
 
     KnobI* owner;
     int dimensionInOwner;
@@ -73,9 +76,7 @@ struct CurvePrivate
 
     CurvePrivate()
         : keyFrames()
-#ifdef NATRON_CURVE_USE_CACHE
-        , resultCache()
-#endif
+        , snapshot()
         , owner(NULL)
         , dimensionInOwner(-1)
         , type(eCurveTypeDouble)
@@ -107,9 +108,30 @@ struct CurvePrivate
         yMin = other.yMin;
         yMax = other.yMax;
         isPeriodic = other.isPeriodic;
+        invalidateSnapshot();
+    }
+
+    void invalidateSnapshot()
+    {
+        boost::atomic_store( &snapshot, CurveSnapshotPtr() );
     }
+};
 
-    
+/**
+ * @brief An immutable copy of the keyframes and of the parameters of a curve, used to evaluate it
+ * without taking the curve lock. A reader keeps the snapshot it loaded alive while the curve changes.
+ **/
+struct CurveSnapshot
+{
+    std::vector<double> times; // the keyframe times, contiguous for the binary search
+    std::vector<KeyFrame> keyFrames;
+    CurvePrivate::CurveTypeEnum type;
+    bool isPeriodic;
+    double xMin, xMax;
+    bool mustClamp;
+    double yMin, yMax; // used to clamp when the curve has no owner
+    bool canBakeLUT; // false if a table cannot approximate the curve (@see Curve::getLUT())
+    mutable CurveLUTPtr lut; // baked on first use, only accessed with boost::atomic_load/atomic_store
 };
 
 NATRON_NAMESPACE_EXIT
@@ -39,8 +39,6 @@
 #include <QtCore/QThreadPool>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QCoreApplication>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
-#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -1267,9 +1265,9 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         // If the plug-in is eRenderSafetyFullySafeFrame that means it wants the host to perform SMP aka slice up the RoI into chunks
         // but if the effect doesn't support tiles it won't work.
         // Also check that the number of threads indicating by the settings are appropriate for this render mode.
+        // The tiles do not need to wait for idle threads: the task scheduler lets the current thread render them.
         if ( !frameArgs->tilesSupported || (nbThreads == -1) || (nbThreads == 1) ||
-            ( (nbThreads == 0) && (appPTR->getHardwareIdealThreadCount() == 1) ) ||
-            ( QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount() )) {
+            ( (nbThreads == 0) && (appPTR->getHardwareIdealThreadCount() == 1) ) ) {
             safety = eRenderSafetyFullySafe;
         }
     }
@@ -1983,30 +1981,27 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
             tiledArgs->compsNeeded = compsNeeded;
 
 
+            std::vector<RectToRender> rectsToRender( planesToRender->rectsToRender.begin(), planesToRender->rectsToRender.end() );
+            std::vector<EffectInstance::RenderingFunctorRetEnum> ret;
 #ifdef NATRON_HOSTFRAMETHREADING_SEQUENTIAL
-            std::vector<EffectInstance::RenderingFunctorRetEnum> ret( tiledData.size() );
-            int i = 0;
-            for (std::list<RectToRender>::const_iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++i) {
-                ret[i] = self->_imp->tiledRenderingFunctor(tiledArgs,
-                                               *it,
-                                               currentThread);
+            ret.resize( rectsToRender.size() );
+            for (std::size_t i = 0; i < rectsToRender.size(); ++i) {
+                ret[i] = self->_imp->tiledRenderingFunctor(*tiledArgs,
+                                                           rectsToRender[i],
+                                                           currentThread);
             }
-            std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
-
 #else
-
-
-            QFuture<RenderingFunctorRetEnum> ret = QtConcurrent::mapped( planesToRender->rectsToRender,
-                                                                         boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
-                                                                                     self->_imp.get(),
-                                                                                     *tiledArgs,
-                                                                                     _1,
-                                                                                     currentThread) );
-            ret.waitForFinished();
-            QFuture<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
-
+            // The current thread renders tiles too. If the plug-in uses the multi-thread suite from a tile,
+            // the thread waiting for the slices keeps rendering instead of blocking a worker.
+            appPTR->getTaskScheduler()->blockingMapped( rectsToRender,
+                                                        boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
+                                                                    self->_imp.get(),
+                                                                    *tiledArgs,
+                                                                    _1,
+                                                                    currentThread),
+                                                        &ret );
 #endif
-            for (it2 = ret.begin(); it2 != ret.end(); ++it2) {
+            for (std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2 = ret.begin(); it2 != ret.end(); ++it2) {
                 if ( (*it2) == EffectInstance::eRenderingFunctorRetFailed ) {
                     renderStatus = eRenderingFunctorRetFailed;
                     break;
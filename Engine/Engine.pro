@@ -75,8 +75,10 @@ SOURCES += \
     Bezier.cpp \
     BezierCP.cpp \
     BlockingBackgroundRender.cpp \
+    BufferPool.cpp \
     CLArgs.cpp \
     Cache.cpp \
+    CacheJournal.cpp \
     CoonsRegularization.cpp \
     CreateNodeArgs.cpp \
     Curve.cpp \
@@ -93,6 +95,7 @@ SOURCES += \
     FitCurve.cpp \
     FrameEntry.cpp \
     FrameKey.cpp \
+    FrameLockstep.cpp \
     FrameParamsSerialization.cpp \
     GLShader.cpp \
     GPUContextPool.cpp \
@@ -108,10 +111,12 @@ SOURCES += \
     ImageCopyChannels.cpp \
     ImageKey.cpp \
     ImageMaskMix.cpp \
+    ImageMipMapKernels.cpp \
     ImageParamsSerialization.cpp \
     ImagePlaneDesc.cpp \
     Interpolation.cpp \
     JoinViewsNode.cpp \
+    KernelsISA.cpp \
     Knob.cpp \
     KnobFactory.cpp \
     KnobFile.cpp \
@@ -123,6 +128,7 @@ SOURCES += \
     Markdown.cpp \
     MemoryFile.cpp \
     MemoryInfo.cpp \
+    NativeExpression.cpp \
     NoOpBase.cpp \
     Node.cpp \
     NodeDocumentation.cpp \
@@ -170,6 +176,7 @@ SOURCES += \
     ReadNode.cpp \
     RectD.cpp \
     RectI.cpp \
+    RenderServer.cpp \
     RenderStats.cpp \
     RotoContext.cpp \
     RotoDrawableItem.cpp \
@@ -177,6 +184,7 @@ SOURCES += \
     RotoLayer.cpp \
     RotoPaint.cpp \
     RotoPaintInteract.cpp \
+    RotoRasterizer.cpp \
     RotoSmear.cpp \
     RotoStrokeItem.cpp \
     RotoUndoCommand.cpp \
@@ -201,6 +209,7 @@ SOURCES += \
     Transform.cpp \
     Utils.cpp \
     ViewerInstance.cpp \
+    ViewerInstanceKernels.cpp \
     WriteNode.cpp \
     ../Global/glad_source.c \
     ../Global/FStreamsSupport.cpp \
@@ -270,11 +279,13 @@ HEADERS += \
     BezierCPSerialization.h \
     BezierSerialization.h \
     BlockingBackgroundRender.h \
+    BufferPool.h \
     BufferableObject.h \
     CLArgs.h \
     Cache.h \
     CacheEntry.h \
     CacheEntryHolder.h \
+    CacheJournal.h \
     CacheSerialization.h \
     ChoiceOption.h \
     CoonsRegularization.h \
@@ -299,6 +310,7 @@ HEADERS += \
     FrameEntry.h \
     FrameEntrySerialization.h \
     FrameKey.h \
+    FrameLockstep.h \
     FrameParams.h \
     FrameParamsSerialization.h \
     GLShader.h \
@@ -313,12 +325,14 @@ HEADERS += \
     Image.h \
     ImageKey.h \
     ImageLocker.h \
+    ImageMipMapKernels.h \
     ImageParams.h \
     ImageParamsSerialization.h \
     ImagePlaneDesc.h \
     ImageSerialization.h \
     Interpolation.h \
     JoinViewsNode.h \
+    KernelsISA.h \
     KeyHelper.h \
     Knob.h \
     KnobFactory.h \
@@ -336,6 +350,7 @@ HEADERS += \
     MemoryFile.h \
     MemoryInfo.h \
     MergingEnum.h \
+    NativeExpression.h \
     NoOpBase.h \
     Node.h \
     NodeGraphI.h \
@@ -388,6 +403,7 @@ HEADERS += \
     RectDSerialization.h \
     RectI.h \
     RectISerialization.h \
+    RenderServer.h \
     RenderStats.h \
     RotoContext.h \
     RotoContextPrivate.h \
@@ -401,6 +417,7 @@ HEADERS += \
     RotoPaint.h \
     RotoPaintInteract.h \
     RotoPoint.h \
+    RotoRasterizer.h \
     RotoSmear.h \
     RotoStrokeItem.h \
     RotoStrokeItemSerialization.h \
@@ -437,6 +454,7 @@ HEADERS += \
     VariantSerialization.h \
     ViewIdx.h \
     ViewerInstance.h \
+    ViewerInstanceKernels.h \
     ViewerInstancePrivate.h \
     WriteNode.h \
     fstream_mingw.h \
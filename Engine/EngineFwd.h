@@ -135,6 +135,7 @@ class CacheSignalEmitter;
 class ChoiceExtraData;
 class CreateNodeArgs;
 class Curve;
+struct CurveLUT;
 class Dimension;
 class DockablePanelI;
 class EffectInstance;
@@ -143,6 +144,7 @@ class FileSystemItem;
 class FileSystemModel;
 class Format;
 class FrameEntry;
+class FrameLockstep;
 class FrameKey;
 class FrameParams;
 class FramebufferConfig;
@@ -194,6 +196,7 @@ class KnobTable;
 class LibraryBinary;
 class LogEntry;
 class MemoryFile;
+class NativeExpression;
 class Node;
 class NodeCollection;
 class NodeFrameRequest;
@@ -250,6 +253,8 @@ class RotoStrokeItemSerialization;
 class Settings;
 class StringAnimationManager;
 class TLSHolderBase;
+class TaskGroup;
+class TaskScheduler;
 class Texture;
 class TextureRect;
 class TileCacheFile;
@@ -332,11 +337,13 @@ typedef boost::shared_ptr<BezierSerialization> BezierSerializationPtr;
 typedef boost::shared_ptr<BufferableObject> BufferableObjectPtr;
 typedef boost::shared_ptr<CacheSignalEmitter> CacheSignalEmitterPtr;
 typedef boost::shared_ptr<Curve> CurvePtr;
+typedef boost::shared_ptr<const CurveLUT> CurveLUTPtr;
 typedef boost::shared_ptr<EffectInstance> EffectInstancePtr;
 typedef boost::shared_ptr<ExistenceCheckerThread> ExistenceCheckerThreadPtr;
 typedef boost::shared_ptr<FileSystemItem> FileSystemItemPtr;
 typedef boost::shared_ptr<FileSystemModel> FileSystemModelPtr;
 typedef boost::shared_ptr<FrameEntry> FrameEntryPtr;
+typedef boost::shared_ptr<FrameLockstep> FrameLockstepPtr;
 typedef boost::shared_ptr<FrameParams> FrameParamsPtr;
 typedef boost::shared_ptr<GLShader> GLShaderPtr;
 typedef boost::shared_ptr<GenericAccess> GenericAccessPtr;
@@ -379,6 +386,7 @@ typedef boost::shared_ptr<KnobString> KnobStringPtr;
 typedef boost::shared_ptr<KnobTLSData> KnobTLSDataPtr;
 typedef boost::shared_ptr<KnobTable> KnobTablePtr;
 typedef boost::shared_ptr<MemoryFile> MemoryFilePtr;
+typedef boost::shared_ptr<NativeExpression> NativeExpressionPtr;
 typedef boost::shared_ptr<Node> NodePtr;
 typedef boost::shared_ptr<NodeCollection> NodeCollectionPtr;
 typedef boost::shared_ptr<NodeFrameRequest> NodeFrameRequestPtr;
@@ -127,7 +127,7 @@ private:
     double _gain; // The gain on the viewer (if we don't apply it through GLSL shaders)
     double _gamma;  // The gamma on the viewer (if we don't apply it through GLSL shaders)
     int _lut;  // The lut on the viewer (if we don't apply it through GLSL shaders)
-    int _bitDepth;  // The bitdepth of the texture (i.e: 8bit or 32bit fp)
+    int _bitDepth;  // The bitdepth of the texture (i.e: 8bit, 16bit half or 32bit fp)
     int _channels; // The display channels, as requested by the user. Note that this will make a new cache entry whenever the user
                    // picks a new value in dropdown on the GUI
     int /*ViewIdx*/ _view; // The view of the frame, store it locally as an int for easier serialization
@@ -136,7 +136,7 @@ private:
     std::string _inputName; // The name of the input node used (to not mix up input 1, 2, 3 etc...)
     ImagePlaneDesc _layer; // The Layer of the image
     std::string _alphaChannelFullName; /// e.g: color.a , only used if _channels if A
-    bool _useShaders; // Whether GLSL shaders are active or not
+    bool _useShaders; // Whether GLSL shaders are active or not: if so, the texture is linear and gain, gamma and lut are not part of the key
     bool _draftMode; // Whether draft mode is enabled or not
 };
 
@@ -0,0 +1,164 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "FrameLockstep.h"
+
+#include <cassert>
+
+NATRON_NAMESPACE_ENTER
+
+FrameLockstep::FrameLockstep(int frameWindow)
+    : _lock()
+    , _nextFrameChangedCond()
+    , _frameWindow(frameWindow)
+    , _nextFrame()
+    , _nodeRenders()
+{
+    assert(_frameWindow >= 0);
+}
+
+FrameLockstep::~FrameLockstep()
+{
+}
+
+void
+FrameLockstep::addParticipant(const void* participant,
+                              int firstFrame)
+{
+    QMutexLocker k(&_lock);
+
+    _nextFrame[participant] = firstFrame;
+    _nextFrameChangedCond.wakeAll();
+}
+
+void
+FrameLockstep::removeParticipant(const void* participant)
+{
+    QMutexLocker k(&_lock);
+
+    _nextFrame.erase(participant);
+    _nextFrameChangedCond.wakeAll();
+}
+
+void
+FrameLockstep::raiseNextFrame(const void* participant,
+                              int frame)
+{
+    // Called with _lock held
+    std::map<const void*, int>::iterator found = _nextFrame.find(participant);
+
+    if ( ( found != _nextFrame.end() ) && (found->second < frame) ) {
+        found->second = frame;
+        _nextFrameChangedCond.wakeAll();
+    }
+}
+
+bool
+FrameLockstep::canStartFrame(const void* participant,
+                             int frame) const
+{
+    // Called with _lock held
+    for (std::map<const void*, int>::const_iterator it = _nextFrame.begin(); it != _nextFrame.end(); ++it) {
+        if ( (it->first != participant) && (it->second < frame - _frameWindow) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+FrameLockstep::waitForFrame(const void* participant,
+                            int frame,
+                            unsigned long timeoutMS)
+{
+    QMutexLocker k(&_lock);
+
+    // The next frame of a participant never decreases: it may over-estimate the frames that its threads are waiting
+    // for, which only lets the others go further, but never under-estimate them, which could deadlock.
+    raiseNextFrame(participant, frame);
+    if ( !canStartFrame(participant, frame) ) {
+        _nextFrameChangedCond.wait(&_lock, timeoutMS);
+        if ( !canStartFrame(participant, frame) ) {
+            return false;
+        }
+    }
+    raiseNextFrame(participant, frame + 1);
+
+    return true;
+}
+
+void
+FrameLockstep::addFrameStats(const void* participant,
+                             int frame,
+                             const std::map<NodePtr, NodeRenderStats>& stats)
+{
+    QMutexLocker k(&_lock);
+
+    for (std::map<NodePtr, NodeRenderStats>::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+        int nbCacheMisses, nbCacheHits, nbCacheHitButDownscaled;
+        it->second.getCacheAccessInfos(&nbCacheMisses, &nbCacheHits, &nbCacheHitButDownscaled);
+
+        NodeRenderInfo info;
+        info.participant = participant;
+        info.computed = nbCacheMisses > 0 || nbCacheHits == 0;
+        info.timeSpent = it->second.getTotalTimeSpentRendering();
+        _nodeRenders[std::make_pair(it->first.get(), frame)].push_back(info);
+    }
+}
+
+void
+FrameLockstep::getSharedWorkStats(int* nbNodeRenders,
+                                  int* nbSharedNodeRenders,
+                                  double* timeSaved) const
+{
+    QMutexLocker k(&_lock);
+
+    *nbNodeRenders = 0;
+    *nbSharedNodeRenders = 0;
+    *timeSaved = 0.;
+    for (NodeRenderInfoMap::const_iterator it = _nodeRenders.begin(); it != _nodeRenders.end(); ++it) {
+        *nbNodeRenders += (int)it->second.size();
+
+        // Find who computed the node at this frame
+        const NodeRenderInfo* computedBy = 0;
+        for (std::list<NodeRenderInfo>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            if ( it2->computed && ( !computedBy || (it2->timeSpent > computedBy->timeSpent) ) ) {
+                computedBy = &*it2;
+            }
+        }
+        if (!computedBy) {
+            continue;
+        }
+        for (std::list<NodeRenderInfo>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            if ( !it2->computed && (it2->participant != computedBy->participant) ) {
+                ++(*nbSharedNodeRenders);
+                *timeSaved += computedBy->timeSpent;
+            }
+        }
+    }
+}
+
+NATRON_NAMESPACE_EXIT
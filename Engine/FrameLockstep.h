@@ -0,0 +1,121 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_FrameLockstep_h
+#define Engine_FrameLockstep_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <map>
+#include <utility>
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/RenderStats.h"
+#include "Engine/EngineFwd.h"
+
+// How many frames a render may get ahead of the slowest render of the same lockstep.
+// Large enough to keep all the render threads of a writer busy, small enough for the images
+// shared between the writers to still be in the cache when the other writers need them.
+#define NATRON_FRAME_LOCKSTEP_WINDOW 4
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Keeps the sequential renders of several outputs frame-interleaved.
+ * Each participant (a scheduler) may only start a frame once the next frame of all the other running participants
+ * is at most a small window behind. The outputs thus render the same frames at the same time, and the nodes they share
+ * upstream are computed once per frame: the other outputs find the images in the cache, or wait for the pending render
+ * to finish.
+ * The participant that is the furthest behind is never blocked, so the lockstep cannot deadlock.
+ * The render stats of the participants are accumulated to report the work that was shared.
+ **/
+class FrameLockstep
+{
+public:
+
+    FrameLockstep(int frameWindow = NATRON_FRAME_LOCKSTEP_WINDOW);
+
+    ~FrameLockstep();
+
+    /**
+     * @brief Called when a participant starts rendering, before its first frame is picked.
+     **/
+    void addParticipant(const void* participant, int firstFrame);
+
+    /**
+     * @brief Called when a participant stops rendering: it no longer holds the others back.
+     **/
+    void removeParticipant(const void* participant);
+
+    /**
+     * @brief Blocks until the participant is allowed to render the given frame or the timeout expires.
+     * @returns True if the frame may be rendered, false on timeout so that the caller can check for abort.
+     **/
+    bool waitForFrame(const void* participant, int frame, unsigned long timeoutMS);
+
+    /**
+     * @brief Accumulates the render stats of a frame rendered by a participant.
+     **/
+    void addFrameStats(const void* participant, int frame, const std::map<NodePtr, NodeRenderStats>& stats);
+
+    /**
+     * @brief Returns the number of node renders accounted, how many of those were served from the cache because
+     * another participant computed the same node at the same frame, and the time it took that other participant.
+     **/
+    void getSharedWorkStats(int* nbNodeRenders, int* nbSharedNodeRenders, double* timeSaved) const;
+
+private:
+
+    struct NodeRenderInfo
+    {
+        const void* participant;
+        bool computed;
+        double timeSpent;
+    };
+
+    // Key: node and frame. The node is only used as an identifier.
+    typedef std::map<std::pair<const Node*, int>, std::list<NodeRenderInfo> > NodeRenderInfoMap;
+
+    void raiseNextFrame(const void* participant, int frame);
+
+    bool canStartFrame(const void* participant, int frame) const;
+
+    mutable QMutex _lock;
+    QWaitCondition _nextFrameChangedCond;
+    int _frameWindow;
+
+    // The lowest frame each running participant may still start
+    std::map<const void*, int> _nextFrame;
+    NodeRenderInfoMap _nodeRenders;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_FrameLockstep_h
@@ -29,7 +29,7 @@
 #include <cassert>
 #include <stdexcept>
 
-#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN) && defined(NATRON_HASH64_CRC)
 #include <boost/crc.hpp>
 #endif
 #include <QtCore/QString>
@@ -41,6 +41,7 @@ NATRON_NAMESPACE_ENTER
 void
 Hash64::computeHash()
 {
+#ifdef NATRON_HASH64_CRC
     if ( node_values.empty() ) {
         return;
     }
@@ -49,12 +50,28 @@ Hash64::computeHash()
     boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> crc_64;
     crc_64 = std::for_each( data, data + node_values.size() * sizeof(node_values[0]), crc_64 );
     hash = crc_64();
+#else
+    if (_nValues == 0) {
+        return;
+    }
+
+    // xxHash64 avalanche, the state itself is left untouched so that more values can be appended
+    U64 h = _state + _nValues * 8;
+    h ^= h >> 33;
+    h *= 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    h *= 0x165667B19E3779F9ULL;
+    h ^= h >> 32;
+
+    // 0 is reserved for invalid hashes
+    hash = h ? h : 1;
+#endif
 }
 
 void
 Hash64::reset()
 {
-    node_values.clear();
+    resetState();
     hash = 0;
 }
 
@@ -62,9 +79,46 @@ void
 Hash64_appendQString(Hash64* hash,
                      const QString & str)
 {
+#ifdef NATRON_HASH64_CRC
     Q_FOREACH (QChar ch, str) {
         hash->append<unsigned short>( ch.unicode() );
     }
+#else
+    // Pack 4 UTF-16 code units per value
+    const ushort* data = str.utf16();
+    int n = str.size();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        hash->append<U64>( (U64)data[i] | ( (U64)data[i + 1] << 16 ) | ( (U64)data[i + 2] << 32 ) | ( (U64)data[i + 3] << 48 ) );
+    }
+    if (i < n) {
+        U64 last = 0;
+        for (int j = 0; i + j < n; ++j) {
+            last |= (U64)data[i + j] << (16 * j);
+        }
+        hash->append<U64>(last);
+    }
+    hash->append<U64>( (U64)n );
+#endif
+}
+
+void
+Hash64_appendStdString(Hash64* hash,
+                       const std::string & str)
+{
+    // Also append the length so that consecutive strings cannot alias each other
+    hash->append<U64>( str.size() );
+
+    // Pack 8 bytes per value
+    std::size_t n = str.size();
+    std::size_t i = 0;
+    for (; i < n; i += 8) {
+        U64 v = 0;
+        for (std::size_t j = 0; j < 8 && i + j < n; ++j) {
+            v |= (U64)(unsigned char)str[i + j] << (8 * j);
+        }
+        hash->append<U64>(v);
+    }
 }
 
 NATRON_NAMESPACE_EXIT
@@ -29,6 +29,7 @@
 #include "Global/Macros.h"
 
 #include <vector>
+#include <string>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/static_assert.hpp>
 #endif
@@ -39,9 +40,14 @@
 
 NATRON_NAMESPACE_ENTER
 
-/*The hash of a Node is the checksum of the vector of data containing:
+/*The hash of a Node is the checksum of the stream of data containing:
     - the values of the current knob for this node + the name of the node
     - the hash values for the  tree upstream
+
+   Values are mixed into the hash state as they are appended, without buffering them
+   (a 64-bit multiply-rotate hash in the spirit of xxHash64).
+   When built with NATRON_HASH64_CRC, values are buffered and checksummed with the legacy
+   CRC64 instead, so that the keys of caches written by older versions remain valid.
  */
 
 class Hash64
@@ -50,11 +56,14 @@ public:
     Hash64()
     {
         hash = 0;
+        resetState();
     }
 
     ~Hash64()
     {
+#ifdef NATRON_HASH64_CRC
         node_values.clear();
+#endif
     }
 
     U64 value() const
@@ -62,6 +71,10 @@ public:
         return hash;
     }
 
+    /**
+     * @brief Computes the hash of all values appended since the last reset().
+     * More values may be appended afterwards, and computeHash() called again.
+     **/
     void computeHash();
 
     void reset();
@@ -87,7 +100,11 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
     template<typename T>
     void append(T value)
     {
+#ifdef NATRON_HASH64_CRC
         node_values.push_back( toU64(value) );
+#else
+        mix( toU64(value) );
+#endif
     }
 
     bool operator== (const Hash64 & h) const
@@ -116,12 +133,49 @@ private:
         };
     };
 
+#ifndef NATRON_HASH64_CRC
+    static U64 rotl(U64 x,
+                    int r)
+    {
+        return (x << r) | ( x >> (64 - r) );
+    }
+
+    void mix(U64 v)
+    {
+        // xxHash64 round on a single 8-byte lane
+        v *= 0xC2B2AE3D27D4EB4FULL;
+        v = rotl(v, 31);
+        v *= 0x9E3779B185EBCA87ULL;
+        _state ^= v;
+        _state = rotl(_state, 27) * 0x9E3779B185EBCA87ULL + 0x85EBCA77C2B2AE63ULL;
+        ++_nValues;
+    }
+
+#endif
+
+    void resetState()
+    {
+#ifdef NATRON_HASH64_CRC
+        node_values.clear();
+#else
+        _state = 0x27D4EB2F165667C5ULL;
+        _nValues = 0;
+#endif
+    }
+
     U64 hash;
+#ifdef NATRON_HASH64_CRC
     std::vector<U64> node_values;
+#else
+    U64 _state;
+    U64 _nValues;
+#endif
 };
 
 void Hash64_appendQString(Hash64* hash, const QString & str);
 
+void Hash64_appendStdString(Hash64* hash, const std::string & str);
+
 NATRON_NAMESPACE_EXIT
 
 #endif // NATRON_ENGINE_Hash64_H
@@ -32,11 +32,19 @@
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
 
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
 #ifdef DEBUG
 #include "Global/FloatingPointExceptions.h"
 #endif
+#include "Engine/AppManager.h"
 #include "Engine/Image.h"
 #include "Engine/Smooth1D.h"
+#include "Engine/ThreadPool.h"
+#include "Engine/ViewerInstanceKernels.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -224,160 +232,134 @@ HistogramCPU::getMostRecentlyProducedHistogram(std::vector<float>* histogram1,
     return true;
 }
 
-///putting these in an anonymous namespace will yield this error on gcc 4.2:
-///"function has not external linkage"
-struct pix_red
+/**
+ * @brief Counts the pixels of a band of the image in partial histograms, one per histogram of the request.
+ * The bands are processed concurrently, their counters are summed once they are all done.
+ **/
+static std::vector<unsigned int>
+computeHistogramsForBand(const ImagePtr & image,
+                         const ViewerRowHistogramArgs & rowArgs,
+                         const RectI & band)
 {
-    static float val(const float *pix)
-    {
-        return pix[0];
-    }
-};
-
-struct pix_green
-{
-    static float val(const float *pix)
-    {
-        return pix[1];
-    }
-};
+    std::vector<unsigned int> counters(rowArgs.histogramsCount * rowArgs.binsCount, 0);
+    ViewerRowHistogramArgs args = rowArgs;
 
-struct pix_blue
-{
-    static float val(const float *pix)
-    {
-        return pix[2];
+    for (int k = 0; k < args.histogramsCount; ++k) {
+        args.histograms[k] = &counters[k * args.binsCount];
     }
-};
 
-struct pix_alpha
-{
-    static float val(const float *pix)
-    {
-        return pix[3];
+    Image::ReadAccess acc = image->getReadRights();
+    const float* src_pixels = (const float*)acc.pixelAt(band.x1, band.y1);
+    assert(src_pixels);
+    const std::size_t srcRowElements = image->getRowElements();
+    args.width = band.width();
+    for (int y = band.y1; y < band.y2; ++y, src_pixels += srcRowElements) {
+        args.src = src_pixels;
+        ViewerKernels::rowHistogram(args);
     }
-};
 
-struct pix_lum
-{
-    static float val(const float *pix)
-    {
-        return 0.299 * pix[0] + 0.587 * pix[1] + 0.114 * pix[2];
-    }
-};
-
-
-template <float pix_func(const float*)>
-void
-computeHisto(const HistogramRequest & request,
-             int upscale,
-             std::vector<float> *histo)
-{
-    assert(histo);
-    histo->resize(request.binsCount * upscale);
-    std::fill(histo->begin(), histo->end(), 0.f);
-    double binSize = (request.vmax - request.vmin) / histo->size();
-
-    ///Images come from the viewer which is in float.
-    assert(request.image->getBitDepth() == eImageBitDepthFloat);
-
-    Image::ReadAccess acc = request.image->getReadRights();
-
-    for (int y = request.rect.bottom(); y < request.rect.top(); ++y) {
-        for (int x = request.rect.left(); x < request.rect.right(); ++x) {
-            const float *pix = (const float*)acc.pixelAt(x, y);
-            float v = pix_func(pix);
-            if ( (request.vmin <= v) && (v < request.vmax) ) {
-                int index = (int)( (v - request.vmin) / binSize );
-                assert( 0 <= index && index < (int)histo->size() );
-                (*histo)[index] += 1.f;
-            }
-        }
-    }
+    return counters;
 }
 
-
-
 static void
-computeHistogramStatic(const HistogramRequest & request,
-                       FinishedHistogramPtr ret,
-                       int histogramIndex)
+computeHistograms(const HistogramRequest & request,
+                  FinishedHistogram* ret)
 {
     const int upscale = 5;
-    std::vector<float> *histo = 0;
-
-    switch (histogramIndex) {
-    case 1:
-        histo = &ret->histogram1;
-        break;
-    case 2:
-        histo = &ret->histogram2;
-        break;
-    case 3:
-        histo = &ret->histogram3;
-        break;
-    default:
-        break;
-    }
-    assert(histo);
-    if (!histo) {
-        return;
-    }
-
-    /// keep the mode parameter in sync with Histogram::DisplayModeEnum
 
-    int mode = request.mode;
+    // a histogram with upscale more bins
+    ViewerRowHistogramArgs rowArgs;
 
-    ///if the mode is RGB, adjust the mode to either R,G or B depending on the histogram index
-    if (mode == 0) {
-        mode = histogramIndex + 2;
-    }
+    rowArgs.src = 0;
+    rowArgs.width = 0;
+    rowArgs.nComps = (int)request.image->getComponentsCount();
+    rowArgs.binsCount = request.binsCount * upscale;
+    rowArgs.vmin = (float)request.vmin;
+    rowArgs.scale = 0.f;
 
-    ret->pixelsCount = request.rect.area();
-    // a histogram with upscale more bins
-    std::vector<float> histo_upscaled;
-    switch (mode) {
+    /// keep the mode parameter in sync with Histogram::DisplayModeEnum
+    switch (request.mode) {
+    case 0:     //< RGB
+        rowArgs.histogramsCount = 3;
+        rowArgs.channels[0] = 0;
+        rowArgs.channels[1] = 1;
+        rowArgs.channels[2] = 2;
+        break;
     case 1:     //< A
-        computeHisto<&pix_alpha::val>(request, upscale, &histo_upscaled);
+        rowArgs.histogramsCount = 1;
+        rowArgs.channels[0] = 3;
         break;
-    case 2:     //<Y
-        computeHisto<&pix_lum::val>(request, upscale, &histo_upscaled);
+    case 2:     //< Y
+        rowArgs.histogramsCount = 1;
+        rowArgs.channels[0] = 4;
         break;
     case 3:     //< R
-        computeHisto<&pix_red::val>(request, upscale, &histo_upscaled);
-        break;
     case 4:     //< G
-        computeHisto<&pix_green::val>(request, upscale, &histo_upscaled);
-        break;
     case 5:     //< B
-        computeHisto<&pix_blue::val>(request, upscale, &histo_upscaled);
+        rowArgs.histogramsCount = 1;
+        rowArgs.channels[0] = request.mode - 3;
         break;
-
     default:
-        assert(false);
-        break;
+        assert(false);     //< unknown case.
+
+        return;
     }
-    double sigma = upscale;
-    if (request.smoothingKernelSize > 1) {
-        sigma *= request.smoothingKernelSize;
+
+    ///Images come from the viewer which is in float.
+    assert(request.image->getBitDepth() == eImageBitDepthFloat);
+
+    ret->pixelsCount = request.rect.area();
+
+    // The smoothing works on floats
+    std::vector<std::vector<float> > histos_upscaled( rowArgs.histogramsCount, std::vector<float>(rowArgs.binsCount, 0.f) );
+    RectI rect;
+    if ( (request.vmax > request.vmin) && request.rect.intersect(request.image->getBounds(), &rect) ) {
+        rowArgs.scale = (float)(rowArgs.binsCount / (request.vmax - request.vmin) );
+        std::vector<RectI> bands = rect.splitIntoSmallerRects( appPTR->getMaxThreadCount() );
+        std::vector<std::vector<unsigned int> > counters;
+        appPTR->getTaskScheduler()->blockingMapped( bands,
+                                                    boost::bind(&computeHistogramsForBand,
+                                                                request.image,
+                                                                rowArgs,
+                                                                _1),
+                                                    &counters );
+        for (std::size_t i = 0; i < counters.size(); ++i) {
+            for (int k = 0; k < rowArgs.histogramsCount; ++k) {
+                const unsigned int* bandCounters = &counters[i][k * rowArgs.binsCount];
+                std::vector<float>& histo_upscaled = histos_upscaled[k];
+                for (int b = 0; b < rowArgs.binsCount; ++b) {
+                    histo_upscaled[b] += bandCounters[b];
+                }
+            }
+        }
     }
-    // smooth the upscaled histogram
-    Smooth1D::iir_gaussianFilter1D(histo_upscaled, sigma);
-
-    // downsample to obtain the final histogram
-    histo->resize(request.binsCount);
-    assert(histo_upscaled.size() == histo->size() * upscale);
-    std::vector<float>::const_iterator it_in = histo_upscaled.begin();
-    std::advance(it_in, (upscale - 1) / 2);
-    std::vector<float>::iterator it_out = histo->begin();
-    while ( it_out != histo->end() ) {
-        *it_out = *it_in * upscale;
-        ++it_out;
-        if ( it_out != histo->end() ) {
-            std::advance (it_in, upscale);
+
+    for (int k = 0; k < rowArgs.histogramsCount; ++k) {
+        std::vector<float> & histo_upscaled = histos_upscaled[k];
+        std::vector<float> *histo = (k == 0) ? &ret->histogram1 : (k == 1) ? &ret->histogram2 : &ret->histogram3;
+
+        double sigma = upscale;
+        if (request.smoothingKernelSize > 1) {
+            sigma *= request.smoothingKernelSize;
+        }
+        // smooth the upscaled histogram
+        Smooth1D::iir_gaussianFilter1D(histo_upscaled, sigma);
+
+        // downsample to obtain the final histogram
+        histo->resize(request.binsCount);
+        assert(histo_upscaled.size() == histo->size() * upscale);
+        std::vector<float>::const_iterator it_in = histo_upscaled.begin();
+        std::advance(it_in, (upscale - 1) / 2);
+        std::vector<float>::iterator it_out = histo->begin();
+        while ( it_out != histo->end() ) {
+            *it_out = *it_in * upscale;
+            ++it_out;
+            if ( it_out != histo->end() ) {
+                std::advance (it_in, upscale);
+            }
         }
     }
-} // computeHistogramStatic
+} // computeHistograms
 
 void
 HistogramCPU::run()
@@ -420,23 +402,8 @@ HistogramCPU::run()
         ret->mipMapLevel = request.image->getMipMapLevel();
 
 
-        switch (request.mode) {
-        case 0:     //< RGB
-            computeHistogramStatic(request, ret, 1);
-            computeHistogramStatic(request, ret, 2);
-            computeHistogramStatic(request, ret, 3);
-            break;
-        case 1:
-        case 2:
-        case 3:
-        case 4:
-        case 5:
-            computeHistogramStatic(request, ret, 1);
-            break;
-        default:
-            assert(false);     //< unknown case.
-            break;
-        }
+        // All the histograms of the request are computed in a single pass over the image
+        computeHistograms( request, ret.get() );
 
 
         {
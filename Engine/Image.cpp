@@ -29,6 +29,7 @@
 #include <cassert>
 #include <cstring> // for std::memcpy, std::memset
 #include <stdexcept>
+#include <utility> // pair
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -43,105 +44,170 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/GPUContextPool.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/GLShader.h"
+#include "Engine/ImageMipMapKernels.h"
+#include "Engine/ThreadPool.h"
 
 NATRON_NAMESPACE_ENTER
 
-#define BM_GET(i, j) (&_map[( i - _bounds.bottom() ) * _bounds.width() + ( j - _bounds.left() )])
-
 #define PIXEL_UNAVAILABLE 2
 
+// Below this number of source pixels, the mipmap levels are built in the calling thread
+#define NATRON_MIPMAP_MIN_PARALLEL_AREA (512 * 512)
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// Sets of pixel states passed to Bitmap::findFirstOf() and Bitmap::findLastOf()
+enum BitmapValuesEnum
+{
+    eBitmapValuesNotRendered = 1 << 0,
+    eBitmapValuesRendered = 1 << 1,
+    eBitmapValuesUnavailable = 1 << PIXEL_UNAVAILABLE
+};
+
+// The low bit of each of the 32 pixels of a word
+const U64 kBitmapLowBits = 0x5555555555555555ULL;
+
+inline int
+bitmapRowWords(int width)
+{
+    return (width + 31) / 32;
+}
+
+inline U64
+bitmapPattern(char value)
+{
+    return value == 0 ? 0 : (value == 1 ? kBitmapLowBits : (kBitmapLowBits << 1));
+}
+
+// Returns the low bit of each pixel of the word whose state is in the values set
+inline U64
+bitmapMatchingPixels(U64 word,
+                     int values)
+{
+    const U64 lo = word & kBitmapLowBits;
+    const U64 hi = (word >> 1) & kBitmapLowBits;
+    U64 ret = 0;
+
+    if (values & eBitmapValuesNotRendered) {
+        ret |= ~(lo | hi) & kBitmapLowBits;
+    }
+    if (values & eBitmapValuesRendered) {
+        ret |= lo & ~hi;
+    }
+    if (values & eBitmapValuesUnavailable) {
+        ret |= hi & ~lo;
+    }
+
+    return ret;
+}
+
+// The bits of the word w covering the pixels [i1,i2) of a row
+inline U64
+bitmapWordMask(int w,
+               int i1,
+               int i2)
+{
+    U64 mask = ~(U64)0;
+
+    if ( w == (i1 >> 5) ) {
+        mask &= ~(U64)0 << ( 2 * (i1 & 31) );
+    }
+    if ( w == ( (i2 - 1) >> 5 ) ) {
+        int n = ( (i2 - 1) & 31 ) + 1;
+        if (n < 32) {
+            mask &= ( (U64)1 << (2 * n) ) - 1;
+        }
+    }
+
+    return mask;
+}
+
+inline int
+countTrailingZeros(U64 v)
+{
+    assert(v);
+#if defined(__GNUC__)
+    return __builtin_ctzll(v);
+#else
+    int n = 0;
+    while ( !(v & 1) ) {
+        v >>= 1;
+        ++n;
+    }
+
+    return n;
+#endif
+}
+
+inline int
+highestBit(U64 v)
+{
+    assert(v);
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(v);
+#else
+    int n = 0;
+    while (v >>= 1) {
+        ++n;
+    }
+
+    return n;
+#endif
+}
+
+// Returns the 32 pixels of the row starting at the pixel index i, the pixels out of the row being 0
+inline U64
+bitmapReadPixels(const U64* row,
+                 int rowWords,
+                 int i)
+{
+    int w = i >= 0 ? i / 32 : -( (31 - i) / 32 );
+    int shift = 2 * (i - w * 32);
+    U64 lo = (w >= 0 && w < rowWords) ? row[w] : 0;
+
+    if (shift == 0) {
+        return lo;
+    }
+    U64 hi = (w + 1 >= 0 && w + 1 < rowWords) ? row[w + 1] : 0;
+
+    return (lo >> shift) | ( hi << (64 - shift) );
+}
+
 template <int trimap>
 RectI
 minimalNonMarkedBbox_internal(const RectI& roi,
-                              const RectI& _bounds,
-                              const std::vector<char>& _map,
+                              const Bitmap& bm,
                               bool* isBeingRenderedElsewhere)
 {
     RectI bbox;
 
-    assert( _bounds.contains(roi) );
+    assert( bm.getBounds().contains(roi) );
     bbox = roi;
 
+    // The pixels that are left to render. Pixels being rendered elsewhere are not with the trimap,
+    // but they are flagged if a whole row or column of the bbox is not 0.
+    const int notDone = trimap ? eBitmapValuesNotRendered : (eBitmapValuesNotRendered | eBitmapValuesUnavailable);
+
     //find bottom
     for (int i = bbox.bottom(); i < bbox.top(); ++i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                ++bbox.y1;
-            } else {
-                ++bbox.y1;
-            }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                ++bbox.y1;
-            }
+        if ( bm.findFirstOf(i, bbox.x1, bbox.x2, notDone) < bbox.x2 ) {
+            break;
+        }
+        if ( trimap && ( bm.findFirstOf(i, bbox.x1, bbox.x2, eBitmapValuesUnavailable) < bbox.x2 ) ) {
+            *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
         }
+        ++bbox.y1;
     }
 
     //find top (will do zero iteration if the bbox is already empty)
     for (int i = bbox.top() - 1; i >= bbox.bottom(); --i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                --bbox.y2;
-            } else {
-                --bbox.y2;
-            }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                --bbox.y2;
-            }
+        if ( bm.findFirstOf(i, bbox.x1, bbox.x2, notDone) < bbox.x2 ) {
+            break;
+        }
+        if ( trimap && ( bm.findFirstOf(i, bbox.x1, bbox.x2, eBitmapValuesUnavailable) < bbox.x2 ) ) {
+            *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
         }
+        --bbox.y2;
     }
 
     // avoid making bbox.width() iterations for nothing
@@ -149,75 +215,67 @@ minimalNonMarkedBbox_internal(const RectI& roi,
         return bbox;
     }
 
-    //find left
-    for (int j = bbox.left(); j < bbox.right(); ++j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
-
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
-            }
-        }
-        if (pix) {
-            ++bbox.x1;
-            if (trimap && metUnavailablePixel) {
+    //find left: the first column with a pixel left to render is the leftmost one over all the rows
+    int x1 = bbox.right();
+    for (int i = bbox.bottom(); i < bbox.top() && x1 > bbox.left(); ++i) {
+        x1 = bm.findFirstOf(i, bbox.left(), x1, notDone);
+    }
+    if (trimap) {
+        for (int i = bbox.bottom(); i < bbox.top(); ++i) {
+            if ( bm.findFirstOf(i, bbox.left(), x1, eBitmapValuesUnavailable) < x1 ) {
                 *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
+                break;
             }
-        } else {
-            break;
         }
     }
+    bbox.x1 = x1;
 
     //find right
-    for (int j = bbox.right() - 1; j >= bbox.left(); --j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
-
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
-            }
-        }
-        if (pix) {
-            --bbox.x2;
-            if (trimap && metUnavailablePixel) {
+    int x2 = bbox.left();
+    for (int i = bbox.bottom(); i < bbox.top() && x2 < bbox.right(); ++i) {
+        x2 = bm.findLastOf(i, x2, bbox.right(), notDone) + 1;
+    }
+    if (trimap) {
+        for (int i = bbox.bottom(); i < bbox.top(); ++i) {
+            if ( bm.findFirstOf(i, x2, bbox.right(), eBitmapValuesUnavailable) < bbox.right() ) {
                 *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
+                break;
             }
-        } else {
-            break;
         }
     }
+    bbox.x2 = x2;
 
     return bbox;
 } // minimalNonMarkedBbox_internal
 
+// With the trimap, flag if the first pixel of the column x that is not 0 is being rendered elsewhere
+void
+flagColumnIfUnavailable(const Bitmap& bm,
+                        int x,
+                        int y1,
+                        int y2,
+                        bool* isBeingRenderedElsewhere)
+{
+    for (int i = y1; i < y2; ++i) {
+        char value = bm.getValueAt(x, i);
+        if (value == PIXEL_UNAVAILABLE) {
+            *isBeingRenderedElsewhere = true;
+            break;
+        } else if (value) {
+            break;
+        }
+    }
+}
 
 template <int trimap>
 void
 minimalNonMarkedRects_internal(const RectI & roi,
-                               const RectI& _bounds,
-                               const std::vector<char>& _map,
+                               const Bitmap& bm,
                                std::list<RectI>& ret,
                                bool* isBeingRenderedElsewhere)
 {
     assert(ret.empty());
+    const RectI& _bounds = bm.getBounds();
     ///Any out of bounds portion is pushed to the rectangles to render
     RectI intersection;
 
@@ -251,7 +309,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
         return;
     }
 
-    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, _bounds, _map, isBeingRenderedElsewhere);
+    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, bm, isBeingRenderedElsewhere);
     assert( (trimap && isBeingRenderedElsewhere) || (!trimap && !isBeingRenderedElsewhere) );
 
     //#define NATRON_BITMAP_DISABLE_OPTIMIZATION
@@ -285,44 +343,25 @@ minimalNonMarkedRects_internal(const RectI & roi,
     // CXXXXXXXXXXDDD
     // AAAAAAAAAAAAAA
 
+    // The pixels that end the A, B, C and D rectangles. Without the trimap, pixels
+    // being rendered elsewhere are rendered again.
+    const int done = trimap ? (eBitmapValuesRendered | eBitmapValuesUnavailable) : eBitmapValuesRendered;
+
     // First, find if there's an "A" rectangle, and push it to the result
     //find bottom
     RectI bboxX = bboxM;
     RectI bboxA = bboxX;
     bboxA.set_top( bboxX.bottom() );
     for (int i = bboxX.bottom(); i < bboxX.top(); ++i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                break;
+        int x = bm.findFirstOf(i, bboxX.left(), bboxX.right(), done);
+        if ( x < bboxX.right() ) {
+            if ( trimap && (bm.getValueAt(x, i) == PIXEL_UNAVAILABLE) ) {
+                *isBeingRenderedElsewhere = true;
             }
+            break;
         }
+        ++bboxX.y1;
+        bboxA.y2 = bboxX.y1;
     }
     if ( !bboxA.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxA);
@@ -333,39 +372,15 @@ minimalNonMarkedRects_internal(const RectI & roi,
     RectI bboxB = bboxX;
     bboxB.set_bottom( bboxX.top() );
     for (int i = bboxX.top() - 1; i >= bboxX.bottom(); --i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                break;
+        int x = bm.findFirstOf(i, bboxX.left(), bboxX.right(), done);
+        if ( x < bboxX.right() ) {
+            if ( trimap && (bm.getValueAt(x, i) == PIXEL_UNAVAILABLE) ) {
+                *isBeingRenderedElsewhere = true;
             }
+            break;
         }
+        --bboxX.y2;
+        bboxB.y1 = bboxX.y2;
     }
     if ( !bboxB.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxB);
@@ -375,30 +390,15 @@ minimalNonMarkedRects_internal(const RectI & roi,
     RectI bboxC = bboxX;
     bboxC.set_right( bboxX.left() );
     if ( bboxX.bottom() < bboxX.top() ) {
-        for (int j = bboxX.left(); j < bboxX.right(); ++j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                ++bboxX.x1;
-                bboxC.x2 = bboxX.x1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
+        int x1 = bboxX.right();
+        for (int i = bboxX.bottom(); i < bboxX.top() && x1 > bboxX.left(); ++i) {
+            x1 = bm.findFirstOf(i, bboxX.left(), x1, done);
+        }
+        if ( trimap && ( x1 < bboxX.right() ) ) {
+            flagColumnIfUnavailable(bm, x1, bboxX.bottom(), bboxX.top(), isBeingRenderedElsewhere);
         }
+        bboxX.x1 = x1;
+        bboxC.x2 = bboxX.x1;
     }
     if ( !bboxC.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxC);
@@ -408,30 +408,15 @@ minimalNonMarkedRects_internal(const RectI & roi,
     RectI bboxD = bboxX;
     bboxD.set_left( bboxX.right() );
     if ( bboxX.bottom() < bboxX.top() ) {
-        for (int j = bboxX.right() - 1; j >= bboxX.left(); --j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                --bboxX.x2;
-                bboxD.x1 = bboxX.x2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
+        int x2 = bboxX.left();
+        for (int i = bboxX.bottom(); i < bboxX.top() && x2 < bboxX.right(); ++i) {
+            x2 = bm.findLastOf(i, x2, bboxX.right(), done) + 1;
         }
+        if ( trimap && ( x2 > bboxX.left() ) ) {
+            flagColumnIfUnavailable(bm, x2 - 1, bboxX.bottom(), bboxX.top(), isBeingRenderedElsewhere);
+        }
+        bboxX.x2 = x2;
+        bboxD.x1 = bboxX.x2;
     }
     if ( !bboxD.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxD);
@@ -458,7 +443,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
     assert( bboxD.bottom() == bboxX.bottom() );
 
     // get the bounding box of what's left (the X rectangle in the drawing above)
-    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, _bounds, _map, isBeingRenderedElsewhere);
+    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, bm, isBeingRenderedElsewhere);
 
     if ( !bboxX.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxX);
@@ -467,6 +452,22 @@ minimalNonMarkedRects_internal(const RectI & roi,
 #endif // NATRON_BITMAP_DISABLE_OPTIMIZATION
 } // minimalNonMarkedRects
 
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+Bitmap::initialize(const RectI & bounds)
+{
+    _bounds = bounds;
+    _rowWords = bitmapRowWords( _bounds.width() );
+    _map.assign( (std::size_t)_rowWords * std::max(0, _bounds.height()), 0 );
+}
+
+void
+Bitmap::setTo1()
+{
+    std::fill( _map.begin(), _map.end(), bitmapPattern(1) );
+}
+
 RectI
 Bitmap::minimalNonMarkedBbox(const RectI & roi) const
 {
@@ -476,9 +477,9 @@ Bitmap::minimalNonMarkedBbox(const RectI & roi) const
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<0>(realRoi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(realRoi, *this, NULL);
     } else {
-        return minimalNonMarkedBbox_internal<0>(roi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(roi, *this, NULL);
     }
 }
 
@@ -491,9 +492,9 @@ Bitmap::minimalNonMarkedRects(const RectI & roi,
         if ( !roi.intersect(_dirtyZone, &realRoi) ) {
             return;
         }
-        minimalNonMarkedRects_internal<0>(realRoi, _bounds, _map, ret, NULL);
+        minimalNonMarkedRects_internal<0>(realRoi, *this, ret, NULL);
     } else {
-        minimalNonMarkedRects_internal<0>(roi, _bounds, _map, ret, NULL);
+        minimalNonMarkedRects_internal<0>(roi, *this, ret, NULL);
     }
 }
 
@@ -510,9 +511,9 @@ Bitmap::minimalNonMarkedBbox_trimap(const RectI & roi,
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<1>(realRoi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(realRoi, *this, isBeingRenderedElsewhere);
     } else {
-        return minimalNonMarkedBbox_internal<1>(roi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(roi, *this, isBeingRenderedElsewhere);
     }
 }
 
@@ -528,28 +529,84 @@ Bitmap::minimalNonMarkedRects_trimap(const RectI & roi,
 
             return;
         }
-        minimalNonMarkedRects_internal<1>(realRoi, _bounds, _map, ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(realRoi, *this, ret, isBeingRenderedElsewhere);
     } else {
-        minimalNonMarkedRects_internal<1>(roi, _bounds, _map, ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(roi, *this, ret, isBeingRenderedElsewhere);
     }
 }
 
 #endif
 
+int
+Bitmap::findFirstOf(int y,
+                    int x1,
+                    int x2,
+                    int values) const
+{
+    if (x1 >= x2) {
+        return x2;
+    }
+    assert(x1 >= _bounds.x1 && x2 <= _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2);
+
+    const U64* row = rowAt(y);
+    const int i1 = x1 - _bounds.x1;
+    const int i2 = x2 - _bounds.x1;
+    for (int w = i1 >> 5; w <= ( (i2 - 1) >> 5 ); ++w) {
+        U64 matching = bitmapMatchingPixels(row[w], values) & bitmapWordMask(w, i1, i2);
+        if (matching) {
+            return _bounds.x1 + w * 32 + countTrailingZeros(matching) / 2;
+        }
+    }
+
+    return x2;
+}
+
+int
+Bitmap::findLastOf(int y,
+                   int x1,
+                   int x2,
+                   int values) const
+{
+    if (x1 >= x2) {
+        return x1 - 1;
+    }
+    assert(x1 >= _bounds.x1 && x2 <= _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2);
+
+    const U64* row = rowAt(y);
+    const int i1 = x1 - _bounds.x1;
+    const int i2 = x2 - _bounds.x1;
+    for (int w = (i2 - 1) >> 5; w >= (i1 >> 5); --w) {
+        U64 matching = bitmapMatchingPixels(row[w], values) & bitmapWordMask(w, i1, i2);
+        if (matching) {
+            return _bounds.x1 + w * 32 + highestBit(matching) / 2;
+        }
+    }
+
+    return x1 - 1;
+}
+
 void
-Bitmap::markFor(const RectI & roi, char value)
+Bitmap::markFor(const RectI & roi,
+                char value)
 {
     int x1 = std::max(roi.x1, _bounds.x1);
     int y1 = std::max(roi.y1, _bounds.y1);
     int x2 = std::min(roi.x2, _bounds.x2);
     int y2 = std::min(roi.y2, _bounds.y2);
 
-    char* buf = BM_GET(y1, x1);
-    int w = _bounds.width();
-    int roiw = x2 - x1;
+    if ( (x1 >= x2) || (y1 >= y2) ) {
+        return;
+    }
 
-    for (int i = y1; i < y2; ++i, buf += w) {
-        std::memset( buf, value, roiw);
+    const U64 pattern = bitmapPattern(value);
+    const int i1 = x1 - _bounds.x1;
+    const int i2 = x2 - _bounds.x1;
+    for (int y = y1; y < y2; ++y) {
+        U64* row = rowAt(y);
+        for (int w = i1 >> 5; w <= ( (i2 - 1) >> 5 ); ++w) {
+            U64 mask = bitmapWordMask(w, i1, i2);
+            row[w] = (row[w] & ~mask) | (pattern & mask);
+        }
     }
 }
 
@@ -561,17 +618,12 @@ Bitmap::isNonMarked(const RectI & roi) const
     int x2 = std::min(roi.x2, _bounds.x2);
     int y2 = std::min(roi.y2, _bounds.y2);
 
-    const char* buf = BM_GET(y1, x1);
-    int w = _bounds.width();
-    int roiw = x2 - x1;
-
-    for (int i = y1; i < y2; ++i, buf += w) {
-        for (int j = 0; j < roiw; ++j) {
-            if (buf[j]) {
-                return false;
-            }
+    for (int i = y1; i < y2; ++i) {
+        if ( findFirstOf(i, x1, x2, eBitmapValuesRendered | eBitmapValuesUnavailable) < x2 ) {
+            return false;
         }
     }
+
     return true;
 }
 
@@ -588,30 +640,69 @@ void
 Bitmap::swap(Bitmap& other)
 {
     _map.swap(other._map);
-    _bounds = other._bounds;
+    std::swap(_bounds, other._bounds);
+    std::swap(_rowWords, other._rowWords);
     _dirtyZone.clear(); //merge(other._dirtyZone);
     _dirtyZoneSet = false;
 }
 
-const char*
-Bitmap::getBitmapAt(int x,
-                    int y) const
+char
+Bitmap::getValueAt(int x,
+                   int y) const
 {
     if ( ( x >= _bounds.left() ) && ( x < _bounds.right() ) && ( y >= _bounds.bottom() ) && ( y < _bounds.top() ) ) {
-        return BM_GET(y, x);
+        int i = x - _bounds.x1;
+
+        return (char)( ( rowAt(y)[i >> 5] >> ( 2 * (i & 31) ) ) & 3 );
     } else {
-        return NULL;
+        return 0;
     }
 }
 
-char*
-Bitmap::getBitmapAt(int x,
-                    int y)
+void
+Bitmap::setValueAt(int x,
+                   int y,
+                   char value)
+{
+    assert( ( x >= _bounds.left() ) && ( x < _bounds.right() ) && ( y >= _bounds.bottom() ) && ( y < _bounds.top() ) );
+    int i = x - _bounds.x1;
+    int shift = 2 * (i & 31);
+    U64& word = rowAt(y)[i >> 5];
+    word = ( word & ~( (U64)3 << shift ) ) | ( (U64)value << shift );
+}
+
+void
+Bitmap::getRow(int x1,
+               int x2,
+               int y,
+               char* values) const
 {
-    if ( ( x >= _bounds.left() ) && ( x < _bounds.right() ) && ( y >= _bounds.bottom() ) && ( y < _bounds.top() ) ) {
-        return BM_GET(y, x);
-    } else {
-        return NULL;
+    assert(x1 >= _bounds.x1 && x2 <= _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2);
+    const U64* row = rowAt(y);
+    for (int i = x1 - _bounds.x1; i < x2 - _bounds.x1; ++i, ++values) {
+        *values = (char)( ( row[i >> 5] >> ( 2 * (i & 31) ) ) & 3 );
+    }
+}
+
+void
+Bitmap::setRow(int x1,
+               int x2,
+               int y,
+               const char* values)
+{
+    assert(x1 >= _bounds.x1 && x2 <= _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2);
+    U64* row = rowAt(y);
+    const int i1 = x1 - _bounds.x1;
+    const int i2 = x2 - _bounds.x1;
+    for (int w = i1 >> 5; w <= ( (i2 - 1) >> 5 ) && i1 < i2; ++w) {
+        U64 packed = 0;
+        int first = std::max(i1, w * 32);
+        int last = std::min(i2, w * 32 + 32);
+        for (int i = first; i < last; ++i) {
+            packed |= (U64)values[i - i1] << ( 2 * (i & 31) );
+        }
+        U64 mask = bitmapWordMask(w, i1, i2);
+        row[w] = (row[w] & ~mask) | (packed & mask);
     }
 }
 
@@ -623,9 +714,6 @@ Image::printUnrenderedPixels(const RectI& roi) const
         return;
     }
     QReadLocker k(&_entryLock);
-    const char* bm = _bitmap.getBitmapAt(roi.x1, roi.y1);
-    int roiw = roi.x2 - roi.x1;
-    int boundsW = _bitmap.getBounds().width();
     RectD bboxUnrendered;
     bboxUnrendered.setupInfinity();
     RectD bboxUnavailable;
@@ -634,10 +722,10 @@ Image::printUnrenderedPixels(const RectI& roi) const
     bool hasUnrendered = false;
     bool hasUnavailable = false;
 
-    for ( int y = roi.y1; y < roi.y2; ++y,
-          bm += (boundsW - roiw) ) {
-        for (int x = roi.x1; x < roi.x2; ++x, ++bm) {
-            if (*bm == 0) {
+    for (int y = roi.y1; y < roi.y2; ++y) {
+        for (int x = roi.x1; x < roi.x2; ++x) {
+            char bm = _bitmap.getValueAt(x, y);
+            if (bm == 0) {
                 if (x < bboxUnrendered.x1) {
                     bboxUnrendered.x1 = x;
                 }
@@ -651,7 +739,7 @@ Image::printUnrenderedPixels(const RectI& roi) const
                     bboxUnrendered.y2 = y;
                 }
                 hasUnrendered = true;
-            } else if (*bm == PIXEL_UNAVAILABLE) {
+            } else if (bm == PIXEL_UNAVAILABLE) {
                 if (x < bboxUnavailable.x1) {
                     bboxUnavailable.x1 = x;
                 }
@@ -1051,9 +1139,7 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t memsize = a * pixelSize;
             std::memset(pix, 0, memsize);
             if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                char* bm = wacc.bitmapAt(aRect.x1, aRect.y1);
-                assert(bm);
-                std::memset(bm, 1, a);
+                (*outputImage)->_bitmap.markForRendered(aRect);
             }
         }
         if ( !cRect.isNull() ) {
@@ -1063,9 +1149,7 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t memsize = a * pixelSize;
             std::memset(pix, 0, memsize);
             if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                char* bm = (char*)wacc.bitmapAt(cRect.x1, cRect.y1);
-                assert(bm);
-                std::memset(bm, 1, a);
+                (*outputImage)->_bitmap.markForRendered(cRect);
             }
         }
         if ( !bRect.isNull() ) {
@@ -1075,13 +1159,11 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t rowsize = mw * pixelSize;
             int bw = bRect.width();
             std::size_t rectRowSize = bw * pixelSize;
-            char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(bRect.x1, bRect.y1) : 0;
             for (int y = bRect.y1; y < bRect.y2; ++y, pix += rowsize) {
                 std::memset(pix, 0, rectRowSize);
-                if (bm) {
-                    std::memset(bm, 1, bw);
-                    bm += mw;
-                }
+            }
+            if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                (*outputImage)->_bitmap.markForRendered(bRect);
             }
         }
         if ( !dRect.isNull() ) {
@@ -1091,13 +1173,11 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t rowsize = mw * pixelSize;
             int dw = dRect.width();
             std::size_t rectRowSize = dw * pixelSize;
-            char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(dRect.x1, dRect.y1) : 0;
             for (int y = dRect.y1; y < dRect.y2; ++y, pix += rowsize) {
                 std::memset(pix, 0, rectRowSize);
-                if (bm) {
-                    std::memset(bm, 1, dw);
-                    bm += mw;
-                }
+            }
+            if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                (*outputImage)->_bitmap.markForRendered(dRect);
             }
         }
     } // fillWithBlackAndTransparent
@@ -1121,6 +1201,31 @@ Image::resizeInternal(const Image* srcImg,
     }
 } // Image::resizeInternal
 
+RectI
+Image::getGrownBounds(const RectI& newBounds,
+                      bool setBitmapTo1) const
+{
+    RectI merge = newBounds;
+
+    merge.merge(_bounds);
+    if ( !usesBitMap() || setBitmapTo1 ) {
+        // Without a bitmap we cannot tell apart the pixels that were added, keep the exact size.
+        // Neither can we when the added pixels are marked as rendered (as the paint strokes do).
+        return merge;
+    }
+
+    RectI pixelRod;
+    _rod.toPixelEnclosing(getMipMapLevel(), _par, &pixelRod);
+
+    RectI tiled = merge.roundPowerOfTwoSmallestEnclosing(NATRON_IMAGE_TILE_SIZE_LOG2);
+    RectI clipped;
+    if ( tiled.intersect(pixelRod, &clipped) ) {
+        merge.merge(clipped);
+    }
+
+    return merge;
+}
+
 bool
 Image::copyAndResizeIfNeeded(const RectI& newBounds,
                              bool fillWithBlackAndTransparent,
@@ -1134,8 +1239,7 @@ Image::copyAndResizeIfNeeded(const RectI& newBounds,
     assert(output);
 
     QReadLocker k(&_entryLock);
-    RectI merge = newBounds;
-    merge.merge(_bounds);
+    RectI merge = getGrownBounds(newBounds, setBitmapTo1);
 
     resizeInternal(this, _bounds, merge, fillWithBlackAndTransparent, setBitmapTo1, usesBitMap(), output);
 
@@ -1154,8 +1258,7 @@ Image::ensureBounds(const RectI& newBounds,
     }
 
     QWriteLocker k(&_entryLock);
-    RectI merge = newBounds;
-    merge.merge(_bounds);
+    RectI merge = getGrownBounds(newBounds, setBitmapTo1);
 
     ImagePtr tmpImg;
     resizeInternal(this, _bounds, merge, fillWithBlackAndTransparent, setBitmapTo1, false, &tmpImg);
@@ -1834,10 +1937,8 @@ Image::halveRoIForDepth(const RectI & roi,
     ///The source rectangle, intersected to this image region of definition in pixels
     const RectI &srcBounds = _bounds;
     const RectI &dstBounds = output->_bounds;
-    const RectI &srcBmBounds = _bitmap.getBounds();
-    const RectI &dstBmBounds = output->_bitmap.getBounds();
     assert( !copyBitMap || usesBitMap() );
-    assert( !usesBitMap() || (srcBmBounds == srcBounds && dstBmBounds == dstBounds) );
+    assert( !usesBitMap() || (_bitmap.getBounds() == srcBounds && output->_bitmap.getBounds() == dstBounds) );
 
     // the srcRoD of the output should be enclosed in half the roi.
     // It does not have to be exactly half of the input.
@@ -1853,32 +1954,25 @@ Image::halveRoIForDepth(const RectI & roi,
     RectI srcRoI = roi;
     srcRoI.intersect(srcBounds, &srcRoI); // intersect srcRoI with the region of definition
 
-    dstRoI.x1 = (srcRoI.x1 + 1) / 2; // equivalent to ceil(srcRoI.x1/2.0)
-    dstRoI.y1 = (srcRoI.y1 + 1) / 2; // equivalent to ceil(srcRoI.y1/2.0)
-    dstRoI.x2 = srcRoI.x2 / 2; // equivalent to floor(srcRoI.x2/2.0)
-    dstRoI.y2 = srcRoI.y2 / 2; // equivalent to floor(srcRoI.y2/2.0)
+    // Shifts round towards -infinity, the division would round negative bounds towards 0
+    dstRoI.x1 = (srcRoI.x1 + 1) >> 1; // equivalent to ceil(srcRoI.x1/2.0)
+    dstRoI.y1 = (srcRoI.y1 + 1) >> 1; // equivalent to ceil(srcRoI.y1/2.0)
+    dstRoI.x2 = srcRoI.x2 >> 1; // equivalent to floor(srcRoI.x2/2.0)
+    dstRoI.y2 = srcRoI.y2 >> 1; // equivalent to floor(srcRoI.y2/2.0)
 
 
     const PIX* const srcPixels      = (const PIX*)pixelAt(srcBounds.x1,   srcBounds.y1);
-    const char* const srcBmPixels   = _bitmap.getBitmapAt(srcBmBounds.x1, srcBmBounds.y1);
     PIX* const dstPixels          = (PIX*)output->pixelAt(dstBounds.x1,   dstBounds.y1);
-    char* const dstBmPixels = output->_bitmap.getBitmapAt(dstBmBounds.x1, dstBmBounds.y1);
     int srcRowSize = srcBounds.width() * _nbComponents;
     int dstRowSize = dstBounds.width() * _nbComponents;
 
     // offset pointers so that srcData and dstData correspond to pixel (0,0)
     const PIX* const srcData = srcPixels - (srcBounds.x1 * _nbComponents + srcRowSize * srcBounds.y1);
     PIX* const dstData       = dstPixels - (dstBounds.x1 * _nbComponents + dstRowSize * dstBounds.y1);
-    const int srcBmRowSize = srcBmBounds.width();
-    const int dstBmRowSize = dstBmBounds.width();
-    const char* const srcBmData = srcBmPixels - (srcBmBounds.x1 + srcBmRowSize * srcBmBounds.y1);
-    char* const dstBmData       = dstBmPixels - (dstBmBounds.x1 + dstBmRowSize * dstBmBounds.y1);
 
     for (int y = dstRoI.y1; y < dstRoI.y2; ++y) {
         const PIX* const srcLineStart    = srcData + y * 2 * srcRowSize;
         PIX* const dstLineStart          = dstData + y     * dstRowSize;
-        const char* const srcBmLineStart = srcBmData + y * 2 * srcBmRowSize;
-        char* const dstBmLineStart       = dstBmData + y     * dstBmRowSize;
 
         // The current dst row, at y, covers the src rows y*2 (thisRow) and y*2+1 (nextRow).
         // Check that if are within srcBounds.
@@ -1890,9 +1984,7 @@ Image::halveRoIForDepth(const RectI & roi,
 
         for (int x = dstRoI.x1; x < dstRoI.x2; ++x) {
             const PIX* const srcPixStart    = srcLineStart   + x * 2 * _nbComponents;
-            const char* const srcBmPixStart = srcBmLineStart + x * 2;
             PIX* const dstPixStart          = dstLineStart   + x * _nbComponents;
-            char* const dstBmPixStart       = dstBmLineStart + x;
 
             // The current dst col, at y, covers the src cols x*2 (thisCol) and x*2+1 (nextCol).
             // Check that if are within srcBounds.
@@ -1909,7 +2001,7 @@ Image::halveRoIForDepth(const RectI & roi,
                     dstPixStart[k] = 0;
                 }
                 if (copyBitMap) {
-                    dstBmPixStart[0] = 0;
+                    output->_bitmap.setValueAt(x, y, 0);
                 }
                 continue;
             }
@@ -1932,10 +2024,10 @@ Image::halveRoIForDepth(const RectI & roi,
                 ///a b
                 ///c d
 
-                char a = (pickThisCol && pickThisRow) ? *(srcBmPixStart) : 0;
-                char b = (pickNextCol && pickThisRow) ? *(srcBmPixStart + 1) : 0;
-                char c = (pickThisCol && pickNextRow) ? *(srcBmPixStart + srcBmRowSize) : 0;
-                char d = (pickNextCol && pickNextRow) ? *(srcBmPixStart + srcBmRowSize  + 1)  : 0;
+                char a = (pickThisCol && pickThisRow) ? _bitmap.getValueAt(srcx, srcy) : 0;
+                char b = (pickNextCol && pickThisRow) ? _bitmap.getValueAt(srcx + 1, srcy) : 0;
+                char c = (pickThisCol && pickNextRow) ? _bitmap.getValueAt(srcx, srcy + 1) : 0;
+                char d = (pickNextCol && pickNextRow) ? _bitmap.getValueAt(srcx + 1, srcy + 1)  : 0;
 #if NATRON_ENABLE_TRIMAP
                 /*
                    The only correct solution is to convert pixels being rendered to 0 otherwise the caller
@@ -1958,8 +2050,8 @@ Image::halveRoIForDepth(const RectI & roi,
                 assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
                 assert(a + b + c + d <= sum); // bitmaps are 0 or 1
                 // the following is an integer division, the result can be 0 or 1
-                dstBmPixStart[0] = (a + b + c + d) / sum;
-                assert(dstBmPixStart[0] == 0 || dstBmPixStart[0] == 1);
+                output->_bitmap.setValueAt(x, y, (a + b + c + d) / sum);
+                assert(output->_bitmap.getValueAt(x, y) == 0 || output->_bitmap.getValueAt(x, y) == 1);
             }
         }
     }
@@ -2088,7 +2180,7 @@ Image::downscaleMipMap(const RectD& dstRod,
 //    roiCanonical.toPixelEnclosing(toLevel, par , &dstRoI);
     unsigned int downscaleLvls = toLevel - fromLevel;
 
-    assert( !copyBitMap || _bitmap.getBitmap() );
+    assert( !copyBitMap || !_bitmap.getBounds().isNull() );
 
     RectI dstRoI  = roi.downscalePowerOfTwoSmallestEnclosing(downscaleLvls);
     ImagePtr tmpImg = boost::make_shared<Image>( getComponents(), dstRod, dstRoI, toLevel, par, getBitDepth(), getPremultiplication(), getFieldingOrder(), true);
@@ -2243,6 +2335,224 @@ Image::upscaleMipMap(const RectI & roi,
     }
 }
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// A mipmap pyramid built row by row: each row of a level is computed from the two rows of the
+// previous level it covers, so that no intermediate image is allocated.
+// Level 0 is the source image and the last level is written directly into the output image.
+struct MipMapPyramid
+{
+    // For each level, the bounds of the image allocated by the level-by-level halving, and
+    // the part of them written by Image::halveRoI(). The rest of the bounds is set to 0.
+    std::vector<RectI> bounds;
+    std::vector<RectI> computed;
+    int nComps;
+    ImageBitDepthEnum depth;
+    std::size_t pixelSize; // in bytes
+    const unsigned char* srcPixels; // pixel (srcBounds.x1, srcBounds.y1)
+    const Bitmap* srcBitmap; // NULL if the bitmap is not copied
+    RectI srcBounds;
+    unsigned char* dstPixels; // pixel (dstBounds.x1, dstBounds.y1)
+    Bitmap* dstBitmap;
+    RectI dstBounds;
+};
+
+// The two rows of an intermediate level needed to compute a row of the next level.
+// The bitmap rows are unpacked to one char per pixel, those of level 0 are read from the source bitmap.
+struct MipMapScratchRows
+{
+    std::vector<unsigned char> pixels[2];
+    std::vector<char> bitmap[2];
+};
+
+void
+computeMipMapRow(const MipMapPyramid& p,
+                 std::vector<MipMapScratchRows>& scratch,
+                 unsigned int level,
+                 int y,
+                 unsigned char* dst, // pixel bounds[level].x1 of the row
+                 char* dstBitmap)
+{
+    const RectI& bounds = p.bounds[level];
+    const RectI& computed = p.computed[level];
+
+    if ( (y < computed.y1) || (y >= computed.y2) || (computed.x1 >= computed.x2) ) {
+        std::memset(dst, 0, bounds.width() * p.pixelSize);
+        if (dstBitmap) {
+            std::memset( dstBitmap, 0, bounds.width() );
+        }
+
+        return;
+    }
+
+    const unsigned char* src[2];
+    const char* srcBitmap[2] = { NULL, NULL };
+    for (int i = 0; i < 2; ++i) {
+        int srcY = 2 * y + i;
+        if (level == 1) {
+            std::size_t srcOffset = (std::size_t)(srcY - p.srcBounds.y1) * p.srcBounds.width() + (2 * computed.x1 - p.srcBounds.x1);
+            src[i] = p.srcPixels + srcOffset * p.pixelSize;
+            if (dstBitmap) {
+                std::vector<char>& bitmapRow = scratch[0].bitmap[i];
+                p.srcBitmap->getRow(2 * computed.x1, 2 * computed.x2, srcY, &bitmapRow.front());
+                srcBitmap[i] = &bitmapRow.front();
+            }
+        } else {
+            const RectI& srcBounds = p.bounds[level - 1];
+            MipMapScratchRows& rows = scratch[level - 1];
+            computeMipMapRow(p, scratch, level - 1, srcY, &rows.pixels[i].front(), dstBitmap ? &rows.bitmap[i].front() : NULL);
+            src[i] = &rows.pixels[i].front() + (2 * computed.x1 - srcBounds.x1) * p.pixelSize;
+            if (dstBitmap) {
+                srcBitmap[i] = &rows.bitmap[i].front() + (2 * computed.x1 - srcBounds.x1);
+            }
+        }
+    }
+
+    // Zero the pixels of the bounds that are not computed
+    std::memset(dst, 0, (computed.x1 - bounds.x1) * p.pixelSize);
+    std::memset(dst + (computed.x2 - bounds.x1) * p.pixelSize, 0, (bounds.x2 - computed.x2) * p.pixelSize);
+
+    MipMapHalveRowArgs args;
+    args.src0 = src[0];
+    args.src1 = src[1];
+    args.dst = dst + (computed.x1 - bounds.x1) * p.pixelSize;
+    args.width = computed.width();
+    args.nComps = p.nComps;
+    args.depth = p.depth;
+    MipMapKernels::halveRow(args);
+
+    if (dstBitmap) {
+        std::memset(dstBitmap, 0, computed.x1 - bounds.x1);
+        std::memset(dstBitmap + (computed.x2 - bounds.x1), 0, bounds.x2 - computed.x2);
+        MipMapKernels::halveBitmapRow( srcBitmap[0], srcBitmap[1], dstBitmap + (computed.x1 - bounds.x1), computed.width() );
+    }
+} // computeMipMapRow
+
+// Computes the rows [band.first, band.second) of the last level
+void
+buildMipMapBand(const MipMapPyramid* p,
+                const std::pair<int, int>& band)
+{
+    const unsigned int level = p->bounds.size() - 1;
+
+    // Allocated once for all the rows of the band
+    std::vector<MipMapScratchRows> scratch(level);
+    if (p->dstBitmap) {
+        for (int j = 0; j < 2; ++j) {
+            scratch[0].bitmap[j].resize( std::max(1, 2 * p->computed[1].width() ) );
+        }
+    }
+    for (unsigned int i = 1; i < level; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            scratch[i].pixels[j].resize(p->bounds[i].width() * p->pixelSize);
+            if (p->dstBitmap) {
+                scratch[i].bitmap[j].resize( p->bounds[i].width() );
+            }
+        }
+    }
+
+    const RectI& bounds = p->bounds[level];
+    std::vector<char> dstBitmapRow;
+    if (p->dstBitmap) {
+        dstBitmapRow.resize( std::max( 1, bounds.width() ) );
+    }
+    for (int y = band.first; y < band.second; ++y) {
+        std::size_t dstOffset = (std::size_t)(y - p->dstBounds.y1) * p->dstBounds.width() + (bounds.x1 - p->dstBounds.x1);
+        computeMipMapRow(*p, scratch, level, y, p->dstPixels + dstOffset * p->pixelSize, p->dstBitmap ? &dstBitmapRow.front() : NULL);
+        if (p->dstBitmap) {
+            // Each row of the bitmap starts on a new word, so that the bands can write their rows concurrently
+            p->dstBitmap->setRow(bounds.x1, bounds.x2, y, &dstBitmapRow.front());
+        }
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+bool
+Image::buildMipMapLevelFused(const RectI & roi,
+                             unsigned int level,
+                             bool copyBitMap,
+                             Image* output) const
+{
+    assert(level > 0);
+    if ( (_bitDepth != eImageBitDepthByte) && (_bitDepth != eImageBitDepthShort) && (_bitDepth != eImageBitDepthFloat) ) {
+        return false;
+    }
+
+    MipMapPyramid p;
+    p.bounds.resize(level + 1);
+    p.computed.resize(level + 1);
+    p.bounds[0] = roi;
+    if ( !roi.intersect(_bounds, &p.computed[0]) ) {
+        return false;
+    }
+    for (unsigned int i = 1; i <= level; ++i) {
+        const RectI& prevBounds = p.bounds[i - 1];
+        if ( (prevBounds.width() == 1) || (prevBounds.height() == 1) ) {
+            // halveRoI() uses halve1DImage() there
+            return false;
+        }
+        p.bounds[i] = prevBounds.downscalePowerOfTwoSmallestEnclosing(1);
+
+        // Same as halveRoIForDepth(): only the pixels covering 2x2 source pixels are computed
+        const RectI& src = (i == 1) ? p.computed[0] : prevBounds;
+        RectI& computed = p.computed[i];
+        computed.x1 = (src.x1 + 1) >> 1; // ceil(src.x1/2.0)
+        computed.y1 = (src.y1 + 1) >> 1;
+        computed.x2 = std::max(src.x2 >> 1, computed.x1); // floor(src.x2/2.0)
+        computed.y2 = std::max(src.y2 >> 1, computed.y1);
+    }
+
+    const RectI& lastBounds = p.bounds[level];
+    if ( !output->_bounds.contains(lastBounds) || (output->getComponentsCount() != getComponentsCount()) || (output->_bitDepth != _bitDepth) ) {
+        return false;
+    }
+
+    /// Take the lock for both bitmaps since we're about to read/write from them!
+    QWriteLocker k1(&output->_entryLock);
+    QReadLocker k2(&_entryLock);
+
+    p.nComps = _nbComponents;
+    p.depth = _bitDepth;
+    p.pixelSize = _nbComponents * _depthBytesSize;
+    p.srcBounds = _bounds;
+    p.srcPixels = pixelAt(_bounds.x1, _bounds.y1);
+    p.dstBounds = output->_bounds;
+    p.dstPixels = output->pixelAt(p.dstBounds.x1, p.dstBounds.y1);
+    p.srcBitmap = NULL;
+    p.dstBitmap = NULL;
+    if (copyBitMap && output->_useBitmap) {
+        if ( (_bitmap.getBounds() != _bounds) || (output->_bitmap.getBounds() != output->_bounds) ) {
+            return false;
+        }
+        p.srcBitmap = &_bitmap;
+        p.dstBitmap = &output->_bitmap;
+    }
+    if ( !p.srcPixels || !p.dstPixels ) {
+        return false;
+    }
+
+    // Split the rows of the last level in bands: each band computes the rows of all the levels it covers
+    std::vector<std::pair<int, int> > bands;
+    int nBands = 1;
+    TaskScheduler* scheduler = appPTR ? appPTR->getTaskScheduler() : 0;
+    if ( scheduler && ( (double)p.computed[0].area() >= (double)NATRON_MIPMAP_MIN_PARALLEL_AREA ) ) {
+        nBands = std::min( lastBounds.height(), 4 * (scheduler->getMaxThreadCount() + 1) );
+    }
+    for (int i = 0; i < nBands; ++i) {
+        bands.push_back( std::make_pair( lastBounds.y1 + (int)( (long long)lastBounds.height() * i / nBands ),
+                                         lastBounds.y1 + (int)( (long long)lastBounds.height() * (i + 1) / nBands ) ) );
+    }
+
+    if (bands.size() == 1) {
+        buildMipMapBand(&p, bands.front());
+    } else {
+        scheduler->blockingMap( bands, boost::bind(&buildMipMapBand, &p, _1) );
+    }
+
+    return true;
+} // buildMipMapLevelFused
+
 // code proofread and fixed by @devernay on 8/8/2014
 void
 Image::buildMipMapLevel(const RectD& dstRoD,
@@ -2266,6 +2576,10 @@ Image::buildMipMapLevel(const RectD& dstRoD,
         return;
     }
 
+    if ( buildMipMapLevelFused(roi, level, copyBitMap, output) ) {
+        return;
+    }
+
     const Image* srcImg = this;
     Image* dstImg = NULL;
     bool mustFreeSrc = false;
@@ -2339,14 +2653,23 @@ Bitmap::copyRowPortion(int x1,
                        int y,
                        const Bitmap& other)
 {
-    const char* srcBitmap = other.getBitmapAt(x1, y);
-    char* dstBitmap = getBitmapAt(x1, y);
-    const char* end = dstBitmap + (x2 - x1);
+    assert(x1 >= _bounds.x1 && x2 <= _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2);
+    assert(x1 >= other._bounds.x1 && x2 <= other._bounds.x2 && y >= other._bounds.y1 && y < other._bounds.y2);
+
+    if (x1 >= x2) {
+        return;
+    }
 
-    while (dstBitmap < end) {
-        *dstBitmap = /**srcBitmap == PIXEL_UNAVAILABLE ? 0 : */ *srcBitmap;
-        ++dstBitmap;
-        ++srcBitmap;
+    // The two bitmaps may not have the same x1: read the source 32 pixels at a time at the offset of each destination word
+    const U64* srcRow = other.rowAt(y);
+    U64* dstRow = rowAt(y);
+    const int i1 = x1 - _bounds.x1;
+    const int i2 = x2 - _bounds.x1;
+    const int offset = _bounds.x1 - other._bounds.x1;
+    for (int w = i1 >> 5; w <= ( (i2 - 1) >> 5 ); ++w) {
+        U64 pixels = bitmapReadPixels(srcRow, other._rowWords, w * 32 + offset);
+        U64 mask = bitmapWordMask(w, i1, i2);
+        dstRow[w] = (dstRow[w] & ~mask) | (pixels & mask);
     }
 }
 
@@ -2364,22 +2687,8 @@ Bitmap::copyBitmapPortion(const RectI& roi,
     assert(roi.x1 >= _bounds.x1 && roi.x2 <= _bounds.x2 && roi.y1 >= _bounds.y1 && roi.y2 <= _bounds.y2);
     assert(roi.x1 >= other._bounds.x1 && roi.x2 <= other._bounds.x2 && roi.y1 >= other._bounds.y1 && roi.y2 <= other._bounds.y2);
 
-    int srcRowSize = other._bounds.width();
-    int dstRowSize = _bounds.width();
-    const char* srcBitmap = other.getBitmapAt(roi.x1, roi.y1);
-    char* dstBitmap = getBitmapAt(roi.x1, roi.y1);
-
-    for (int y = roi.y1; y < roi.y2; ++y,
-         srcBitmap += srcRowSize,
-         dstBitmap += dstRowSize) {
-        const char* srcCur = srcBitmap;
-        const char* srcEnd = srcBitmap + roi.width();
-        char* dstCur = dstBitmap;
-        while (srcCur < srcEnd) {
-            *dstCur = /**srcCur == PIXEL_UNAVAILABLE ? 0 : */ *srcCur;
-            ++srcCur;
-            ++dstCur;
-        }
+    for (int y = roi.y1; y < roi.y2; ++y) {
+        copyRowPortion(roi.x1, roi.x2, y, other);
     }
 }
 
@@ -32,6 +32,7 @@
 #include <map>
 #include <algorithm> // min, max
 #include <bitset>
+#include <vector>
 
 #include "Global/GlobalDefines.h"
 
@@ -49,6 +50,15 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
+/*
+ * When an image holding a bitmap has to grow, its bounds are extended to a grid of
+ * tiles of 2^NATRON_IMAGE_TILE_SIZE_LOG2 pixels (clipped to the region of definition)
+ * so that panning or zooming over the same node does not reallocate and copy the
+ * whole buffer for every few new pixels. The extra area is marked as unrendered.
+ * The buffer stays contiguous: this is not a tiled storage.
+ */
+#define NATRON_IMAGE_TILE_SIZE_LOG2 8
+
 
 NATRON_NAMESPACE_ENTER
 
@@ -64,12 +74,19 @@ public:
     }
 };
 
+/**
+ * @brief The render state of the pixels of an image: 0 if the pixel is not rendered, 1 if it is rendered
+ * and 2 if it is being rendered by another thread (only with the trimap).
+ * Each pixel takes 2 bits and each row starts on a 64-bit word, so that the bitmap of a 4K image takes 2MB
+ * and the searches for unrendered pixels test 32 pixels at a time.
+ **/
 class Bitmap
 {
 public:
     Bitmap(const RectI & bounds)
-        : _bounds(bounds)
-        , _map( bounds.area() )
+        : _bounds()
+        , _rowWords(0)
+        , _map()
         , _dirtyZone()
         , _dirtyZoneSet(false)
     {
@@ -77,39 +94,36 @@ public:
         // "identities" images (i.e: images that are just a link to another image). See EffectInstance :
         // "!!!Note that if isIdentity is true it will allocate an empty image object with 0 bytes of data."
         //assert(!rod.isNull());
-        std::fill(_map.begin(), _map.end(), 0);
+        initialize(bounds);
     }
 
     Bitmap()
         : _bounds()
+        , _rowWords(0)
         , _map()
         , _dirtyZone()
         , _dirtyZoneSet(false)
     {
     }
 
-    void initialize(const RectI & bounds)
-    {
-        _bounds = bounds;
-        _map.resize( _bounds.area() );
-
-        std::fill(_map.begin(), _map.end(), 0);
-    }
+    void initialize(const RectI & bounds);
 
     ~Bitmap()
     {
     }
 
-    void setTo1()
-    {
-        std::fill(_map.begin(), _map.end(), 1);
-    }
+    void setTo1();
 
     const RectI & getBounds() const
     {
         return _bounds;
     }
 
+    std::size_t getMemorySize() const
+    {
+        return _map.size() * sizeof(U64);
+    }
+
 #if NATRON_ENABLE_TRIMAP
     void minimalNonMarkedRects_trimap(const RectI & roi, std::list<RectI>& ret, bool* isBeingRenderedElsewhere) const;
     RectI minimalNonMarkedBbox_trimap(const RectI & roi, bool* isBeingRenderedElsewhere) const;
@@ -133,18 +147,24 @@ public:
 
     void swap(Bitmap& other);
 
-    const char* getBitmap() const
-    {
-        return &_map.front();
-    }
+    /**
+     * @brief Returns the state of the pixel (x,y), or 0 if it is outside of the bounds.
+     **/
+    char getValueAt(int x, int y) const;
+    void setValueAt(int x, int y, char value);
 
-    char* getBitmap()
-    {
-        return &_map.front();
-    }
+    /**
+     * @brief Unpacks the states of the pixels [x1,x2) of the row y, one char per pixel, and the converse.
+     **/
+    void getRow(int x1, int x2, int y, char* values) const;
+    void setRow(int x1, int x2, int y, const char* values);
 
-    const char* getBitmapAt(int x, int y) const;
-    char* getBitmapAt(int x, int y);
+    /**
+     * @brief Returns the first (resp. last) x in [x1,x2) of the row y whose state is in the values set,
+     * or x2 (resp. x1 - 1) if there is none. values is a combination of the flags 1 << state.
+     **/
+    int findFirstOf(int y, int x1, int x2, int values) const;
+    int findLastOf(int y, int x1, int x2, int values) const;
 
     void copyRowPortion(int x1, int x2, int y, const Bitmap& other);
 
@@ -159,9 +179,20 @@ public:
 private:
     void markFor(const RectI & roi, char value);
 
+    U64* rowAt(int y)
+    {
+        return &_map[(std::size_t)(y - _bounds.y1) * _rowWords];
+    }
+
+    const U64* rowAt(int y) const
+    {
+        return &_map[(std::size_t)(y - _bounds.y1) * _rowWords];
+    }
+
 private:
     RectI _bounds;
-    std::vector<char> _map;
+    int _rowWords; // number of 64-bit words of a row
+    std::vector<U64> _map;
 
     /**
      * This represents the zone that has potentially something to render. In minimalNonMarkedRects
@@ -256,6 +287,13 @@ public:
      **/
     bool copyAndResizeIfNeeded(const RectI& newBounds, bool fillWithBlackAndTransparent, bool setBitmapTo1, ImagePtr* output);
 
+    /**
+     * @brief Returns the bounds the image would have after a call to ensureBounds(newBounds): the union of the current
+     * bounds and newBounds, grown to the tile grid (see NATRON_IMAGE_TILE_SIZE_LOG2) when the image has a bitmap and
+     * setBitmapTo1 is false.
+     **/
+    RectI getGrownBounds(const RectI& newBounds, bool setBitmapTo1 = false) const;
+
 
     static void applyTextureMapping(const RectI& bounds, const RectI& roi);
 
@@ -303,7 +341,7 @@ public:
         std::size_t dt = dataSize();
         bool got = _entryLock.tryLockForRead();
 
-        dt += _bitmap.getBounds().area();
+        dt += _bitmap.getMemorySize();
         if (got) {
             _entryLock.unlock();
         }
@@ -411,12 +449,12 @@ public:
             return img->pixelAt(x, y);
         }
 
-        const char* bitmapAt(int x,
-                             int y) const
+        char bitmapValueAt(int x,
+                           int y) const
         {
             assert(img);
 
-            return img->getBitmapAt(x, y);
+            return img->getBitmapValueAt(x, y);
         }
     };
 
@@ -463,12 +501,12 @@ public:
             return img->pixelAt(x, y);
         }
 
-        char* bitmapAt(int x,
-                       int y) const
+        char bitmapValueAt(int x,
+                           int y) const
         {
             assert(img);
 
-            return img->getBitmapAt(x, y);
+            return img->getBitmapValueAt(x, y);
         }
     };
 
@@ -496,16 +534,10 @@ private:
      * of an image.
      **/
 
-    const char* getBitmapAt(int x,
-                            int y) const
+    char getBitmapValueAt(int x,
+                          int y) const
     {
-        return this->_bitmap.getBitmapAt(x, y);
-    }
-
-    char* getBitmapAt(int x,
-                      int y)
-    {
-        return this->_bitmap.getBitmapAt(x, y);
+        return this->_bitmap.getValueAt(x, y);
     }
 
     /**
@@ -989,6 +1021,14 @@ private:
     void buildMipMapLevel(const RectD& dstRoD, const RectI & roiCanonical, unsigned int level, bool copyBitMap,
                           Image* output) const;
 
+    /**
+     * @brief Same as buildMipMapLevel() in a single pass, without intermediate images: each row of a level is
+     * computed from the rows of the previous level it covers, and the rows of the last level are split across threads.
+     * Returns false without writing anything if the mipmap can only be built level by level.
+     **/
+    bool buildMipMapLevelFused(const RectI & roi, unsigned int level, bool copyBitMap,
+                               Image* output) const;
+
 
     /**
      * @brief Halve the given roi of this image into output.
@@ -0,0 +1,259 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ImageMipMapKernels.h"
+
+#include <algorithm> // min
+#include <cassert>
+
+#ifdef NATRON_KERNELS_X86
+#include <smmintrin.h>
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+template <typename PIX, typename SUM>
+void
+halveRowForDepth(const MipMapHalveRowArgs& args)
+{
+    const PIX* src0 = (const PIX*)args.src0;
+    const PIX* src1 = (const PIX*)args.src1;
+    PIX* dst = (PIX*)args.dst;
+    const int nComps = args.nComps;
+
+    for (int x = 0; x < args.width; ++x) {
+        for (int k = 0; k < nComps; ++k) {
+            ///a b
+            ///c d
+            const SUM a = src0[k];
+            const SUM b = src0[k + nComps];
+            const SUM c = src1[k];
+            const SUM d = src1[k + nComps];
+            *dst++ = PIX( (a + b + c + d) / 4 );
+        }
+        src0 += 2 * nComps;
+        src1 += 2 * nComps;
+    }
+}
+
+void
+halveRow_scalar(const MipMapHalveRowArgs& args)
+{
+    switch (args.depth) {
+    case eImageBitDepthByte:
+        halveRowForDepth<unsigned char, int>(args);
+        break;
+    case eImageBitDepthShort:
+        halveRowForDepth<unsigned short, int>(args);
+        break;
+    case eImageBitDepthFloat:
+        halveRowForDepth<float, float>(args);
+        break;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+}
+
+#ifdef NATRON_KERNELS_X86
+
+NATRON_TARGET_SSE41
+void
+halveRowFloatRGBA_SSE41(const MipMapHalveRowArgs& args)
+{
+    const float* src0 = (const float*)args.src0;
+    const float* src1 = (const float*)args.src1;
+    float* dst = (float*)args.dst;
+    const __m128 quarter = _mm_set1_ps(0.25f);
+
+    for (int x = 0; x < args.width; ++x) {
+        __m128 a = _mm_loadu_ps(src0);
+        __m128 b = _mm_loadu_ps(src0 + 4);
+        __m128 c = _mm_loadu_ps(src1);
+        __m128 d = _mm_loadu_ps(src1 + 4);
+        // Same order of the additions as the scalar code, dividing by 4 is exact
+        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d);
+        _mm_storeu_ps( dst, _mm_mul_ps(sum, quarter) );
+        src0 += 8;
+        src1 += 8;
+        dst += 4;
+    }
+}
+
+NATRON_TARGET_SSE41
+inline __m128i
+halvePixelShortRGBA_SSE41(const unsigned short* src0,
+                          const unsigned short* src1)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i ab = _mm_loadu_si128( (const __m128i*)src0 );
+    __m128i cd = _mm_loadu_si128( (const __m128i*)src1 );
+    __m128i sum = _mm_add_epi32( _mm_add_epi32( _mm_unpacklo_epi16(ab, zero), _mm_unpackhi_epi16(ab, zero) ),
+                                 _mm_add_epi32( _mm_unpacklo_epi16(cd, zero), _mm_unpackhi_epi16(cd, zero) ) );
+
+    return _mm_srli_epi32(sum, 2);
+}
+
+NATRON_TARGET_SSE41
+void
+halveRowShortRGBA_SSE41(const MipMapHalveRowArgs& args)
+{
+    const unsigned short* src0 = (const unsigned short*)args.src0;
+    const unsigned short* src1 = (const unsigned short*)args.src1;
+    unsigned short* dst = (unsigned short*)args.dst;
+    int x = 0;
+
+    for (; x + 2 <= args.width; x += 2) {
+        __m128i p0 = halvePixelShortRGBA_SSE41(src0, src1);
+        __m128i p1 = halvePixelShortRGBA_SSE41(src0 + 8, src1 + 8);
+        _mm_storeu_si128( (__m128i*)dst, _mm_packus_epi32(p0, p1) );
+        src0 += 16;
+        src1 += 16;
+        dst += 8;
+    }
+    if (x < args.width) {
+        __m128i p0 = halvePixelShortRGBA_SSE41(src0, src1);
+        _mm_storel_epi64( (__m128i*)dst, _mm_packus_epi32(p0, p0) );
+    }
+}
+
+NATRON_TARGET_SSE41
+void
+halveRowByteRGBA_SSE41(const MipMapHalveRowArgs& args)
+{
+    const unsigned char* src0 = (const unsigned char*)args.src0;
+    const unsigned char* src1 = (const unsigned char*)args.src1;
+    unsigned char* dst = (unsigned char*)args.dst;
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    // 2 destination pixels per iteration: 4 source pixels of each row, widened to 16 bits
+    for (; x + 2 <= args.width; x += 2) {
+        __m128i ab = _mm_loadu_si128( (const __m128i*)src0 );
+        __m128i cd = _mm_loadu_si128( (const __m128i*)src1 );
+        __m128i sumLo = _mm_add_epi16( _mm_unpacklo_epi8(ab, zero), _mm_unpacklo_epi8(cd, zero) );
+        __m128i sumHi = _mm_add_epi16( _mm_unpackhi_epi8(ab, zero), _mm_unpackhi_epi8(cd, zero) );
+        // add the 2 source columns of each destination pixel
+        sumLo = _mm_add_epi16( sumLo, _mm_srli_si128(sumLo, 8) );
+        sumHi = _mm_add_epi16( sumHi, _mm_srli_si128(sumHi, 8) );
+        __m128i sum = _mm_srli_epi16(_mm_unpacklo_epi64(sumLo, sumHi), 2);
+        _mm_storel_epi64( (__m128i*)dst, _mm_packus_epi16(sum, sum) );
+        src0 += 16;
+        src1 += 16;
+        dst += 8;
+    }
+    if (x < args.width) {
+        MipMapHalveRowArgs last = args;
+        last.src0 = src0;
+        last.src1 = src1;
+        last.dst = dst;
+        last.width = args.width - x;
+        halveRowForDepth<unsigned char, int>(last);
+    }
+}
+
+NATRON_TARGET_SSE41
+void
+halveRow_SSE41(const MipMapHalveRowArgs& args)
+{
+    if (args.nComps != 4) {
+        halveRow_scalar(args);
+
+        return;
+    }
+    switch (args.depth) {
+    case eImageBitDepthByte:
+        halveRowByteRGBA_SSE41(args);
+        break;
+    case eImageBitDepthShort:
+        halveRowShortRGBA_SSE41(args);
+        break;
+    case eImageBitDepthFloat:
+        halveRowFloatRGBA_SSE41(args);
+        break;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+}
+
+#endif // NATRON_KERNELS_X86
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+namespace MipMapKernels {
+
+KernelsISAEnum
+getSupportedISA()
+{
+    // There is no AVX2 kernel
+    return std::min(getSupportedKernelsISA(), eKernelsISASSE41);
+}
+
+void
+halveRow(const MipMapHalveRowArgs& args,
+         KernelsISAEnum isa)
+{
+    assert(isa <= getSupportedISA());
+    switch (isa) {
+#ifdef NATRON_KERNELS_X86
+    case eKernelsISASSE41:
+        halveRow_SSE41(args);
+        break;
+#endif
+    default:
+        halveRow_scalar(args);
+        break;
+    }
+}
+
+void
+halveRow(const MipMapHalveRowArgs& args)
+{
+    halveRow( args, getSupportedISA() );
+}
+
+void
+halveBitmapRow(const char* src0,
+               const char* src1,
+               char* dst,
+               int width)
+{
+    for (int x = 0; x < width; ++x) {
+        // The bitmap holds 0 or 1, or PIXEL_UNAVAILABLE with the trimap, which counts as 0:
+        // the average of the 4 pixels is 1 only if they are all 1
+        dst[x] = (src0[0] == 1 && src0[1] == 1 && src1[0] == 1 && src1[1] == 1) ? 1 : 0;
+        src0 += 2;
+        src1 += 2;
+    }
+}
+
+} // namespace MipMapKernels
+
+NATRON_NAMESPACE_EXIT
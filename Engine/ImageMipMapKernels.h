@@ -0,0 +1,84 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_ImageMipMapKernels_h
+#define Natron_Engine_ImageMipMapKernels_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+#include "Engine/KernelsISA.h"
+
+NATRON_NAMESPACE_ENTER
+
+/*
+   Row kernels used by Image::buildMipMapLevel() to halve an image.
+
+   A destination pixel x is the box average of the source pixels 2x and 2x+1 of two
+   consecutive source rows, computed as (a + b + c + d) / 4 in the type of the image,
+   integers being truncated: this is what Image::halveRoI() does.
+   The 4-channel images use SSE4.1 kernels when the CPU supports them, the other
+   channel counts go through the scalar kernels. All variants produce the same output.
+ */
+
+struct MipMapHalveRowArgs
+{
+    const void* src0; // pixel 2*x of the first source row
+    const void* src1; // pixel 2*x of the second source row
+    void* dst; // pixel x of the destination row
+    int width; // number of destination pixels
+    int nComps;
+    ImageBitDepthEnum depth; // byte, short or float
+};
+
+namespace MipMapKernels {
+
+/**
+ * @brief Returns the best instruction set of getSupportedKernelsISA() that has mipmap kernels.
+ **/
+KernelsISAEnum getSupportedISA();
+
+/**
+ * @brief Halve two source rows into a destination row with the best kernel supported by the CPU.
+ **/
+void halveRow(const MipMapHalveRowArgs& args);
+
+/**
+ * @brief Same as above with an explicit instruction set, which must be supported.
+ **/
+void halveRow(const MipMapHalveRowArgs& args, KernelsISAEnum isa);
+
+/**
+ * @brief Halve two rows of a bitmap: a destination pixel is marked rendered only if the 4 source pixels are.
+ * Pixels being rendered elsewhere (with the trimap) count as not rendered.
+ **/
+void halveBitmapRow(const char* src0, const char* src1, char* dst, int width);
+
+} // namespace MipMapKernels
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Natron_Engine_ImageMipMapKernels_h
@@ -0,0 +1,97 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "KernelsISA.h"
+
+#ifdef NATRON_KERNELS_X86
+#if defined(__GNUC__) || defined(__clang__)
+#include <cpuid.h>
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+#ifdef NATRON_KERNELS_X86
+
+KernelsISAEnum
+detectKernelsISA()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    unsigned int eax, ebx, ecx, edx;
+    bool f16c = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1 << 29)) != 0;
+    if ( __builtin_cpu_supports("avx2") && f16c ) {
+        return eKernelsISAAVX2;
+    } else if ( __builtin_cpu_supports("sse4.1") ) {
+        return eKernelsISASSE41;
+    }
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool f16c = (info[2] & (1 << 29)) != 0;
+    if (osxsave && avx && f16c) {
+        // The OS must also save the YMM registers
+        bool ymmSaved = (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        if ( ymmSaved && (info[1] & (1 << 5)) ) {
+            return eKernelsISAAVX2;
+        }
+    }
+    if (sse41) {
+        return eKernelsISASSE41;
+    }
+#endif
+
+    return eKernelsISAScalar;
+}
+
+#else // !NATRON_KERNELS_X86
+
+KernelsISAEnum
+detectKernelsISA()
+{
+    return eKernelsISAScalar;
+}
+
+#endif // NATRON_KERNELS_X86
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+KernelsISAEnum
+getSupportedKernelsISA()
+{
+    static const KernelsISAEnum isa = detectKernelsISA();
+
+    return isa;
+}
+
+NATRON_NAMESPACE_EXIT
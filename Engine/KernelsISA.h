@@ -0,0 +1,69 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_KernelsISA_h
+#define Natron_Engine_KernelsISA_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+/*
+   The instruction sets of the vectorized row kernels (ViewerInstanceKernels, ImageMipMapKernels).
+
+   The vectorized kernels are compiled for their instruction set only, with the NATRON_TARGET_*
+   function attributes, the rest of the code stays generic: the kernel to use is selected at
+   runtime from getSupportedKernelsISA().
+ */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#if defined(__GNUC__) || defined(__clang__)
+#define NATRON_KERNELS_X86
+#define NATRON_TARGET_SSE41 __attribute__( ( target("sse4.1") ) )
+#define NATRON_TARGET_AVX2 __attribute__( ( target("avx2") ) )
+#define NATRON_TARGET_F16C __attribute__( ( target("avx,f16c") ) )
+#elif defined(_MSC_VER)
+#define NATRON_KERNELS_X86
+#define NATRON_TARGET_SSE41
+#define NATRON_TARGET_AVX2
+#define NATRON_TARGET_F16C
+#endif
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+enum KernelsISAEnum
+{
+    eKernelsISAScalar = 0,
+    eKernelsISASSE41,
+    eKernelsISAAVX2 // AVX2 and F16C
+};
+
+/**
+ * @brief Returns the best instruction set supported by this CPU (and this build). Computed once.
+ **/
+KernelsISAEnum getSupportedKernelsISA();
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Natron_Engine_KernelsISA_h
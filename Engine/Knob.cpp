@@ -51,11 +51,15 @@
 #include "Engine/KnobSerialization.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/LibraryBinary.h"
+#include "Engine/NativeExpression.h"
 #include "Engine/Node.h"
+#include "Engine/ParallelRenderArgs.h"
 #include "Engine/Project.h"
+#include "Engine/RenderStats.h"
 #include "Engine/StringAnimationManager.h"
 #include "Engine/TLSHolder.h"
 #include "Engine/TimeLine.h"
+#include "Engine/Timer.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerInstance.h"
@@ -227,10 +231,15 @@ struct Expr
     ///The list of pair<knob, dimension> dpendencies for an expression
     std::list<std::pair<KnobIWPtr, int> > dependencies;
 
-    //PyObject* code;
+    ///The call to the expression function compiled once when the expression is set, evaluated
+    ///with the frame and view as locals. NULL if the expression is invalid. Owned (new ref), protected by the GIL.
+    PyObject* code;
+
+    ///The expression compiled for the native evaluator, NULL if Python must evaluate it
+    NativeExpressionPtr native;
 
     Expr()
-        : expression(), originalExpression(), exprInvalid(), hasRet(false) /*, code(0)*/ {}
+        : expression(), originalExpression(), exprInvalid(), hasRet(false), code(0), native() {}
 };
 
 struct KnobHelperPrivate
@@ -436,6 +445,14 @@ KnobHelper::KnobHelper(KnobHolder* holder,
 
 KnobHelper::~KnobHelper()
 {
+    // The interpreter may already be gone when the application quits
+    if ( Py_IsInitialized() ) {
+        PythonGILLocker pgl;
+        for (std::size_t i = 0; i < _imp->expressions.size(); ++i) {
+            Py_XDECREF(_imp->expressions[i].code);
+            _imp->expressions[i].code = 0;
+        }
+    }
 }
 
 void
@@ -2701,6 +2718,15 @@ KnobHelper::setExpressionInternal(int dimension,
         }
     }
 
+    // exprCpy is "ret = <expression function>": compile the call to the function once, so that
+    // evaluating the expression does not have to parse a script each time.
+    PyObject* code = 0;
+    if ( exprInvalid.empty() ) {
+        const std::string retPrefix("ret = ");
+        assert(exprCpy.compare(0, retPrefix.size(), retPrefix) == 0);
+        code = NATRON_PYTHON_NAMESPACE::compilePyScript(exprCpy.substr( retPrefix.size() ) + "(frame, view)", Py_eval_input);
+    }
+
     //Set internal fields
 
     {
@@ -2709,9 +2735,7 @@ KnobHelper::setExpressionInternal(int dimension,
         _imp->expressions[dimension].expression = exprCpy;
         _imp->expressions[dimension].originalExpression = expression;
         _imp->expressions[dimension].exprInvalid = exprInvalid;
-
-        ///This may throw an exception upon failure
-        //NATRON_PYTHON_NAMESPACE::compilePyScript(exprCpy, &_imp->expressions[dimension].code);
+        _imp->expressions[dimension].code = code;
     }
 
     if ( getHolder() ) {
@@ -2728,6 +2752,20 @@ KnobHelper::setExpressionInternal(int dimension,
         }
     }
 
+    // Single-line expressions simple enough are evaluated without Python. The dependencies found by
+    // parseListenersFromExpression() invalidate the expression results, so they must cover all the
+    // parameters read by the native expression.
+    if ( exprInvalid.empty() && !hasRetVariable ) {
+        KnobIPtr thisShared = shared_from_this();
+        NativeExpressionPtr native = NativeExpression::compile(expression, thisShared, dimension);
+        std::list<std::pair<KnobIWPtr, int> > dependencies;
+        getExpressionDependencies(dimension, dependencies);
+        if ( native && native->isCoveredByDependencies(thisShared, dependencies) ) {
+            QMutexLocker k(&_imp->expressionMutex);
+            _imp->expressions[dimension].native = native;
+        }
+    }
+
 
     //Notify the expr. has changed
     expressionChanged(dimension);
@@ -2789,6 +2827,72 @@ KnobHelper::getExpressionDependencies(int dimension,
     return false;
 }
 
+bool
+KnobHelper::appendToHash(Hash64* hash,
+                         std::set<const KnobI*>* visited) const
+{
+    if ( !visited->insert(this).second ) {
+        // Already hashed, also breaks cycles in expressions/links
+        return true;
+    }
+
+    int nDims = getDimension();
+    bool animates = canAnimate();
+    for (int i = 0; i < nDims; ++i) {
+        std::pair<int, KnobIPtr> master = getMaster(i);
+        if (master.second) {
+            hash->append<int>(master.first);
+            if ( !master.second->appendToHash(hash, visited) ) {
+                return false;
+            }
+            continue;
+        }
+
+        std::string expr;
+        bool hasRet = false;
+        bool isNative = false;
+        std::list<std::pair<KnobIWPtr, int> > deps;
+        {
+            QMutexLocker k(&_imp->expressionMutex);
+            expr = _imp->expressions[i].originalExpression;
+            hasRet = _imp->expressions[i].hasRet;
+            isNative = (bool)_imp->expressions[i].native;
+            deps = _imp->expressions[i].dependencies;
+        }
+        if ( !expr.empty() ) {
+            // A native expression only reads the frame, the view, its dependencies and the curve of this knob
+            if (!isNative) {
+                return false;
+            }
+            Hash64_appendStdString(hash, expr);
+            hash->append(hasRet);
+            for (std::list<std::pair<KnobIWPtr, int> >::iterator it = deps.begin(); it != deps.end(); ++it) {
+                KnobIPtr dep = it->first.lock();
+                if (dep) {
+                    hash->append<int>(it->second);
+                    if ( !dep->appendToHash(hash, visited) ) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        if (animates) {
+            CurvePtr curve = _imp->curves[i];
+            if ( curve && curve->isAnimated() ) {
+                curve->appendToHash(hash);
+                continue;
+            }
+        }
+
+        if ( expr.empty() ) {
+            appendValueToHash(hash, i);
+        }
+    }
+
+    return true;
+} // KnobHelper::appendToHash
+
 void
 KnobHelper::clearExpression(int dimension,
                             bool clearResults)
@@ -2801,8 +2905,9 @@ KnobHelper::clearExpression(int dimension,
         _imp->expressions[dimension].expression.clear();
         _imp->expressions[dimension].originalExpression.clear();
         _imp->expressions[dimension].exprInvalid.clear();
-        //Py_XDECREF(_imp->expressions[dimension].code); //< new ref
-        //_imp->expressions[dimension].code = 0;
+        Py_XDECREF(_imp->expressions[dimension].code); //< new ref
+        _imp->expressions[dimension].code = 0;
+        _imp->expressions[dimension].native.reset();
     }
     KnobIPtr thisShared = shared_from_this();
     {
@@ -2912,6 +3017,51 @@ catchErrors(PyObject* mainModule,
     return true;
 }
 
+// When profiling a render, the time spent in expressions is accounted to the node owning the knob
+static RenderStatsPtr
+getExpressionRenderStats(EffectInstance* effect)
+{
+    if (effect) {
+        ParallelRenderArgsPtr frameArgs = effect->getParallelRenderArgsTLS();
+        if ( frameArgs && frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
+            return frameArgs->stats;
+        }
+    }
+
+    return RenderStatsPtr();
+}
+
+bool
+KnobHelper::evaluateNativeExpression(double time,
+                                     ViewIdx view,
+                                     int dimension,
+                                     double* ret) const
+{
+    NativeExpressionPtr native;
+    {
+        QMutexLocker k(&_imp->expressionMutex);
+        native = _imp->expressions[dimension].native;
+    }
+    if (!native) {
+        return false;
+    }
+
+    EffectInstance* effect = dynamic_cast<EffectInstance*>( getHolder() );
+    RenderStatsPtr stats = getExpressionRenderStats(effect);
+    boost::scoped_ptr<TimeLapse> timer;
+    if (stats) {
+        timer.reset(new TimeLapse);
+    }
+
+    bool ok = native->evaluate(time, view, ret);
+
+    if (stats && ok) {
+        stats->addExpressionInfosForNode( effect->getNode(), timer->getTimeSinceCreation() );
+    }
+
+    return ok;
+}
+
 bool
 KnobHelper::executeExpression(double time,
                               ViewIdx view,
@@ -2919,16 +3069,90 @@ KnobHelper::executeExpression(double time,
                               PyObject** ret,
                               std::string* error) const
 {
+    PythonGILLocker pgl;
+
+    EffectInstance* effect = dynamic_cast<EffectInstance*>( getHolder() );
+    RenderStatsPtr stats = getExpressionRenderStats(effect);
+    boost::scoped_ptr<TimeLapse> timer;
+    if (stats) {
+        timer.reset(new TimeLapse);
+    }
+
     std::string expr;
+    PyObject* code;
     {
         QMutexLocker k(&_imp->expressionMutex);
         expr = _imp->expressions[dimension].expression;
+        code = _imp->expressions[dimension].code;
+        Py_XINCREF(code);
     }
-    std::stringstream ss;
 
-    ss << expr << '(' << time << ", " <<  view << ")\n";
+    bool ok;
+    if (code) {
+        ok = executeCompiledExpression(code, time, view, ret, error);
+        Py_DECREF(code);
+    } else {
+        std::stringstream ss;
+
+        ss << expr << '(' << time << ", " <<  view << ")\n";
+
+        ok = executeExpression(ss.str(), ret, error);
+    }
+
+    if (stats) {
+        stats->addExpressionInfosForNode( effect->getNode(), timer->getTimeSinceCreation() );
+    }
+
+    return ok;
+}
+
+bool
+KnobHelper::executeCompiledExpression(PyObject* code,
+                                      double time,
+                                      ViewIdx view,
+                                      PyObject** ret,
+                                      std::string* error)
+{
+    PythonGILLocker pgl;
+    PyObject* mainModule = NATRON_PYTHON_NAMESPACE::getMainModule();
+    PyObject* globalDict = PyModule_GetDict(mainModule);
+
+    // Pass integer frames as int, as the expression scripts used to get them
+    PyObject* locals = PyDict_New();
+    PyObject* frameObj;
+    if ( time == std::floor(time) ) {
+        frameObj = PyInt_FromLong( (long)time );
+    } else {
+        frameObj = PyFloat_FromDouble(time);
+    }
+    PyObject* viewObj = PyInt_FromLong( (long)view.value() );
+    PyDict_SetItemString(locals, "frame", frameObj);
+    PyDict_SetItemString(locals, "view", viewObj);
+    Py_DECREF(frameObj);
+    Py_DECREF(viewObj);
+
+    PyErr_Clear();
+
+#if PY_MAJOR_VERSION >= 3
+    *ret = PyEval_EvalCode(code, globalDict, locals);
+#else
+    *ret = PyEval_EvalCode( (PyCodeObject*)code, globalDict, locals );
+#endif
+    Py_DECREF(locals);
+
+    if ( !catchErrors(mainModule, error) ) {
+        Py_XDECREF(*ret);
+        *ret = 0;
+
+        return false;
+    }
+    if (!*ret) {
+        *error = "The expression did not return a value";
+
+        return false;
+    }
 
-    return executeExpression(ss.str(), ret, error);
+    return true;
 }
 
 
@@ -6339,6 +6563,28 @@ AnimatingKnobStringHelper::saveAnimation(std::map<int, std::string>* keyframes)
     _animation->save(keyframes);
 }
 
+bool
+AnimatingKnobStringHelper::appendToHash(Hash64* hash,
+                                        std::set<const KnobI*>* visited) const
+{
+    if ( visited->find(this) != visited->end() ) {
+        return true;
+    }
+    if ( !KnobStringBase::appendToHash(hash, visited) ) {
+        return false;
+    }
+
+    // String keyframes are not stored in the curve values
+    std::map<int, std::string> keyframes;
+    _animation->save(&keyframes);
+    for (std::map<int, std::string>::iterator it = keyframes.begin(); it != keyframes.end(); ++it) {
+        hash->append<int>(it->first);
+        Hash64_appendStdString(hash, it->second);
+    }
+
+    return true;
+}
+
 /***************************KNOB EXPLICIT TEMPLATE INSTANTIATION******************************************/
 
 
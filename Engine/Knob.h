@@ -708,6 +708,16 @@ public:
      **/
     virtual bool getExpressionDependencies(int dimension, std::list<std::pair<KnobIWPtr, int> >& dependencies) const = 0;
 
+    /**
+     * @brief Appends to the hash everything that determines the values of this knob: its static values,
+     * animation curves, master links and expressions, along with the knobs these expressions depend on.
+     * Knobs already present in visited are skipped.
+     * @returns False if the values cannot be identified by a hash: an expression evaluated by Python may read
+     * any Python state (module variables, random, nodes reached through variables...) besides the knobs it depends on.
+     * Only the expressions compiled by NativeExpression are hashed.
+     **/
+    virtual bool appendToHash(Hash64* hash, std::set<const KnobI*>* visited) const WARN_UNUSED_RETURN = 0;
+
 
     /**
      * @brief Calls setValueAtTime with a reason of eValueChangedReasonUserEdited.
@@ -1461,6 +1471,7 @@ public:
 
     virtual bool isExpressionUsingRetVariable(int dimension = 0) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool getExpressionDependencies(int dimension, std::list<std::pair<KnobIWPtr, int> >& dependencies) const OVERRIDE FINAL;
+    virtual bool appendToHash(Hash64* hash, std::set<const KnobI*>* visited) const OVERRIDE WARN_UNUSED_RETURN;
     virtual std::string getExpression(int dimension) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual const std::vector<boost::shared_ptr<Curve>  > & getCurves() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual void setAnimationEnabled(bool val) OVERRIDE FINAL;
@@ -1589,6 +1600,16 @@ protected:
     ///The return value must be Py_DECRREF
     bool executeExpression(double time, ViewIdx view, int dimension, PyObject** ret, std::string* error) const;
 
+    ///Evaluates the expression without the Python GIL, if it is simple enough (see NativeExpression).
+    ///Returns false if the expression must be evaluated by Python.
+    bool evaluateNativeExpression(double time, ViewIdx view, int dimension, double* ret) const;
+
+private:
+
+    ///Evaluates the call to the expression function compiled when the expression was set.
+    ///The return value must be Py_DECRREF
+    static bool executeCompiledExpression(PyObject* code, double time, ViewIdx view, PyObject** ret, std::string* error);
+
 public:
 
     /// The return value must be Py_DECRREF
@@ -1638,6 +1659,11 @@ protected:
 
     virtual void copyValuesFromCurve(int /*dim*/) {}
 
+    /**
+     * @brief Appends the static (non-animated) value of the given dimension to the hash.
+     **/
+    virtual void appendValueToHash(Hash64* hash, int dimension) const = 0;
+
 
     virtual void handleSignalSlotsForAliasLink(const KnobIPtr& /*alias*/,
                                                bool /*connect*/)
@@ -2074,6 +2100,8 @@ private:
 
     virtual void copyValuesFromCurve(int dim) OVERRIDE FINAL;
 
+    virtual void appendValueToHash(Hash64* hash, int dimension) const OVERRIDE FINAL;
+
     virtual bool hasDefaultValueChanged(int dimension) const OVERRIDE FINAL;
 
     void initMinMax();
@@ -2283,6 +2311,10 @@ protected:
     virtual void keyframeRemoved_virtual(int dimension, double time) OVERRIDE;
     virtual void animationRemoved_virtual(int dimension) OVERRIDE;
 
+public:
+
+    virtual bool appendToHash(Hash64* hash, std::set<const KnobI*>* visited) const OVERRIDE WARN_UNUSED_RETURN;
+
 private:
     boost::scoped_ptr<StringAnimationManager> _animation;
 };
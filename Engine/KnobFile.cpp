@@ -30,11 +30,14 @@
 #include <stdexcept>
 #include <sstream> // stringstream
 
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
 #include <QtCore/QStringList>
 #include <QtCore/QMutexLocker>
 #include <QtCore/QDebug>
 
 #include "Engine/EffectInstance.h"
+#include "Engine/Hash64.h"
 #include "Engine/Transform.h"
 #include "Engine/StringAnimationManager.h"
 #include "Engine/KnobTypes.h"
@@ -78,6 +81,32 @@ KnobFile::reloadFile()
     evaluateValueChange(0, getCurrentTime(), ViewIdx(0), eValueChangedReasonNatronInternalEdited);
 }
 
+bool
+KnobFile::appendFileToHash(Hash64* hash)
+{
+    if ( isAnimated(0) ) {
+        return false;
+    }
+    std::string filename = getValue();
+    // Frame numbers (### or %04d) and views (%v or %V)
+    if ( filename.find_first_of("#%") != std::string::npos ) {
+        return false;
+    }
+    if ( getHolder() && getHolder()->getApp() ) {
+        getHolder()->getApp()->getProject()->canonicalizePath(filename);
+    }
+
+    QFileInfo info( QString::fromUtf8( filename.c_str() ) );
+    bool exists = info.exists();
+    hash->append<bool>(exists);
+    if (exists) {
+        hash->append<qint64>( info.size() );
+        hash->append<qint64>( info.lastModified().toMSecsSinceEpoch() );
+    }
+
+    return true;
+}
+
 bool
 KnobFile::canAnimate() const
 {
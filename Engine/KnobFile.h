@@ -89,6 +89,13 @@ public:
 
     void reloadFile();
 
+    /**
+     * @brief Appends the size and the modification date of the file named by this knob to the hash, so that a file
+     * written again under the same name changes it. Returns false if the knob names a different file at each frame
+     * or view (a sequence pattern or an animated name), in which case nothing is appended.
+     **/
+    bool appendFileToHash(Hash64* hash);
+
     /**
      * @brief getRandomFrameName
      * @param f The index of the frame.
@@ -56,6 +56,7 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/AppInstance.h"
 #include "Engine/Project.h"
 #include "Engine/EffectInstance.h"
+#include "Engine/Hash64.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
@@ -400,6 +401,30 @@ hashFunction(unsigned int a)
     return a;
 }
 
+// Converts the result of a native expression, which is only compiled for int, double and boolean parameters
+template <typename T>
+T
+nativeExpressionResultToType(double value)
+{
+    return (T)value;
+}
+
+template <>
+inline bool
+nativeExpressionResultToType<bool>(double value)
+{
+    return value != 0.;
+}
+
+template <>
+inline std::string
+nativeExpressionResultToType<std::string>(double /*value*/)
+{
+    assert(false);
+
+    return std::string();
+}
+
 template <typename T>
 bool
 Knob<T>::evaluateExpression(const std::string& expr,
@@ -428,6 +453,13 @@ Knob<T>::evaluateExpression(double time,
                             T* value,
                             std::string* error)
 {
+    double nativeRet;
+    if ( evaluateNativeExpression(time, view, dimension, &nativeRet) ) {
+        *value = nativeExpressionResultToType<T>(nativeRet);
+
+        return true;
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -450,6 +482,10 @@ Knob<T>::evaluateExpression_pod(double time,
                                 double* value,
                                 std::string* error)
 {
+    if ( evaluateNativeExpression(time, view, dimension, value) ) {
+        return true;
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -2700,6 +2736,26 @@ Knob<T>::cloneValuesAndCheckIfChanged(KnobI* other,
     return false;
 }
 
+template<>
+void
+KnobStringBase::appendValueToHash(Hash64* hash,
+                                  int dimension) const
+{
+    QMutexLocker k(&_valueMutex);
+
+    Hash64_appendStdString(hash, _values[dimension]);
+}
+
+template<typename T>
+void
+Knob<T>::appendValueToHash(Hash64* hash,
+                           int dimension) const
+{
+    QMutexLocker k(&_valueMutex);
+
+    hash->append(_values[dimension]);
+}
+
 template <typename T>
 void
 Knob<T>::cloneExpressionsResults(KnobI* other,
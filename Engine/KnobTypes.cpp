@@ -53,6 +53,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/Curve.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Format.h"
+#include "Engine/Hash64.h"
 #include "Engine/Image.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobSerialization.h"
@@ -2022,6 +2023,43 @@ KnobParametric::getValue(int dimension,
     return eStatusOK;
 }
 
+StatusEnum
+KnobParametric::getValues(int dimension,
+                          const double* parametricPositions,
+                          double *returnValues,
+                          int count) const
+{
+    ///Mt-safe as Curve is MT-safe
+    if ( dimension >= (int)_curves.size() ) {
+        return eStatusFailed;
+    }
+    try {
+        getParametricCurve(dimension)->getValuesAt(parametricPositions, returnValues, count);
+    } catch (...) {
+        return eStatusFailed;
+    }
+
+    return eStatusOK;
+}
+
+StatusEnum
+KnobParametric::getValueFromLUT(int dimension,
+                                double parametricPosition,
+                                double *returnValue) const
+{
+    ///Mt-safe as Curve is MT-safe
+    if ( dimension >= (int)_curves.size() ) {
+        return eStatusFailed;
+    }
+    try {
+        *returnValue = getParametricCurve(dimension)->getValueAtFromLUT(parametricPosition);
+    } catch (...) {
+        return eStatusFailed;
+    }
+
+    return eStatusOK;
+}
+
 StatusEnum
 KnobParametric::getNControlPoints(int dimension,
                                   int *returnValue) const
@@ -2274,6 +2312,26 @@ KnobParametric::saveParametricCurves(std::list<Curve >* curves) const
     }
 }
 
+bool
+KnobParametric::appendToHash(Hash64* hash,
+                             std::set<const KnobI*>* visited) const
+{
+    if ( visited->find(this) != visited->end() ) {
+        return true;
+    }
+    if ( !KnobDoubleBase::appendToHash(hash, visited) ) {
+        return false;
+    }
+
+    // The parametric curves are the actual content of this knob
+    QMutexLocker k(&_curvesMutex);
+    for (U32 i = 0; i < _curves.size(); ++i) {
+        _curves[i]->appendToHash(hash);
+    }
+
+    return true;
+}
+
 void
 KnobParametric::loadParametricCurves(const std::list<Curve > & curves)
 {
@@ -1012,6 +1012,9 @@ public:
     StatusEnum addControlPoint(ValueChangedReasonEnum reason, int dimension, double key, double value, KeyframeTypeEnum interpolation = eKeyframeTypeSmooth) WARN_UNUSED_RETURN;
     StatusEnum addControlPoint(ValueChangedReasonEnum reason, int dimension, double key, double value, double leftDerivative, double rightDerivative, KeyframeTypeEnum interpolation = eKeyframeTypeSmooth) WARN_UNUSED_RETURN;
     StatusEnum getValue(int dimension, double parametricPosition, double *returnValue) const WARN_UNUSED_RETURN;
+    StatusEnum getValues(int dimension, const double* parametricPositions, double *returnValues, int count) const WARN_UNUSED_RETURN;
+    // Same as getValue() but interpolates the table the curve is baked into (@see Curve::getValueAtFromLUT())
+    StatusEnum getValueFromLUT(int dimension, double parametricPosition, double *returnValue) const WARN_UNUSED_RETURN;
     StatusEnum getNControlPoints(int dimension, int *returnValue) const WARN_UNUSED_RETURN;
     StatusEnum getNthControlPoint(int dimension,
                                   int nthCtl,
@@ -1052,6 +1055,8 @@ public:
 
     void loadParametricCurves(const std::list<Curve > & curves);
 
+    virtual bool appendToHash(Hash64* hash, std::set<const KnobI*>* visited) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+
 Q_SIGNALS:
 
 
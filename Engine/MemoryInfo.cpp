@@ -76,6 +76,7 @@
 #include <QtCore/QDebug>
 
 #include "Global/GlobalDefines.h"
+#include "Engine/BufferPool.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -421,4 +422,15 @@ getAmountFreePhysicalRAM()
 #endif
 }
 
+void
+getBufferPoolRAM(std::size_t* usedRAM,
+                 std::size_t* idleRAM)
+{
+    BufferPoolStats stats;
+
+    BufferPool::getStats(&stats);
+    *usedRAM = stats.usedSize;
+    *idleRAM = stats.idleSize;
+}
+
 NATRON_NAMESPACE_EXIT
@@ -67,6 +67,9 @@ std::size_t getCurrentRSS( );
 
 std::size_t getAmountFreePhysicalRAM();
 
+// The memory held by the pool of image buffers (@see BufferPool): handed out, and freed but kept for reuse
+void getBufferPoolRAM(std::size_t* usedRAM, std::size_t* idleRAM);
+
 NATRON_NAMESPACE_EXIT
 
 #endif // ifndef Engine_MemoryInfo_h
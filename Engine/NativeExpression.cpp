@@ -0,0 +1,1309 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "NativeExpression.h"
+
+#include <cmath>
+#include <cctype>
+#include <cstring> // strchr
+#include <locale>
+#include <sstream> // istringstream
+
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include "Engine/AppManager.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Knob.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
+
+// Python ints are exact, doubles only up to 2^53: larger ints are left to Python
+#define NATIVE_EXPRESSION_MAX_EXACT_INT 9007199254740992.
+
+// Maximum depth of the evaluation stack, deeper expressions are left to Python
+#define NATIVE_EXPRESSION_MAX_STACK_DEPTH 32
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum NativeFunctionEnum
+{
+    // builtins
+    eNativeFunctionAbs = 0,
+    eNativeFunctionMin,
+    eNativeFunctionMax,
+    eNativeFunctionInt,
+    eNativeFunctionFloat,
+    eNativeFunctionRound,
+    // math module
+    eNativeFunctionSin,
+    eNativeFunctionCos,
+    eNativeFunctionTan,
+    eNativeFunctionAsin,
+    eNativeFunctionAcos,
+    eNativeFunctionAtan,
+    eNativeFunctionAtan2,
+    eNativeFunctionSinh,
+    eNativeFunctionCosh,
+    eNativeFunctionTanh,
+    eNativeFunctionExp,
+    eNativeFunctionLog,
+    eNativeFunctionLog10,
+    eNativeFunctionSqrt,
+    eNativeFunctionPow,
+    eNativeFunctionFabs,
+    eNativeFunctionFmod,
+    eNativeFunctionHypot,
+    eNativeFunctionFloor,
+    eNativeFunctionCeil,
+    eNativeFunctionTrunc,
+    eNativeFunctionDegrees,
+    eNativeFunctionRadians
+};
+
+struct NativeFunction
+{
+    const char* name;
+    int minArgs;
+    int maxArgs; // -1 for any number of arguments
+    bool isMathFunction; // false for builtins
+};
+
+// Indexed by NativeFunctionEnum
+const NativeFunction nativeFunctions[] = {
+    { "abs", 1, 1, false },
+    { "min", 2, -1, false },
+    { "max", 2, -1, false },
+    { "int", 1, 1, false },
+    { "float", 1, 1, false },
+    { "round", 1, 1, false },
+    { "sin", 1, 1, true },
+    { "cos", 1, 1, true },
+    { "tan", 1, 1, true },
+    { "asin", 1, 1, true },
+    { "acos", 1, 1, true },
+    { "atan", 1, 1, true },
+    { "atan2", 2, 2, true },
+    { "sinh", 1, 1, true },
+    { "cosh", 1, 1, true },
+    { "tanh", 1, 1, true },
+    { "exp", 1, 1, true },
+    { "log", 1, 2, true },
+    { "log10", 1, 1, true },
+    { "sqrt", 1, 1, true },
+    { "pow", 2, 2, true },
+    { "fabs", 1, 1, true },
+    { "fmod", 2, 2, true },
+    { "hypot", 2, 2, true },
+    { "floor", 1, 1, true },
+    { "ceil", 1, 1, true },
+    { "trunc", 1, 1, true },
+    { "degrees", 1, 1, true },
+    { "radians", 1, 1, true }
+};
+
+const int nativeFunctionsCount = (int)( sizeof(nativeFunctions) / sizeof(nativeFunctions[0]) );
+
+// A Python int or float
+struct NativeValue
+{
+    double value;
+    bool isInt;
+};
+
+/**
+ * @brief Checks a result: anything Python would raise an exception for (overflow, domain error) or that
+ * it would compute differently (ints which do not fit exactly in a double) is left to Python.
+ **/
+bool
+checkValue(NativeValue* v)
+{
+    if (v->isInt) {
+        return std::fabs(v->value) <= NATIVE_EXPRESSION_MAX_EXACT_INT;
+    }
+
+    return !(boost::math::isnan)(v->value) && !(boost::math::isinf)(v->value);
+}
+
+bool
+setInt(double value,
+       NativeValue* ret)
+{
+    ret->value = value;
+    ret->isInt = true;
+
+    return checkValue(ret);
+}
+
+bool
+setFloat(double value,
+         NativeValue* ret)
+{
+    ret->value = value;
+    ret->isInt = false;
+
+    return checkValue(ret);
+}
+
+// Python's float_floor_div
+double
+pythonFloatFloorDivide(double a,
+                       double b)
+{
+    double mod = std::fmod(a, b);
+    double div = (a - mod) / b;
+
+    if (mod) {
+        if ( (b < 0) != (mod < 0) ) {
+            div -= 1.;
+        }
+    }
+    double floordiv;
+    if (div) {
+        floordiv = std::floor(div);
+        if (div - floordiv > 0.5) {
+            floordiv += 1.;
+        }
+    } else {
+        floordiv = (a / b < 0) ? -0. : 0.;
+    }
+
+    return floordiv;
+}
+
+// Python's float_rem
+double
+pythonFloatModulo(double a,
+                  double b)
+{
+    double mod = std::fmod(a, b);
+
+    if (mod) {
+        if ( (b < 0) != (mod < 0) ) {
+            mod += b;
+        }
+    } else {
+        mod = (b < 0) ? -0. : 0.;
+    }
+
+    return mod;
+}
+
+bool
+applyBinaryOperator(NativeExpression::OpEnum op,
+                    const NativeValue& a,
+                    const NativeValue& b,
+                    NativeValue* ret)
+{
+    bool isInt = a.isInt && b.isInt;
+
+    switch (op) {
+    case NativeExpression::eOpAdd:
+
+        return isInt ? setInt(a.value + b.value, ret) : setFloat(a.value + b.value, ret);
+    case NativeExpression::eOpSubtract:
+
+        return isInt ? setInt(a.value - b.value, ret) : setFloat(a.value - b.value, ret);
+    case NativeExpression::eOpMultiply:
+
+        return isInt ? setInt(a.value * b.value, ret) : setFloat(a.value * b.value, ret);
+    case NativeExpression::eOpDivide:
+        if (b.value == 0.) {
+            // ZeroDivisionError
+            return false;
+        }
+#if PY_MAJOR_VERSION < 3
+        // Python 2 divides ints like the // operator
+        if (isInt) {
+            return applyBinaryOperator(NativeExpression::eOpFloorDivide, a, b, ret);
+        }
+#endif
+
+        return setFloat(a.value / b.value, ret);
+    case NativeExpression::eOpFloorDivide:
+        if (b.value == 0.) {
+            return false;
+        }
+        if (isInt) {
+            long long x = (long long)a.value;
+            long long y = (long long)b.value;
+            long long q = x / y;
+            if ( (x % y != 0) && ( (x < 0) != (y < 0) ) ) {
+                --q;
+            }
+
+            return setInt( (double)q, ret );
+        }
+
+        return setFloat(pythonFloatFloorDivide(a.value, b.value), ret);
+    case NativeExpression::eOpModulo:
+        if (b.value == 0.) {
+            return false;
+        }
+        if (isInt) {
+            long long x = (long long)a.value;
+            long long y = (long long)b.value;
+            long long r = x % y;
+            if ( (r != 0) && ( (r < 0) != (y < 0) ) ) {
+                r += y;
+            }
+
+            return setInt( (double)r, ret );
+        }
+
+        return setFloat(pythonFloatModulo(a.value, b.value), ret);
+    case NativeExpression::eOpPower:
+        if ( (a.value == 0.) && (b.value < 0.) ) {
+            // ZeroDivisionError
+            return false;
+        }
+        if ( isInt && (b.value >= 0.) ) {
+            return setInt(std::pow(a.value, b.value), ret);
+        }
+        if ( (a.value < 0.) && (b.value != std::floor(b.value)) ) {
+            // ValueError in Python 2, a complex number in Python 3
+            return false;
+        }
+
+        return setFloat(std::pow(a.value, b.value), ret);
+    default:
+        break;
+    }
+    assert(false);
+
+    return false;
+}
+
+// Rounds half away from zero (Python 2) or half to even (Python 3)
+double
+pythonRound(double x)
+{
+#if PY_MAJOR_VERSION < 3
+    double r = std::floor(std::fabs(x) + 0.5);
+
+    return x < 0 ? -r : r;
+#else
+    double r = std::floor(x);
+    double diff = x - r;
+    if (diff > 0.5) {
+        r += 1.;
+    } else if ( (diff == 0.5) && (std::fmod(r, 2.) != 0.) ) {
+        r += 1.;
+    }
+
+    return r;
+#endif
+}
+
+/**
+ * @brief Calls the function on the nArgs values starting at args, and stores the result in args[0]
+ **/
+bool
+callFunction(NativeFunctionEnum function,
+             NativeValue* args,
+             int nArgs)
+{
+    double x = args[0].value;
+    double y = nArgs > 1 ? args[1].value : 0.;
+
+    switch (function) {
+    case eNativeFunctionAbs:
+        args[0].value = std::fabs(x);
+
+        return true;
+    case eNativeFunctionMin:
+    case eNativeFunctionMax: {
+        // Like Python, keep the first of equal values, with its type
+        NativeValue ret = args[0];
+        for (int i = 1; i < nArgs; ++i) {
+            if ( (function == eNativeFunctionMin) ? (args[i].value < ret.value) : (args[i].value > ret.value) ) {
+                ret = args[i];
+            }
+        }
+        args[0] = ret;
+
+        return true;
+    }
+    case eNativeFunctionInt:
+
+        return setInt( x < 0 ? std::ceil(x) : std::floor(x), &args[0] );
+    case eNativeFunctionFloat:
+
+        return setFloat(x, &args[0]);
+    case eNativeFunctionRound:
+#if PY_MAJOR_VERSION < 3
+
+        return setFloat(pythonRound(x), &args[0]);
+#else
+
+        return setInt(pythonRound(x), &args[0]);
+#endif
+    case eNativeFunctionSin:
+
+        return setFloat(std::sin(x), &args[0]);
+    case eNativeFunctionCos:
+
+        return setFloat(std::cos(x), &args[0]);
+    case eNativeFunctionTan:
+
+        return setFloat(std::tan(x), &args[0]);
+    case eNativeFunctionAsin:
+
+        return setFloat(std::asin(x), &args[0]);
+    case eNativeFunctionAcos:
+
+        return setFloat(std::acos(x), &args[0]);
+    case eNativeFunctionAtan:
+
+        return setFloat(std::atan(x), &args[0]);
+    case eNativeFunctionAtan2:
+
+        return setFloat(std::atan2(x, y), &args[0]);
+    case eNativeFunctionSinh:
+
+        return setFloat(std::sinh(x), &args[0]);
+    case eNativeFunctionCosh:
+
+        return setFloat(std::cosh(x), &args[0]);
+    case eNativeFunctionTanh:
+
+        return setFloat(std::tanh(x), &args[0]);
+    case eNativeFunctionExp:
+
+        return setFloat(std::exp(x), &args[0]);
+    case eNativeFunctionLog:
+        if ( (x <= 0.) || ( (nArgs > 1) && (y <= 0.) ) ) {
+            // ValueError
+            return false;
+        }
+        if (nArgs > 1) {
+            return setFloat(std::log(x) / std::log(y), &args[0]);
+        }
+
+        return setFloat(std::log(x), &args[0]);
+    case eNativeFunctionLog10:
+        if (x <= 0.) {
+            return false;
+        }
+
+        return setFloat(std::log10(x), &args[0]);
+    case eNativeFunctionSqrt:
+        if (x < 0.) {
+            return false;
+        }
+
+        return setFloat(std::sqrt(x), &args[0]);
+    case eNativeFunctionPow:
+
+        return setFloat(std::pow(x, y), &args[0]);
+    case eNativeFunctionFabs:
+
+        return setFloat(std::fabs(x), &args[0]);
+    case eNativeFunctionFmod:
+        if (y == 0.) {
+            return false;
+        }
+
+        return setFloat(std::fmod(x, y), &args[0]);
+    case eNativeFunctionHypot:
+
+        return setFloat(std::sqrt(x * x + y * y), &args[0]);
+    case eNativeFunctionFloor:
+#if PY_MAJOR_VERSION < 3
+
+        return setFloat(std::floor(x), &args[0]);
+#else
+
+        return setInt(std::floor(x), &args[0]);
+#endif
+    case eNativeFunctionCeil:
+#if PY_MAJOR_VERSION < 3
+
+        return setFloat(std::ceil(x), &args[0]);
+#else
+
+        return setInt(std::ceil(x), &args[0]);
+#endif
+    case eNativeFunctionTrunc:
+
+        return setInt( x < 0 ? std::ceil(x) : std::floor(x), &args[0] );
+    case eNativeFunctionDegrees:
+
+        return setFloat(x * 180. / M_PI, &args[0]);
+    case eNativeFunctionRadians:
+
+        return setFloat(x * M_PI / 180., &args[0]);
+    } // switch
+    assert(false);
+
+    return false;
+} // callFunction
+
+struct NativeToken
+{
+    enum TypeEnum
+    {
+        eTypeEnd = 0,
+        eTypeNumber,
+        eTypeName,
+        eTypeOperator
+    };
+
+    TypeEnum type;
+    std::string text;
+    double value;
+    bool isInt;
+
+    NativeToken()
+        : type(eTypeEnd)
+        , text()
+        , value(0.)
+        , isInt(false)
+    {
+    }
+};
+
+bool
+isNameStart(char c)
+{
+    return std::isalpha( (unsigned char)c ) || c == '_';
+}
+
+bool
+isNameChar(char c)
+{
+    return std::isalnum( (unsigned char)c ) || c == '_';
+}
+
+bool
+isDigit(char c)
+{
+    return std::isdigit( (unsigned char)c ) != 0;
+}
+
+/**
+ * @brief Splits the expression in tokens, @returns false if it contains anything unsupported
+ * (strings, comments, non-decimal or imaginary literals...)
+ **/
+bool
+tokenize(const std::string& str,
+         std::vector<NativeToken>* tokens)
+{
+    std::size_t i = 0;
+    const std::size_t n = str.size();
+
+    while (i < n) {
+        char c = str[i];
+        if ( (c == ' ') || (c == '\t') ) {
+            ++i;
+            continue;
+        }
+        NativeToken token;
+        if ( isDigit(c) || ( (c == '.') && (i + 1 < n) && isDigit(str[i + 1]) ) ) {
+            std::size_t start = i;
+            token.type = NativeToken::eTypeNumber;
+            token.isInt = true;
+            while ( i < n && isDigit(str[i]) ) {
+                ++i;
+            }
+            if ( (i < n) && (str[i] == '.') ) {
+                token.isInt = false;
+                ++i;
+                while ( i < n && isDigit(str[i]) ) {
+                    ++i;
+                }
+            }
+            if ( (i < n) && ( (str[i] == 'e') || (str[i] == 'E') ) ) {
+                token.isInt = false;
+                ++i;
+                if ( (i < n) && ( (str[i] == '+') || (str[i] == '-') ) ) {
+                    ++i;
+                }
+                if ( (i >= n) || !isDigit(str[i]) ) {
+                    return false;
+                }
+                while ( i < n && isDigit(str[i]) ) {
+                    ++i;
+                }
+            }
+            if ( (i < n) && isNameChar(str[i]) ) {
+                // 1L, 0x10, 1j, 1_000...
+                return false;
+            }
+            token.text = str.substr(start, i - start);
+            if ( token.isInt && (token.text.size() > 1) && (token.text[0] == '0') ) {
+                // octal in Python 2, a syntax error in Python 3
+                return false;
+            }
+            std::istringstream ss(token.text);
+            ss.imbue( std::locale::classic() );
+            ss >> token.value;
+            if ( ss.fail() || ( token.isInt && (token.value > NATIVE_EXPRESSION_MAX_EXACT_INT) ) ) {
+                return false;
+            }
+        } else if ( isNameStart(c) ) {
+            std::size_t start = i;
+            while ( i < n && isNameChar(str[i]) ) {
+                ++i;
+            }
+            token.type = NativeToken::eTypeName;
+            token.text = str.substr(start, i - start);
+        } else if ( (i + 1 < n) && ( (c == '*') || (c == '/') ) && (str[i + 1] == c) ) {
+            token.type = NativeToken::eTypeOperator;
+            token.text = str.substr(i, 2);
+            i += 2;
+        } else if ( std::strchr("+-*/%()[],.", c) && (c != '\0') ) {
+            token.type = NativeToken::eTypeOperator;
+            token.text = std::string(1, c);
+            ++i;
+        } else {
+            return false;
+        }
+        tokens->push_back(token);
+    }
+    tokens->push_back( NativeToken() );
+
+    return true;
+} // tokenize
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+/**
+ * @brief Recursive descent parser of the supported subset, following the Python grammar and operator precedence.
+ * Emits the instructions of a stack machine in the NativeExpression.
+ **/
+class NativeExpressionParser
+{
+public:
+
+    NativeExpressionParser(NativeExpression* expr,
+                           const KnobIPtr& thisKnob,
+                           int dimension)
+        : _expr(expr)
+        , _thisKnob(thisKnob)
+        , _dimension(dimension)
+        , _node()
+        , _tokens()
+        , _pos(0)
+        , _stackDepth(0)
+        , _mainDict(0)
+        , _mathModule(0)
+    {
+        if (thisKnob) {
+            EffectInstance* effect = dynamic_cast<EffectInstance*>( thisKnob->getHolder() );
+            if (effect) {
+                _node = effect->getNode();
+            }
+        }
+        PyObject* mainModule = NATRON_PYTHON_NAMESPACE::getMainModule();
+        if (mainModule) {
+            _mainDict = PyModule_GetDict(mainModule); // borrowed
+        }
+        _mathModule = PyImport_ImportModule("math"); // new ref
+        PyErr_Clear();
+    }
+
+    ~NativeExpressionParser()
+    {
+        Py_XDECREF(_mathModule);
+    }
+
+    bool parse(const std::string& expression)
+    {
+        if ( !_mainDict || !tokenize(expression, &_tokens) ) {
+            return false;
+        }
+        if ( !parseExpression() ) {
+            return false;
+        }
+
+        return peek().type == NativeToken::eTypeEnd && _stackDepth == 1;
+    }
+
+private:
+
+    const NativeToken& peek() const
+    {
+        return _tokens[_pos];
+    }
+
+    bool accept(const char* op)
+    {
+        const NativeToken& t = _tokens[_pos];
+
+        if ( (t.type == NativeToken::eTypeOperator) && (t.text == op) ) {
+            ++_pos;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    bool acceptName(std::string* name)
+    {
+        const NativeToken& t = _tokens[_pos];
+
+        if (t.type == NativeToken::eTypeName) {
+            *name = t.text;
+            ++_pos;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    bool emit(const NativeExpression::Instruction& instr,
+              int stackDelta)
+    {
+        _stackDepth += stackDelta;
+        if ( (_stackDepth < 1) || (_stackDepth > NATIVE_EXPRESSION_MAX_STACK_DEPTH) ) {
+            return false;
+        }
+        _expr->_code.push_back(instr);
+
+        return true;
+    }
+
+    bool emit(NativeExpression::OpEnum op,
+              int stackDelta)
+    {
+        NativeExpression::Instruction instr;
+
+        instr.op = op;
+
+        return emit(instr, stackDelta);
+    }
+
+    bool emitConstant(double value,
+                      bool isInt)
+    {
+        NativeExpression::Instruction instr;
+
+        instr.op = NativeExpression::eOpPushConstant;
+        instr.value = value;
+        instr.isInt = isInt;
+
+        return emit(instr, 1);
+    }
+
+    // expression: term (('+' | '-') term)*
+    bool parseExpression()
+    {
+        if ( !parseTerm() ) {
+            return false;
+        }
+        for (;;) {
+            NativeExpression::OpEnum op;
+            if ( accept("+") ) {
+                op = NativeExpression::eOpAdd;
+            } else if ( accept("-") ) {
+                op = NativeExpression::eOpSubtract;
+            } else {
+                return true;
+            }
+            if ( !parseTerm() || !emit(op, -1) ) {
+                return false;
+            }
+        }
+    }
+
+    // term: factor (('*' | '/' | '//' | '%') factor)*
+    bool parseTerm()
+    {
+        if ( !parseFactor() ) {
+            return false;
+        }
+        for (;;) {
+            NativeExpression::OpEnum op;
+            if ( accept("*") ) {
+                op = NativeExpression::eOpMultiply;
+            } else if ( accept("/") ) {
+                op = NativeExpression::eOpDivide;
+            } else if ( accept("//") ) {
+                op = NativeExpression::eOpFloorDivide;
+            } else if ( accept("%") ) {
+                op = NativeExpression::eOpModulo;
+            } else {
+                return true;
+            }
+            if ( !parseFactor() || !emit(op, -1) ) {
+                return false;
+            }
+        }
+    }
+
+    // factor: ('+' | '-') factor | power
+    bool parseFactor()
+    {
+        if ( accept("-") ) {
+            return parseFactor() && emit(NativeExpression::eOpNegate, 0);
+        } else if ( accept("+") ) {
+            return parseFactor();
+        }
+
+        return parsePower();
+    }
+
+    // power: primary ['**' factor]
+    bool parsePower()
+    {
+        if ( !parsePrimary() ) {
+            return false;
+        }
+        if ( accept("**") ) {
+            return parseFactor() && emit(NativeExpression::eOpPower, -1);
+        }
+
+        return true;
+    }
+
+    bool parsePrimary()
+    {
+        const NativeToken& t = peek();
+        bool ok;
+
+        if (t.type == NativeToken::eTypeNumber) {
+            ++_pos;
+            ok = emitConstant(t.value, t.isInt);
+        } else if ( accept("(") ) {
+            ok = parseExpression() && accept(")");
+        } else if (t.type == NativeToken::eTypeName) {
+            ++_pos;
+            ok = parseName(t.text);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+
+        // Attributes, calls or subscripts on a value are not supported
+        const NativeToken& next = peek();
+
+        return !( (next.type == NativeToken::eTypeOperator) && (next.text == "." || next.text == "(" || next.text == "[") );
+    }
+
+    /**
+     * @brief Resolves a name the way the expression function does: the variables defined by
+     * KnobHelperPrivate::declarePythonVariables() shadow the frame and view arguments, which shadow the
+     * globals of the main module, which shadow the builtins.
+     **/
+    bool parseName(const std::string& name)
+    {
+        if (name == "thisParam") {
+            return parseKnobMethod(_thisKnob);
+        } else if (name == "thisNode") {
+            std::string paramName;
+            if ( !_node || !accept(".") || !acceptName(&paramName) ) {
+                return false;
+            }
+
+            return parseKnobMethod( _node->getKnobByName(paramName) );
+        } else if (name == "thisGroup") {
+            std::string nodeName;
+            if ( !_node || !accept(".") || !acceptName(&nodeName) ) {
+                return false;
+            }
+
+            return parseNodeParam( getSiblingNode(nodeName) );
+        } else if (name == "curve") {
+            return parseCurve();
+        } else if (name == "dimension") {
+            return emitConstant(_dimension, true);
+        } else if ( (name == "random") || (name == "randomInt") || (name == "app") ) {
+            return false;
+        }
+
+        NodePtr sibling = getSiblingNode(name);
+        if (sibling) {
+            return parseNodeParam(sibling);
+        }
+
+        if (name == "frame") {
+            return emit(NativeExpression::eOpPushFrame, 1);
+        } else if (name == "view") {
+            return emit(NativeExpression::eOpPushView, 1);
+        }
+
+        for (int i = 0; i < nativeFunctionsCount; ++i) {
+            if (name == nativeFunctions[i].name) {
+                if ( !isGlobalResolvedTo(name, nativeFunctions[i].isMathFunction) ) {
+                    return false;
+                }
+
+                return parseCall(i);
+            }
+        }
+        if ( (name == "pi") || (name == "e") ) {
+            if ( !isGlobalResolvedTo(name, true) ) {
+                return false;
+            }
+            PyObject* value = PyDict_GetItemString( _mainDict, name.c_str() ); // borrowed
+
+            return emitConstant(PyFloat_AsDouble(value), false);
+        }
+
+        return false;
+    } // parseName
+
+    /**
+     * @brief Returns true if name refers to the function (or constant) of the math module imported in the main module,
+     * or for a builtin, if it is not shadowed by a global of the main module.
+     **/
+    bool isGlobalResolvedTo(const std::string& name,
+                            bool fromMathModule) const
+    {
+        PyObject* global = PyDict_GetItemString( _mainDict, name.c_str() ); // borrowed
+
+        if (!fromMathModule) {
+            return !global;
+        }
+        if (!global || !_mathModule) {
+            return false;
+        }
+        PyObject* mathAttr = PyObject_GetAttrString( _mathModule, name.c_str() ); // new ref
+        PyErr_Clear();
+        bool same = mathAttr == global;
+        Py_XDECREF(mathAttr);
+
+        return same;
+    }
+
+    NodePtr getSiblingNode(const std::string& name) const
+    {
+        if (!_node) {
+            return NodePtr();
+        }
+        NodeCollectionPtr collection = _node->getGroup();
+        if (!collection) {
+            return NodePtr();
+        }
+        NodesList siblings = collection->getNodes();
+        for (NodesList::iterator it = siblings.begin(); it != siblings.end(); ++it) {
+            if ( (*it)->isActivated() && !(*it)->getParentMultiInstance() && ( (*it)->getScriptName_mt_safe() == name ) ) {
+                return *it;
+            }
+        }
+
+        return NodePtr();
+    }
+
+    // '.' param followed by the method call
+    bool parseNodeParam(const NodePtr& node)
+    {
+        std::string paramName;
+
+        if ( !node || !accept(".") || !acceptName(&paramName) ) {
+            return false;
+        }
+
+        return parseKnobMethod( node->getKnobByName(paramName) );
+    }
+
+    // integer literal or the dimension variable
+    bool parseConstantDimension(int* dimension)
+    {
+        const NativeToken& t = peek();
+
+        if ( (t.type == NativeToken::eTypeNumber) && t.isInt && (t.value < 16) ) {
+            *dimension = (int)t.value;
+            ++_pos;
+
+            return true;
+        } else if ( (t.type == NativeToken::eTypeName) && (t.text == "dimension") ) {
+            *dimension = _dimension;
+            ++_pos;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    // function arguments and call
+    bool parseCall(int function)
+    {
+        if ( !accept("(") ) {
+            return false;
+        }
+        int nArgs = 0;
+        if ( !accept(")") ) {
+            do {
+                if ( !parseExpression() ) {
+                    return false;
+                }
+                ++nArgs;
+            } while ( accept(",") );
+            if ( !accept(")") ) {
+                return false;
+            }
+        }
+        const NativeFunction& f = nativeFunctions[function];
+        if ( (nArgs < f.minArgs) || ( (f.maxArgs != -1) && (nArgs > f.maxArgs) ) ) {
+            return false;
+        }
+        NativeExpression::Instruction instr;
+        instr.op = NativeExpression::eOpCall;
+        instr.index = function;
+        instr.arg = nArgs;
+
+        return emit(instr, 1 - nArgs);
+    }
+
+    // curve(time[, dimension])
+    bool parseCurve()
+    {
+        if ( !_thisKnob || !accept("(") || !parseExpression() ) {
+            return false;
+        }
+        int dimension = 0;
+        if ( accept(",") && !parseConstantDimension(&dimension) ) {
+            return false;
+        }
+        if ( !accept(")") || ( dimension >= _thisKnob->getDimension() ) ) {
+            return false;
+        }
+        NativeExpression::Instruction instr;
+        instr.op = NativeExpression::eOpCurve;
+        instr.arg = dimension;
+
+        return emit(instr, 0);
+    }
+
+    int addKnob(const KnobIPtr& knob,
+                NativeExpression::KnobTypeEnum type)
+    {
+        for (std::size_t i = 0; i < _expr->_knobs.size(); ++i) {
+            if (_expr->_knobs[i].first.lock() == knob) {
+                return (int)i;
+            }
+        }
+        _expr->_knobs.push_back( std::make_pair(knob, type) );
+
+        return (int)_expr->_knobs.size() - 1;
+    }
+
+    /**
+     * @brief Parses the get(), getValue() and getValueAtTime() calls of the Python IntParam, Int2DParam,
+     * Int3DParam, DoubleParam, Double2DParam, Double3DParam, ColorParam and BooleanParam classes.
+     **/
+    bool parseKnobMethod(const KnobIPtr& knob)
+    {
+        if (!knob) {
+            return false;
+        }
+        int nDims = knob->getDimension();
+        NativeExpression::KnobTypeEnum type;
+        // The components of the tuple returned by get(), empty if it returns a single value
+        std::string components;
+        if ( dynamic_cast<KnobInt*>( knob.get() ) ) {
+            type = NativeExpression::eKnobTypeInt;
+            components = std::string("xyz").substr(0, nDims > 1 ? nDims : 0);
+        } else if ( dynamic_cast<KnobDouble*>( knob.get() ) ) {
+            type = NativeExpression::eKnobTypeDouble;
+            components = std::string("xyz").substr(0, nDims > 1 ? nDims : 0);
+        } else if ( dynamic_cast<KnobColor*>( knob.get() ) ) {
+            type = NativeExpression::eKnobTypeDouble;
+            // The alpha of ColorTuple is not always the 4th dimension
+            components = "rgb";
+        } else if ( dynamic_cast<KnobBool*>( knob.get() ) ) {
+            type = NativeExpression::eKnobTypeBool;
+        } else {
+            return false;
+        }
+        // Other dimensions have no Python wrapper
+        if ( (nDims < 1) || (nDims > 4) || ( (nDims == 4) && (components != "rgb") ) ) {
+            return false;
+        }
+        bool isBool = type == NativeExpression::eKnobTypeBool;
+
+        std::string method;
+        if ( !accept(".") || !acceptName(&method) || !accept("(") ) {
+            return false;
+        }
+
+        bool hasTime = false;
+        int dimension = 0;
+        if (method == "get") {
+            if ( !accept(")") ) {
+                if ( !parseExpression() || !accept(")") ) {
+                    return false;
+                }
+                hasTime = true;
+            }
+            if ( !components.empty() ) {
+                // get() returns a tuple
+                std::string component;
+                if ( accept("[") ) {
+                    if ( !parseConstantDimension(&dimension) || !accept("]") ) {
+                        return false;
+                    }
+                } else if ( accept(".") && acceptName(&component) && (component.size() == 1) ) {
+                    std::size_t found = components.find(component[0]);
+                    if (found == std::string::npos) {
+                        return false;
+                    }
+                    dimension = (int)found;
+                } else {
+                    return false;
+                }
+                if ( dimension >= (int)components.size() ) {
+                    return false;
+                }
+            }
+        } else if (method == "getValue") {
+            if ( !accept(")") ) {
+                if ( isBool || !parseConstantDimension(&dimension) || !accept(")") ) {
+                    return false;
+                }
+            }
+        } else if (method == "getValueAtTime") {
+            if ( !parseExpression() ) {
+                return false;
+            }
+            if ( accept(",") && ( isBool || !parseConstantDimension(&dimension) ) ) {
+                return false;
+            }
+            if ( !accept(")") ) {
+                return false;
+            }
+            hasTime = true;
+        } else {
+            return false;
+        }
+        if (dimension >= nDims) {
+            return false;
+        }
+
+        NativeExpression::Instruction instr;
+        instr.op = hasTime ? NativeExpression::eOpGetValueAtTime : NativeExpression::eOpGetValue;
+        instr.index = addKnob(knob, type);
+        instr.arg = dimension;
+        _expr->_referencedKnobs.push_back( std::make_pair(knob, dimension) );
+
+        // getValueAtTime pops the time
+        return emit(instr, hasTime ? 0 : 1);
+    } // parseKnobMethod
+
+    NativeExpression* _expr;
+    KnobIPtr _thisKnob;
+    int _dimension;
+    NodePtr _node;
+    std::vector<NativeToken> _tokens;
+    std::size_t _pos;
+    int _stackDepth;
+    PyObject* _mainDict; // borrowed
+    PyObject* _mathModule; // new ref
+};
+
+NativeExpression::NativeExpression()
+    : _code()
+    , _knobs()
+    , _referencedKnobs()
+    , _thisKnob()
+    , _requiresIntResult(false)
+{
+}
+
+NativeExpression::~NativeExpression()
+{
+}
+
+NativeExpressionPtr
+NativeExpression::compile(const std::string& expression,
+                          const KnobIPtr& thisKnob,
+                          int dimension)
+{
+    NativeExpressionPtr ret( new NativeExpression() );
+
+    if (thisKnob) {
+        if ( dynamic_cast<KnobIntBase*>( thisKnob.get() ) ) {
+            ret->_requiresIntResult = true;
+        } else if ( !dynamic_cast<KnobDoubleBase*>( thisKnob.get() ) && !dynamic_cast<KnobBoolBase*>( thisKnob.get() ) ) {
+            return NativeExpressionPtr();
+        }
+        ret->_thisKnob = thisKnob;
+    }
+
+    // Names are resolved against the globals of the main module
+    PythonGILLocker pgl;
+    NativeExpressionParser parser(ret.get(), thisKnob, dimension);
+    if ( !parser.parse(expression) ) {
+        return NativeExpressionPtr();
+    }
+
+    return ret;
+}
+
+bool
+NativeExpression::evaluate(double time,
+                           ViewIdx view,
+                           double* ret) const
+{
+    NativeValue stack[NATIVE_EXPRESSION_MAX_STACK_DEPTH];
+    int top = -1;
+
+    for (std::vector<Instruction>::const_iterator it = _code.begin(); it != _code.end(); ++it) {
+        switch (it->op) {
+        case eOpPushConstant:
+            ++top;
+            stack[top].value = it->value;
+            stack[top].isInt = it->isInt;
+            break;
+        case eOpPushFrame:
+            // Integer frames are passed to Python as int
+            ++top;
+            stack[top].value = time;
+            stack[top].isInt = time == std::floor(time);
+            break;
+        case eOpPushView:
+            ++top;
+            stack[top].value = view.value();
+            stack[top].isInt = true;
+            break;
+        case eOpNegate:
+            stack[top].value = -stack[top].value;
+            break;
+        case eOpAdd:
+        case eOpSubtract:
+        case eOpMultiply:
+        case eOpDivide:
+        case eOpFloorDivide:
+        case eOpModulo:
+        case eOpPower:
+            if ( !applyBinaryOperator(it->op, stack[top - 1], stack[top], &stack[top - 1]) ) {
+                return false;
+            }
+            --top;
+            break;
+        case eOpCall:
+            top -= it->arg - 1;
+            if ( !callFunction( (NativeFunctionEnum)it->index, &stack[top], it->arg ) ) {
+                return false;
+            }
+            break;
+        case eOpGetValue:
+        case eOpGetValueAtTime: {
+            const std::pair<KnobIWPtr, KnobTypeEnum>& k = _knobs[it->index];
+            KnobIPtr knob = k.first.lock();
+            if (!knob) {
+                // Python reports the error
+                return false;
+            }
+            bool atTime = it->op == eOpGetValueAtTime;
+            if (!atTime) {
+                ++top;
+            }
+            double t = stack[top].value;
+            switch (k.second) {
+            case eKnobTypeDouble: {
+                KnobDoubleBase* isDouble = dynamic_cast<KnobDoubleBase*>( knob.get() );
+                assert(isDouble);
+                stack[top].value = atTime ? isDouble->getValueAtTime(t, it->arg) : isDouble->getValue(it->arg);
+                stack[top].isInt = false;
+                break;
+            }
+            case eKnobTypeInt: {
+                KnobIntBase* isInt = dynamic_cast<KnobIntBase*>( knob.get() );
+                assert(isInt);
+                stack[top].value = atTime ? isInt->getValueAtTime(t, it->arg) : isInt->getValue(it->arg);
+                stack[top].isInt = true;
+                break;
+            }
+            case eKnobTypeBool: {
+                KnobBoolBase* isBool = dynamic_cast<KnobBoolBase*>( knob.get() );
+                assert(isBool);
+                stack[top].value = ( atTime ? isBool->getValueAtTime(t, it->arg) : isBool->getValue(it->arg) ) ? 1. : 0.;
+                stack[top].isInt = true;
+                break;
+            }
+            }
+            if ( !checkValue(&stack[top]) ) {
+                return false;
+            }
+            break;
+        }
+        case eOpCurve: {
+            KnobIPtr knob = _thisKnob.lock();
+            if (!knob) {
+                return false;
+            }
+            stack[top].value = knob->getRawCurveValueAt(stack[top].value, ViewSpec::current(), it->arg);
+            stack[top].isInt = false;
+            if ( !checkValue(&stack[top]) ) {
+                return false;
+            }
+            break;
+        }
+        } // switch
+    }
+    assert(top == 0);
+    if ( _requiresIntResult && !stack[0].isInt ) {
+        return false;
+    }
+    *ret = stack[0].value;
+
+    return true;
+} // NativeExpression::evaluate
+
+const std::list<std::pair<KnobIWPtr, int> >&
+NativeExpression::getReferencedKnobs() const
+{
+    return _referencedKnobs;
+}
+
+bool
+NativeExpression::isCoveredByDependencies(const KnobIPtr& thisKnob,
+                                          const std::list<std::pair<KnobIWPtr, int> >& dependencies) const
+{
+    for (std::list<std::pair<KnobIWPtr, int> >::const_iterator it = _referencedKnobs.begin(); it != _referencedKnobs.end(); ++it) {
+        KnobIPtr knob = it->first.lock();
+        if (!knob) {
+            return false;
+        }
+        if (knob == thisKnob) {
+            continue;
+        }
+        bool found = false;
+        for (std::list<std::pair<KnobIWPtr, int> >::const_iterator it2 = dependencies.begin(); it2 != dependencies.end(); ++it2) {
+            if (it2->first.lock() == knob) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+NATRON_NAMESPACE_EXIT
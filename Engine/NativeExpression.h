@@ -0,0 +1,158 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_NativeExpression_h
+#define Engine_NativeExpression_h
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#endif
+
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A knob expression evaluated without the Python interpreter.
+ *
+ * Most expressions are single-line arithmetic on the frame and on the values of other parameters, e.g.
+ * "thisParam.get(frame - 1) * 2 + Blur1.size.get()[0]". Evaluating them through Python takes the GIL,
+ * which serializes all the render threads reading animated parameters.
+ *
+ * compile() recognizes the following subset of the Python expressions and returns NULL for anything else,
+ * in which case the expression keeps being evaluated by Python:
+ * - int and float literals, +, -, *, /, //, %, ** and parentheses, with the Python int/float semantics
+ * - frame, view, dimension, pi, e
+ * - the functions of the math module imported in the main module (sin, cos, sqrt, floor, pow, ...)
+ *   and abs, min, max, int, float, round
+ * - curve(time[, dimension])
+ * - get(), get(time), getValue([dimension]), getValueAtTime(time[, dimension]) on thisParam, thisNode.<param>,
+ *   <node>.<param> and thisGroup.<node>.<param>, followed by [dimension] or .x/.y/.z/.r/.g/.b/.a for
+ *   multi-dimensional parameters. Only int, double and boolean parameters are supported.
+ *
+ * The nodes and parameters are resolved once, when the expression is compiled.
+ * Evaluation errors (division by zero, math domain errors, a deleted parameter) make evaluate() return false,
+ * so that Python evaluates the expression and reports the error.
+ **/
+class NativeExpression
+{
+public:
+
+    /**
+     * @brief Compiles the expression of the given dimension of thisKnob.
+     * thisKnob may be NULL, in which case expressions referencing parameters are not supported.
+     * @returns NULL if the expression is not in the supported subset.
+     **/
+    static NativeExpressionPtr compile(const std::string& expression,
+                                       const KnobIPtr& thisKnob,
+                                       int dimension);
+
+    ~NativeExpression();
+
+    /**
+     * @brief Evaluates the expression. This is thread-safe and does not take the Python GIL,
+     * unless one of the referenced parameters itself has a Python expression.
+     * @returns False if the expression could not be evaluated natively.
+     **/
+    bool evaluate(double time, ViewIdx view, double* ret) const;
+
+    /**
+     * @brief The parameters read by the expression and the dimension read.
+     **/
+    const std::list<std::pair<KnobIWPtr, int> >& getReferencedKnobs() const;
+
+    /**
+     * @brief The knobs read by the expression, other than the knob owning it, must all be known dependencies of the
+     * expression (see KnobI::getExpressionDependencies()): this is what invalidates the results of the expression
+     * when they change.
+     **/
+    bool isCoveredByDependencies(const KnobIPtr& thisKnob,
+                                 const std::list<std::pair<KnobIWPtr, int> >& dependencies) const;
+
+    enum OpEnum
+    {
+        eOpPushConstant = 0,
+        eOpPushFrame,
+        eOpPushView,
+        eOpNegate,
+        eOpAdd,
+        eOpSubtract,
+        eOpMultiply,
+        eOpDivide,
+        eOpFloorDivide,
+        eOpModulo,
+        eOpPower,
+        eOpCall, // function, number of arguments
+        eOpGetValue, // knob, dimension
+        eOpGetValueAtTime, // knob, dimension, pops the time
+        eOpCurve // dimension, pops the time
+    };
+
+    struct Instruction
+    {
+        OpEnum op;
+        double value;
+        bool isInt;
+        int index; // function or knob index
+        int arg; // number of arguments or dimension
+
+        Instruction()
+            : op(eOpPushConstant)
+            , value(0.)
+            , isInt(false)
+            , index(0)
+            , arg(0)
+        {
+        }
+    };
+
+    enum KnobTypeEnum
+    {
+        eKnobTypeDouble = 0,
+        eKnobTypeInt,
+        eKnobTypeBool
+    };
+
+private:
+
+    NativeExpression();
+
+    friend class NativeExpressionParser;
+
+    std::vector<Instruction> _code;
+    std::vector<std::pair<KnobIWPtr, KnobTypeEnum> > _knobs;
+    std::list<std::pair<KnobIWPtr, int> > _referencedKnobs;
+    KnobIWPtr _thisKnob;
+
+    // Python cannot convert a float to an int parameter value without loss: let it handle it
+    bool _requiresIntResult;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_NativeExpression_h
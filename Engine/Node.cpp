@@ -796,6 +796,52 @@ Node::computeHashInternal()
         qDebug() << "Node::computeHash(): inputs not initialized";
     }
 
+    RotoDrawableItemPtr attachedStroke = _imp->paintStroke.lock();
+    NodePtr attachedStrokeContextNode;
+    if (attachedStroke) {
+        attachedStrokeContextNode = attachedStroke->getContext()->getNode();
+    }
+
+    /*
+     * In content-based mode, the hash only depends on what determines the output of the node, so that identical graphs
+     * hit the same cache entries across sessions and after undo/redo. Roto shapes are not knobs of the node itself:
+     * nodes involved with a RotoContext keep relying on the knobs age which is incremented on each roto action.
+     * The files read by the node are identified by their size and modification date. A sequence of files cannot be
+     * checked each time the hash is computed: nodes reading one also keep relying on the knobs age.
+     * So do the nodes with a parameter driven by a Python expression, which may read any Python state.
+     */
+    bool contentBased = appPTR->getCurrentSettings()->isContentBasedNodeHashEnabled() && !_imp->rotoContext && !attachedStroke;
+    U64 contentHash = 0;
+    if (contentBased) {
+        // Done outside of knobsAgeMutex: this locks the knobs (and the knobs their expressions depend on)
+        Hash64 knobsHash;
+        Hash64_appendStdString( &knobsHash, getPluginID() );
+        knobsHash.append<int>( getMajorVersion() );
+        knobsHash.append<int>( getMinorVersion() );
+
+        std::set<const KnobI*> visited;
+        const KnobsVec & knobs = getKnobs();
+        for (KnobsVec::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+            // Knobs that do not trigger a new render cannot change the output
+            if ( !(*it)->getEvaluateOnChange() ) {
+                continue;
+            }
+            Hash64_appendStdString( &knobsHash, (*it)->getName() );
+            if ( !(*it)->appendToHash(&knobsHash, &visited) ) {
+                contentBased = false;
+                break;
+            }
+
+            KnobFile* isFile = dynamic_cast<KnobFile*>( it->get() );
+            if ( isFile && !isFile->appendFileToHash(&knobsHash) ) {
+                contentBased = false;
+                break;
+            }
+        }
+        knobsHash.computeHash();
+        contentHash = knobsHash.value();
+    }
+
     U64 oldHash, newHash;
     {
         QWriteLocker l(&_imp->knobsAgeMutex);
@@ -805,15 +851,14 @@ Node::computeHashInternal()
         ///reset the hash value
         _imp->hash.reset();
 
-        ///append the effect's own age
-        _imp->hash.append(_imp->knobsAge);
+        if (contentBased) {
+            _imp->hash.append(contentHash);
+        } else {
+            ///append the effect's own age
+            _imp->hash.append(_imp->knobsAge);
+        }
 
         ///append all inputs hash
-        RotoDrawableItemPtr attachedStroke = _imp->paintStroke.lock();
-        NodePtr attachedStrokeContextNode;
-        if (attachedStroke) {
-            attachedStrokeContextNode = attachedStroke->getContext()->getNode();
-        }
         {
             ViewerInstance* isViewer = dynamic_cast<ViewerInstance*>( _imp->effect.get() );
 
@@ -854,13 +899,15 @@ Node::computeHashInternal()
         //            _imp->hash.append(rotoAge);
         //        }
 
-        ///Also append the effect's label to distinguish 2 instances with the same parameters
-        Hash64_appendQString( &_imp->hash, QString::fromUtf8( getScriptName().c_str() ) );
+        if (!contentBased) {
+            ///Also append the effect's label to distinguish 2 instances with the same parameters
+            Hash64_appendQString( &_imp->hash, QString::fromUtf8( getScriptName().c_str() ) );
 
-        ///Also append the project's creation time in the hash because 2 projects opened concurrently
-        ///could reproduce the same (especially simple graphs like Viewer-Reader)
-        qint64 creationTime =  getApp()->getProject()->getProjectCreationTime();
-        _imp->hash.append(creationTime);
+            ///Also append the project's creation time in the hash because 2 projects opened concurrently
+            ///could reproduce the same (especially simple graphs like Viewer-Reader)
+            qint64 creationTime =  getApp()->getProject()->getProjectCreationTime();
+            _imp->hash.append(creationTime);
+        }
 
         _imp->hash.computeHash();
 
@@ -870,10 +917,11 @@ Node::computeHashInternal()
 
     if (hashChanged) {
         _imp->effect->onNodeHashChanged(newHash);
-        if ( _imp->nodeCreated && !getApp()->getProject()->isProjectClosing() ) {
+        if ( !contentBased && _imp->nodeCreated && !getApp()->getProject()->isProjectClosing() ) {
             /*
              * We changed the node hash. That means all cache entries for this node with a different hash
              * are impossible to re-create again. Just discard them all. This is done in a separate thread.
+             * With content-based hashes, they can be hit again after an undo: let the LRU evict them instead.
              */
             removeAllImagesFromCacheWithMatchingIDAndDifferentKey(newHash);
         }
@@ -29,6 +29,7 @@
 #include <limits>
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
 #include <QtCore/QDebug>
 #include <QtCore/QByteArray>
@@ -181,6 +182,39 @@ public:
 private:
     OfxImageEffectInstance* effect;
 };
+
+/**
+ * @class Bakes the parametric params of an effect into tables before the render action,
+ * and lets them release the tables once it returned (@see OfxParametricInstance::beginRender()).
+ **/
+class ParametricLUTsBaker
+{
+public:
+
+    ParametricLUTsBaker(OfxImageEffectInstance* effect)
+        : parametricParams()
+    {
+        const std::list<OFX::Host::Param::Instance*>& params = effect->getParamList();
+
+        for (std::list<OFX::Host::Param::Instance*>::const_iterator it = params.begin(); it != params.end(); ++it) {
+            OfxParametricInstance* isParametric = dynamic_cast<OfxParametricInstance*>(*it);
+            if (isParametric) {
+                isParametric->beginRender();
+                parametricParams.push_back(isParametric);
+            }
+        }
+    }
+
+    ~ParametricLUTsBaker()
+    {
+        for (std::vector<OfxParametricInstance*>::const_iterator it = parametricParams.begin(); it != parametricParams.end(); ++it) {
+            (*it)->endRender();
+        }
+    }
+
+private:
+    std::vector<OfxParametricInstance*> parametricParams;
+};
 } // anon namespace
 
 struct OfxEffectInstancePrivate
@@ -2088,6 +2122,7 @@ OfxEffectInstance::render(const RenderActionArgs& args)
                                              Image::getLevelFromScale(args.originalScale.x),
                                              firstPlane.first,
                                              args.inputImages);
+        ParametricLUTsBaker lutsBaker( effectInstance() );
         OfxGLContextEffectData* isOfxGLData = dynamic_cast<OfxGLContextEffectData*>( args.glContextData.get() );
         void* oglData = isOfxGLData ? isOfxGLData->getDataHandle() : 0;
 
@@ -32,6 +32,7 @@
 #include <new> // std::bad_alloc
 #include <stdexcept> // std::exception
 #include <cctype> // tolower
+#include <cstdio> // rename
 #include <algorithm> // transform, min, max
 #include <string>
 #include <cstring> // for std::memcpy, std::memset, std::strcmp
@@ -50,7 +51,6 @@ CLANG_DIAG_ON(deprecated-register)
 #ifdef OFX_SUPPORTS_MULTITHREAD
 #include <QtCore/QThread>
 #include <QtCore/QThreadStorage>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 // /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
 #include <boost/bind.hpp>
@@ -110,6 +110,7 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/StandardPaths.h"
 #include "Engine/TLSHolder.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/Timer.h"
 
 //An effect may not use more than this amount of threads
 #define NATRON_MULTI_THREAD_SUITE_MAX_NUM_CPU 4
@@ -772,6 +773,23 @@ getCacheFilePath()
     return ofxCacheFilePath;
 }
 
+///Replace the cache file by a freshly written one. On POSIX this is atomic, so that
+///concurrent renderer processes never read a missing or partially written cache.
+static bool
+replaceCacheFile(const QString& from,
+                 const QString& to)
+{
+#ifdef __NATRON_WIN32__
+    // QFile::rename() does not overwrite an existing file
+    QFile::remove(to);
+
+    return QFile::rename(from, to);
+#else
+
+    return std::rename( QFile::encodeName(from).constData(), QFile::encodeName(to).constData() ) == 0;
+#endif
+}
+
 
 static void
 getPluginShortcuts(const OFX::Host::ImageEffect::Descriptor& desc, std::list<PluginActionShortcut>* shortcuts)
@@ -910,6 +928,7 @@ OfxHost::loadOFXPlugins(IOPluginsMap* readersMap,
     QString ofxCacheFilePath = getCacheFilePath();
     qDebug() << "Load OFX Plugins: reading cache file" << ofxCacheFilePath;
 
+    TimeLapse timer;
     {
         FStreamsSupport::ifstream ifs;
         FStreamsSupport::open( &ifs, ofxCacheFilePath.toStdString() );
@@ -927,11 +946,14 @@ OfxHost::loadOFXPlugins(IOPluginsMap* readersMap,
         }
     }
     
+    appPTR->printStartupTime( "OpenFX cache read", timer.getTimeElapsedReset() );
+
     qDebug() << "Load OFX Plugins: plugin path is" << pluginCache->getPluginPath();
     qDebug() << "Load OFX Plugins: scan plugins...";
     pluginCache->scanPluginFiles();
     qDebug() << "Load OFX Plugins: scan plugins... done!";
     _imp->loadingPluginID.clear(); // finished loading plugins
+    appPTR->printStartupTime( "OpenFX plug-in scan", timer.getTimeElapsedReset() );
 
     if ( pluginCache->dirty() ) {
         // write the cache NOW (it won't change anyway)
@@ -939,6 +961,7 @@ OfxHost::loadOFXPlugins(IOPluginsMap* readersMap,
         /// flush out the current cache
         writeOFXCache();
         qDebug() << "Load OFX Plugins: writing cache file... done!";
+        appPTR->printStartupTime( "OpenFX cache write", timer.getTimeElapsedReset() );
     }
 
     /*Filling node name list and plugin grouping*/
@@ -1080,6 +1103,10 @@ OfxHost::loadOFXPlugins(IOPluginsMap* readersMap,
             }
         }
     }
+    if ( appPTR->isVerbose() ) {
+        appPTR->printStartupTime( std::string("OpenFX registration of ") + QString::number( (int)ofxPlugins.size() ).toStdString() + " plug-ins",
+                                  timer.getTimeElapsedReset() );
+    }
     qDebug() << "Load OFX Plugins... done!";
 } // loadOFXPlugins
 
@@ -1091,14 +1118,20 @@ OfxHost::writeOFXCache()
     QDir().mkpath(ofxCachePath);
     QString ofxCacheFilePath = getCacheFilePath();
 
-    QTemporaryFile tmpf;
-    tmpf.open();
+    // Write next to the cache file so that the final rename stays on the same file system
+    QTemporaryFile tmpf( ofxCachePath + QString::fromUtf8("/OFXCache_XXXXXX.tmp") );
+    tmpf.setAutoRemove(false);
+    if ( !tmpf.open() ) {
+        return;
+    }
     QString tmpFileName = tmpf.fileName();
-    tmpf.remove();
+    tmpf.close();
 
     FStreamsSupport::ofstream ofile;
     FStreamsSupport::open( &ofile, tmpFileName.toStdString() );
     if (!ofile) {
+        QFile::remove(tmpFileName);
+
         return;
     }
     OFX::Host::PluginCache* pluginCache = OFX::Host::PluginCache::getPluginCache();
@@ -1106,11 +1139,10 @@ OfxHost::writeOFXCache()
     pluginCache->writePluginCache(ofile);
 
     ofile.close();
-    if (QFile::exists(ofxCacheFilePath)) {
-        QFile::remove(ofxCacheFilePath);
+    if ( !ofile || !replaceCacheFile(tmpFileName, ofxCacheFilePath) ) {
+        qDebug() << "Failed to write the OpenFX plug-ins cache" << ofxCacheFilePath;
+        QFile::remove(tmpFileName);
     }
-    QFile::copy(tmpFileName, ofxCacheFilePath);
-    QFile::remove(tmpFileName);
 }
 
 void
@@ -1161,6 +1193,8 @@ OfxHost::fetchSuite(const char *suiteName,
 {
     if ( (std::strcmp(suiteName, kOfxParametricParameterSuite) == 0) && (suiteVersion == 1) ) {
         return OFX::Host::ParametricParam::GetSuite(suiteVersion);
+    } else if ( (std::strcmp(suiteName, kNatronOfxParametricParameterLUTSuite) == 0) && (suiteVersion == 1) ) {
+        return OFX::Host::ParametricParam::GetLUTSuite(suiteVersion);
     } else {
         return OFX::Host::ImageEffect::Host::fetchSuite(suiteName, suiteVersion);
     }
@@ -1204,8 +1238,8 @@ OfxHost::setThreadAsActionCaller(OfxImageEffectInstance* instance,
 
 NATRON_NAMESPACE_ANONYMOUS_ENTER
 
-///Using QtConcurrent doesn't work with The Foundry Furnace plug-ins because they expect fresh threads
-///to be created. As QtConcurrent's thread-pool recycles thread, it seems to make Furnace crash.
+///Using the task scheduler doesn't work with The Foundry Furnace plug-ins because they expect fresh threads
+///to be created. As the scheduler recycles its threads, it seems to make Furnace crash.
 ///We think this is because Furnace must keep an internal thread-local state that becomes then dirty
 ///if we re-use the same thread.
 
@@ -1361,13 +1395,12 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
         }
 
         /// DON'T set the maximum thread count, this is a global application setting, and see the documentation excerpt above
-        //QThreadPool::globalInstance()->setMaxThreadCount(nThreads);
-        QFuture<OfxStatus> future = QtConcurrent::mapped( threadIndexes, boost::bind(threadFunctionWrapper, func, _1, nThreads, spawnerThread, customArg) );
-        future.waitForFinished();
-        ///DON'T reset back to the original value the maximum thread count
-        //QThreadPool::globalInstance()->setMaxThreadCount(QThread::idealThreadCount());
+        ///The spawner thread executes the slices too while waiting, so a multiThread call issued from a render
+        ///that is itself running in the scheduler does not block a worker.
+        std::vector<OfxStatus> status;
+        appPTR->getTaskScheduler()->blockingMapped( threadIndexes, boost::bind(threadFunctionWrapper, func, _1, nThreads, spawnerThread, customArg), &status );
 
-        for (QFuture<OfxStatus>::const_iterator it = future.begin(); it != future.end(); ++it) {
+        for (std::vector<OfxStatus>::const_iterator it = status.begin(); it != status.end(); ++it) {
             OfxStatus stat = *it;
             if (stat != kOfxStatOK) {
                 return stat;
@@ -1438,6 +1471,14 @@ OfxHost::multiThreadNumCPUS(unsigned int *nCPUs) const
 
     if (nThreadsToRender == -1) {
         *nCPUs = 1;
+    } else if ( appPTR->getUseThreadPool() ) {
+        // The slices are queued in the task scheduler, which never runs more than its workers + the spawner thread:
+        // there is no need to look at what is already running, idle workers pick the slices up as they come.
+        int maxThreadsCount = appPTR->getTaskScheduler()->getMaxThreadCount() + 1;
+        if (nThreadsPerEffect == 0) {
+            nThreadsPerEffect = maxThreadsCount;
+        }
+        *nCPUs = std::max( 1, std::min(maxThreadsCount, nThreadsPerEffect) );
     } else {
         // activeThreadCount may be negative (for example if releaseThread() is called)
         int activeThreadsCount = QThreadPool::globalInstance()->activeThreadCount();
@@ -4542,10 +4542,21 @@ OfxCustomInstance::copyFrom(const OFX::Host::Param::Instance &instance,
 
 ////////////////////////// OfxParametricInstance /////////////////////////////////////////////////
 
+struct OfxParametricInstancePrivate
+{
+    boost::shared_ptr<TLSHolder<OfxParamToKnob::OfxParamTLSData> > tlsData;
+
+    OfxParametricInstancePrivate()
+        : tlsData( new TLSHolder<OfxParamToKnob::OfxParamTLSData>() )
+    {
+    }
+};
+
 OfxParametricInstance::OfxParametricInstance(const OfxEffectInstancePtr& node,
                                              OFX::Host::Param::Descriptor & descriptor)
     : OfxParamToKnob(node)
     , OFX::Host::ParametricParam::ParametricInstance( descriptor, node->effectInstance() )
+    , _imp( new OfxParametricInstancePrivate() )
 {
     const OFX::Host::Property::Set &properties = getProperties();
     int parametricDimension = properties.getIntProperty(kOfxParamPropParametricDimension);
@@ -4740,7 +4751,7 @@ OfxParametricInstance::getValue(int curveIndex,
     if (!knob) {
         return kOfxStatFailed;
     }
-    StatusEnum stat = knob->getValue(curveIndex, parametricPosition, returnValue);
+    StatusEnum stat = knob->getValueFromLUT(curveIndex, parametricPosition, returnValue);
 
     if (stat == eStatusOK) {
         return kOfxStatOK;
@@ -4749,6 +4760,65 @@ OfxParametricInstance::getValue(int curveIndex,
     }
 }
 
+void
+OfxParametricInstance::beginRender()
+{
+    // Baking is done once per change of the curve
+    std::vector<CurveLUTPtr> luts;
+    KnobParametricPtr knob = _knob.lock();
+
+    if (knob) {
+        luts.resize( knob->getDimension() );
+        for (int i = 0; i < (int)luts.size(); ++i) {
+            luts[i] = knob->getParametricCurve(i)->getLUT();
+        }
+    }
+
+    // Each render holds its own tables: the ones replaced by an edit of the curve are freed when the last render using them returns
+    _imp->tlsData->getOrCreateTLSData()->luts.push_back(luts);
+}
+
+void
+OfxParametricInstance::endRender()
+{
+    boost::shared_ptr<OfxParamTLSData> tls = _imp->tlsData->getTLSData();
+
+    assert(tls && !tls->luts.empty());
+    if ( tls && !tls->luts.empty() ) {
+        tls->luts.pop_back();
+    }
+}
+
+OfxStatus
+OfxParametricInstance::getLUT(int curveIndex,
+                              double /*time*/,
+                              const double** table,
+                              int* tableSize,
+                              double* rangeMin,
+                              double* rangeMax)
+{
+    boost::shared_ptr<OfxParamTLSData> tls = _imp->tlsData->getTLSData();
+
+    if ( !tls || tls->luts.empty() ) {
+        // Outside of a render action: the plug-in samples the curve itself
+        return kOfxStatFailed;
+    }
+    const std::vector<CurveLUTPtr>& luts = tls->luts.back();
+    if ( (curveIndex < 0) || ( curveIndex >= (int)luts.size() ) ) {
+        return kOfxStatErrBadIndex;
+    }
+    const CurveLUTPtr& lut = luts[curveIndex];
+    if (!lut) {
+        return kOfxStatFailed;
+    }
+    *table = &lut->values[0];
+    *tableSize = (int)lut->values.size();
+    *rangeMin = lut->xMin;
+    *rangeMax = lut->xMax;
+
+    return kOfxStatOK;
+}
+
 OfxStatus
 OfxParametricInstance::getNControlPoints(int curveIndex,
                                          double /*time*/,
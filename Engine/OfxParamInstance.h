@@ -28,6 +28,7 @@
 
 #include "Global/Macros.h"
 
+#include <list>
 #include <map>
 #include <string>
 #include <vector>
@@ -128,8 +129,12 @@ public:
     //these are per ofxparam thread-local data
     struct OfxParamTLSData
     {
-        //only for string-param for now
+        //only for string-param
         std::string str;
+
+        //only for parametric-param: the tables baked for each render action in progress on this thread, the last one
+        //being the innermost
+        std::list<std::vector<CurveLUTPtr> > luts;
     };
 
     static std::string getParamLabel(OFX::Host::Param::Instance* param)
@@ -912,6 +917,7 @@ private:
 };
 
 
+struct OfxParametricInstancePrivate;
 class OfxParametricInstance
     : public OfxParamToKnob, public OFX::Host::ParametricParam::ParametricInstance
 {
@@ -973,12 +979,29 @@ public:
                                       bool addAnimationKey) OVERRIDE FINAL;
     virtual OfxStatus  deleteControlPoint(int curveIndex, int nthCtl) OVERRIDE FINAL;
     virtual OfxStatus  deleteAllControlPoints(int curveIndex) OVERRIDE FINAL;
+    virtual OfxStatus getLUT(int curveIndex,
+                             double time,
+                             const double** table,
+                             int* tableSize,
+                             double* rangeMin,
+                             double* rangeMax) OVERRIDE FINAL;
     virtual OfxStatus copyFrom(const OFX::Host::Param::Instance &instance, OfxTime offset, const OfxRangeD* range) OVERRIDE FINAL;
     virtual KnobIPtr getKnob() const OVERRIDE FINAL;
     virtual OFX::Host::Param::Instance* getOfxParam() OVERRIDE FINAL { return this; }
 
+    /**
+     * @brief Called before the render action: bakes each curve into a table (@see Curve::getLUT())
+     * and holds the tables in the thread-local storage of the render until endRender(), so that plug-ins can sample
+     * them directly. Tables replaced by an edit of the curve are freed once the last render holding them returns.
+     **/
+    void beginRender();
+    void endRender();
 
     KnobParametricWPtr _knob;
+
+private:
+
+    boost::scoped_ptr<OfxParametricInstancePrivate> _imp;
 };
 
 NATRON_NAMESPACE_EXIT
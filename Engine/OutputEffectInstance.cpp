@@ -503,7 +503,7 @@ OutputEffectInstance::reportStats(int time,
         ofile << std::endl;
         int nbCacheMiss, nbCacheHit, nbCacheHitButDownscaled;
         it->second.getCacheAccessInfos(&nbCacheMiss, &nbCacheHit, &nbCacheHitButDownscaled);
-        ofile << "Nb cache hit: " << nbCacheMiss << std::endl;
+        ofile << "Nb cache hit: " << nbCacheHit << std::endl;
         ofile << "Nb cache miss: " << nbCacheMiss << std::endl;
         ofile << "Nb cache hit requiring mipmap downscaling: " << nbCacheHitButDownscaled << std::endl;
 
@@ -53,6 +53,7 @@
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
 #include "Engine/EffectInstance.h"
+#include "Engine/FrameLockstep.h"
 #include "Engine/Image.h"
 #include "Engine/KnobFile.h"
 #include "Engine/Node.h"
@@ -852,6 +853,19 @@ OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread,
 
         return -1;
     } else {
+        ///Do not get ahead of the other renders of the lockstep, poll to check for abort
+        FrameLockstepPtr lockstep = _imp->engine->getFrameLockstep();
+        if (lockstep) {
+            while ( !lockstep->waitForFrame(this, frame, 100) ) {
+                if ( thread->mustQuit() ) {
+                    thread->notifyIsRunning(false);
+                    *enableRenderStats = false;
+
+                    return -1;
+                }
+            }
+        }
+
         ///Flag the thread as active
         {
             QMutexLocker l(&_imp->renderThreadsMutex);
@@ -1109,6 +1123,12 @@ OutputSchedulerThread::startRender()
         QMutexLocker k(&_imp->framesToRenderMutex);
         _imp->expectFrameToRender = startingFrame;
     }
+
+    FrameLockstepPtr lockstep = _imp->engine->getFrameLockstep();
+    if (lockstep) {
+        lockstep->addParticipant(this, firstFrame);
+    }
+
     SchedulingPolicyEnum policy = getSchedulingPolicy();
     if (policy == eSchedulingPolicyFFA) {
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
@@ -1155,6 +1175,12 @@ OutputSchedulerThread::stopRender()
     }
 #endif
 
+    ///Do not hold back the other renders of the lockstep
+    FrameLockstepPtr lockstep = _imp->engine->getFrameLockstep();
+    if (lockstep) {
+        lockstep->removeParticipant(this);
+    }
+
     ///Remove all current threads so the new render doesn't have many threads concurrently trying to do the same thing at the same time
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
     stopRenderThreads(0);
@@ -1569,6 +1595,11 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
         std::map<NodePtr, NodeRenderStats > statResults = stats->getStats(&timeSpentForFrame);
         if ( !statResults.empty() ) {
             effect->reportStats(frame, viewIndex, timeSpentForFrame, statResults);
+
+            FrameLockstepPtr lockstep = _imp->engine->getFrameLockstep();
+            if (lockstep) {
+                lockstep->addFrameStats(this, frame, statResults);
+            }
         }
     }
 
@@ -2962,6 +2993,10 @@ struct RenderEnginePrivate
      */
     std::list<RefreshRequest> refreshQueue;
 
+    // If set, sequential renders are frame-interleaved with the other renders of the lockstep
+    mutable QMutex frameLockstepMutex;
+    FrameLockstepPtr frameLockstep;
+
     RenderEnginePrivate(const OutputEffectInstancePtr& output)
         : schedulerCreationLock()
         , scheduler(0)
@@ -2972,6 +3007,8 @@ struct RenderEnginePrivate
         , pbMode(ePlaybackModeLoop)
         , currentFrameScheduler(0)
         , refreshQueue()
+        , frameLockstepMutex()
+        , frameLockstep()
     {
     }
 };
@@ -3002,6 +3039,22 @@ RenderEngine::getOutput() const
     return _imp->output.lock();
 }
 
+void
+RenderEngine::setFrameLockstep(const FrameLockstepPtr& lockstep)
+{
+    QMutexLocker k(&_imp->frameLockstepMutex);
+
+    _imp->frameLockstep = lockstep;
+}
+
+FrameLockstepPtr
+RenderEngine::getFrameLockstep() const
+{
+    QMutexLocker k(&_imp->frameLockstepMutex);
+
+    return _imp->frameLockstep;
+}
+
 void
 RenderEngine::renderFrameRange(bool isBlocking,
                                bool enableRenderStats,
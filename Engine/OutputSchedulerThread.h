@@ -645,6 +645,13 @@ public:
 
     OutputEffectInstancePtr getOutput() const;
 
+    /**
+     * @brief When set, the frames of the sequential renders are only started in lockstep with the other
+     * renders sharing the same FrameLockstep. Pass an empty pointer to render freely again.
+     **/
+    void setFrameLockstep(const FrameLockstepPtr& lockstep);
+    FrameLockstepPtr getFrameLockstep() const;
+
     /**
      * @brief Call this to render from firstFrame to lastFrame included.
      **/
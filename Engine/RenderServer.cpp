@@ -0,0 +1,233 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderServer.h"
+
+#include <cassert>
+#include <list>
+#include <string>
+#include <utility>
+#include <iostream>
+#include <stdexcept>
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+
+#include "Engine/AppInstance.h"
+#include "Engine/CLArgs.h"
+#include "Engine/Project.h"
+
+NATRON_NAMESPACE_ENTER
+
+RenderServer::RenderServer(const AppInstancePtr& app,
+                           const QString& projectFilePath,
+                           const QString& onLoadScript,
+                           bool enableRenderStats)
+    : _app(app)
+    , _projectFilePath( QFileInfo(projectFilePath).absoluteFilePath() )
+    , _projectHash()
+    , _onLoadScript(onLoadScript)
+    , _enableRenderStats(enableRenderStats)
+{
+    _projectHash = hashFile(_projectFilePath);
+}
+
+RenderServer::~RenderServer()
+{
+}
+
+void
+RenderServer::run(const QString& serverName)
+{
+    // Remove a socket left behind by a server that crashed
+    QLocalServer::removeServer(serverName);
+
+    QLocalServer server;
+    if ( !server.listen(serverName) ) {
+        throw std::runtime_error( tr("Cannot start the render server %1: %2").arg(serverName).arg( server.errorString() ).toStdString() );
+    }
+    std::cout << tr("Render server listening on %1").arg( server.fullServerName() ).toStdString() << std::endl;
+
+    // Jobs are rendered one after the other anyway, so clients are served sequentially
+    // with the blocking API: no event loop is running in a background process.
+    bool mustQuit = false;
+    while (!mustQuit) {
+        if ( !server.waitForNewConnection(-1) ) {
+            break;
+        }
+        QLocalSocket* socket = server.nextPendingConnection();
+        if (!socket) {
+            continue;
+        }
+        while ( !mustQuit && (socket->state() == QLocalSocket::ConnectedState) ) {
+            if ( !socket->canReadLine() && !socket->waitForReadyRead(-1) ) {
+                break;
+            }
+            while ( !mustQuit && socket->canReadLine() ) {
+                QString command = QString::fromUtf8( socket->readLine() ).trimmed();
+                if ( command.isEmpty() ) {
+                    continue;
+                }
+                std::cout << tr("Render server: %1").arg(command).toStdString() << std::endl;
+
+                QString reply;
+                mustQuit = !processCommand(command, &reply);
+                socket->write( reply.toUtf8() + '\n' );
+                socket->waitForBytesWritten(-1);
+            }
+        }
+        socket->disconnectFromServer();
+        delete socket;
+    }
+    server.close();
+} // RenderServer::run
+
+bool
+RenderServer::processCommand(const QString& command,
+                             QString* reply)
+{
+    assert(reply);
+    int firstSpace = command.indexOf( QLatin1Char(' ') );
+    QString name = (firstSpace == -1) ? command : command.left(firstSpace);
+    QString args = (firstSpace == -1) ? QString() : command.mid(firstSpace + 1).trimmed();
+
+    try {
+        if ( name == QString::fromUtf8("quit") ) {
+            *reply = QString::fromUtf8("bye");
+
+            return false;
+        } else if ( name == QString::fromUtf8("load") ) {
+            if ( args.isEmpty() ) {
+                throw std::invalid_argument( tr("You must specify the project file path").toStdString() );
+            }
+            loadProjectIfChanged(args);
+            *reply = QString::fromUtf8("ok");
+        } else if ( name == QString::fromUtf8("render") ) {
+            renderJob(args);
+            *reply = QString::fromUtf8("done");
+        } else {
+            throw std::invalid_argument( tr("Unknown command: %1").arg(name).toStdString() );
+        }
+    } catch (const std::exception& e) {
+        // A reply is exactly 1 line
+        QString message = QString::fromUtf8( e.what() );
+        message.replace( QLatin1Char('\n'), QLatin1Char(' ') );
+        *reply = QString::fromUtf8("error ") + message;
+        std::cout << tr("Render server: %1").arg(*reply).toStdString() << std::endl;
+    }
+
+    return true;
+}
+
+void
+RenderServer::renderJob(const QString& args)
+{
+    AppInstancePtr app = _app.lock();
+
+    if (!app) {
+        throw std::logic_error("RenderServer::renderJob");
+    }
+
+    // Script-names cannot be parsed as frame ranges, so the range is optional
+    QStringList tokens = args.split( QLatin1Char(' '), QString::SkipEmptyParts );
+    std::list<std::pair<int, std::pair<int, int> > > frameRanges;
+    std::list<std::string> writers;
+    for (QStringList::const_iterator it = tokens.begin(); it != tokens.end(); ++it) {
+        if ( ( it == tokens.begin() ) && CLArgs::parseFrameRanges(*it, &frameRanges) ) {
+            continue;
+        }
+        writers.push_back( it->toStdString() );
+    }
+
+    loadProjectIfChanged(_projectFilePath);
+
+    app->startWritersRenderingFromNames(_enableRenderStats, true /*doBlockingRender*/, writers, frameRanges);
+}
+
+void
+RenderServer::loadProjectIfChanged(const QString& projectFilePath)
+{
+    QFileInfo info(projectFilePath);
+    QString absoluteFilePath = info.absoluteFilePath();
+    QByteArray fileHash = hashFile(absoluteFilePath);
+
+    if ( (absoluteFilePath == _projectFilePath) && (fileHash == _projectHash) ) {
+        return;
+    }
+
+    AppInstancePtr app = _app.lock();
+    if (!app) {
+        throw std::logic_error("RenderServer::loadProjectIfChanged");
+    }
+
+    // If loading fails the project is left empty: the next job must try again
+    _projectFilePath = absoluteFilePath;
+    _projectHash.clear();
+
+    std::cout << tr("Render server: loading %1").arg(absoluteFilePath).toStdString() << std::endl;
+    if ( info.suffix() == QString::fromUtf8(NATRON_PROJECT_FILE_EXT) ) {
+        if ( !app->loadProject( absoluteFilePath.toStdString() ) ) {
+            throw std::invalid_argument( tr("Project file loading failed.").toStdString() );
+        }
+    } else if ( info.suffix() == QString::fromUtf8("py") ) {
+        app->getProject()->resetProject();
+        if ( !app->loadPythonScript(info) ) {
+            throw std::invalid_argument( tr("Python script loading failed.").toStdString() );
+        }
+    } else {
+        throw std::invalid_argument( tr("%1 only accepts python scripts or .ntp project files.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ).toStdString() );
+    }
+
+    if ( !_onLoadScript.isEmpty() ) {
+        QFileInfo cbInfo(_onLoadScript);
+        if ( cbInfo.exists() ) {
+            app->loadPythonScript(cbInfo);
+        }
+    }
+
+    _projectHash = fileHash;
+} // RenderServer::loadProjectIfChanged
+
+QByteArray
+RenderServer::hashFile(const QString& filePath)
+{
+    QFile file(filePath);
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        throw std::invalid_argument( tr("%1: No such file.").arg(filePath).toStdString() );
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    while ( !file.atEnd() ) {
+        hash.addData( file.read(1 << 16) );
+    }
+
+    return hash.result();
+}
+
+NATRON_NAMESPACE_EXIT
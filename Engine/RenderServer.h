@@ -0,0 +1,105 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_RenderServer_h
+#define Engine_RenderServer_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QByteArray>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QString>
+CLANG_DIAG_ON(deprecated)
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A long-lived background renderer (NatronRenderer --server <name>).
+ * Instead of rendering once and exiting, the process keeps its project, plug-ins and caches loaded and renders the
+ * jobs received on a local socket, one client at a time. Messages consist of exactly 1 line, like for the
+ * ProcessHandler IPC:
+ * - "render <frameRange> [<writer> ...]" renders the frame range (command-line syntax) with the given writers,
+ * or all the writers of the project. Replies "done" once the render is finished.
+ * - "load <project file path>" makes subsequent jobs render this project. Replies "ok".
+ * - "quit" stops the server. Replies "bye".
+ * A command that fails replies "error <message>".
+ * Before each job the content of the project file is hashed: the project is only reloaded if it changed, so that
+ * consecutive jobs hit the warm image cache.
+ **/
+class RenderServer
+{
+    Q_DECLARE_TR_FUNCTIONS(RenderServer)
+
+public:
+
+    /**
+     * @brief The project file path must be the project currently loaded in app.
+     * The onLoadScript, if any, is executed again each time the project is reloaded.
+     **/
+    RenderServer(const AppInstancePtr& app,
+                 const QString& projectFilePath,
+                 const QString& onLoadScript,
+                 bool enableRenderStats);
+
+    ~RenderServer();
+
+    /**
+     * @brief Listens on the local socket serverName and serves jobs until the "quit" command is received.
+     * This is blocking.
+     **/
+    void run(const QString& serverName);
+
+    /**
+     * @brief Executes a single command line and sets the reply to send back.
+     * @returns False if the server should stop.
+     **/
+    bool processCommand(const QString& command, QString* reply);
+
+private:
+
+    void renderJob(const QString& args);
+
+    /**
+     * @brief Loads the given project, unless it is the current one and its file did not change.
+     **/
+    void loadProjectIfChanged(const QString& projectFilePath);
+
+    static QByteArray hashFile(const QString& filePath);
+
+    AppInstanceWPtr _app;
+    QString _projectFilePath;
+    QByteArray _projectHash;
+    QString _onLoadScript;
+    bool _enableRenderStats;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_RenderServer_h
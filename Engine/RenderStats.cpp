@@ -66,6 +66,10 @@ struct NodeRenderStatsPrivate
     int nbCacheHit;
     int nbCacheHitButDownscaledImages;
 
+    //The number of expressions evaluated and the time spent in their evaluation
+    int nbExpressionsEvaluated;
+    double timeSpentInExpressions;
+
     //Is tile support enabled for this render
     bool tileSupportEnabled;
 
@@ -89,6 +93,8 @@ struct NodeRenderStatsPrivate
         , nbCacheMisses(0)
         , nbCacheHit(0)
         , nbCacheHitButDownscaledImages(0)
+        , nbExpressionsEvaluated(0)
+        , timeSpentInExpressions(0)
         , tileSupportEnabled(false)
         , renderScaleSupportEnabled(false)
         , channelsEnabled()
@@ -128,6 +134,8 @@ NodeRenderStats::operator=(const NodeRenderStats& other)
     _imp->nbCacheMisses = other._imp->nbCacheMisses;
     _imp->nbCacheHit = other._imp->nbCacheHit;
     _imp->nbCacheHitButDownscaledImages = other._imp->nbCacheHitButDownscaledImages;
+    _imp->nbExpressionsEvaluated = other._imp->nbExpressionsEvaluated;
+    _imp->timeSpentInExpressions = other._imp->timeSpentInExpressions;
     _imp->tileSupportEnabled = other._imp->tileSupportEnabled;
     _imp->renderScaleSupportEnabled = other._imp->renderScaleSupportEnabled;
     for (int i = 0; i < 4; ++i) {
@@ -254,6 +262,21 @@ NodeRenderStats::getCacheAccessInfos(int* nbCacheMisses,
     *nbCacheHitButDownscaledImages = _imp->nbCacheHitButDownscaledImages;
 }
 
+void
+NodeRenderStats::addExpressionEvaluation(double time)
+{
+    ++_imp->nbExpressionsEvaluated;
+    _imp->timeSpentInExpressions += time;
+}
+
+void
+NodeRenderStats::getExpressionsInfos(int* nbEvaluations,
+                                     double* timeSpent) const
+{
+    *nbEvaluations = _imp->nbExpressionsEvaluated;
+    *timeSpent = _imp->timeSpentInExpressions;
+}
+
 void
 NodeRenderStats::setTilesSupported(bool tilesSupported)
 {
@@ -436,6 +459,18 @@ RenderStats::addRenderInfosForNode(const NodePtr& node,
     stats.addPlaneRendered(plane);
 }
 
+void
+RenderStats::addExpressionInfosForNode(const NodePtr& node,
+                                       double timeSpent)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addExpressionEvaluation(timeSpent);
+}
+
 std::map<NodePtr, NodeRenderStats >
 RenderStats::getStats(double *totalTimeSpent) const
 {
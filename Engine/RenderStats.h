@@ -88,6 +88,9 @@ public:
     void addCacheAccessInfo(bool isCacheMiss, bool hasDownscaled);
     void getCacheAccessInfos(int* nbCacheMisses, int* nbCacheHits, int* nbCacheHitButDownscaledImages) const;
 
+    void addExpressionEvaluation(double time);
+    void getExpressionsInfos(int* nbEvaluations, double* timeSpent) const;
+
     void setTilesSupported(bool tilesSupported);
     bool isTilesSupportEnabled() const;
 
@@ -143,6 +146,12 @@ public:
                                const RectI& rectangle,
                                double timeSpent);
 
+    /**
+     * @brief Accounts the evaluation of an expression of a knob of the given node.
+     **/
+    void addExpressionInfosForNode(const NodePtr& node,
+                                   double timeSpent);
+
     std::map<NodePtr, NodeRenderStats > getStats(double *totalTimeSpent) const;
 
 private:
@@ -26,6 +26,7 @@
 #include "RotoContext.h"
 
 #include <algorithm> // min, max
+#include <iterator> // advance
 #include <sstream>
 #include <locale>
 #include <limits>
@@ -70,6 +71,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoLayer.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewerInstance.h"
@@ -97,6 +99,13 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 //This will enable correct evaluation of beziers
 //#define ROTO_USE_MESH_PATTERN_ONLY
 
+// Render the closed beziers with cairo instead of RotoRasterizer
+//#define ROTO_RENDER_BEZIER_WITH_CAIRO
+
+// Largest motion, in pixels, of the points of a shape between two of its motion-blur samples.
+// Shapes that move less over the shutter interval are rendered with fewer samples than the motion-blur amount asks for.
+#define ROTO_MOTION_BLUR_SAMPLE_DISTANCE 1.
+
 // The number of pressure levels is 256 on an old Wacom Graphire 4, and 512 on an entry-level Wacom Bamboo
 // 512 should be OK, see:
 // http://www.davidrevoy.com/article182/calibrating-wacom-stylus-pressure-on-krita
@@ -158,11 +167,11 @@ RotoContext::getRotoPaintBottomMergeNode() const
         return NodePtr();
     }
 
-    int bop;
-    if ( isRotoPaintTreeConcatenatableInternal(items, &bop) ) {
+    {
         QMutexLocker k(&_imp->rotoContextMutex);
-        if ( !_imp->globalMergeNodes.empty() ) {
-            return _imp->globalMergeNodes.front();
+        NodePtr bottomMerge = _imp->bottomMergeNode.lock();
+        if (bottomMerge) {
+            return bottomMerge;
         }
     }
 
@@ -923,49 +932,18 @@ const
 }
 
 bool
-RotoContext::isRotoPaintTreeConcatenatableInternal(const std::list<RotoDrawableItemPtr>& items,
-                                                   int* blendingMode)
+RotoContext::isRotoPaintItemConcatenatable(const RotoDrawableItemPtr& item)
 {
-    bool operatorSet = false;
-    int comp_i = -1;
+    RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>( item.get() );
 
-    for (std::list<RotoDrawableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
-        int op = (*it)->getCompositingOperator();
-        if (!operatorSet) {
-            operatorSet = true;
-            comp_i = op;
-        } else {
-            if (op != comp_i) {
-                //2 items have a different compositing operator
-                return false;
-            }
-        }
-        RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>( it->get() );
-        if (!isStroke) {
-            assert( dynamic_cast<Bezier*>( it->get() ) );
-        } else {
-            if (isStroke->getBrushType() != eRotoStrokeTypeSolid) {
-                return false;
-            }
-        }
-    }
-    if (operatorSet) {
-        *blendingMode = comp_i;
+    if (!isStroke) {
+        assert( dynamic_cast<Bezier*>( item.get() ) );
 
         return true;
     }
 
-    return false;
-}
-
-bool
-RotoContext::isRotoPaintTreeConcatenatable() const
-{
-    // Do not use only activated items when defining the shape of the RotoPaint tree otherwise we would have to adjust the tree at each frame.
-    std::list<RotoDrawableItemPtr> items = getCurvesByRenderOrder(false /*onlyActivatedItems*/);
-    int bop;
-
-    return isRotoPaintTreeConcatenatableInternal(items, &bop);
+    // The other strokes read the image below them
+    return isStroke->getBrushType() == eRotoStrokeTypeSolid;
 }
 
 bool
@@ -2895,6 +2873,17 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
 
     double opacity = getOpacity(time);
 
+#ifndef ROTO_RENDER_BEZIER_WITH_CAIRO
+    if ( isBezier && !isBezier->isOpenBezier() ) {
+        // Closed shapes are rasterized per tile, in parallel, directly into the image
+        RotoRasterizer rasterizer;
+        RotoContextPrivate::rasterizeBezier(&rasterizer, isBezier, time, startTime, endTime, timeStep, mipmapLevel);
+        rasterizer.render(roi, shapeColor, opacity, inverted, image.get());
+
+        return image;
+    }
+#endif
+
     ////Allocate the cairo temporary buffer
     CairoImageWrapper imgWrapper;
 
@@ -3309,19 +3298,168 @@ RotoContextPrivate::renderBezier(cairo_t* cr,
 } // RotoContextPrivate::renderBezier
 
 void
-RotoContextPrivate::renderFeather(const Bezier* bezier,
-                                  double time,
-                                  unsigned int mipmapLevel,
-                                  double shapeColor[3],
-                                  double /*opacity*/,
-                                  double featherDist,
-                                  double fallOff,
-                                  cairo_pattern_t* mesh)
+RotoContextPrivate::computeMotionBlurSampleTimes(const Bezier* bezier,
+                                                 double startTime,
+                                                 double endTime,
+                                                 double mbFrameStep,
+                                                 unsigned int mipmapLevel,
+                                                 std::vector<double>* sampleTimes)
+{
+    sampleTimes->clear();
+    for (double t = startTime; t <= endTime; t += mbFrameStep) {
+        sampleTimes->push_back(t);
+    }
+    if (sampleTimes->size() <= 1) {
+        return;
+    }
+
+    // The longest path followed by a point of the shape (or by its feather edge), in pixels, over the samples asked for.
+    // The tangents are followed too: they bend the curve between the points.
+    BezierCPs cps = bezier->getControlPoints_mt_safe();
+    BezierCPs fps = bezier->getFeatherPoints_mt_safe();
+    std::vector<Transform::Matrix3x3> transforms( sampleTimes->size() );
+    for (std::size_t i = 0; i < sampleTimes->size(); ++i) {
+        bezier->getTransformAtTime( (*sampleTimes)[i], &transforms[i] );
+    }
+    double featherDistPath = 0.;
+    double prevFeatherDist = bezier->getFeatherDistance( sampleTimes->front() );
+    for (std::size_t i = 1; i < sampleTimes->size(); ++i) {
+        double featherDist = bezier->getFeatherDistance( (*sampleTimes)[i] );
+        featherDistPath += std::abs(featherDist - prevFeatherDist);
+        prevFeatherDist = featherDist;
+    }
+    double maxPath = 0.;
+    for (int list = 0; list < 2; ++list) {
+        const BezierCPs& points = list == 0 ? cps : fps;
+        for (BezierCPs::const_iterator it = points.begin(); it != points.end(); ++it) {
+            // The point, then its left and right tangents
+            for (int k = 0; k < 3; ++k) {
+                double path = 0.;
+                Transform::Point3D prev;
+                for (std::size_t i = 0; i < sampleTimes->size(); ++i) {
+                    Transform::Point3D p;
+                    double time = (*sampleTimes)[i];
+                    if (k == 0) {
+                        (*it)->getPositionAtTime(false, time, ViewIdx(0), &p.x, &p.y);
+                    } else if (k == 1) {
+                        (*it)->getLeftBezierPointAtTime(false, time, ViewIdx(0), &p.x, &p.y);
+                    } else {
+                        (*it)->getRightBezierPointAtTime(false, time, ViewIdx(0), &p.x, &p.y);
+                    }
+                    p.z = 1.;
+                    p = Transform::matApply(transforms[i], p);
+                    if (p.z != 0) {
+                        p.x /= p.z;
+                        p.y /= p.z;
+                    }
+                    if (i > 0) {
+                        path += std::sqrt( (p.x - prev.x) * (p.x - prev.x) + (p.y - prev.y) * (p.y - prev.y) );
+                    }
+                    prev = p;
+                }
+                maxPath = std::max(maxPath, path);
+            }
+        }
+    }
+    maxPath += featherDistPath;
+    if (mipmapLevel != 0) {
+        maxPath /= (1 << mipmapLevel);
+    }
+
+    std::size_t nSamples = (std::size_t)std::ceil(maxPath / ROTO_MOTION_BLUR_SAMPLE_DISTANCE) + 1;
+    if ( nSamples >= sampleTimes->size() ) {
+        return;
+    }
+
+    // Spread the samples uniformly over the same interval
+    double first = sampleTimes->front();
+    double last = sampleTimes->back();
+    sampleTimes->resize(nSamples);
+    if (nSamples == 1) {
+        (*sampleTimes)[0] = (first + last) / 2.;
+    } else {
+        for (std::size_t i = 0; i < nSamples; ++i) {
+            (*sampleTimes)[i] = first + (last - first) * i / (nSamples - 1);
+        }
+    }
+} // RotoContextPrivate::computeMotionBlurSampleTimes
+
+void
+RotoContextPrivate::evaluateBezierSample(const Bezier* bezier,
+                                         unsigned int mipmapLevel,
+                                         RotoBezierSample* sample)
 {
-    ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
-    ///to the Natron image.
+    double featherDist = bezier->getFeatherDistance(sample->time);
 
-    double fallOffInverse = 1. / fallOff;
+    sample->fallOff = bezier->getFeatherFallOff(sample->time);
+
+    ///Adjust the feather distance so it takes the mipmap level into account
+    if (mipmapLevel != 0) {
+        featherDist /= (1 << mipmapLevel);
+    }
+
+    // The same patches as the cairo renderer
+    std::list<ParametricPoint> bezierPolygon;
+    computeFeatherQuads(bezier, sample->time, mipmapLevel, featherDist, &sample->feather, &bezierPolygon);
+
+    sample->polygon.clear();
+    sample->polygon.reserve( bezierPolygon.size() );
+    for (std::list<ParametricPoint>::const_iterator it = bezierPolygon.begin(); it != bezierPolygon.end(); ++it) {
+        Point p;
+        p.x = it->x;
+        p.y = it->y;
+        sample->polygon.push_back(p);
+    }
+}
+
+void
+RotoContextPrivate::rasterizeBezier(RotoRasterizer* rasterizer,
+                                    const Bezier* bezier,
+                                    double time,
+                                    double startTime,
+                                    double endTime,
+                                    double mbFrameStep,
+                                    unsigned int mipmapLevel)
+{
+    ///render the bezier only if finished (closed) and activated
+    if ( !bezier->isCurveFinished() || !bezier->isActivated(time) || ( bezier->getControlPointsCount() <= 1 ) ) {
+        return;
+    }
+
+    std::vector<double> sampleTimes;
+    computeMotionBlurSampleTimes(bezier, startTime, endTime, mbFrameStep, mipmapLevel, &sampleTimes);
+
+    std::vector<RotoBezierSample> samples( sampleTimes.size() );
+    std::vector<RotoBezierSample*> samplesToEvaluate( samples.size() );
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        samples[i].time = sampleTimes[i];
+        samplesToEvaluate[i] = &samples[i];
+    }
+
+    // The motion-blur samples are evaluated concurrently, each one in its own buffers
+    TaskScheduler* scheduler = appPTR ? appPTR->getTaskScheduler() : 0;
+    if ( !scheduler || (samples.size() == 1) ) {
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            evaluateBezierSample(bezier, mipmapLevel, &samples[i]);
+        }
+    } else {
+        scheduler->blockingMap( samplesToEvaluate, boost::bind(&RotoContextPrivate::evaluateBezierSample, bezier, mipmapLevel, _1) );
+    }
+
+    // Shapes are added in the order of the samples so that the mask does not depend on the scheduling
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        rasterizer->addShape(samples[i].polygon, samples[i].feather, samples[i].fallOff);
+    }
+} // RotoContextPrivate::rasterizeBezier
+
+void
+RotoContextPrivate::computeFeatherQuads(const Bezier* bezier,
+                                        double time,
+                                        unsigned int mipmapLevel,
+                                        double featherDist,
+                                        std::vector<RotoFeatherQuad>* quads,
+                                        std::list<ParametricPoint>* bezierPolygon)
+{
     /*
      * We descretize the feather control points to obtain a polygon so that the feather distance will be of the same thickness around all the shape.
      * If we were to extend only the end points, the resulting bezier interpolation would create a feather with different thickness around the shape,
@@ -3331,7 +3469,6 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
     ///This is used only if the feather distance is different of 0 and the feather points equal
     ///the control points in order to still be able to apply the feather distance.
     std::list<ParametricPoint> featherPolygon;
-    std::list<ParametricPoint> bezierPolygon;
     RectD featherPolyBBox;
 
     featherPolyBBox.setupInfinity();
@@ -3349,14 +3486,14 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
 #else
                                        1,
 #endif
-                                       &bezierPolygon, NULL);
+                                       bezierPolygon, NULL);
 
     bool clockWise = bezier->isFeatherPolygonClockwiseOriented(false, time);
 
-    assert( !featherPolygon.empty() && !bezierPolygon.empty() );
+    assert( !featherPolygon.empty() && !bezierPolygon->empty() );
 
-
-    std::list<Point> featherContour;
+    quads->clear();
+    quads->reserve( featherPolygon.size() );
 
     // prepare iterators
     std::list<ParametricPoint>::iterator next = featherPolygon.begin();
@@ -3366,8 +3503,8 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
     }
     std::list<ParametricPoint>::iterator prev = featherPolygon.end();
     --prev; // can only be valid since we assert the list is not empty
-    std::list<ParametricPoint>::iterator bezIT = bezierPolygon.begin();
-    std::list<ParametricPoint>::iterator prevBez = bezierPolygon.end();
+    std::list<ParametricPoint>::iterator bezIT = bezierPolygon->begin();
+    std::list<ParametricPoint>::iterator prevBez = bezierPolygon->end();
     --prevBez; // can only be valid since we assert the list is not empty
 
     // prepare p1
@@ -3388,12 +3525,7 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
         p1.y += dy * absFeatherDist;
     }
 
-
-    double innerOpacity = 1.;
-    double outterOpacity = 0.;
-
     Point origin = p1;
-    featherContour.push_back(p1);
 
 
     // increment for first iteration
@@ -3403,8 +3535,8 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
     assert( cur != featherPolygon.end() &&
             prev != featherPolygon.end() &&
             next != featherPolygon.end() &&
-            bezIT != bezierPolygon.end() &&
-            prevBez != bezierPolygon.end() );
+            bezIT != bezierPolygon->end() &&
+            prevBez != bezierPolygon->end() );
     if ( cur != featherPolygon.end() ) {
         ++cur;
     }
@@ -3414,10 +3546,10 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
     if ( next != featherPolygon.end() ) {
         ++next;
     }
-    if ( bezIT != bezierPolygon.end() ) {
+    if ( bezIT != bezierPolygon->end() ) {
         ++bezIT;
     }
-    if ( prevBez != bezierPolygon.end() ) {
+    if ( prevBez != bezierPolygon->end() ) {
         ++prevBez;
     }
 
@@ -3428,11 +3560,11 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
         if ( prev == featherPolygon.end() ) {
             prev = featherPolygon.begin();
         }
-        if ( bezIT == bezierPolygon.end() ) {
-            bezIT = bezierPolygon.begin();
+        if ( bezIT == bezierPolygon->end() ) {
+            bezIT = bezierPolygon->begin();
         }
-        if ( prevBez == bezierPolygon.end() ) {
-            prevBez = bezierPolygon.begin();
+        if ( prevBez == bezierPolygon->end() ) {
+            prevBez = bezierPolygon->begin();
         }
         bool mustStop = false;
         if ( cur == featherPolygon.end() ) {
@@ -3445,7 +3577,7 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
             continue;
         }*/
 
-        Point p0, p0p1, p1p0, p2, p2p3, p3p2, p3;
+        Point p0, p2, p3;
         p0.x = prevBez->x;
         p0.y = prevBez->y;
         p3.x = bezIT->x;
@@ -3474,7 +3606,53 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
             p2.x = origin.x;
             p2.y = origin.y;
         }
-        featherContour.push_back(p2);
+
+        RotoFeatherQuad quad;
+        quad.p[0] = p0;
+        quad.p[1] = p1;
+        quad.p[2] = p2;
+        quad.p[3] = p3;
+        quads->push_back(quad);
+
+        if (mustStop) {
+            break;
+        }
+
+        p1 = p2;
+
+        // increment for next iteration
+        // ++prev, ++next, ++bezIT, ++prevBez
+        if ( prev != featherPolygon.end() ) {
+            ++prev;
+        }
+        if ( next != featherPolygon.end() ) {
+            ++next;
+        }
+        if ( bezIT != bezierPolygon->end() ) {
+            ++bezIT;
+        }
+        if ( prevBez != bezierPolygon->end() ) {
+            ++prevBez;
+        }
+    }  // for each point in polygon
+} // RotoContextPrivate::computeFeatherQuads
+
+void
+RotoContextPrivate::renderFeatherQuads_cairo(const std::vector<RotoFeatherQuad>& quads,
+                                             double shapeColor[3],
+                                             double fallOff,
+                                             cairo_pattern_t* mesh)
+{
+    double fallOffInverse = 1. / fallOff;
+    double innerOpacity = 1.;
+    double outterOpacity = 0.;
+
+    for (std::vector<RotoFeatherQuad>::const_iterator it = quads.begin(); it != quads.end(); ++it) {
+        const Point& p0 = it->p[0];
+        const Point& p1 = it->p[1];
+        const Point& p2 = it->p[2];
+        const Point& p3 = it->p[3];
+        Point p0p1, p1p0, p2p3, p3p2;
 
         ///linear interpolation
         p0p1.x = (p0.x * fallOff * 2. + fallOffInverse * p1.x) / (fallOff * 2. + fallOffInverse);
@@ -3516,30 +3694,26 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
         assert(cairo_pattern_status(mesh) == CAIRO_STATUS_SUCCESS);
 
         cairo_mesh_pattern_end_patch(mesh);
+    }
+} // RotoContextPrivate::renderFeatherQuads_cairo
 
-        if (mustStop) {
-            break;
-        }
-
-        //std::swap(innerOpacity, outterOpacity);
-
-        p1 = p2;
+void
+RotoContextPrivate::renderFeather(const Bezier* bezier,
+                                  double time,
+                                  unsigned int mipmapLevel,
+                                  double shapeColor[3],
+                                  double /*opacity*/,
+                                  double featherDist,
+                                  double fallOff,
+                                  cairo_pattern_t* mesh)
+{
+    ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
+    ///to the Natron image.
+    std::vector<RotoFeatherQuad> quads;
+    std::list<ParametricPoint> bezierPolygon;
 
-        // increment for next iteration
-        // ++prev, ++next, ++bezIT, ++prevBez
-        if ( prev != featherPolygon.end() ) {
-            ++prev;
-        }
-        if ( next != featherPolygon.end() ) {
-            ++next;
-        }
-        if ( bezIT != bezierPolygon.end() ) {
-            ++bezIT;
-        }
-        if ( prevBez != bezierPolygon.end() ) {
-            ++prevBez;
-        }
-    }  // for each point in polygon
+    computeFeatherQuads(bezier, time, mipmapLevel, featherDist, &quads, &bezierPolygon);
+    renderFeatherQuads_cairo(quads, shapeColor, fallOff, mesh);
 } // RotoContextPrivate::renderFeather
 
 void
@@ -4641,30 +4815,17 @@ RotoContext::removeItemAsPythonField(const RotoItemPtr& item)
 }
 
 NodePtr
-RotoContext::getOrCreateGlobalMergeNode(int *availableInputIndex)
+RotoContext::getOrCreateGlobalMergeNode(std::size_t index)
 {
     {
         QMutexLocker k(&_imp->rotoContextMutex);
-        for (NodesList::iterator it = _imp->globalMergeNodes.begin(); it != _imp->globalMergeNodes.end(); ++it) {
-            const std::vector<NodeWPtr> &inputs = (*it)->getInputs();
-
-            //Merge node goes like this: B, A, Mask, A2, A3, A4 ...
-            assert( inputs.size() >= 3 && (*it)->getEffectInstance()->isInputMask(2) );
-            if ( !inputs[1].lock() ) {
-                *availableInputIndex = 1;
-
-                return *it;
-            }
-
-            //Leave the B empty to connect the next merge node
-            for (std::size_t i = 3; i < inputs.size(); ++i) {
-                if ( !inputs[i].lock() ) {
-                    *availableInputIndex = (int)i;
+        if ( index < _imp->globalMergeNodes.size() ) {
+            NodesList::iterator it = _imp->globalMergeNodes.begin();
+            std::advance(it, index);
 
-                    return *it;
-                }
-            }
+            return *it;
         }
+        assert( index == _imp->globalMergeNodes.size() );
     }
 
     NodePtr node = getNode();
@@ -4689,7 +4850,6 @@ RotoContext::getOrCreateGlobalMergeNode(int *availableInputIndex)
     if ( getNode()->isDuringPaintStrokeCreation() ) {
         mergeNode->setWhileCreatingPaintStroke(true);
     }
-    *availableInputIndex = 1;
 
     QMutexLocker k(&_imp->rotoContextMutex);
     _imp->globalMergeNodes.push_back(mergeNode);
@@ -4697,6 +4857,17 @@ RotoContext::getOrCreateGlobalMergeNode(int *availableInputIndex)
     return mergeNode;
 } // RotoContext::getOrCreateGlobalMergeNode
 
+static int
+getNextMergeAInput(const NodePtr& mergeNode,
+                   int inputNb)
+{
+    //Merge node goes like this: B, A, Mask, A2, A3, A4 ...
+    assert( mergeNode->getNInputs() >= 3 && mergeNode->getEffectInstance()->isInputMask(2) );
+    int next = (inputNb < 1) ? 1 : ( (inputNb == 1) ? 3 : inputNb + 1 );
+
+    return next < mergeNode->getNInputs() ? next : -1;
+}
+
 void
 RotoContext::refreshRotoPaintTree()
 {
@@ -4706,10 +4877,6 @@ RotoContext::refreshRotoPaintTree()
 
     // Do not use only activated items when defining the shape of the RotoPaint tree otherwise we would have to adjust the tree at each frame.
     std::list<RotoDrawableItemPtr> items = getCurvesByRenderOrder(false /*onlyActivatedItems*/);
-    int blendingOperator;
-    bool canConcatenate = isRotoPaintTreeConcatenatableInternal(items, &blendingOperator);
-    NodePtr globalMerge;
-    int globalMergeIndex = -1;
     NodesList mergeNodes;
     {
         QMutexLocker k(&_imp->rotoContextMutex);
@@ -4722,27 +4889,62 @@ RotoContext::refreshRotoPaintTree()
             (*it)->disconnectInput(i);
         }
     }
-    if (canConcatenate) {
-        globalMerge = getOrCreateGlobalMergeNode(&globalMergeIndex);
-    }
-    if (globalMerge) {
-        NodePtr rotopaintNodeInput = getNode()->getInput(0);
-        //Connect the rotopaint node input to the B input of the Merge
-        if (rotopaintNodeInput) {
-            globalMerge->connectInput(rotopaintNodeInput, 0);
+
+    /*
+       Consecutive items that only paint over the image below them (Beziers and solid strokes) with the same compositing
+       operator are concatenated: their effect nodes are connected to the A inputs of global merge nodes, which render them
+       all at once instead of going through one merge node per item.
+       The other strokes (eraser, clone, reveal, blur, smear...) read the image below them: they keep their own merge node,
+       painted over the output of the items before them.
+     */
+    NodePtr upstreamNode = getNode()->getInput(0);
+    std::size_t nGlobalMergesUsed = 0;
+    std::list<RotoDrawableItemPtr>::const_iterator it = items.begin();
+    while ( it != items.end() ) {
+        int blendingOperator = (*it)->getCompositingOperator();
+        std::list<RotoDrawableItemPtr>::const_iterator runEnd = it;
+        std::size_t runLength = 0;
+        while ( runEnd != items.end() && isRotoPaintItemConcatenatable(*runEnd) && ( (*runEnd)->getCompositingOperator() == blendingOperator ) ) {
+            ++runEnd;
+            ++runLength;
+        }
+
+        if (runLength < 2) {
+            (*it)->refreshNodesConnections(upstreamNode);
+            upstreamNode = (*it)->getMergeNode();
+            ++it;
+            continue;
         }
-    }
 
-    for (std::list<RotoDrawableItemPtr>::const_iterator it = items.begin(); it != items.end(); ++it) {
-        (*it)->refreshNodesConnections();
+        NodePtr globalMerge;
+        int globalMergeIndex = -1;
+        for (; it != runEnd; ++it) {
+            // The own merge node of the item is not part of the tree, but it is used to identify the mask of the item in the cache
+            (*it)->refreshNodesConnections(upstreamNode);
 
-        if (globalMerge) {
-            {
-                KnobIPtr mergeOperatorKnob = globalMerge->getKnobByName(kMergeOFXParamOperation);
+            if (globalMerge) {
+                globalMergeIndex = getNextMergeAInput(globalMerge, globalMergeIndex);
+            }
+            if (!globalMerge || (globalMergeIndex == -1) ) {
+                NodePtr nextMerge = getOrCreateGlobalMergeNode(nGlobalMergesUsed);
+                if (!nextMerge) {
+                    break;
+                }
+                ++nGlobalMergesUsed;
+
+                KnobIPtr mergeOperatorKnob = nextMerge->getKnobByName(kMergeOFXParamOperation);
                 KnobChoice* mergeOp = dynamic_cast<KnobChoice*>( mergeOperatorKnob.get() );
                 if (mergeOp) {
                     mergeOp->setValue(blendingOperator);
                 }
+
+                //Connect the output of the previous items to the B input of the Merge
+                NodePtr bInput = globalMerge ? globalMerge : upstreamNode;
+                if (bInput) {
+                    nextMerge->connectInput(bInput, 0);
+                }
+                globalMerge = nextMerge;
+                globalMergeIndex = getNextMergeAInput(globalMerge, 0);
             }
 
             NodePtr effectNode = (*it)->getEffectNode();
@@ -4750,16 +4952,16 @@ RotoContext::refreshRotoPaintTree()
             //qDebug() << "Connecting" << (*it)->getScriptName().c_str() << "to input" << globalMergeIndex <<
             //"(" << globalMerge->getInputLabel(globalMergeIndex).c_str() << ")" << "of" << globalMerge->getScriptName().c_str();
             globalMerge->connectInput(effectNode, globalMergeIndex);
-
-            ///Refresh for next node
-            NodePtr nextMerge = getOrCreateGlobalMergeNode(&globalMergeIndex);
-            if (nextMerge != globalMerge) {
-                assert( !nextMerge->getInput(0) );
-                nextMerge->connectInput(globalMerge, 0);
-                globalMerge = nextMerge;
-            }
         }
+        if (!globalMerge) {
+            // The merge plug-in is missing: the remaining items are not connected
+            break;
+        }
+        upstreamNode = globalMerge;
     }
+
+    QMutexLocker k(&_imp->rotoContextMutex);
+    _imp->bottomMergeNode = items.empty() ? NodePtr() : upstreamNode;
 } // RotoContext::refreshRotoPaintTree
 
 void
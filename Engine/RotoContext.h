@@ -28,6 +28,7 @@
 
 #include "Global/Macros.h"
 
+#include <cstddef>
 #include <list>
 #include <set>
 #include <string>
@@ -205,12 +206,10 @@ public:
                                    RectD* rod) const; //!< rod in canonical coordinates
 
     /**
-     * @brief Returns true if  all items have the same compositing operator and there are only strokes or bezier (because they
-     * are not masked)
+     * @brief Returns true if the item only paints over the image below it and can thus be rendered by a global merge node
+     * along with the items next to it.
      **/
-    bool isRotoPaintTreeConcatenatable() const;
-
-    static bool isRotoPaintTreeConcatenatableInternal(const std::list<RotoDrawableItemPtr>& items, int* blendingMode);
+    static bool isRotoPaintItemConcatenatable(const RotoDrawableItemPtr& item);
 
     void getGlobalMotionBlurSettings(const double time,
                                      double* startTime,
@@ -455,7 +454,10 @@ public Q_SLOTS:
 private:
 
 
-    NodePtr getOrCreateGlobalMergeNode(int *availableInputIndex);
+    /**
+     * @brief Returns the global merge node at the given index in the list, creating it if needed.
+     **/
+    NodePtr getOrCreateGlobalMergeNode(std::size_t index);
 
     void selectInternal(const RotoItemPtr& b, bool slaveKnobs = true);
     void deselectInternal(RotoItemPtr b);
@@ -57,6 +57,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Global/GlobalDefines.h"
 
 #include "Engine/AppManager.h"
+#include "Engine/Bezier.h"
 #include "Engine/BezierCP.h"
 #include "Engine/Curve.h"
 #include "Engine/EffectInstance.h"
@@ -66,6 +67,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/Node.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoPaint.h"
+#include "Engine/RotoRasterizer.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
@@ -397,6 +399,23 @@ struct RotoTriangles
     std::list<Point> vertices;
 };
 
+// A motion-blur sample of a Bezier, as rasterized by RotoRasterizer
+struct RotoBezierSample
+{
+    double time;
+    double fallOff;
+    std::vector<Point> polygon;
+    std::vector<RotoFeatherQuad> feather;
+
+    RotoBezierSample()
+        : time(0.)
+        , fallOff(1.)
+        , polygon()
+        , feather()
+    {
+    }
+};
+
 struct BezierPrivate
 {
     BezierCPs points; //< the control points of the curve
@@ -1401,10 +1420,14 @@ public:
     bool mustDoNeatRender;
 
     /*
-     * A merge node (or more if there are more than 64 items) used when all items share the same compositing operator to make the rotopaint tree shallow
+     * Merge nodes (several per group if there are more than 64 items) used to render at once consecutive items that share
+     * the same compositing operator, to make the rotopaint tree shallow
      */
     NodesList globalMergeNodes;
 
+    // The output of the rotopaint tree, as connected by refreshRotoPaintTree()
+    NodeWPtr bottomMergeNode;
+
     RotoContextPrivate(const NodePtr& n )
         : rotoContextMutex()
         , isPaintNode(false)
@@ -1418,6 +1441,7 @@ public:
         , doingNeatRender(false)
         , mustDoNeatRender(false)
         , globalMergeNodes()
+        , bottomMergeNode()
     {
         EffectInstancePtr effect = n->getEffectInstance();
         RotoPaint* isRotoNode = dynamic_cast<RotoPaint*>( effect.get() );
@@ -2229,6 +2253,11 @@ public:
                                double time,
                                unsigned int mipmapLevel);
     static void renderBezier(cairo_t* cr, const Bezier* bezier, double opacity, double time, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel);
+    static void rasterizeBezier(RotoRasterizer* rasterizer, const Bezier* bezier, double time, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel);
+    static void computeMotionBlurSampleTimes(const Bezier* bezier, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel, std::vector<double>* sampleTimes);
+    static void evaluateBezierSample(const Bezier* bezier, unsigned int mipmapLevel, RotoBezierSample* sample);
+    static void computeFeatherQuads(const Bezier * bezier, double time, unsigned int mipmapLevel, double featherDist, std::vector<RotoFeatherQuad>* quads, std::list<ParametricPoint>* bezierPolygon);
+    static void renderFeatherQuads_cairo(const std::vector<RotoFeatherQuad>& quads, double shapeColor[3], double fallOff, cairo_pattern_t * mesh);
     static void renderFeather(const Bezier * bezier, double time, unsigned int mipmapLevel, double shapeColor[3], double opacity, double featherDist, double fallOff, cairo_pattern_t * mesh);
     static void renderFeather_cairo(const std::list<RotoFeatherVertex>& vertices, double shapeColor[3],  double fallOff, cairo_pattern_t * mesh);
     static void renderInternalShape_cairo(const std::list<RotoTriangles>& triangles,
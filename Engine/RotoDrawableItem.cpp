@@ -549,7 +549,7 @@ RotoDrawableItem::rotoKnobChanged(const KnobIPtr& knob,
     }
 #endif
     else if (knob == _imp->sourceColor) {
-        refreshNodesConnections();
+        getContext()->refreshRotoPaintTree();
     } else if (knob == _imp->effectStrength) {
         double strength = _imp->effectStrength->getValue();
         switch (type) {
@@ -584,7 +584,7 @@ RotoDrawableItem::rotoKnobChanged(const KnobIPtr& knob,
             offset->setValue(value);
         }
     } else if ( (knob == _imp->timeOffsetMode) && _imp->timeOffsetNode ) {
-        refreshNodesConnections();
+        getContext()->refreshRotoPaintTree();
     }
 
     if ( (type == eRotoStrokeTypeClone) || (type == eRotoStrokeTypeReveal) ) {
@@ -703,8 +703,15 @@ void
 RotoDrawableItem::refreshNodesConnections()
 {
     RotoDrawableItem* previous = findPreviousInHierarchy();
+    NodePtr upstreamNode = previous ? previous->getMergeNode() : getContext()->getNode()->getInput(0);
+
+    refreshNodesConnections(upstreamNode);
+}
+
+void
+RotoDrawableItem::refreshNodesConnections(const NodePtr& upstreamNode)
+{
     NodePtr rotoPaintInput =  getContext()->getNode()->getInput(0);
-    NodePtr upstreamNode = previous ? previous->getMergeNode() : rotoPaintInput;
     RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>(this);
     RotoStrokeType type;
 
@@ -85,6 +85,15 @@ public:
 
     void incrementNodesAge();
 
+    /**
+     * @brief Connects the nodes of the item so that it paints over the output of upstreamNode.
+     **/
+    void refreshNodesConnections(const NodePtr& upstreamNode);
+
+    /**
+     * @brief Same as above, painting over the previous item in the hierarchy. The rotopaint tree may concatenate items
+     * differently: RotoContext::refreshRotoPaintTree() must be called when the tree layout may have changed.
+     **/
     void refreshNodesConnections();
 
     virtual void clone(const RotoItem*  other) OVERRIDE;
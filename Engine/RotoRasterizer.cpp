@@ -0,0 +1,778 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RotoRasterizer.h"
+
+#include <algorithm> // min, max, fill
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
+#include "Engine/AppManager.h"
+#include "Engine/Image.h"
+#include "Engine/ThreadPool.h"
+
+// Number of intervals of the feather fall-off lookup table
+#define ROTO_RASTERIZER_FALLOFF_LUT_SIZE 1024
+
+NATRON_NAMESPACE_ENTER
+
+RotoRasterizer::RotoRasterizer()
+    : _shapes()
+    , _bbox()
+{
+}
+
+RotoRasterizer::~RotoRasterizer()
+{
+}
+
+void
+RotoRasterizer::computeFallOffLut(double fallOff,
+                                  std::vector<float>* lut)
+{
+    /*
+       renderFeatherQuads_cairo() shades a feather patch with a Coons patch whose sides going from the inner vertices
+       (opacity 1) to the outer vertices (opacity 0) are cubic Bezier curves with their control points at a and b along
+       the side. The position along the side of the point of parameter u is thus B(u) below, and its opacity 1 - u:
+       the opacity at a point at the position s of the patch is 1 - B^-1(s). B is monotonic since 0 < a <= b < 1.
+     */
+    double a = 1. / (2. * fallOff * fallOff + 1.);
+    double b = 2. / (fallOff * fallOff + 2.);
+
+    lut->resize(ROTO_RASTERIZER_FALLOFF_LUT_SIZE + 1);
+    for (int i = 0; i <= ROTO_RASTERIZER_FALLOFF_LUT_SIZE; ++i) {
+        double d = (double)i / ROTO_RASTERIZER_FALLOFF_LUT_SIZE;
+        double lo = 0.;
+        double hi = 1.;
+        for (int iter = 0; iter < 40; ++iter) {
+            double u = (lo + hi) / 2.;
+            double v = 1. - u;
+            double bu = 3. * u * v * v * a + 3. * u * u * v * b + u * u * u;
+            if (bu < d) {
+                lo = u;
+            } else {
+                hi = u;
+            }
+        }
+        (*lut)[i] = (float)( 1. - (lo + hi) / 2. );
+    }
+}
+
+void
+RotoRasterizer::addShape(const std::vector<Point>& polygon,
+                         const std::vector<RotoFeatherQuad>& feather,
+                         double fallOff)
+{
+    if ( polygon.empty() && feather.empty() ) {
+        return;
+    }
+
+    _shapes.resize(_shapes.size() + 1);
+    Shape& shape = _shapes.back();
+    RectD shapeBbox;
+    bool bboxSet = false;
+
+    shape.edges.reserve( polygon.size() );
+    for (std::size_t i = 0; i < polygon.size(); ++i) {
+        const Point& p0 = polygon[i];
+        const Point& p1 = polygon[(i + 1) % polygon.size()];
+        if (!bboxSet) {
+            shapeBbox = RectD(p0.x, p0.y, p0.x, p0.y);
+            bboxSet = true;
+        }
+        shapeBbox.merge(p0.x, p0.y, p0.x, p0.y);
+        if (p0.y == p1.y) {
+            // Horizontal edges do not change the winding number
+            continue;
+        }
+        Edge e;
+        if (p0.y < p1.y) {
+            e.x0 = p0.x;
+            e.y0 = p0.y;
+            e.x1 = p1.x;
+            e.y1 = p1.y;
+            e.direction = 1.f;
+        } else {
+            e.x0 = p1.x;
+            e.y0 = p1.y;
+            e.x1 = p0.x;
+            e.y1 = p0.y;
+            e.direction = -1.f;
+        }
+        shape.edges.push_back(e);
+    }
+
+    shape.feather.reserve( feather.size() );
+    for (std::vector<RotoFeatherQuad>::const_iterator it = feather.begin(); it != feather.end(); ++it) {
+        FeatherQuad q;
+        for (int i = 0; i < 4; ++i) {
+            q.x[i] = it->p[i].x;
+            q.y[i] = it->p[i].y;
+        }
+        q.ex = q.x[1] - q.x[0];
+        q.ey = q.y[1] - q.y[0];
+        q.fx = q.x[3] - q.x[0];
+        q.fy = q.y[3] - q.y[0];
+        q.gx = q.x[0] - q.x[1] + q.x[2] - q.x[3];
+        q.gy = q.y[0] - q.y[1] + q.y[2] - q.y[3];
+        // The sides p[3]p[2] and p[1]p[2] are e + g and f + g
+        bool nullS = (q.ex * q.ex + q.ey * q.ey < 1e-24) && ( (q.ex + q.gx) * (q.ex + q.gx) + (q.ey + q.gy) * (q.ey + q.gy) < 1e-24 );
+        bool nullV = (q.fx * q.fx + q.fy * q.fy < 1e-24) && ( (q.fx + q.gx) * (q.fx + q.gx) + (q.fy + q.gy) * (q.fy + q.gy) < 1e-24 );
+        if (nullS || nullV) {
+            // Degenerate, e.g. when the feather distance is 0: cairo does not draw anything either
+            continue;
+        }
+        q.xmin = std::min( std::min(q.x[0], q.x[1]), std::min(q.x[2], q.x[3]) );
+        q.xmax = std::max( std::max(q.x[0], q.x[1]), std::max(q.x[2], q.x[3]) );
+        q.ymin = std::min( std::min(q.y[0], q.y[1]), std::min(q.y[2], q.y[3]) );
+        q.ymax = std::max( std::max(q.y[0], q.y[1]), std::max(q.y[2], q.y[3]) );
+        if (!bboxSet) {
+            shapeBbox = RectD(q.xmin, q.ymin, q.xmax, q.ymax);
+            bboxSet = true;
+        }
+        shapeBbox.merge(q.xmin, q.ymin, q.xmax, q.ymax);
+        shape.feather.push_back(q);
+    }
+
+    if ( shape.edges.empty() && shape.feather.empty() ) {
+        _shapes.pop_back();
+
+        return;
+    }
+
+    if ( !shape.feather.empty() ) {
+        computeFallOffLut(fallOff, &shape.fallOffLut);
+    }
+    shape.bbox = shapeBbox;
+    shape.antialiased = shape.feather.empty();
+    if (_shapes.size() == 1) {
+        _bbox = shapeBbox;
+    } else {
+        _bbox.merge(shapeBbox);
+    }
+} // RotoRasterizer::addShape
+
+void
+RotoRasterizer::rasterizeEdgeSegment(double x0,
+                                     double y0,
+                                     double x1,
+                                     double y1,
+                                     float direction,
+                                     int width,
+                                     int height,
+                                     int stride,
+                                     float* area)
+{
+    /*
+       Accumulates the signed area of each pixel that is on the right of the segment: the coverage of a pixel is then
+       the sum of the accumulated values up to it on its row. This is the scanline algorithm of font-rs (Raph Levien).
+       The segment goes downward (y0 < y1) and is within [0,width]x[0,height]. The row buffers have 2 extra values on
+       the right for the areas of the segments that are on the right edge.
+     */
+    assert(y0 < y1);
+    double dxdy = (x1 - x0) / (y1 - y0);
+    double x = x0;
+    int yStart = std::max(0, (int)std::floor(y0));
+    int yEnd = std::min(height, (int)std::ceil(y1));
+
+    for (int y = yStart; y < yEnd; ++y) {
+        float* row = area + (std::size_t)y * stride;
+        double dy = std::min( (double)(y + 1), y1 ) - std::max( (double)y, y0 );
+        double xnext = std::max( 0., std::min( (double)width, x + dxdy * dy ) );
+        double d = dy * direction;
+        double xa = std::min(x, xnext);
+        double xb = std::max(x, xnext);
+        double xaFloor = std::floor(xa);
+        int xai = (int)xaFloor;
+        double xbCeil = std::ceil(xb);
+        int xbi = (int)xbCeil;
+
+        if (xbi <= xai + 1) {
+            // The segment is within a single pixel column
+            double xmf = 0.5 * (x + xnext) - xaFloor;
+            row[xai] += (float)(d - d * xmf);
+            row[xai + 1] += (float)(d * xmf);
+        } else {
+            double s = 1. / (xb - xa);
+            double xaf = xa - xaFloor;
+            double a0 = 0.5 * s * (1. - xaf) * (1. - xaf);
+            double xbf = xb - xbCeil + 1.;
+            double am = 0.5 * s * xbf * xbf;
+            row[xai] += (float)(d * a0);
+            if (xbi == xai + 2) {
+                row[xai + 1] += (float)( d * (1. - a0 - am) );
+            } else {
+                double a1 = s * (1.5 - xaf);
+                row[xai + 1] += (float)( d * (a1 - a0) );
+                for (int xi = xai + 2; xi < xbi - 1; ++xi) {
+                    row[xi] += (float)(d * s);
+                }
+                double a2 = a1 + (xbi - xai - 3) * s;
+                row[xbi - 1] += (float)( d * (1. - a2 - am) );
+            }
+            row[xbi] += (float)(d * am);
+        }
+        x = xnext;
+    }
+} // RotoRasterizer::rasterizeEdgeSegment
+
+void
+RotoRasterizer::accumulateEdge(const Edge& edge,
+                               const RectI& tile,
+                               int stride,
+                               float* area)
+{
+    int width = tile.width();
+    int height = tile.height();
+    double x0 = edge.x0 - tile.x1;
+    double y0 = edge.y0 - tile.y1;
+    double x1 = edge.x1 - tile.x1;
+    double y1 = edge.y1 - tile.y1;
+
+    if ( (y1 <= 0.) || (y0 >= height) ) {
+        return;
+    }
+    // Clip to the rows of the tile
+    if (y0 < 0.) {
+        x0 += (x1 - x0) * (0. - y0) / (y1 - y0);
+        y0 = 0.;
+    }
+    if (y1 > height) {
+        x1 = x0 + (x1 - x0) * (height - y0) / (y1 - y0);
+        y1 = height;
+    }
+    if (y0 >= y1) {
+        return;
+    }
+
+    /*
+       Split the edge where it crosses the left and right sides of the tile. The parts that are on the left of the tile
+       cover the whole rows of the tile: they are moved to its left side. The parts that are on the right do not cover
+       anything, they are moved to its right side, which is outside of the tile.
+     */
+    double ts[4];
+    int nTs = 0;
+    ts[nTs++] = 0.;
+    if (x0 != x1) {
+        double tl = (0. - x0) / (x1 - x0);
+        double tr = (width - x0) / (x1 - x0);
+        if (tl > tr) {
+            std::swap(tl, tr);
+        }
+        if ( (tl > 0.) && (tl < 1.) ) {
+            ts[nTs++] = tl;
+        }
+        if ( (tr > 0.) && (tr < 1.) ) {
+            ts[nTs++] = tr;
+        }
+    }
+    ts[nTs++] = 1.;
+
+    double prevX = x0;
+    double prevY = y0;
+    for (int i = 1; i < nTs; ++i) {
+        double x = (i == nTs - 1) ? x1 : x0 + (x1 - x0) * ts[i];
+        double y = (i == nTs - 1) ? y1 : y0 + (y1 - y0) * ts[i];
+        if (y > prevY) {
+            rasterizeEdgeSegment(std::max( 0., std::min( (double)width, prevX ) ), prevY,
+                                 std::max( 0., std::min( (double)width, x ) ), y,
+                                 edge.direction, width, height, stride, area);
+        }
+        prevX = x;
+        prevY = y;
+    }
+} // RotoRasterizer::accumulateEdge
+
+void
+RotoRasterizer::accumulateEdgeAtPixelCenters(const Edge& edge,
+                                             const RectI& tile,
+                                             int stride,
+                                             float* area)
+{
+    // Same as accumulateEdge(), but a pixel is either covered or not by the edge depending on its center
+    int width = tile.width();
+    int yStart = std::max( tile.y1, (int)std::ceil(edge.y0 - 0.5) );
+    int yEnd = std::min( tile.y2, (int)std::ceil(edge.y1 - 0.5) );
+    double dxdy = (edge.x1 - edge.x0) / (edge.y1 - edge.y0);
+
+    for (int y = yStart; y < yEnd; ++y) {
+        double x = edge.x0 + (y + 0.5 - edge.y0) * dxdy - tile.x1;
+        int xi = std::max( 0, std::min( width, (int)std::ceil(x - 0.5) ) );
+        area[(std::size_t)(y - tile.y1) * stride + xi] += edge.direction;
+    }
+}
+
+bool
+RotoRasterizer::getFeatherQuadPosition(const FeatherQuad& q,
+                                       double x,
+                                       double y,
+                                       double* s)
+{
+    /*
+       Inverts the bilinear patch p(s,v) = p[0] + s * e + v * f + s * v * g at (x,y) (Inigo Quilez): v is a root of
+       k2 * v^2 + k1 * v + k0. v is in [0,1) so that a pixel on the side shared by 2 patches is only in one of them.
+       Where the patch folds over itself, cairo paints the part with the highest v last, it is the one kept.
+     */
+    double hx = x - q.x[0];
+    double hy = y - q.y[0];
+    double k2 = q.gx * q.fy - q.gy * q.fx;
+    double k1 = q.ex * q.fy - q.ey * q.fx + hx * q.gy - hy * q.gx;
+    double k0 = hx * q.ey - hy * q.ex;
+    double roots[2];
+    int nRoots = 0;
+
+    if ( std::abs(k2) <= 1e-9 * std::abs(k1) ) {
+        if (k1 == 0.) {
+            return false;
+        }
+        roots[nRoots++] = -k0 / k1;
+    } else {
+        double disc = k1 * k1 - 4. * k0 * k2;
+        if (disc < 0.) {
+            return false;
+        }
+        disc = std::sqrt(disc);
+        double r0 = (-k1 - disc) / (2. * k2);
+        double r1 = (-k1 + disc) / (2. * k2);
+        roots[nRoots++] = std::max(r0, r1);
+        roots[nRoots++] = std::min(r0, r1);
+    }
+
+    const double eps = 1e-9;
+    for (int i = 0; i < nRoots; ++i) {
+        double v = roots[i];
+        if ( (v < -eps) || (v >= 1. - eps) ) {
+            continue;
+        }
+        double dx = q.ex + q.gx * v;
+        double dy = q.ey + q.gy * v;
+        double u = ( std::abs(dx) >= std::abs(dy) ) ? (hx - q.fx * v) / dx : (hy - q.fy * v) / dy;
+        if ( (u >= -eps) && (u <= 1. + eps) ) {
+            *s = std::max( 0., std::min(1., u) );
+
+            return true;
+        }
+    }
+
+    return false;
+} // RotoRasterizer::getFeatherQuadPosition
+
+void
+RotoRasterizer::rasterizeFeatherQuad(const FeatherQuad& q,
+                                     const std::vector<float>& lut,
+                                     const RectI& tile,
+                                     float* feather)
+{
+    // Like the cairo meshes, the patches are sampled at the pixel centers, without anti-aliasing
+    int width = tile.width();
+    int yStart = std::max( tile.y1, (int)std::floor(q.ymin - 0.5) );
+    int yEnd = std::min( tile.y2, (int)std::ceil(q.ymax + 0.5) );
+
+    for (int y = yStart; y < yEnd; ++y) {
+        double yc = y + 0.5;
+        double xl = 0., xr = 0.;
+        int nIntersections = 0;
+        for (int i = 0; i < 4; ++i) {
+            int j = (i + 1) % 4;
+            double ya = q.y[i], yb = q.y[j];
+            if ( ( (ya <= yc) && (yc < yb) ) || ( (yb <= yc) && (yc < ya) ) ) {
+                double xi = q.x[i] + (yc - ya) * (q.x[j] - q.x[i]) / (yb - ya);
+                if (nIntersections == 0) {
+                    xl = xr = xi;
+                } else {
+                    xl = std::min(xl, xi);
+                    xr = std::max(xr, xi);
+                }
+                ++nIntersections;
+            }
+        }
+        if (nIntersections < 2) {
+            continue;
+        }
+        // The span covers the patch on this row, the pixels of a patch folding over itself being checked one by one
+        int xStart = std::max( tile.x1, (int)std::floor(xl - 0.5) );
+        int xEnd = std::min( tile.x2, (int)std::ceil(xr + 0.5) );
+        float* dst = feather + (std::size_t)(y - tile.y1) * width;
+        for (int x = xStart; x < xEnd; ++x) {
+            double s;
+            if ( !getFeatherQuadPosition(q, x + 0.5, yc, &s) ) {
+                continue;
+            }
+            double lutIndex = s * ROTO_RASTERIZER_FALLOFF_LUT_SIZE;
+            int i = std::min( (int)lutIndex, ROTO_RASTERIZER_FALLOFF_LUT_SIZE - 1 );
+            float f = (float)(lutIndex - i);
+            float alpha = lut[i] + (lut[i + 1] - lut[i]) * f;
+            // The patches of a cairo mesh are painted over each other
+            float& pix = dst[x - tile.x1];
+            pix = alpha + pix * (1.f - alpha);
+        }
+    }
+} // RotoRasterizer::rasterizeFeatherQuad
+
+void
+RotoRasterizer::accumulateTile(const RectI& tile,
+                               std::size_t firstShape,
+                               std::size_t lastShape,
+                               float* sum) const
+{
+    assert(firstShape <= lastShape && lastShape <= _shapes.size());
+    int width = tile.width();
+    int height = tile.height();
+    std::size_t nPixels = (std::size_t)width * height;
+
+    if ( (firstShape == lastShape) || (_bbox.x2 < tile.x1) || (_bbox.x1 > tile.x2) || (_bbox.y2 < tile.y1) || (_bbox.y1 > tile.y2) ) {
+        return;
+    }
+
+    int stride = width + 2;
+    std::vector<float> area( (std::size_t)stride * height );
+    std::vector<float> feather(nPixels);
+
+    for (std::size_t i = firstShape; i < lastShape; ++i) {
+        const Shape& shape = _shapes[i];
+        // A closed polygon entirely on the left of the tile adds as much as it removes on each row
+        if ( (shape.bbox.x2 < tile.x1) || (shape.bbox.x1 > tile.x2) || (shape.bbox.y2 < tile.y1) || (shape.bbox.y1 > tile.y2) ) {
+            continue;
+        }
+
+        std::fill(area.begin(), area.end(), 0.f);
+        for (std::vector<Edge>::const_iterator e = shape.edges.begin(); e != shape.edges.end(); ++e) {
+            if (shape.antialiased) {
+                accumulateEdge(*e, tile, stride, &area[0]);
+            } else {
+                accumulateEdgeAtPixelCenters(*e, tile, stride, &area[0]);
+            }
+        }
+
+        bool hasFeather = false;
+        for (std::vector<FeatherQuad>::const_iterator q = shape.feather.begin(); q != shape.feather.end(); ++q) {
+            if ( (q->xmax < tile.x1 - 0.5) || (q->xmin > tile.x2 + 0.5) || (q->ymax < tile.y1 - 0.5) || (q->ymin > tile.y2 + 0.5) ) {
+                continue;
+            }
+            if (!hasFeather) {
+                std::fill(feather.begin(), feather.end(), 0.f);
+                hasFeather = true;
+            }
+            rasterizeFeatherQuad(*q, shape.fallOffLut, tile, &feather[0]);
+        }
+
+        for (int y = 0; y < height; ++y) {
+            const float* areaRow = &area[(std::size_t)y * stride];
+            const float* featherRow = &feather[(std::size_t)y * width];
+            float* dst = sum + (std::size_t)y * width;
+            float acc = 0.f;
+            for (int x = 0; x < width; ++x) {
+                acc += areaRow[x];
+                // Non-zero winding rule
+                float c = std::min(std::abs(acc), 1.f);
+                if (hasFeather) {
+                    // The cairo mesh is used both as the source and as the mask, hence the square
+                    float f = featherRow[x];
+                    c += (1.f - c) * f * f;
+                }
+                dst[x] += c;
+            }
+        }
+    }
+} // RotoRasterizer::accumulateTile
+
+void
+RotoRasterizer::renderTile(const RectI& tile,
+                           float* coverage) const
+{
+    std::size_t nPixels = (std::size_t)tile.width() * tile.height();
+
+    std::fill(coverage, coverage + nPixels, 0.f);
+    accumulateTile(tile, 0, _shapes.size(), coverage);
+    if (_shapes.size() > 1) {
+        float scale = 1.f / _shapes.size();
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            coverage[i] *= scale;
+        }
+    }
+}
+
+namespace {
+
+struct RotoRasterizerRenderArgs
+{
+    const RotoRasterizer* rasterizer;
+    RectI roi;
+    unsigned char* pixels; // pixel (roi.x1, roi.y1) of the image
+    std::size_t rowElements;
+    int nComps;
+    ImageBitDepthEnum depth;
+    float color[3]; // multiplied by the opacity
+    float opacity;
+    bool inverted;
+};
+
+template <typename PIX, int maxValue>
+PIX
+convertMaskValue(float v)
+{
+    v = std::max( 0.f, std::min(1.f, v) );
+
+    return PIX(v * maxValue + 0.5f);
+}
+
+template <>
+float
+convertMaskValue<float, 1>(float v)
+{
+    return v;
+}
+
+template <typename PIX, int maxValue, int nComps>
+void
+writeTile(const RotoRasterizerRenderArgs& args,
+          const RectI& tile,
+          const float* coverage)
+{
+    int width = tile.width();
+
+    for (int y = tile.y1; y < tile.y2; ++y, coverage += width) {
+        PIX* dstPix = (PIX*)args.pixels + ( (std::size_t)(y - args.roi.y1) * args.rowElements + (std::size_t)(tile.x1 - args.roi.x1) * nComps );
+        for (int x = 0; x < width; ++x, dstPix += nComps) {
+            float v = args.inverted ? 1.f - coverage[x] : coverage[x];
+            switch (nComps) {
+            case 4:
+                dstPix[0] = convertMaskValue<PIX, maxValue>(v * args.color[0]);
+                dstPix[1] = convertMaskValue<PIX, maxValue>(v * args.color[1]);
+                dstPix[2] = convertMaskValue<PIX, maxValue>(v * args.color[2]);
+                dstPix[3] = convertMaskValue<PIX, maxValue>(v * args.opacity);
+                break;
+            case 3:
+                dstPix[0] = convertMaskValue<PIX, maxValue>(v * args.color[0]);
+                dstPix[1] = convertMaskValue<PIX, maxValue>(v * args.color[1]);
+                dstPix[2] = convertMaskValue<PIX, maxValue>(v * args.color[2]);
+                break;
+            case 2:
+                dstPix[0] = convertMaskValue<PIX, maxValue>(v * args.color[0]);
+                dstPix[1] = convertMaskValue<PIX, maxValue>(v * args.color[1]);
+                break;
+            case 1:
+                dstPix[0] = convertMaskValue<PIX, maxValue>(v * args.opacity);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+template <typename PIX, int maxValue>
+void
+writeTileForDepth(const RotoRasterizerRenderArgs& args,
+                  const RectI& tile,
+                  const float* coverage)
+{
+    switch (args.nComps) {
+    case 1:
+        writeTile<PIX, maxValue, 1>(args, tile, coverage);
+        break;
+    case 2:
+        writeTile<PIX, maxValue, 2>(args, tile, coverage);
+        break;
+    case 3:
+        writeTile<PIX, maxValue, 3>(args, tile, coverage);
+        break;
+    case 4:
+        writeTile<PIX, maxValue, 4>(args, tile, coverage);
+        break;
+    default:
+        break;
+    }
+}
+
+void
+writeCoverage(const RotoRasterizerRenderArgs& args,
+              const RectI& tile,
+              const float* coverage)
+{
+    switch (args.depth) {
+    case eImageBitDepthFloat:
+        writeTileForDepth<float, 1>(args, tile, coverage);
+        break;
+    case eImageBitDepthByte:
+        writeTileForDepth<unsigned char, 255>(args, tile, coverage);
+        break;
+    case eImageBitDepthShort:
+        writeTileForDepth<unsigned short, 65535>(args, tile, coverage);
+        break;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+}
+
+void
+renderAndWriteTile(const RotoRasterizerRenderArgs* args,
+                   const RectI& tile)
+{
+    std::vector<float> coverage( (std::size_t)tile.width() * tile.height() );
+
+    args->rasterizer->renderTile(tile, &coverage[0]);
+    writeCoverage(*args, tile, &coverage[0]);
+}
+
+// A tile whose shapes are split in groups, each group being accumulated by a different thread in its own buffer
+struct RotoRasterizerSplitTile
+{
+    RectI tile;
+    std::vector<std::vector<float> > sums; // one per group of shapes
+};
+
+struct RotoRasterizerShapeGroup
+{
+    RotoRasterizerSplitTile* tile;
+    std::size_t group;
+    std::size_t firstShape, lastShape;
+};
+
+void
+accumulateShapeGroup(const RotoRasterizerRenderArgs* args,
+                     const RotoRasterizerShapeGroup& group)
+{
+    const RectI& tile = group.tile->tile;
+    std::vector<float>& sum = group.tile->sums[group.group];
+
+    sum.assign( (std::size_t)tile.width() * tile.height(), 0.f );
+    args->rasterizer->accumulateTile(tile, group.firstShape, group.lastShape, &sum[0]);
+}
+
+void
+reduceAndWriteTile(const RotoRasterizerRenderArgs* args,
+                   RotoRasterizerSplitTile* tile)
+{
+    std::vector<float>& coverage = tile->sums[0];
+    float scale = 1.f / args->rasterizer->getShapesCount();
+
+    for (std::size_t i = 1; i < tile->sums.size(); ++i) {
+        const std::vector<float>& sum = tile->sums[i];
+        for (std::size_t p = 0; p < coverage.size(); ++p) {
+            coverage[p] += sum[p];
+        }
+        // Free the memory as soon as possible, the buffers of all the tiles being allocated at once
+        std::vector<float>().swap(tile->sums[i]);
+    }
+    for (std::size_t p = 0; p < coverage.size(); ++p) {
+        coverage[p] *= scale;
+    }
+    writeCoverage(*args, tile->tile, &coverage[0]);
+}
+
+} // anon namespace
+
+void
+RotoRasterizer::render(const RectI& roi,
+                       const double shapeColor[3],
+                       double opacity,
+                       bool inverted,
+                       Image* image) const
+{
+    assert(image);
+    if ( roi.isNull() ) {
+        return;
+    }
+    assert( image->getBounds().contains(roi) );
+
+    Image::WriteAccess acc = image->getWriteRights();
+    RotoRasterizerRenderArgs args;
+    args.rasterizer = this;
+    args.roi = roi;
+    args.pixels = acc.pixelAt(roi.x1, roi.y1);
+    args.rowElements = image->getRowElements();
+    args.nComps = (int)image->getComponentsCount();
+    args.depth = image->getBitDepth();
+    for (int i = 0; i < 3; ++i) {
+        args.color[i] = (float)(shapeColor[i] * opacity);
+    }
+    args.opacity = (float)opacity;
+    args.inverted = inverted;
+    if (!args.pixels) {
+        return;
+    }
+
+    std::vector<RectI> tiles;
+    for (int y = roi.y1; y < roi.y2; y += NATRON_ROTO_RASTERIZER_TILE_SIZE) {
+        for (int x = roi.x1; x < roi.x2; x += NATRON_ROTO_RASTERIZER_TILE_SIZE) {
+            tiles.push_back( RectI( x, y, std::min(x + NATRON_ROTO_RASTERIZER_TILE_SIZE, roi.x2), std::min(y + NATRON_ROTO_RASTERIZER_TILE_SIZE, roi.y2) ) );
+        }
+    }
+
+    TaskScheduler* scheduler = appPTR ? appPTR->getTaskScheduler() : 0;
+    std::size_t nShapes = _shapes.size();
+    if ( !scheduler || ( (tiles.size() == 1) && (nShapes == 1) ) ) {
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            renderAndWriteTile(&args, tiles[i]);
+        }
+        return;
+    }
+
+    // The workers and the thread waiting on them
+    std::size_t nThreads = scheduler->getMaxThreadCount() + 1;
+    if ( (nShapes == 1) || (tiles.size() >= nThreads) ) {
+        scheduler->blockingMap( tiles, boost::bind(&renderAndWriteTile, &args, _1) );
+    } else {
+        /*
+           There are fewer tiles than threads, which is the case of most masks rendered for the viewer, but several
+           shapes (the motion-blur samples): each tile is split in groups of shapes accumulated concurrently, the
+           sums being reduced once all the groups are done.
+         */
+        std::size_t nGroups = std::min( nShapes, (nThreads + tiles.size() - 1) / tiles.size() );
+        std::vector<RotoRasterizerSplitTile> splitTiles( tiles.size() );
+        std::vector<RotoRasterizerShapeGroup> groups;
+        groups.reserve(tiles.size() * nGroups);
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            splitTiles[i].tile = tiles[i];
+            splitTiles[i].sums.resize(nGroups);
+            for (std::size_t g = 0; g < nGroups; ++g) {
+                RotoRasterizerShapeGroup group;
+                group.tile = &splitTiles[i];
+                group.group = g;
+                group.firstShape = nShapes * g / nGroups;
+                group.lastShape = nShapes * (g + 1) / nGroups;
+                groups.push_back(group);
+            }
+        }
+        scheduler->blockingMap( groups, boost::bind(&accumulateShapeGroup, &args, _1) );
+
+        std::vector<RotoRasterizerSplitTile*> tilesToReduce( splitTiles.size() );
+        for (std::size_t i = 0; i < splitTiles.size(); ++i) {
+            tilesToReduce[i] = &splitTiles[i];
+        }
+        scheduler->blockingMap( tilesToReduce, boost::bind(&reduceAndWriteTile, &args, _1) );
+    }
+} // RotoRasterizer::render
+
+NATRON_NAMESPACE_EXIT
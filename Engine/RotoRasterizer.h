@@ -0,0 +1,181 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Engine_RotoRasterizer_h
+#define Engine_RotoRasterizer_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/RectD.h"
+#include "Engine/RectI.h"
+#include "Engine/EngineFwd.h"
+
+// Size of the tiles a mask is rasterized in. Each tile is rendered by a single thread in a buffer of this size.
+#define NATRON_ROTO_RASTERIZER_TILE_SIZE 256
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A patch of the feather of a Bezier, as built by RotoContextPrivate::computeFeatherQuads(): p[0] and p[3] are
+ * consecutive vertices of the polygon of the shape (opaque), p[1] and p[2] the matching vertices of the feather edge
+ * (transparent). The opacity falls off along the sides p[0]p[1] and p[3]p[2] and is interpolated bilinearly in between,
+ * as in the cairo Coons patches of RotoContextPrivate::renderFeatherQuads_cairo().
+ **/
+struct RotoFeatherQuad
+{
+    Point p[4];
+};
+
+/**
+ * @brief Renders the mask of closed Bezier shapes without cairo.
+ * A shape is made of the polygon of the Bezier, filled with the non-zero winding rule, and of the feather patches
+ * computed by RotoContextPrivate::computeFeatherQuads(), shaded like the cairo mesh patterns of renderFeatherQuads_cairo().
+ * The feather patches and the polygon of a feathered shape are sampled at the pixel centers so that they join
+ * without gaps, the feather smoothing the edges. The polygon of a shape without feather is anti-aliased by computing
+ * the exact area of each pixel that it covers.
+ * The feather of a shape only shows outside of its polygon. The shapes added, one per motion-blur sample, are
+ * averaged so that the mask does not depend on the number of samples.
+ * The mask is computed per tile, the tiles being rendered concurrently on the task scheduler, and converted directly
+ * to the pixel depth and components of the destination image. When there are fewer tiles than threads, the shapes
+ * of a tile are also split among the threads, each accumulating its samples in its own buffer.
+ **/
+class RotoRasterizer
+{
+public:
+
+    RotoRasterizer();
+
+    ~RotoRasterizer();
+
+    /**
+     * @brief Adds a shape to the mask. Coordinates are in pixels of the image to render.
+     * @param polygon A closed polygon: the last vertex is connected to the first.
+     * @param feather The patches going from the polygon to the feather edge, painted in this order.
+     * @param fallOff The feather fall-off of the Bezier: 1 is linear.
+     **/
+    void addShape(const std::vector<Point>& polygon,
+                  const std::vector<RotoFeatherQuad>& feather,
+                  double fallOff);
+
+    bool isEmpty() const
+    {
+        return _shapes.empty();
+    }
+
+    std::size_t getShapesCount() const
+    {
+        return _shapes.size();
+    }
+
+    /**
+     * @brief The bounding box of the pixels that may be non zero in the mask.
+     **/
+    const RectD& getBoundingBox() const
+    {
+        return _bbox;
+    }
+
+    /**
+     * @brief Computes the mask of the given tile into coverage, a buffer of tile.width() * tile.height() floats
+     * in [0,1], rows going upward from tile.y1.
+     * This is thread-safe.
+     **/
+    void renderTile(const RectI& tile, float* coverage) const;
+
+    /**
+     * @brief Adds the masks of the shapes in [firstShape, lastShape) to sum, a buffer of the size of the tile.
+     * renderTile() is the sum of all the shapes divided by their count.
+     * This is thread-safe.
+     **/
+    void accumulateTile(const RectI& tile, std::size_t firstShape, std::size_t lastShape, float* sum) const;
+
+    /**
+     * @brief Renders the mask in the roi of the image, as RotoDrawableItem::renderMaskInternal did with the cairo image:
+     * a single-channel image receives the mask multiplied by the opacity, the color channels the mask multiplied by
+     * the color and the opacity and the alpha channel the mask multiplied by the opacity.
+     * The image must be at least as large as the roi and of depth byte, short or float.
+     * The tiles are rendered concurrently if the roi is large enough.
+     **/
+    void render(const RectI& roi,
+                const double shapeColor[3],
+                double opacity,
+                bool inverted,
+                Image* image) const;
+
+private:
+
+    struct Edge
+    {
+        // Going downward (y0 < y1), the direction is the sign to apply to the area covered
+        double x0, y0, x1, y1;
+        float direction;
+    };
+
+    struct FeatherQuad
+    {
+        double x[4], y[4];
+        double xmin, xmax, ymin, ymax;
+
+        // The patch is p(s,v) = p[0] + s * e + v * f + s * v * g, s going from the polygon to the feather edge
+        double ex, ey, fx, fy, gx, gy;
+    };
+
+    struct Shape
+    {
+        std::vector<Edge> edges;
+        std::vector<FeatherQuad> feather;
+        RectD bbox;
+
+        // False if the polygon is sampled at the pixel centers
+        bool antialiased;
+
+        // Maps the position s in a feather patch, sampled uniformly over [0,1], to the feather opacity
+        std::vector<float> fallOffLut;
+    };
+
+    static void computeFallOffLut(double fallOff, std::vector<float>* lut);
+
+    static void accumulateEdge(const Edge& edge, const RectI& tile, int stride, float* area);
+
+    static void accumulateEdgeAtPixelCenters(const Edge& edge, const RectI& tile, int stride, float* area);
+
+    static void rasterizeEdgeSegment(double x0, double y0, double x1, double y1, float direction, int width, int height, int stride, float* area);
+
+    static bool getFeatherQuadPosition(const FeatherQuad& quad, double x, double y, double* s);
+
+    static void rasterizeFeatherQuad(const FeatherQuad& quad, const std::vector<float>& lut, const RectI& tile, float* feather);
+
+    std::vector<Shape> _shapes;
+    RectD _bbox;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Engine_RotoRasterizer_h
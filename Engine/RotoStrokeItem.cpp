@@ -601,35 +601,36 @@ RotoStrokeItem::getMostRecentStrokeChangesSinceAge(double time,
         *wholeStrokeBbox = computeBoundingBoxInternal(time);
     }
 
-    KeyFrameSet xCurve = stroke->xCurve->getKeyFrames_mt_safe();
-    KeyFrameSet yCurve = stroke->yCurve->getKeyFrames_mt_safe();
-    KeyFrameSet pCurve = stroke->pressureCurve->getKeyFrames_mt_safe();
-
-    if ( xCurve.empty() ) {
+    // Points may be added while painting: only read those that are in all 3 curves
+    int nKeys = std::min( stroke->xCurve->getKeyFramesCount(), std::min( stroke->yCurve->getKeyFramesCount(), stroke->pressureCurve->getKeyFramesCount() ) );
+    if (nKeys == 0) {
         return false;
     }
     if (lastAge == -1) {
         lastAge = 0;
     }
 
-    if (lastAge >= (int) xCurve.size()) {
+    if (lastAge >= nKeys) {
         return false;
     }
 
+    *newAge = nKeys - 1;
+
+    // Only the points added since the last render are read, so that the cost does not grow with the length of the stroke
     KeyFrameSet realX, realY, realP;
-    KeyFrameSet::iterator xIt = xCurve.begin();
-    KeyFrameSet::iterator yIt = yCurve.begin();
-    KeyFrameSet::iterator pIt = pCurve.begin();
-    std::advance(xIt, lastAge);
-    std::advance(yIt, lastAge);
-    std::advance(pIt, lastAge);
-    *newAge = (int)xCurve.size() - 1;
-
-    if ( lastAge != (int)(xCurve.size() - 1) ) {
-        for (; xIt != xCurve.end(); ++xIt, ++yIt, ++pIt) {
-            realX.insert(*xIt);
-            realY.insert(*yIt);
-            realP.insert(*pIt);
+    if ( lastAge != (nKeys - 1) ) {
+        realX = stroke->xCurve->getKeyFramesFromIndex_mt_safe(lastAge);
+        realY = stroke->yCurve->getKeyFramesFromIndex_mt_safe(lastAge);
+        realP = stroke->pressureCurve->getKeyFramesFromIndex_mt_safe(lastAge);
+        std::size_t nNewKeys = (std::size_t)(nKeys - lastAge);
+        while (realX.size() > nNewKeys) {
+            realX.erase( --realX.end() );
+        }
+        while (realY.size() > nNewKeys) {
+            realY.erase( --realY.end() );
+        }
+        while (realP.size() > nNewKeys) {
+            realP.erase( --realP.end() );
         }
     }
 
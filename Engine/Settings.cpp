@@ -43,6 +43,7 @@
 
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
+#include "Engine/BufferPool.h"
 #include "Engine/KnobFactory.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
@@ -54,6 +55,7 @@
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
 #include "Engine/StandardPaths.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/Utils.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerInstance.h"
@@ -1052,12 +1054,17 @@ Settings::initializeKnobsViewers()
                                         tr("Post-processing done by the viewer (such as colorspace conversion) is done "
                                            "by the CPU. The size of cached textures is thus smaller.").toStdString() ));
 
-    //textureModes.push_back("16bits half-float");
-    //helpStringsTextureModes.push_back("Not available yet. Similar to 32bits fp.");
     textureModes.push_back(ChoiceOption("32f",
                                         tr("32-bit floating-point").toStdString(),
                                         tr("Post-processing done by the viewer (such as colorspace conversion) is done "
                                            "by the GPU, using GLSL. The size of cached textures is thus larger.").toStdString()));
+    // Appended after "32f" so that the index of existing options saved in the settings does not change
+    textureModes.push_back(ChoiceOption("16f",
+                                        tr("16-bit half-float").toStdString(),
+                                        tr("Same as 32-bit floating-point: the cached textures hold the linear image and "
+                                           "the gain, gamma and colorspace conversion are applied by the GPU, so changing "
+                                           "them does not re-render cached frames. The size of cached textures is half the "
+                                           "size of 32-bit textures, at the cost of a lower precision.").toStdString()));
     _texturesMode->populateChoices(textureModes);
 
 
@@ -1274,6 +1281,41 @@ Settings::initializeKnobsCaching()
     _maxDiskCacheNodeGB->setHintToolTip( tr("The maximum size that may be used by the DiskCache node on disk (in GiB)") );
     _cachingTab->addKnob(_maxDiskCacheNodeGB);
 
+    _cacheShards = AppManager::createKnob<KnobInt>( this, tr("Number of cache shards (0=\"guess\")") );
+    _cacheShards->setName("cacheShards");
+    _cacheShards->disableSlider();
+    _cacheShards->setMinimum(0);
+    _cacheShards->setMaximum(NATRON_CACHE_MAX_SHARDS);
+    _cacheShards->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                     "The image caches are split into this many partitions, each with its own lock, "
+                                     "so that parallel renders looking up the cache do not wait on each other. "
+                                     "A value of 1 uses a single lock for the whole cache. "
+                                     "When set to 0, the number of partitions is chosen from the number of cores of the computer.") );
+    _cachingTab->addKnob(_cacheShards);
+
+    _contentBasedNodeHash = AppManager::createKnob<KnobBool>( this, tr("Content-based node hash") );
+    _contentBasedNodeHash->setName("contentBasedNodeHash");
+    _contentBasedNodeHash->setHintToolTip( tr("When checked, the hash identifying the images rendered by a node is computed from "
+                                              "the actual content of its parameters (values, animation curves, expressions and links), "
+                                              "its plug-in ID and version and the hash of its inputs. "
+                                              "Identical graphs then share the same cache entries, even after undo/redo, "
+                                              "renaming a node or re-opening the project in another session.\n"
+                                              "When unchecked, the hash also depends on the modification count of the parameters, "
+                                              "the node name and the project creation time, so that cached images are never shared across sessions.\n"
+                                              "Nodes with Roto or RotoPaint shapes always use the latter.") );
+    _cachingTab->addKnob(_contentBasedNodeHash);
+
+    _imageBuffersHugePages = AppManager::createKnob<KnobBool>( this, tr("Use huge pages for images") );
+    _imageBuffersHugePages->setName("imageBuffersHugePages");
+    _imageBuffersHugePages->setHintToolTip( tr("When checked, the memory of large images is requested from the system "
+                                               "as transparent huge pages, which lowers the cost of accessing it "
+                                               "but may increase the memory used by small images. "
+                                               "This is only available on Linux, when transparent huge pages are enabled in the system.") );
+    if ( !BufferPool::isHugePagesSupported() ) {
+        _imageBuffersHugePages->setSecret(true);
+    }
+    _cachingTab->addKnob(_imageBuffersHugePages);
+
 
     _diskCachePath = AppManager::createKnob<KnobPath>( this, tr("Disk cache path") );
     _diskCachePath->setName("diskCachePath");
@@ -1514,6 +1556,9 @@ Settings::setDefaultValues()
     _unreachableRAMPercent->setDefaultValue(5);
     _maxViewerDiskCacheGB->setDefaultValue(5, 0);
     _maxDiskCacheNodeGB->setDefaultValue(10, 0);
+    _cacheShards->setDefaultValue(0, 0);
+    _contentBasedNodeHash->setDefaultValue(false);
+    _imageBuffersHugePages->setDefaultValue(false);
     //_diskCachePath
     setCachingLabels();
 
@@ -2135,6 +2180,7 @@ Settings::restoreSettings(bool useDefault)
         appPTR->setNThreadsToRender( getNumberOfThreads() );
         appPTR->setUseThreadPool( _useThreadPool->getValue() );
         appPTR->setPluginsUseInputImageCopyToRender( _pluginUseImageCopyForSource->getValue() );
+        BufferPool::setHugePagesEnabled( _imageBuffersHugePages->getValue() );
     } catch (std::logic_error&) {
         // ignore
     }
@@ -2266,6 +2312,8 @@ Settings::onKnobValueChanged(KnobI* k,
             appPTR->setApplicationsCachesMaximumMemoryPercent( getRamMaximumPercent() );
         }
         setCachingLabels();
+    } else if ( k == _imageBuffersHugePages.get() ) {
+        BufferPool::setHugePagesEnabled( _imageBuffersHugePages->getValue() );
     } else if ( k == _diskCachePath.get() ) {
         QString path = QString::fromUtf8(_diskCachePath->getValue().c_str());
         qputenv(NATRON_DISK_CACHE_PATH_ENV_VAR, path.toUtf8());
@@ -2275,13 +2323,25 @@ Settings::onKnobValueChanged(KnobI* k,
     } else if ( k == _numberOfThreads.get() ) {
         int nbThreads = getNumberOfThreads();
         appPTR->setNThreadsToRender(nbThreads);
+        // The task scheduler runs the parallel loops of the renders: with -1 its workers are parked
+        // and every loop runs on the thread that spawned it.
+        TaskScheduler* scheduler = appPTR->getTaskScheduler();
         if (nbThreads == -1) {
             QThreadPool::globalInstance()->setMaxThreadCount(1);
+            if (scheduler) {
+                scheduler->setMaxThreadCount(0);
+            }
             appPTR->abortAnyProcessing();
         } else if (nbThreads == 0) {
             QThreadPool::globalInstance()->setMaxThreadCount( QThread::idealThreadCount() );
+            if (scheduler) {
+                scheduler->setMaxThreadCount( QThread::idealThreadCount() );
+            }
         } else {
             QThreadPool::globalInstance()->setMaxThreadCount(nbThreads);
+            if (scheduler) {
+                scheduler->setMaxThreadCount(nbThreads);
+            }
         }
     } else if ( k == _nThreadsPerEffect.get() ) {
         appPTR->setNThreadsPerEffect( getNumberOfThreadsPerEffect() );
@@ -2410,6 +2470,8 @@ Settings::getViewersBitDepth() const
         return eImageBitDepthByte;
     } else if (v == 1) {
         return eImageBitDepthFloat;
+    } else if (v == 2) {
+        return eImageBitDepthHalf;
     } else {
         return eImageBitDepthByte;
     }
@@ -2508,6 +2570,18 @@ Settings::getMaximumDiskCacheNodeSize() const
     return (U64)( _maxDiskCacheNodeGB->getValue() ) * 1024 * 1024 * 1024;
 }
 
+int
+Settings::getNumberOfCacheShards() const
+{
+    return _cacheShards->getValue();
+}
+
+bool
+Settings::isContentBasedNodeHashEnabled() const
+{
+    return _contentBasedNodeHash->getValue();
+}
+
 ///////////////////////////////////////////////////
 
 double
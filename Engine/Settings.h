@@ -111,6 +111,10 @@ public:
 
     U64 getMaximumDiskCacheNodeSize() const;
 
+    int getNumberOfCacheShards() const;
+
+    bool isContentBasedNodeHashEnabled() const;
+
     double getUnreachableRamPercent() const;
 
     bool getColorPickerLinear() const;
@@ -519,6 +523,9 @@ private:
     ///The total disk space allowed for all Natron's caches
     KnobIntPtr _maxViewerDiskCacheGB;
     KnobIntPtr _maxDiskCacheNodeGB;
+    KnobIntPtr _cacheShards;
+    KnobBoolPtr _contentBasedNodeHash;
+    KnobBoolPtr _imageBuffersHugePages;
     KnobPathPtr _diskCachePath;
     KnobButtonPtr _wipeDiskCache;
 
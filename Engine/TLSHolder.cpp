@@ -28,25 +28,191 @@
 
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
 #include "Engine/OfxClipInstance.h"
 #include "Engine/OfxHost.h"
 #include "Engine/OfxParamInstance.h"
 #include "Engine/Project.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/ThreadStorage.h"
 
 #include <QtCore/QWaitCondition>
 #include <QtCore/QThread>
 #include <QtCore/QDebug>
 
+#if defined(_MSC_VER)
+#define NATRON_TLS_POINTER __declspec(thread)
+#else
+#define NATRON_TLS_POINTER __thread
+#endif
+
 NATRON_NAMESPACE_ENTER
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct ThreadCacheSlot
+{
+    U64 holderSerial; // 0 if the slot is not used
+    unsigned int generation;
+    bool hasValue;
+    boost::weak_ptr<void> value; // the map of the holder owns the value
+
+    ThreadCacheSlot()
+        : holderSerial(0)
+        , generation(0)
+        , hasValue(false)
+        , value()
+    {
+    }
+};
+
+struct ThreadCache;
+
+// The cache of the current thread: a native TLS lookup is much cheaper than QThreadStorage::localData()
+NATRON_TLS_POINTER ThreadCache* currentThreadCache = 0;
+
+struct ThreadCache
+{
+    std::vector<ThreadCacheSlot> slots;
+    bool spawnsChecked;
+    unsigned int checkedSpawnsGeneration;
+
+    ThreadCache()
+        : slots()
+        , spawnsChecked(false)
+        , checkedSpawnsGeneration(0)
+    {
+    }
+
+    ~ThreadCache()
+    {
+        if (currentThreadCache == this) {
+            currentThreadCache = 0;
+        }
+    }
+};
+
+// Owns the cache of each thread and deletes it when the thread exits
+ThreadStorage<ThreadCache*> threadCacheStorage;
+
+ThreadCache*
+getThreadCache()
+{
+    ThreadCache* cache = currentThreadCache;
+
+    if (!cache) {
+        cache = new ThreadCache;
+        threadCacheStorage.setLocalData(cache);
+        currentThreadCache = cache;
+    }
+
+    return cache;
+}
+
+boost::atomic<U64> nextHolderSerial(1);
+QMutex slotIndicesMutex;
+std::vector<std::size_t> freeSlotIndices;
+std::size_t nSlotIndices = 0;
+
+std::size_t
+allocateSlotIndex()
+{
+    QMutexLocker k(&slotIndicesMutex);
+
+    if ( !freeSlotIndices.empty() ) {
+        std::size_t index = freeSlotIndices.back();
+        freeSlotIndices.pop_back();
+
+        return index;
+    }
+
+    return nSlotIndices++;
+}
+
+void
+releaseSlotIndex(std::size_t index)
+{
+    QMutexLocker k(&slotIndicesMutex);
+
+    freeSlotIndices.push_back(index);
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+TLSHolderBase::TLSHolderBase()
+    : _serial( nextHolderSerial.fetch_add(1, boost::memory_order_relaxed) )
+    , _slotIndex( allocateSlotIndex() )
+    , _cacheGeneration(0)
+{
+}
+
+TLSHolderBase::~TLSHolderBase()
+{
+    // Slots of the thread caches still referring to this holder do not match the serial of the next holder using the index
+    releaseSlotIndex(_slotIndex);
+}
+
+bool
+TLSHolderBase::getCachedTLS(boost::shared_ptr<void>* value) const
+{
+    ThreadCache* cache = currentThreadCache;
+
+    if ( !cache || ( _slotIndex >= cache->slots.size() ) ) {
+        return false;
+    }
+    const ThreadCacheSlot& slot = cache->slots[_slotIndex];
+    if ( (slot.holderSerial != _serial) || ( slot.generation != getCachedTLSGeneration() ) ) {
+        return false;
+    }
+    if (!slot.hasValue) {
+        value->reset();
+
+        return true;
+    }
+    *value = slot.value.lock();
+
+    return (bool)*value;
+}
+
+void
+TLSHolderBase::setCachedTLS(const boost::shared_ptr<void>& value,
+                            unsigned int generation) const
+{
+    ThreadCache* cache = getThreadCache();
+
+    if ( _slotIndex >= cache->slots.size() ) {
+        cache->slots.resize(_slotIndex + 1);
+    }
+    ThreadCacheSlot& slot = cache->slots[_slotIndex];
+    slot.holderSerial = _serial;
+    slot.generation = generation;
+    slot.hasValue = (bool)value;
+    slot.value = value;
+}
+
+void
+TLSHolderBase::invalidateCachedTLS(const QThread* thread) const
+{
+    if ( thread != QThread::currentThread() ) {
+        // We cannot access the cache of another thread: invalidate the caches of all threads
+        _cacheGeneration.fetch_add(1, boost::memory_order_acq_rel);
+
+        return;
+    }
+    ThreadCache* cache = currentThreadCache;
+    if ( cache && ( _slotIndex < cache->slots.size() ) && (cache->slots[_slotIndex].holderSerial == _serial) ) {
+        cache->slots[_slotIndex] = ThreadCacheSlot();
+    }
+}
 
 AppTLS::AppTLS()
     : _objectMutex()
     , _object( new GLobalTLSObject() )
     , _spawnsMutex()
     , _spawns()
+    , _spawnsGeneration(0)
 {
 }
 
@@ -115,6 +281,25 @@ AppTLS::softCopy(QThread* fromThread,
 
     QWriteLocker k(&_spawnsMutex);
     _spawns[toThread] = fromThread;
+    _spawnsGeneration.fetch_add(1, boost::memory_order_acq_rel);
+}
+
+bool
+AppTLS::mayBeSpawnedThread(unsigned int* generation) const
+{
+    *generation = _spawnsGeneration.load(boost::memory_order_acquire);
+    ThreadCache* cache = currentThreadCache;
+
+    return !cache || !cache->spawnsChecked || (cache->checkedSpawnsGeneration != *generation);
+}
+
+void
+AppTLS::setSpawnedThreadChecked(unsigned int generation) const
+{
+    ThreadCache* cache = getThreadCache();
+
+    cache->spawnsChecked = true;
+    cache->checkedSpawnsGeneration = generation;
 }
 
 void
@@ -40,6 +40,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/atomic.hpp>
 #endif
 
 #include <QtCore/QReadWriteLock>
@@ -59,13 +60,38 @@ public:
     // TODO: enable_shared_from_this
     // constructors should be privatized in any class that derives from boost::enable_shared_from_this<>
 
-    TLSHolderBase() {}
+    TLSHolderBase();
 
 public:
-    virtual ~TLSHolderBase() {}
+    virtual ~TLSHolderBase();
 
 protected:
 
+    /**
+     * @brief Each thread caches the TLS value of the holders it uses in a native thread-local table, indexed by
+     * the holder slot, so that getTLSData() does not have to lock the per-thread map.
+     * The map remains the reference: a cached value is discarded when the map is modified for the thread by
+     * another thread (see invalidateCachedTLS()).
+     * The generation must be read before looking up the map, and passed to setCachedTLS().
+     **/
+    unsigned int getCachedTLSGeneration() const
+    {
+        return _cacheGeneration.load(boost::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns true if the current thread has a valid cached value for this holder, which may be NULL
+     * if the holder does not have TLS for this thread.
+     **/
+    bool getCachedTLS(boost::shared_ptr<void>* value) const;
+
+    void setCachedTLS(const boost::shared_ptr<void>& value, unsigned int generation) const;
+
+    /**
+     * @brief Must be called after the map was modified for the given thread.
+     **/
+    void invalidateCachedTLS(const QThread* thread) const;
+
     /**
      * @brief Returns true if cleanupPerThreadData would do anything OR would return true.
      * It does not return the same value as cleanupPerThreadData, since cleanupPerThreadData
@@ -84,6 +110,17 @@ protected:
      * @brief Copy all the TLS from fromThread to toThread
      **/
     virtual void copyTLS(const QThread* fromThread, const QThread* toThread) const = 0;
+
+private:
+
+    // Unique for the lifetime of the application, identifies the holder owning a slot in the thread caches
+    const U64 _serial;
+
+    // Index in the thread caches, recycled when the holder is destroyed
+    const std::size_t _slotIndex;
+
+    // Incremented whenever a thread modifies the map of another thread
+    mutable boost::atomic<unsigned int> _cacheGeneration;
 };
 
 
@@ -152,6 +189,15 @@ public:
 
 private:
 
+    /**
+     * @brief Returns false if the current thread already checked that it was not registered with softCopy()
+     * since the last call to softCopy(), without taking any lock. Otherwise, generation is set to the value
+     * to pass to setSpawnedThreadChecked() if the thread is not a spawned thread.
+     **/
+    bool mayBeSpawnedThread(unsigned int* generation) const;
+
+    void setSpawnedThreadChecked(unsigned int generation) const;
+
     template <typename T>
     boost::shared_ptr<T> copyTLSFromSpawnerThreadInternal(const TLSHolderBase* holder,
                                                           const QThread* curThread,
@@ -166,6 +212,9 @@ private:
     //of creating a new object and no longer mark it as spawned
     mutable QReadWriteLock _spawnsMutex;
     ThreadSpawnMap _spawns;
+
+    // Incremented after each softCopy() call
+    boost::atomic<unsigned int> _spawnsGeneration;
 };
 
 
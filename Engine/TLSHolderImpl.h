@@ -62,6 +62,7 @@ TLSHolder<EffectInstance::EffectTLSData>::copyAndReturnNewTLS(const QThread* fro
     //Copy constructor
     data.value = boost::make_shared<EffectInstance::EffectTLSData>( *(found->second.value) );
     perThreadData[toThread] = data;
+    invalidateCachedTLS(toThread);
 
     return data.value;
 }
@@ -122,6 +123,7 @@ TLSHolder<T>::cleanupPerThreadData(const QThread* curThread) const
     typename ThreadDataMap::iterator found = perThreadData.find(curThread);
     if ( found != perThreadData.end() ) {
         perThreadData.erase(found);
+        invalidateCachedTLS(curThread);
     }
 
     return perThreadData.empty();
@@ -140,8 +142,14 @@ TLSHolder<T>::getTLSData() const
         return ret;
     }
 
+    //Fast path: the value was already looked up on this thread and the map did not change for this thread since
+    boost::shared_ptr<void> cached;
+    if ( getCachedTLS(&cached) ) {
+        return boost::static_pointer_cast<T>(cached);
+    }
 
     //Attempt to find an object in the map. It will be there if we already called getOrCreateTLSData() for this thread
+    unsigned int generation = getCachedTLSGeneration();
     {
         QReadLocker k(&perThreadDataMutex);
         const ThreadDataMap& perThreadDataCRef = perThreadData; // take a const ref, since it's a read lock
@@ -150,6 +158,7 @@ TLSHolder<T>::getTLSData() const
             ret = found->second.value;
         }
     }
+    setCachedTLS(ret, generation);
 
     return ret;
 }
@@ -167,18 +176,29 @@ TLSHolder<T>::getOrCreateTLSData() const
         return ret;
     }
 
+    //Fast path: the value was already looked up on this thread and the map did not change for this thread since
+    boost::shared_ptr<void> cached;
+    if ( getCachedTLS(&cached) && cached ) {
+        return boost::static_pointer_cast<T>(cached);
+    }
+
     //Attempt to find an object in the map. It will be there if we already called getOrCreateTLSData() for this thread
     //Note that if present, this call is extremely fast as we do not block other threads
+    unsigned int generation = getCachedTLSGeneration();
     {
         QReadLocker k(&perThreadDataMutex);
         const ThreadDataMap& perThreadDataCRef = perThreadData; // take a const ref, since it's a read lock
         typename ThreadDataMap::const_iterator found = perThreadDataCRef.find(curThread);
         if ( found != perThreadDataCRef.end() ) {
             assert(found->second.value);
-
-            return found->second.value;
+            ret = found->second.value;
         }
     }
+    if (ret) {
+        setCachedTLS(ret, generation);
+
+        return ret;
+    }
 
     //getOrCreateTLSData() has never been called on the thread, lookup the TLS
     ThreadData data;
@@ -189,6 +209,7 @@ TLSHolder<T>::getOrCreateTLSData() const
         QWriteLocker k(&perThreadDataMutex);
         perThreadData.insert( std::make_pair(curThread, data) );
     }
+    setCachedTLS(data.value, generation);
     assert(data.value);
 
     return data.value;
@@ -206,6 +227,12 @@ AppTLS::copyTLSFromSpawnerThread(const TLSHolderBase* holder,
     // Either way: return a new object
 
 
+    // exit early without locking if this thread was already checked since the last softCopy()
+    unsigned int spawnsGeneration;
+    if ( !mayBeSpawnedThread(&spawnsGeneration) ) {
+        return boost::shared_ptr<T>();
+    }
+
     // first pass with a read lock to exit early without taking the write lock
     {
         QReadLocker k(&_spawnsMutex);
@@ -213,6 +240,8 @@ AppTLS::copyTLSFromSpawnerThread(const TLSHolderBase* holder,
         ThreadSpawnMap::const_iterator foundSpawned = spawnsCRef.find(curThread);
         if ( foundSpawned == spawnsCRef.end() ) {
             //This is not a spawned thread and it did not have TLS already
+            setSpawnedThreadChecked(spawnsGeneration);
+
             return boost::shared_ptr<T>();
         }
     }
@@ -27,6 +27,11 @@
 
 #include <stdexcept>
 
+// GL_ARB_half_float_pixel is not part of the generated loader, but it is available with GL_ARB_texture_float
+#ifndef GL_HALF_FLOAT_ARB
+#define GL_HALF_FLOAT_ARB 0x140B
+#endif
+
 NATRON_NAMESPACE_ENTER
 
 Texture::Texture(U32 target,
@@ -68,6 +73,14 @@ Texture::getRecommendedTexParametersForRGBAFloatTexture(int* format, int* intern
     *glType = GL_FLOAT;
 }
 
+void
+Texture::getRecommendedTexParametersForRGBAHalfTexture(int* format, int* internalFormat, int* glType)
+{
+    *format = GL_RGBA;
+    *internalFormat = GL_RGBA16F_ARB;
+    *glType = GL_HALF_FLOAT_ARB;
+}
+
 bool
 Texture::ensureTextureHasSize(const TextureRect& texRect,
                               const unsigned char* originalRAMBuffer)
@@ -60,6 +60,7 @@ public:
             int glType);
     static void getRecommendedTexParametersForRGBAByteTexture(int* format, int* internalFormat, int* glType);
     static void getRecommendedTexParametersForRGBAFloatTexture(int* format, int* internalFormat, int* glType);
+    static void getRecommendedTexParametersForRGBAHalfTexture(int* format, int* internalFormat, int* glType);
 
     U32 getTexID() const
     {
@@ -100,8 +101,7 @@ public:
             return sizeof(float);
         case eDataTypeHalf:
 
-            // Fixme when we support half
-            return sizeof(float);
+            return sizeof(unsigned short);
         case eDataTypeNone:
         default:
 
@@ -27,11 +27,19 @@
 
 #include <string>
 #include <sstream> // stringstream
+#include <deque>
+#include <stdexcept>
+#include <algorithm> // find
+
+#include <boost/atomic.hpp>
 
 #include <QtCore/QAtomicInt>
+#include <QtCore/QDebug>
 #include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
 #include <QtCore/QThread>
 #include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
 
 #include "Engine/AbortableRenderInfo.h"
 #include "Engine/Node.h"
@@ -221,5 +229,323 @@ ThreadPool::createThreadPoolThread() const
 
 #endif // ifdef QT_CUSTOM_THREADPOOL
 
+typedef boost::function<void()> TaskFunction;
+
+class TaskSchedulerThread;
+
+struct TaskGroupPrivate
+{
+    TaskSchedulerPrivate* scheduler;
+    QMutex mutex;
+    // Signaled when a task is queued or when the last task is done, only the owner thread waits on it
+    QWaitCondition cond;
+    // The owner pops at the back, the workers steal at the front
+    std::deque<TaskFunction> tasks;
+    // Tasks queued or running
+    int nPending;
+    bool failed;
+    std::string error;
+
+    TaskGroupPrivate(TaskSchedulerPrivate* scheduler)
+        : scheduler(scheduler)
+        , mutex()
+        , cond()
+        , tasks()
+        , nPending(0)
+        , failed(false)
+        , error()
+    {
+    }
+};
+
+struct TaskSchedulerPrivate
+{
+    // Groups that may have tasks to steal: read-locked by the thieves
+    QReadWriteLock groupsLock;
+    std::vector<TaskGroupPrivate*> groups;
+    boost::atomic<unsigned int> stealCursor;
+
+    // Number of tasks in the queues of all groups, the workers sleep when it is 0
+    boost::atomic<int> nQueued;
+    boost::atomic<int> nSleeping;
+    QMutex sleepMutex;
+    QWaitCondition workAvailable;
+    // Workers beyond maxThreadCount wait on this one
+    QWaitCondition parked;
+    boost::atomic<int> maxThreadCount;
+    bool quit; // protected by sleepMutex
+
+    QMutex threadsMutex;
+    std::vector<TaskSchedulerThread*> threads;
+
+    TaskSchedulerPrivate()
+        : groupsLock()
+        , groups()
+        , stealCursor(0)
+        , nQueued(0)
+        , nSleeping(0)
+        , sleepMutex()
+        , workAvailable()
+        , parked()
+        , maxThreadCount(0)
+        , quit(false)
+        , threadsMutex()
+        , threads()
+    {
+    }
+
+    void registerGroup(TaskGroupPrivate* group)
+    {
+        QWriteLocker k(&groupsLock);
+
+        groups.push_back(group);
+    }
+
+    void unregisterGroup(TaskGroupPrivate* group)
+    {
+        QWriteLocker k(&groupsLock);
+        std::vector<TaskGroupPrivate*>::iterator found = std::find(groups.begin(), groups.end(), group);
+
+        assert( found != groups.end() );
+        if ( found != groups.end() ) {
+            groups.erase(found);
+        }
+    }
+
+    void notifyTaskQueued()
+    {
+        ++nQueued;
+        if (nSleeping > 0) {
+            QMutexLocker k(&sleepMutex);
+            workAvailable.wakeOne();
+        }
+    }
+
+    bool stealTask(TaskFunction* task, TaskGroupPrivate** group);
+
+    static void runTask(TaskGroupPrivate* group, const TaskFunction& task);
+};
+
+bool
+TaskSchedulerPrivate::stealTask(TaskFunction* task,
+                                TaskGroupPrivate** group)
+{
+    QReadLocker k(&groupsLock);
+    std::size_t nGroups = groups.size();
+
+    if (nGroups == 0) {
+        return false;
+    }
+    // Start from a different group each time so that concurrent renders get their share of the workers
+    std::size_t start = stealCursor++ % nGroups;
+    for (std::size_t i = 0; i < nGroups; ++i) {
+        TaskGroupPrivate* g = groups[(start + i) % nGroups];
+        QMutexLocker gl(&g->mutex);
+        if ( !g->tasks.empty() ) {
+            *task = g->tasks.front();
+            g->tasks.pop_front();
+            --nQueued;
+            *group = g;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+TaskSchedulerPrivate::runTask(TaskGroupPrivate* group,
+                              const TaskFunction& task)
+{
+    std::string error;
+    bool failed = false;
+
+    try {
+        task();
+    } catch (const std::exception& e) {
+        failed = true;
+        error = e.what();
+    } catch (...) {
+        failed = true;
+        error = "Unknown exception in task";
+    }
+
+    QMutexLocker k(&group->mutex);
+    if ( failed && !group->failed ) {
+        group->failed = true;
+        group->error = error;
+    }
+    --group->nPending;
+    assert(group->nPending >= 0);
+    if (group->nPending == 0) {
+        // The owner may destroy the group as soon as the mutex is released
+        group->cond.wakeAll();
+    }
+}
+
+class TaskSchedulerThread
+    : public QThread
+      , public AbortableThread
+{
+public:
+
+    TaskSchedulerThread(TaskSchedulerPrivate* scheduler,
+                        int index)
+        : QThread()
+        , AbortableThread(this)
+        , _scheduler(scheduler)
+        , _index(index)
+    {
+        setThreadName("Task Scheduler Thread");
+    }
+
+    virtual bool isThreadPoolThread() const OVERRIDE FINAL { return true; }
+
+    virtual ~TaskSchedulerThread() {}
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (;;) {
+            if ( _index < _scheduler->maxThreadCount ) {
+                TaskFunction task;
+                TaskGroupPrivate* group = 0;
+                if ( _scheduler->stealTask(&task, &group) ) {
+                    TaskSchedulerPrivate::runTask(group, task);
+                    continue;
+                }
+            }
+
+            QMutexLocker k(&_scheduler->sleepMutex);
+            if (_scheduler->quit) {
+                return;
+            }
+            if ( _index >= _scheduler->maxThreadCount ) {
+                _scheduler->parked.wait(&_scheduler->sleepMutex);
+            } else {
+                // notifyTaskQueued() increments nQueued before reading nSleeping: one of the two sees the other
+                ++_scheduler->nSleeping;
+                if (_scheduler->nQueued <= 0) {
+                    _scheduler->workAvailable.wait(&_scheduler->sleepMutex);
+                }
+                --_scheduler->nSleeping;
+            }
+        }
+    }
+
+    TaskSchedulerPrivate* _scheduler;
+    int _index;
+};
+
+TaskScheduler::TaskScheduler(int maxThreadCount)
+    : _imp( new TaskSchedulerPrivate() )
+{
+    setMaxThreadCount(maxThreadCount);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        QMutexLocker k(&_imp->sleepMutex);
+        _imp->quit = true;
+        _imp->workAvailable.wakeAll();
+        _imp->parked.wakeAll();
+    }
+    QMutexLocker k(&_imp->threadsMutex);
+    for (std::size_t i = 0; i < _imp->threads.size(); ++i) {
+        _imp->threads[i]->wait();
+        delete _imp->threads[i];
+    }
+    _imp->threads.clear();
+    assert( _imp->groups.empty() );
+}
+
+void
+TaskScheduler::setMaxThreadCount(int maxThreadCount)
+{
+    if (maxThreadCount < 0) {
+        maxThreadCount = QThread::idealThreadCount();
+    }
+
+    QMutexLocker k(&_imp->threadsMutex);
+    // Workers are never destroyed before the scheduler, those beyond the maximum are parked
+    while ( (int)_imp->threads.size() < maxThreadCount ) {
+        TaskSchedulerThread* thread = new TaskSchedulerThread( _imp.get(), (int)_imp->threads.size() );
+        _imp->threads.push_back(thread);
+        thread->start();
+    }
+    {
+        QMutexLocker l(&_imp->sleepMutex);
+        _imp->maxThreadCount = maxThreadCount;
+        _imp->parked.wakeAll();
+    }
+}
+
+int
+TaskScheduler::getMaxThreadCount() const
+{
+    return _imp->maxThreadCount;
+}
+
+TaskGroup::TaskGroup(TaskScheduler* scheduler)
+    : _imp( new TaskGroupPrivate( scheduler->_imp.get() ) )
+{
+    _imp->scheduler->registerGroup( _imp.get() );
+}
+
+TaskGroup::~TaskGroup()
+{
+    try {
+        wait();
+    } catch (const std::exception& e) {
+        qDebug() << "TaskGroup:" << e.what();
+    }
+    _imp->scheduler->unregisterGroup( _imp.get() );
+}
+
+void
+TaskGroup::run(const boost::function<void()>& task)
+{
+    {
+        QMutexLocker k(&_imp->mutex);
+        _imp->tasks.push_back(task);
+        ++_imp->nPending;
+        _imp->cond.wakeAll();
+    }
+    _imp->scheduler->notifyTaskQueued();
+}
+
+void
+TaskGroup::wait()
+{
+    for (;;) {
+        TaskFunction task;
+        {
+            QMutexLocker k(&_imp->mutex);
+            // Tasks stolen by the workers may still be running, or may queue other tasks
+            while ( _imp->tasks.empty() && (_imp->nPending > 0) ) {
+                _imp->cond.wait(&_imp->mutex);
+            }
+            if ( _imp->tasks.empty() ) {
+                break;
+            }
+            task = _imp->tasks.back();
+            _imp->tasks.pop_back();
+        }
+        --_imp->scheduler->nQueued;
+        TaskSchedulerPrivate::runTask(_imp.get(), task);
+    }
+
+    QMutexLocker k(&_imp->mutex);
+    if (_imp->failed) {
+        _imp->failed = false;
+        std::string error = _imp->error;
+        _imp->error.clear();
+        throw std::runtime_error(error);
+    }
+}
+
 NATRON_NAMESPACE_EXIT
 
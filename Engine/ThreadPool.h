@@ -28,8 +28,14 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_same.hpp>
 #endif
 
 #include <QtCore/QThreadPool> // defines QT_CUSTOM_THREADPOOL (or not)
@@ -135,6 +141,140 @@ private:
 
 #endif // QT_CUSTOM_THREADPOOL
 
+/**
+ * @brief A work-stealing task scheduler, used for the parallel loops of the renders (host frame threading,
+ * the OpenFX multi-thread suite, the viewer textures and the tracker).
+ *
+ * Tasks are queued in a TaskGroup. The thread waiting on a group executes the tasks of that group itself,
+ * last queued first, while idle workers steal the oldest tasks of any group. A task may itself create a group
+ * and wait on it: the waiting thread keeps working on its own group instead of blocking on a future,
+ * so nested parallel loops can use all the workers without deadlocking or exhausting the pool.
+ *
+ * While waiting, a thread only executes the tasks of the group it waits on: tasks of other renders would
+ * otherwise run on top of the thread-local storage of the render in progress on this thread.
+ **/
+struct TaskGroupPrivate;
+struct TaskSchedulerPrivate;
+class TaskScheduler
+{
+    friend class TaskGroup;
+
+public:
+
+    /**
+     * @brief Starts maxThreadCount workers, or QThread::idealThreadCount() if negative.
+     **/
+    explicit TaskScheduler(int maxThreadCount = -1);
+
+    /**
+     * @brief Stops the workers. All groups must have been waited on.
+     **/
+    ~TaskScheduler();
+
+    /**
+     * @brief The number of workers executing the tasks, in addition to the threads waiting on a group.
+     * With 0, the tasks run sequentially in the waiting threads.
+     **/
+    void setMaxThreadCount(int maxThreadCount);
+    int getMaxThreadCount() const;
+
+    /**
+     * @brief Calls f(inputs[i]) in parallel and stores the result in outputs[i]. Returns when all calls are done.
+     * The functor is called concurrently and must be thread-safe.
+     **/
+    template <typename Input, typename Output, typename Functor>
+    void blockingMapped(const std::vector<Input>& inputs,
+                        Functor f,
+                        std::vector<Output>* outputs);
+
+    /**
+     * @brief Same as blockingMapped() for functors whose result is not used.
+     **/
+    template <typename Input, typename Functor>
+    void blockingMap(const std::vector<Input>& inputs,
+                     Functor f);
+
+private:
+
+    template <typename Input, typename Output, typename Functor>
+    static void mappedTask(Functor* f,
+                           const Input* input,
+                           Output* output)
+    {
+        *output = (*f)(*input);
+    }
+
+    template <typename Input, typename Functor>
+    static void mapTask(Functor* f,
+                        const Input* input)
+    {
+        (*f)(*input);
+    }
+
+    boost::scoped_ptr<TaskSchedulerPrivate> _imp;
+};
+
+/**
+ * @brief A set of tasks executed by a TaskScheduler. The group must be waited on by the thread that created it,
+ * which is done at the latest in the destructor.
+ **/
+class TaskGroup
+{
+    friend class TaskScheduler;
+
+public:
+
+    explicit TaskGroup(TaskScheduler* scheduler);
+
+    ~TaskGroup();
+
+    /**
+     * @brief Queue a task. It may be called from any thread, including from a task of the group.
+     **/
+    void run(const boost::function<void()>& task);
+
+    /**
+     * @brief Executes the tasks of the group in the calling thread until all of them are done,
+     * including those stolen by the workers.
+     * If tasks threw an exception, a std::runtime_error with the message of the first one is thrown.
+     **/
+    void wait();
+
+private:
+
+    boost::scoped_ptr<TaskGroupPrivate> _imp;
+};
+
+template <typename Input, typename Output, typename Functor>
+void
+TaskScheduler::blockingMapped(const std::vector<Input>& inputs,
+                              Functor f,
+                              std::vector<Output>* outputs)
+{
+    // Each task writes its own element: this is not thread-safe with the bit-packed std::vector<bool>
+    BOOST_STATIC_ASSERT( (!boost::is_same<Output, bool>::value) );
+
+    outputs->resize( inputs.size() );
+    TaskGroup group(this);
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        group.run( boost::bind(&TaskScheduler::mappedTask<Input, Output, Functor>, &f, &inputs[i], &(*outputs)[i]) );
+    }
+    group.wait();
+}
+
+template <typename Input, typename Functor>
+void
+TaskScheduler::blockingMap(const std::vector<Input>& inputs,
+                           Functor f)
+{
+    TaskGroup group(this);
+
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        group.run( boost::bind(&TaskScheduler::mapTask<Input, Functor>, &f, &inputs[i]) );
+    }
+    group.wait();
+}
+
 NATRON_NAMESPACE_EXIT
 
 #endif // Natron_Engine_ThreadPool_h
@@ -25,6 +25,8 @@
 
 #include "TrackerContext.h"
 
+#include <algorithm> // min, max
+#include <cmath>
 #include <set>
 #include <sstream> // stringstream
 
@@ -46,6 +48,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/Project.h"
 #include "Engine/Curve.h"
 #include "Engine/TLSHolder.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/Transform.h"
 #include "Engine/TrackMarker.h"
 #include "Engine/TrackerContextPrivate.h"
@@ -54,6 +57,9 @@ CLANG_DIAG_ON(uninitialized)
 
 #define NATRON_TRACKER_REPORT_PROGRESS_DELTA_MS 200
 
+// Number of frames whose images are fetched while the current frame is tracked
+#define NATRON_TRACKER_PREFETCH_FRAMES_COUNT 2
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -1713,6 +1719,50 @@ TrackArgs::getRedrawAreasNeeded(int time,
     }
 }
 
+TrackerFrameAccessorPtr
+TrackArgs::getFrameAccessor() const
+{
+    return _imp->fa;
+}
+
+void
+TrackArgs::getLibMVSearchRegionsBbox(int time,
+                                     RectI* roi) const
+{
+    roi->clear();
+    for (std::vector<TrackMarkerAndOptionsPtr>::const_iterator it = _imp->tracks.begin(); it != _imp->tracks.end(); ++it) {
+        if ( !(*it)->natronMarker->isEnabled(time) || dynamic_cast<TrackMarkerPM*>( (*it)->natronMarker.get() ) ) {
+            continue;
+        }
+        KnobDoublePtr searchBtmLeft = (*it)->natronMarker->getSearchWindowBottomLeftKnob();
+        KnobDoublePtr searchTopRight = (*it)->natronMarker->getSearchWindowTopRightKnob();
+        KnobDoublePtr centerKnob = (*it)->natronMarker->getCenterKnob();
+        KnobDoublePtr offsetKnob = (*it)->natronMarker->getOffsetKnob();
+
+        // The search region of TrackerContextPrivate::natronTrackerToLibMVTracker
+        Point centerPlusOffset;
+        centerPlusOffset.x = centerKnob->getValueAtTime(time, 0) + offsetKnob->getValueAtTime(time, 0) - 0.5;
+        centerPlusOffset.y = centerKnob->getValueAtTime(time, 1) + offsetKnob->getValueAtTime(time, 1) - 0.5;
+        RectD rect;
+        rect.x1 = searchBtmLeft->getValueAtTime(time, 0) + centerPlusOffset.x;
+        rect.y1 = searchBtmLeft->getValueAtTime(time, 1) + centerPlusOffset.y;
+        rect.x2 = searchTopRight->getValueAtTime(time, 0) + centerPlusOffset.x;
+        rect.y2 = searchTopRight->getValueAtTime(time, 1) + centerPlusOffset.y;
+
+        // The marker is not tracked yet at the time of the frames fetched ahead and libmv may predict its motion:
+        // leave it half the size of its search window in each direction
+        double marginX = rect.width() / 2.;
+        double marginY = rect.height() / 2.;
+        RectI trackRoI( (int)std::floor(rect.x1 - marginX), (int)std::floor(rect.y1 - marginY),
+                        (int)std::ceil(rect.x2 + marginX), (int)std::ceil(rect.y2 + marginY) );
+        if ( roi->isNull() ) {
+            *roi = trackRoI;
+        } else {
+            roi->merge(trackRoI);
+        }
+    }
+}
+
 struct TrackSchedulerPrivate
 {
     TrackerParamsProvider* paramsProvider;
@@ -1736,6 +1786,11 @@ struct TrackSchedulerPrivate
      * @param time The time at which to track. The reference frame is held in the args and can be different for each track
      */
     static bool trackStepFunctor(int trackIndex, const TrackArgs& args, int time);
+
+    /*
+     * @brief Called on the task scheduler to fetch the images of a frame before it is tracked
+     */
+    static void prefetchFrameFunctor(const TrackerFrameAccessorPtr& fa, int time);
 };
 
 TrackScheduler::TrackScheduler(TrackerParamsProvider* paramsProvider,
@@ -1783,6 +1838,15 @@ TrackSchedulerPrivate::trackStepFunctor(int trackIndex,
     return ret;
 }
 
+void
+TrackSchedulerPrivate::prefetchFrameFunctor(const TrackerFrameAccessorPtr& fa,
+                                            int time)
+{
+    fa->fetchFrame(time);
+
+    appPTR->getAppTLS()->cleanupTLSForThread();
+}
+
 NATRON_NAMESPACE_ANONYMOUS_ENTER
 
 class IsTrackingFlagSetter_RAII
@@ -1872,6 +1936,10 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
     timeval lastProgressUpdateTime;
     gettimeofday(&lastProgressUpdateTime, 0);
 
+    // The images of the next frames are fetched in the background while the current one is tracked
+    TrackerFrameAccessorPtr fa = args->getFrameAccessor();
+    TaskGroup prefetchGroup( appPTR->getTaskScheduler() );
+
     bool allTrackFailed = false;
     {
         ///Use RAII style for setting the isDoingPartialUpdates flag so we're sure it gets removed
@@ -1884,16 +1952,39 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
 
 
         while (cur != end) {
-            ///Launch parallel thread for each track using the global thread pool
-            QFuture<bool> future = QtConcurrent::mapped( trackIndexes,
-                                                         boost::bind(&TrackSchedulerPrivate::trackStepFunctor,
-                                                                     _1,
-                                                                     *args,
-                                                                     cur) );
-            future.waitForFinished();
+            if (fa) {
+                // Each frame is rendered once for all the tracks. The regions of the frames not fetched yet are
+                // updated with the latest positions of the markers.
+                for (int i = 0; i <= NATRON_TRACKER_PREFETCH_FRAMES_COUNT; ++i) {
+                    int frame = cur + i * frameStep;
+                    if ( (frameStep > 0) ? (frame >= end) : (frame <= end) ) {
+                        break;
+                    }
+                    RectI roi;
+                    args->getLibMVSearchRegionsBbox(frame, &roi);
+                    if ( roi.isNull() ) {
+                        continue;
+                    }
+                    if ( fa->setFrameRegion(frame, roi) && (i > 0) ) {
+                        prefetchGroup.run( boost::bind(&TrackSchedulerPrivate::prefetchFrameFunctor, fa, frame) );
+                    }
+                }
+                // The previous frame is the reference frame of the current one
+                int lastFrame = cur + NATRON_TRACKER_PREFETCH_FRAMES_COUNT * frameStep;
+                fa->releaseFetchedFrames( std::min(cur - frameStep, lastFrame), std::max(cur - frameStep, lastFrame) );
+            }
+
+            ///Launch parallel thread for each track using the task scheduler
+            std::vector<int> trackSucceeded;
+            appPTR->getTaskScheduler()->blockingMapped( trackIndexes,
+                                                        boost::bind(&TrackSchedulerPrivate::trackStepFunctor,
+                                                                    _1,
+                                                                    *args,
+                                                                    cur),
+                                                        &trackSucceeded );
 
             allTrackFailed = true;
-            for (QFuture<bool>::const_iterator it = future.begin(); it != future.end(); ++it) {
+            for (std::vector<int>::const_iterator it = trackSucceeded.begin(); it != trackSucceeded.end(); ++it) {
                 if ( (*it) ) {
                     allTrackFailed = false;
                     break;
@@ -1968,6 +2059,12 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
             }
         } // while (cur != end) {
     } // IsTrackingFlagSetter_RAII
+
+    // The destructor of prefetchGroup runs the prefetch tasks still queued in this thread: the frames are released
+    // first so that these tasks return without rendering. It then waits for the renders in progress.
+    if (fa) {
+        fa->releaseFetchedFrames(1, 0);
+    }
     TrackerContext* isContext = dynamic_cast<TrackerContext*>(_imp->paramsProvider);
     if (isContext) {
         isContext->solveTransformParams();
@@ -481,6 +481,14 @@ public:
 
     void getRedrawAreasNeeded(int time, std::list<RectD>* canonicalRects) const;
 
+    TrackerFrameAccessorPtr getFrameAccessor() const;
+
+    /**
+     * @brief The bounding box, in pixels, of the search regions of the enabled tracks tracked by libmv at the given time,
+     * enlarged to account for their motion. It is null if there is no such track.
+     **/
+    void getLibMVSearchRegionsBbox(int time, RectI* roi) const;
+
 private:
 
     boost::scoped_ptr<TrackArgsPrivate> _imp;
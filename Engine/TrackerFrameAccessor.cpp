@@ -25,6 +25,9 @@
 
 #include "TrackerFrameAccessor.h"
 
+#include <cstring> // memcpy
+#include <map>
+
 #include <boost/utility.hpp>
 
 GCC_DIAG_OFF(unused-function)
@@ -36,6 +39,8 @@ GCC_DIAG_ON(unused-function)
 GCC_DIAG_ON(unused-parameter)
 
 #include <QtCore/QDebug>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
 
 #include "Engine/AbortableRenderInfo.h"
 #include "Engine/AppInstance.h"
@@ -207,6 +212,25 @@ natronImageToLibMvFloatImage(bool enabledChannels[3],
 } // anon namespace
 
 
+struct FetchedFrame
+{
+    // The region covering the search windows of all the tracks
+    RectI roi;
+
+    // The region intersected with the bounds of the source image, converted to the format of libmv
+    MvFloatImagePtr image;
+    RectI bounds;
+
+    // True while a thread renders the frame
+    bool fetching;
+    bool fetched;
+
+    FetchedFrame()
+        : roi(), image(), bounds(), fetching(false), fetched(false) {}
+};
+
+typedef std::map<int, FetchedFrame> FetchedFrames;
+
 struct TrackerFrameAccessorPrivate
 {
     const TrackerContext* context;
@@ -216,6 +240,11 @@ struct TrackerFrameAccessorPrivate
     bool enabledChannels[3];
     int formatHeight;
 
+    // The frames set by setFrameRegion(), protected by fetchedFramesMutex
+    mutable QMutex fetchedFramesMutex;
+    QWaitCondition fetchedFrameCond;
+    FetchedFrames fetchedFrames;
+
     TrackerFrameAccessorPrivate(const TrackerContext* context,
                                 bool enabledChannels[3],
                                 int formatHeight)
@@ -225,6 +254,9 @@ struct TrackerFrameAccessorPrivate
         , cache()
         , enabledChannels()
         , formatHeight(formatHeight)
+        , fetchedFramesMutex()
+        , fetchedFrameCond()
+        , fetchedFrames()
     {
         trackerInput = context->getNode()->getInput(0);
         assert(trackerInput);
@@ -232,6 +264,10 @@ struct TrackerFrameAccessorPrivate
             this->enabledChannels[i] = enabledChannels[i];
         }
     }
+
+    bool renderImage(int frame, int downscale, const RectI* region, MvFloatImagePtr* image, RectI* bounds);
+
+    bool getFetchedFrame(int frame, const RectI* region, MvFloatImagePtr* image, RectI* bounds);
 };
 
 TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
@@ -277,74 +313,37 @@ TrackerFrameAccessor::convertLibMVRegionToRectI(const mv::Region& region,
 }
 
 /*
- * @brief This is called by LibMV to retrieve an image either for reference or as search frame.
+ * @brief Renders the region of the frame, or the full image if region is NULL, and converts it to the format of libmv.
+ * The image returned covers the region intersected with the bounds of the source image.
  */
-mv::FrameAccessor::Key
-TrackerFrameAccessor::GetImage(int /*clip*/,
-                               int frame,
-                               mv::FrameAccessor::InputMode input_mode,
-                               int downscale,            // Downscale by 2^downscale.
-                               const mv::Region* region,     // Get full image if NULL.
-                               const mv::FrameAccessor::Transform* /*transform*/, // May be NULL.
-                               mv::FloatImage** destination)
+bool
+TrackerFrameAccessorPrivate::renderImage(int frame,
+                                         int downscale,
+                                         const RectI* region,
+                                         MvFloatImagePtr* image,
+                                         RectI* bounds)
 {
-    // Since libmv only uses MONO images for now we have only optimized for this case, remove and handle properly
-    // other case(s) when they get integrated into libmv.
-    assert(input_mode == mv::FrameAccessor::MONO);
-
-
-    FrameAccessorCacheKey key;
-    key.frame = frame;
-    key.mipMapLevel = downscale;
-    key.mode = input_mode;
-
-    /*
-       Check if a frame exists in the cache with matching key and bounds enclosing the given region
-     */
-    RectI roi;
-    if (region) {
-        convertLibMVRegionToRectI(*region, _imp->formatHeight, &roi);
-
-        QMutexLocker k(&_imp->cacheMutex);
-        std::pair<FrameAccessorCache::iterator, FrameAccessorCache::iterator> range = _imp->cache.equal_range(key);
-        for (FrameAccessorCache::iterator it = range.first; it != range.second; ++it) {
-            if ( (roi.x1 >= it->second.bounds.x1) && (roi.x2 <= it->second.bounds.x2) &&
-                 ( roi.y1 >= it->second.bounds.y1) && ( roi.y2 <= it->second.bounds.y2) ) {
-#ifdef TRACE_LIB_MV
-                qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Found cached image at frame" << frame << "with RoI x1="
-                         << region->min(0) << "y1=" << region->max(1) << "x2=" << region->max(0) << "y2=" << region->min(1);
-#endif
-                // LibMV is kinda dumb on this we must necessarily copy the data either via CopyFrom or the
-                // assignment constructor:
-                // EDIT: fixed libmv
-                *destination = it->second.image.get();
-                //destination->CopyFrom<float>(*it->second.image);
-                ++it->second.referenceCount;
-
-                return (mv::FrameAccessor::Key)it->second.image.get();
-            }
-        }
-    }
-
     EffectInstancePtr effect;
-    if (_imp->trackerInput) {
-        effect = _imp->trackerInput->getEffectInstance();
+    if (trackerInput) {
+        effect = trackerInput->getEffectInstance();
     }
     if (!effect) {
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
-    // Not in accessor cache, call renderRoI
     RenderScale scale;
     scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
 
 
+    RectI roi;
     RectD precomputedRoD;
-    if (!region) {
+    if (region) {
+        roi = *region;
+    } else {
         bool isProjectFormat;
-        StatusEnum stat = effect->getRegionOfDefinition_public(_imp->trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
+        StatusEnum stat = effect->getRegionOfDefinition_public(trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
         if (stat == eStatusFailed) {
-            return (mv::FrameAccessor::Key)0;
+            return false;
         }
         double par = effect->getAspectRatio(-1);
         precomputedRoD.toPixelEnclosing( (unsigned int)downscale, par, &roi );
@@ -353,7 +352,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     std::list<ImagePlaneDesc> components;
     components.push_back( ImagePlaneDesc::getRGBComponents() );
 
-    NodePtr node = _imp->context->getNode();
+    NodePtr node = context->getNode();
     const bool isRenderUserInteraction = true;
     const bool isSequentialRender = false;
     AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(false, 0);
@@ -383,7 +382,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                                         components,
                                         eImageBitDepthFloat,
                                         true,
-                                        _imp->context->getNode()->getEffectInstance().get(),
+                                        node->getEffectInstance().get(),
                                         eStorageModeRAM /*returnOpenGLTex*/,
                                         frame);
     std::map<ImagePlaneDesc, ImagePtr> planes;
@@ -394,7 +393,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
 #endif
 
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
     assert( !planes.empty() );
@@ -407,7 +406,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2 << ")";
 #endif
 
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
 #ifdef TRACE_LIB_MV
@@ -418,16 +417,195 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     /*
        Copy the Natron image to the LivMV float image
      */
-    FrameAccessorCacheEntry entry;
-    entry.image = boost::make_shared<MvFloatImage>( intersectedRoI.height(), intersectedRoI.width() );
-    entry.bounds = intersectedRoI;
-    entry.referenceCount = 1;
-    natronImageToLibMvFloatImage(_imp->enabledChannels,
+    *image = boost::make_shared<MvFloatImage>( intersectedRoI.height(), intersectedRoI.width() );
+    *bounds = intersectedRoI;
+    natronImageToLibMvFloatImage(enabledChannels,
                                  sourceImage.get(),
                                  intersectedRoI,
-                                 *entry.image);
+                                 **image);
     // we ignore the transform parameter and do it in natronImageToLibMvFloatImage instead
 
+    return true;
+} // TrackerFrameAccessorPrivate::renderImage
+
+/*
+ * @brief Renders the frame set by setFrameRegion() if no thread did yet, or waits for the thread rendering it.
+ * Returns false if the frame was not set, or if region is not within its region.
+ */
+bool
+TrackerFrameAccessorPrivate::getFetchedFrame(int frame,
+                                             const RectI* region,
+                                             MvFloatImagePtr* image,
+                                             RectI* bounds)
+{
+    QMutexLocker k(&fetchedFramesMutex);
+    FetchedFrames::iterator found = fetchedFrames.find(frame);
+
+    // Do not wait for a render that would not cover the region
+    while ( ( found != fetchedFrames.end() ) && found->second.fetching && ( !region || found->second.roi.contains(*region) ) ) {
+        fetchedFrameCond.wait(&fetchedFramesMutex);
+        // The frame may have been released meanwhile
+        found = fetchedFrames.find(frame);
+    }
+    if ( ( found == fetchedFrames.end() ) || ( region && !found->second.roi.contains(*region) ) ) {
+        return false;
+    }
+
+    if (!found->second.fetched) {
+        RectI roi = found->second.roi;
+        found->second.fetching = true;
+        k.unlock();
+
+        MvFloatImagePtr fetchedImage;
+        RectI fetchedBounds;
+        bool ok = renderImage(frame, 0, &roi, &fetchedImage, &fetchedBounds);
+
+        k.relock();
+        found = fetchedFrames.find(frame);
+        if ( found != fetchedFrames.end() ) {
+            found->second.fetching = false;
+            found->second.fetched = true;
+            if (ok) {
+                found->second.image = fetchedImage;
+                found->second.bounds = fetchedBounds;
+            }
+        }
+        fetchedFrameCond.wakeAll();
+        if ( found == fetchedFrames.end() ) {
+            return false;
+        }
+    }
+
+    // A failed render is reported to libmv, as it would have been for each track
+    *image = found->second.image;
+    *bounds = found->second.bounds;
+
+    return true;
+} // TrackerFrameAccessorPrivate::getFetchedFrame
+
+bool
+TrackerFrameAccessor::setFrameRegion(int frame,
+                                     const RectI& roi)
+{
+    QMutexLocker k(&_imp->fetchedFramesMutex);
+    FetchedFrames::iterator found = _imp->fetchedFrames.find(frame);
+
+    if ( found == _imp->fetchedFrames.end() ) {
+        _imp->fetchedFrames[frame].roi = roi;
+
+        return true;
+    }
+    if (!found->second.fetching && !found->second.fetched) {
+        found->second.roi = roi;
+    }
+
+    return false;
+}
+
+void
+TrackerFrameAccessor::fetchFrame(int frame)
+{
+    MvFloatImagePtr image;
+    RectI bounds;
+
+    _imp->getFetchedFrame(frame, 0, &image, &bounds);
+}
+
+void
+TrackerFrameAccessor::releaseFetchedFrames(int firstFrame,
+                                           int lastFrame)
+{
+    QMutexLocker k(&_imp->fetchedFramesMutex);
+
+    for (FetchedFrames::iterator it = _imp->fetchedFrames.begin(); it != _imp->fetchedFrames.end();) {
+        if ( (it->first < firstFrame) || (it->first > lastFrame) ) {
+            _imp->fetchedFrames.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+    _imp->fetchedFrameCond.wakeAll();
+}
+
+/*
+ * @brief This is called by LibMV to retrieve an image either for reference or as search frame.
+ */
+mv::FrameAccessor::Key
+TrackerFrameAccessor::GetImage(int /*clip*/,
+                               int frame,
+                               mv::FrameAccessor::InputMode input_mode,
+                               int downscale,            // Downscale by 2^downscale.
+                               const mv::Region* region,     // Get full image if NULL.
+                               const mv::FrameAccessor::Transform* /*transform*/, // May be NULL.
+                               mv::FloatImage** destination)
+{
+    // Since libmv only uses MONO images for now we have only optimized for this case, remove and handle properly
+    // other case(s) when they get integrated into libmv.
+    assert(input_mode == mv::FrameAccessor::MONO);
+
+
+    FrameAccessorCacheKey key;
+    key.frame = frame;
+    key.mipMapLevel = downscale;
+    key.mode = input_mode;
+
+    /*
+       Check if a frame exists in the cache with matching key and bounds enclosing the given region
+     */
+    RectI roi;
+    if (region) {
+        convertLibMVRegionToRectI(*region, _imp->formatHeight, &roi);
+
+        QMutexLocker k(&_imp->cacheMutex);
+        std::pair<FrameAccessorCache::iterator, FrameAccessorCache::iterator> range = _imp->cache.equal_range(key);
+        for (FrameAccessorCache::iterator it = range.first; it != range.second; ++it) {
+            // libmv expects the origin of the image at the origin of the region
+            if ( (roi.x1 == it->second.bounds.x1) && (roi.x2 <= it->second.bounds.x2) &&
+                 ( roi.y1 == it->second.bounds.y1) && ( roi.y2 <= it->second.bounds.y2) ) {
+#ifdef TRACE_LIB_MV
+                qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Found cached image at frame" << frame << "with RoI x1="
+                         << region->min(0) << "y1=" << region->max(1) << "x2=" << region->max(0) << "y2=" << region->min(1);
+#endif
+                // LibMV is kinda dumb on this we must necessarily copy the data either via CopyFrom or the
+                // assignment constructor:
+                // EDIT: fixed libmv
+                *destination = it->second.image.get();
+                //destination->CopyFrom<float>(*it->second.image);
+                ++it->second.referenceCount;
+
+                return (mv::FrameAccessor::Key)it->second.image.get();
+            }
+        }
+    }
+
+    FrameAccessorCacheEntry entry;
+    entry.referenceCount = 1;
+
+    /*
+       If the region is within the region fetched for all the tracks at this frame, crop it from there instead
+       of rendering it
+     */
+    MvFloatImagePtr fetchedImage;
+    RectI fetchedBounds;
+    if ( region && (downscale == 0) && _imp->getFetchedFrame(frame, &roi, &fetchedImage, &fetchedBounds) ) {
+        if ( !fetchedImage || !roi.intersect(fetchedBounds, &entry.bounds) ) {
+            return (mv::FrameAccessor::Key)0;
+        }
+        entry.image = boost::make_shared<MvFloatImage>( entry.bounds.height(), entry.bounds.width() );
+        const int srcWidth = fetchedBounds.width();
+        const int dstWidth = entry.bounds.width();
+        const float* srcPixels = fetchedImage->Data() + (std::size_t)(entry.bounds.y1 - fetchedBounds.y1) * srcWidth + (entry.bounds.x1 - fetchedBounds.x1);
+        float* dstPixels = entry.image->Data();
+        for (int y = entry.bounds.y1; y < entry.bounds.y2; ++y, srcPixels += srcWidth, dstPixels += dstWidth) {
+            std::memcpy( dstPixels, srcPixels, dstWidth * sizeof(float) );
+        }
+    } else {
+        // Not in accessor cache, call renderRoI
+        if ( !_imp->renderImage(frame, downscale, region ? &roi : 0, &entry.image, &entry.bounds) ) {
+            return (mv::FrameAccessor::Key)0;
+        }
+    }
+
     *destination = entry.image.get();
     //destination->CopyFrom<float>(*entry.image);
 
@@ -438,7 +616,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     }
 #ifdef TRACE_LIB_MV
     qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Rendered frame" << frame << "with RoI x1="
-             << intersectedRoI.x1 << "y1=" << intersectedRoI.y1 << "x2=" << intersectedRoI.x2 << "y2=" << intersectedRoI.y2;
+             << entry.bounds.x1 << "y1=" << entry.bounds.y1 << "x2=" << entry.bounds.x2 << "y2=" << entry.bounds.y2;
 #endif
 
     return (mv::FrameAccessor::Key)entry.image.get();
@@ -54,6 +54,26 @@ public:
 
     void getEnabledChannels(bool* r, bool* g, bool* b) const;
 
+    /**
+     * @brief Sets the region of the frame covering the search windows of all the tracks. The region is rendered once
+     * and converted once to the format of libmv, then GetImage() crops the image of each track from it. Regions not
+     * within it are still rendered separately.
+     * If the frame was not fetched yet, its region is replaced. Returns true if the frame was not set before.
+     **/
+    bool setFrameRegion(int frame, const RectI& roi);
+
+    /**
+     * @brief Renders the region set for the frame, unless another thread did it already. This is thread-safe, so that
+     * the next frames can be fetched in the background while the current one is tracked.
+     **/
+    void fetchFrame(int frame);
+
+    /**
+     * @brief Releases the frames set by setFrameRegion() which are not in [firstFrame, lastFrame], all of them if
+     * firstFrame > lastFrame.
+     **/
+    void releaseFetchedFrames(int firstFrame, int lastFrame);
+
 
     // Get a possibly-filtered version of a frame of a video. Downscale will
     // cause the input image to get downscaled by 2^downscale for pyramid access.
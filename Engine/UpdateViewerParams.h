@@ -90,6 +90,7 @@ public:
         , abortInfo()
         , isSequential(false)
         , isPartialRect(false)
+        , updateOnlyPaintDirtyRect(false)
         , isViewerPaused(false)
         , recenterViewport(false)
         , viewportCenter()
@@ -154,6 +155,10 @@ public:
     // Is this a marker overlay used when tracking ?
     bool isPartialRect;
 
+    // When painting, is the RAM buffer the one of the previous render, in which only the area of the last strokes was rendered ?
+    // If the texture was made from that buffer, only the area rendered since its last upload is transferred.
+    bool updateOnlyPaintDirtyRect;
+
     // Is the viewer paused ?
     bool isViewerPaused;
 
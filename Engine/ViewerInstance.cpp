@@ -31,6 +31,8 @@
 #include <cassert>
 #include <cstring> // for std::memcpy
 #include <cfloat> // DBL_MAX
+#include <limits>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -42,7 +44,6 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QtGlobal>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 #include <QtCore/QFutureWatcher>
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
@@ -68,11 +69,13 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Timer.h"
 #include "Engine/UpdateViewerParams.h"
 #include "Engine/Utils.h"
 #include "Engine/ViewIdx.h"
+#include "Engine/ViewerInstanceKernels.h"
 
 
 #ifndef M_LN2
@@ -100,6 +103,16 @@ struct MinMaxVal {
     {
     }
 
+    void merge(const MinMaxVal& other)
+    {
+        if (other.min < min) {
+            min = other.min;
+        }
+        if (other.max > max) {
+            max = other.max;
+        }
+    }
+
     double min;
     double max;
 };
@@ -115,13 +128,23 @@ static void scaleToTexture32bits(const RectI& roi,
                                  const RenderViewerArgs & args,
                                  const UpdateViewerParams::CachedTile& tile,
                                  float *output);
-static MinMaxVal findAutoContrastVminVmax(const ImagePtr inputImage,
-                                                         DisplayChannelsEnum channels,
-                                                         const RectI & rect);
+static void scaleToTexture16bits(const RectI& roi,
+                                 const RenderViewerArgs & args,
+                                 const UpdateViewerParams::CachedTile& tile,
+                                 unsigned short *output);
+static MinMaxVal findAutoContrastVminVmax(const ImageConstPtr& inputImage,
+                                          DisplayChannelsEnum channels,
+                                          const RectI & rect);
 static void renderFunctor(const RectI& roi,
                           const RenderViewerArgs & args,
                           ViewerInstance* viewer,
                           UpdateViewerParams::CachedTile tile);
+static MinMaxVal renderFunctorAndFindVminVmax(const RectI& roi,
+                                              const RenderViewerArgs & args,
+                                              ViewerInstance* viewer,
+                                              UpdateViewerParams::CachedTile tile);
+static void setAutoContrastGainAndOffset(const MinMaxVal& vMinMax,
+                                         UpdateViewerParams* params);
 
 /**
  *@brief Actually converting to ARGB... but it is called BGRA by
@@ -137,6 +160,16 @@ toBGRA(unsigned char r,
     return (a << 24) | (r << 16) | (g << 8) | b;
 }
 
+/**
+ * @brief Returns true if the textures of the given bit depth hold the linear image, the gain, gamma and
+ * output colorspace being applied by the GLSL shader at display time: the cached textures do not depend on them.
+ **/
+static bool
+isViewerTextureDisplayReferred(ImageBitDepthEnum depth)
+{
+    return depth == eImageBitDepthFloat || depth == eImageBitDepthHalf;
+}
+
 const Color::Lut*
 ViewerInstance::lutFromColorspace(ViewerColorSpaceEnum cs)
 {
@@ -1015,11 +1048,8 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
                     tile.rectRounded  = pixelRect;
                     tile.rect.closestPo2 = 1 << mipmapLevel;
                     tile.rect.par = outArgs->params->pixelAspectRatio;
-                    tile.bytesCount = tile.rect.area() * 4;
+                    tile.bytesCount = tile.rect.area() * 4 * getSizeOfForBitDepth(outArgs->params->depth);
                     assert(tile.bytesCount > 0);
-                    if (outArgs->params->depth == eImageBitDepthFloat) {
-                        tile.bytesCount *= sizeof(float);
-                    }
                     outArgs->params->tiles.push_back(tile);
                 }
             }
@@ -1029,11 +1059,8 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
                 tile.rectRounded = outArgs->params->roi;
                 tile.rect.closestPo2 = 1 << mipmapLevel;
                 tile.rect.par = outArgs->params->pixelAspectRatio;
-                tile.bytesCount = tile.rect.area() * 4;
+                tile.bytesCount = tile.rect.area() * 4 * getSizeOfForBitDepth(outArgs->params->depth);
                 assert(tile.bytesCount > 0);
-                if (outArgs->params->depth == eImageBitDepthFloat) {
-                    tile.bytesCount *= sizeof(float);
-                }
                 outArgs->params->tiles.push_back(tile);
             }
         }
@@ -1053,11 +1080,9 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
             tile.rect.par = outArgs->params->pixelAspectRatio;
             tile.bytesCount = outArgs->params->tileSize * outArgs->params->tileSize * 4; // RGBA
             assert( outArgs->params->roi.contains(tile.rect) );
-            // If we are using floating point textures, multiply by size of float
+            // If we are using floating point textures, multiply by the size of a channel
+            tile.bytesCount *= getSizeOfForBitDepth(outArgs->params->depth);
             assert(tile.bytesCount > 0);
-            if (outArgs->params->depth == eImageBitDepthFloat) {
-                tile.bytesCount *= sizeof(float);
-            }
             outArgs->params->tiles.push_back(tile);
         }
     }
@@ -1093,7 +1118,7 @@ ViewerInstance::getViewerRoIAndTexture(const RectD& rod,
                          inputToRenderName,
                          outArgs->params->layer,
                          outArgs->params->alphaLayer.getPlaneID() + outArgs->params->alphaChannelName,
-                         outArgs->params->depth == eImageBitDepthFloat,
+                         isViewerTextureDisplayReferred(outArgs->params->depth),
                          isDraftMode);
             std::list<FrameEntryPtr> entries;
             bool hasTextureCached = appPTR->getTexture(key, &entries);
@@ -1647,10 +1672,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
             UpdateViewerParams::CachedTile tile;
             tile.rect.set(viewerRenderRoI);
             tile.rectRounded = viewerRenderRoI;
-            std::size_t pixelSize = 4;
-            if (updateParams->depth == eImageBitDepthFloat) {
-                pixelSize *= sizeof(float);
-            }
+            std::size_t pixelSize = 4 * getSizeOfForBitDepth(updateParams->depth);
             std::size_t dstRowSize = tile.rect.width() * pixelSize;
             tile.bytesCount = tile.rect.height() * dstRowSize;
             tile.ramBuffer =  (unsigned char*)malloc(tile.bytesCount);
@@ -1717,6 +1739,8 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                     } else {
                         //The buffer did not change its size, make sure to keep it
                         _imp->lastRenderParams[updateParams->textureIndex]->mustFreeRamBuffer = false;
+                        //Only the area rendered since the last upload has to be transferred to the texture
+                        updateParams->updateOnlyPaintDirtyRect = true;
                     }
 
                     //This will delete the previous buffer if mustFreeRamBuffer was set to true
@@ -1794,7 +1818,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                                  inputToRenderName,
                                  inArgs.params->layer,
                                  inArgs.params->alphaLayer.getPlaneID() + inArgs.params->alphaChannelName,
-                                 inArgs.params->depth == eImageBitDepthFloat,
+                                 isViewerTextureDisplayReferred(inArgs.params->depth),
                                  inArgs.draftModeEnabled);
 
 
@@ -1856,24 +1880,19 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
 
         std::size_t tileRowElements = inArgs.params->tileSize;
         // Internally the buffer is interpreted as U32 when 8bit, so we do not multiply it by 4 for RGBA
-        if (updateParams->depth == eImageBitDepthFloat) {
+        if (updateParams->depth != eImageBitDepthByte) {
             tileRowElements *= 4;
         }
 
+        // The display-referred textures are filled without the gain and offset, which are applied by the shader:
+        // the extrema of the auto-contrast are found while filling them. The other textures need them beforehand.
+        const bool autoContrast = inArgs.autoContrast && !inArgs.isDoingPartialUpdates;
+        const bool autoContrastWhileFilling = autoContrast && isViewerTextureDisplayReferred(updateParams->depth) && viewerRenderRoiOnly && unCachedTiles.size() == 1;
+        const bool autoContrastBeforeFilling = autoContrast && !autoContrastWhileFilling;
+
         if (singleThreaded) {
-            if (inArgs.autoContrast && !inArgs.isDoingPartialUpdates) {
-                double vmin, vmax;
-                MinMaxVal vMinMax = findAutoContrastVminVmax(colorImage, inArgs.channels, viewerRenderRoI);
-                vmin = vMinMax.min;
-                vmax = vMinMax.max;
-
-                ///if vmax - vmin is greater than 1 the gain will be really small and we won't see
-                ///anything in the image
-                if (vmin == vmax) {
-                    vmin = vmax - 1.;
-                }
-                updateParams->gain = 1 / (vmax - vmin);
-                updateParams->offset = -vmin / ( vmax - vmin);
+            if (autoContrastBeforeFilling) {
+                setAutoContrastGainAndOffset(findAutoContrastVminVmax(colorImage, inArgs.channels, viewerRenderRoI), updateParams.get() );
             }
 
             const RenderViewerArgs args(colorImage,
@@ -1890,58 +1909,43 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                                         viewerRenderRoiOnly,
                                         tileRowElements);
             QReadLocker k(&_imp->gammaLookupMutex);
-            for (std::list<UpdateViewerParams::CachedTile>::iterator it = unCachedTiles.begin(); it != unCachedTiles.end(); ++it) {
-                renderFunctor(viewerRenderRoI,
-                              args,
-                              this,
-                              *it);
+            if (autoContrastWhileFilling) {
+                setAutoContrastGainAndOffset(renderFunctorAndFindVminVmax(viewerRenderRoI, args, this, unCachedTiles.front()), updateParams.get() );
+            } else {
+                for (std::list<UpdateViewerParams::CachedTile>::iterator it = unCachedTiles.begin(); it != unCachedTiles.end(); ++it) {
+                    renderFunctor(viewerRenderRoI,
+                                  args,
+                                  this,
+                                  *it);
+                }
             }
         } else {
-            bool runInCurrentThread = QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
-            if ( !runInCurrentThread && (splitRoi.size() > 1) ) {
-                runInCurrentThread = true;
-            }
+            // No need to check whether the workers are busy: the tasks queued in the scheduler are also executed
+            // by this thread while it waits.
+            bool runInCurrentThread = splitRoi.size() > 1;
 
 
             ///if autoContrast is enabled, find out the vmin/vmax before rendering and mapping against new values
-            if (inArgs.autoContrast && !inArgs.isDoingPartialUpdates) {
-                double vmin = std::numeric_limits<double>::infinity();
-                double vmax = -std::numeric_limits<double>::infinity();
+            if (autoContrastBeforeFilling) {
+                MinMaxVal vMinMax( std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() );
 
                 if (runInCurrentThread) {
-                    MinMaxVal vMinMax = findAutoContrastVminVmax(colorImage, inArgs.channels, viewerRenderRoI);
-                    vmin = vMinMax.min;
-                    vmax = vMinMax.max;
+                    vMinMax = findAutoContrastVminVmax(colorImage, inArgs.channels, viewerRenderRoI);
                 } else {
                     std::vector<RectI> splitRects = viewerRenderRoI.splitIntoSmallerRects( appPTR->getMaxThreadCount() );
-                    QFuture<MinMaxVal> future = QtConcurrent::mapped( splitRects,
-                                                                                       boost::bind(findAutoContrastVminVmax,
-                                                                                                   colorImage,
-                                                                                                   inArgs.channels,
-                                                                                                   _1) );
-                    future.waitForFinished();
-                    QList<MinMaxVal> results = future.results();
-                    Q_FOREACH (const MinMaxVal &vMinMax, results) {
-                        if (vMinMax.min < vmin) {
-                            vmin = vMinMax.min;
-                        }
-                        if (vMinMax.max > vmax) {
-                            vmax = vMinMax.max;
-                        }
+                    std::vector<MinMaxVal> results;
+                    appPTR->getTaskScheduler()->blockingMapped( splitRects,
+                                                                boost::bind(findAutoContrastVminVmax,
+                                                                            colorImage,
+                                                                            inArgs.channels,
+                                                                            _1),
+                                                                &results );
+                    Q_FOREACH (const MinMaxVal &bandMinMax, results) {
+                        vMinMax.merge(bandMinMax);
                     }
                 } // runInCurrentThread
 
-                if (vmax == vmin) {
-                    vmin = vmax - 1.;
-                }
-
-                if (vmax <= 0) {
-                    updateParams->gain = 0;
-                    updateParams->offset = 0;
-                } else {
-                    updateParams->gain = 1 / (vmax - vmin);
-                    updateParams->offset =  -vmin / (vmax - vmin);
-                }
+                setAutoContrastGainAndOffset( vMinMax, updateParams.get() );
             }
 
             const RenderViewerArgs args(colorImage,
@@ -1960,18 +1964,40 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
 
             if (runInCurrentThread) {
                 QReadLocker k(&_imp->gammaLookupMutex);
-                for (std::list<UpdateViewerParams::CachedTile>::iterator it = unCachedTiles.begin(); it != unCachedTiles.end(); ++it) {
-                    renderFunctor(viewerRenderRoI,
-                                  args, this, *it);
+                if (autoContrastWhileFilling) {
+                    setAutoContrastGainAndOffset(renderFunctorAndFindVminVmax(viewerRenderRoI, args, this, unCachedTiles.front()), updateParams.get() );
+                } else {
+                    for (std::list<UpdateViewerParams::CachedTile>::iterator it = unCachedTiles.begin(); it != unCachedTiles.end(); ++it) {
+                        renderFunctor(viewerRenderRoI,
+                                      args, this, *it);
+                    }
+                }
+            } else if (autoContrastWhileFilling) {
+                // The unique tile is filled by parallel bands, each one returning its extrema
+                std::vector<RectI> splitRects = viewerRenderRoI.splitIntoSmallerRects( appPTR->getMaxThreadCount() );
+                std::vector<MinMaxVal> results;
+                QReadLocker k(&_imp->gammaLookupMutex);
+                appPTR->getTaskScheduler()->blockingMapped( splitRects,
+                                                            boost::bind(&renderFunctorAndFindVminVmax,
+                                                                        _1,
+                                                                        args,
+                                                                        this,
+                                                                        unCachedTiles.front() ),
+                                                            &results );
+                MinMaxVal vMinMax( std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() );
+                Q_FOREACH (const MinMaxVal &bandMinMax, results) {
+                    vMinMax.merge(bandMinMax);
                 }
+                setAutoContrastGainAndOffset( vMinMax, updateParams.get() );
             } else {
+                std::vector<UpdateViewerParams::CachedTile> tiles( unCachedTiles.begin(), unCachedTiles.end() );
                 QReadLocker k(&_imp->gammaLookupMutex);
-                QtConcurrent::map( unCachedTiles,
-                                   boost::bind(&renderFunctor,
-                                               viewerRenderRoI,
-                                               args,
-                                               this,
-                                               _1) ).waitForFinished();
+                appPTR->getTaskScheduler()->blockingMap( tiles,
+                                                         boost::bind(&renderFunctor,
+                                                                     viewerRenderRoI,
+                                                                     args,
+                                                                     this,
+                                                                     _1) );
             }
 
             if (inArgs.isDoingPartialUpdates) {
@@ -1980,6 +2006,17 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
         } // if (singleThreaded)
 
 
+        if ( rotoPaintNode && !useTextureCache && !inArgs.isDoingPartialUpdates && !viewerRenderRoI.isNull() ) {
+            // The area is complete in the paint buffer: the next update of the viewer may upload it, see updateViewer()
+            QMutexLocker k(&_imp->lastRenderParamsMutex);
+            RectI& dirtyRect = _imp->paintDirtyRect[updateParams->textureIndex];
+            if ( dirtyRect.isNull() ) {
+                dirtyRect = viewerRenderRoI;
+            } else {
+                dirtyRect.merge(viewerRenderRoI);
+            }
+        }
+
         if ( colorImage && stats && stats->isInDepthProfilingEnabled() ) {
             stats->addRenderInfosForNode( getNode(), NodePtr(), colorImage->getComponents().getChannelsLabel(), viewerRenderRoI, viewerRenderTimeRecorder->getTimeSinceCreation() );
         }
@@ -2038,129 +2075,90 @@ renderFunctor(const RectI& roi,
     if ( (args.bitDepth == eImageBitDepthFloat) ) {
         // image is stored as linear, the OpenGL shader with do gamma/sRGB/Rec709 decompression, as well as gain and offset
         scaleToTexture32bits(roi, args, tile, (float*)tile.ramBuffer);
+    } else if (args.bitDepth == eImageBitDepthHalf) {
+        // same as above, with half the memory
+        scaleToTexture16bits(roi, args, tile, (unsigned short*)tile.ramBuffer);
     } else {
         // texture is stored as sRGB/Rec709 compressed 8-bit RGBA
         scaleToTexture8bits(roi, args, viewer, tile, (U32*)tile.ramBuffer);
     }
 }
 
-inline
 MinMaxVal
-findAutoContrastVminVmax_generic(const ImagePtr inputImage,
-                                 int nComps,
-                                 DisplayChannelsEnum channels,
-                                 const RectI & rect)
-{
-    double localVmin = std::numeric_limits<double>::infinity();
-    double localVmax = -std::numeric_limits<double>::infinity();
-    Image::ReadAccess acc = inputImage->getReadRights();
-
-    for (int y = rect.bottom(); y < rect.top(); ++y) {
-        const float* src_pixels = (const float*)acc.pixelAt(rect.left(), y);
-        ///we fill the scan-line with all the pixels of the input image
-        for (int x = rect.left(); x < rect.right(); ++x) {
-            double r = 0.;
-            double g = 0.;
-            double b = 0.;
-            double a = 0.;
-            switch (nComps) {
-            case 4:
-                r = src_pixels[0];
-                g = src_pixels[1];
-                b = src_pixels[2];
-                a = src_pixels[3];
-                break;
-            case 3:
-                r = src_pixels[0];
-                g = src_pixels[1];
-                b = src_pixels[2];
-                a = 1.;
-                break;
-            case 2:
-                r = src_pixels[0];
-                g = src_pixels[1];
-                b = 0.;
-                a = 1.;
-                break;
-            case 1:
-                a = src_pixels[0];
-                r = g = b = 0.;
-                break;
-            default:
-                r = g = b = a = 0.;
-            }
+findAutoContrastVminVmax(const ImageConstPtr& inputImage,
+                         DisplayChannelsEnum channels,
+                         const RectI & rect)
+{
+    float vmin = std::numeric_limits<float>::infinity();
+    float vmax = -std::numeric_limits<float>::infinity();
+    Image::ReadAccess acc = Image::ReadAccess( inputImage.get() );
+    const float* src_pixels = (const float*)acc.pixelAt(rect.x1, rect.y1);
 
-            double mini, maxi;
-            switch (channels) {
-            case eDisplayChannelsRGB:
-                mini = std::min(std::min(r, g), b);
-                maxi = std::max(std::max(r, g), b);
-                break;
-            case eDisplayChannelsY:
-                mini = r = 0.299 * r + 0.587 * g + 0.114 * b;
-                maxi = mini;
-                break;
-            case eDisplayChannelsR:
-                mini = r;
-                maxi = mini;
-                break;
-            case eDisplayChannelsG:
-                mini = g;
-                maxi = mini;
-                break;
-            case eDisplayChannelsB:
-                mini = b;
-                maxi = mini;
-                break;
-            case eDisplayChannelsA:
-                mini = a;
-                maxi = mini;
-                break;
-            default:
-                mini = 0.;
-                maxi = 0.;
-                break;
-            }
-            if (mini < localVmin) {
-                localVmin = mini;
-            }
-            if (maxi > localVmax) {
-                localVmax = maxi;
-            }
+    if (!src_pixels) {
+        return MinMaxVal(vmin, vmax);
+    }
 
-            src_pixels += nComps;
-        }
+    const std::size_t srcRowElements = inputImage->getRowElements();
+    ViewerRowMinMaxArgs rowArgs;
+    rowArgs.width = rect.width();
+    rowArgs.nComps = (int)inputImage->getComponentsCount();
+    rowArgs.channels = channels;
+    for (int y = rect.y1; y < rect.y2; ++y, src_pixels += srcRowElements) {
+        rowArgs.src = src_pixels;
+        ViewerKernels::rowMinMax(rowArgs, &vmin, &vmax);
     }
 
-    return MinMaxVal(localVmin, localVmax);
-} // findAutoContrastVminVmax_generic
+    return MinMaxVal(vmin, vmax);
+} // findAutoContrastVminVmax
 
-template <int nComps>
+/**
+ * @brief Fills the texture of the RoI like renderFunctor() and returns the extrema of the source on the way.
+ * Only for the display-referred textures, which do not depend on the gain and offset: they are applied by the shader,
+ * so the auto-contrast does not need a separate pass before the fill.
+ * The RoI is filled a few rows at a time, which are still in the CPU cache when their extrema are computed.
+ **/
 MinMaxVal
-findAutoContrastVminVmax_internal(const ImagePtr inputImage,
-                                  DisplayChannelsEnum channels,
-                                  const RectI & rect)
+renderFunctorAndFindVminVmax(const RectI& roi,
+                             const RenderViewerArgs & args,
+                             ViewerInstance* viewer,
+                             UpdateViewerParams::CachedTile tile)
 {
-    return findAutoContrastVminVmax_generic(inputImage, nComps, channels, rect);
+    assert( args.renderOnlyRoI && isViewerTextureDisplayReferred( (ImageBitDepthEnum)args.bitDepth ) );
+
+    // About 64kB of source pixels per chunk
+    const std::size_t srcRowBytes = std::max( (std::size_t)1, roi.width() * args.inputImage->getComponentsCount() * sizeof(float) );
+    const int chunkRows = std::max(1, (int)(65536 / srcRowBytes) );
+    MinMaxVal ret( std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() );
+    for (int y = roi.y1; y < roi.y2; y += chunkRows) {
+        RectI chunk( roi.x1, y, roi.x2, std::min(y + chunkRows, roi.y2) );
+        renderFunctor(chunk, args, viewer, tile);
+        ret.merge( findAutoContrastVminVmax(args.inputImage, args.channels, chunk) );
+    }
+
+    return ret;
 }
 
-MinMaxVal
-findAutoContrastVminVmax(const ImagePtr inputImage,
-                         DisplayChannelsEnum channels,
-                         const RectI & rect)
+void
+setAutoContrastGainAndOffset(const MinMaxVal& vMinMax,
+                             UpdateViewerParams* params)
 {
-    int nComps = inputImage->getComponents().getNumComponents();
+    double vmin = vMinMax.min;
+    double vmax = vMinMax.max;
 
-    if (nComps == 4) {
-        return findAutoContrastVminVmax_internal<4>(inputImage, channels, rect);
-    } else if (nComps == 3) {
-        return findAutoContrastVminVmax_internal<3>(inputImage, channels, rect);
-    } else if (nComps == 1) {
-        return findAutoContrastVminVmax_internal<1>(inputImage, channels, rect);
+    ///if vmax - vmin is greater than 1 the gain will be really small and we won't see
+    ///anything in the image
+    if (vmax == vmin) {
+        vmin = vmax - 1.;
+    }
+
+    if (vmax <= 0) {
+        params->gain = 0;
+        params->offset = 0;
     } else {
-        return findAutoContrastVminVmax_generic(inputImage, nComps, channels, rect);
+        params->gain = 1 / (vmax - vmin);
+        params->offset =  -vmin / (vmax - vmin);
     }
-} // findAutoContrastVminVmax
+}
 
 template <typename PIX, int maxValue, bool opaque, bool applyMatte, int rOffset, int gOffset, int bOffset>
 void
@@ -2525,6 +2523,79 @@ scaleToTexture8bitsForDepth(const RectI& roi,
     }
 }
 
+/**
+ * @brief Returns true if the common case handled by the row kernels of ViewerInstanceKernels.h applies:
+ * float RGBA image in linear colorspace, RGB display without gamma (8-bit only) and a matte taken from the same image.
+ **/
+static bool
+canUseViewerKernels(const RectI& rect,
+                    const RenderViewerArgs & args,
+                    bool texture8bits)
+{
+    if ( (args.inputImage->getBitDepth() != eImageBitDepthFloat) || (args.inputImage->getComponentsCount() != 4) || args.srcColorSpace ) {
+        return false;
+    }
+    if ( (args.channels != eDisplayChannelsRGB) && (args.channels != eDisplayChannelsMatte) ) {
+        return false;
+    }
+    if ( texture8bits && (args.gamma != 1.) ) {
+        return false;
+    }
+    if ( args.matteImage && (args.alphaChannelIndex >= 0) && ( (args.matteImage != args.inputImage) || (args.alphaChannelIndex > 3) ) ) {
+        return false;
+    }
+
+    // The kernels do not handle pixels outside of the image
+    return args.inputImage->getBounds().contains(rect);
+}
+
+static bool
+scaleToTexture8bitsWithKernels(const RectI& roi,
+                               const RenderViewerArgs & args,
+                               const UpdateViewerParams::CachedTile& tile,
+                               U32* tileBuffer)
+{
+    if ( (args.renderOnlyRoI && !tile.rect.contains(roi)) || (!args.renderOnlyRoI && !roi.contains(tile.rect)) ) {
+        return true;
+    }
+    const RectI& rect = args.renderOnlyRoI ? roi : static_cast<const RectI&>(tile.rect);
+    if ( !canUseViewerKernels(rect, args, true) ) {
+        return false;
+    }
+
+    int dstRowElements;
+    U32* dst_pixels;
+    if (args.renderOnlyRoI) {
+        dstRowElements = tile.rect.width();
+        dst_pixels = tileBuffer + (roi.y1 - tile.rect.y1) * dstRowElements + (roi.x1 - tile.rect.x1);
+    } else {
+        dstRowElements = args.tileRowElements;
+        dst_pixels = tileBuffer + (tile.rect.y1 - tile.rectRounded.y1) * args.tileRowElements + (tile.rect.x1 - tile.rectRounded.x1);
+    }
+
+    Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
+    const float* src_pixels = (const float*)acc.pixelAt(rect.x1, rect.y1);
+    assert(src_pixels);
+    const int srcRowElements = (int)args.inputImage->getRowElements();
+
+    ViewerRowTo8BitsArgs rowArgs;
+    rowArgs.width = rect.width();
+    rowArgs.x = rect.x1;
+    rowArgs.gain = (float)args.gain;
+    rowArgs.offset = (float)args.offset;
+    rowArgs.lut = args.colorSpace ? args.colorSpace->getUint8xxTable() : 0;
+    rowArgs.opaque = args.srcPremult == eImagePremultiplicationOpaque;
+    rowArgs.matteChannel = (args.matteImage && args.alphaChannelIndex >= 0) ? args.alphaChannelIndex : -1;
+    for (int y = rect.y1; y < rect.y2; ++y, src_pixels += srcRowElements, dst_pixels += dstRowElements) {
+        rowArgs.src = src_pixels;
+        rowArgs.dst = dst_pixels;
+        rowArgs.y = y;
+        ViewerKernels::rowTo8Bits(rowArgs);
+    }
+
+    return true;
+} // scaleToTexture8bitsWithKernels
+
 void
 scaleToTexture8bits(const RectI& roi,
                     const RenderViewerArgs & args,
@@ -2533,6 +2604,9 @@ scaleToTexture8bits(const RectI& roi,
                     U32* output)
 {
     assert(output);
+    if ( scaleToTexture8bitsWithKernels(roi, args, tile, output) ) {
+        return;
+    }
     switch ( args.inputImage->getBitDepth() ) {
     case eImageBitDepthFloat:
         scaleToTexture8bitsForDepth<float, 1>(roi, args, viewer, tile, output);
@@ -2878,6 +2952,46 @@ scaleToTexture32bitsForPremult(const RectI& roi,
     }
 }
 
+static bool
+scaleToTexture32bitsWithKernels(const RectI& roi,
+                                const RenderViewerArgs & args,
+                                const UpdateViewerParams::CachedTile& tile,
+                                float *tileBuffer)
+{
+    if ( (args.renderOnlyRoI && !tile.rect.contains(roi)) || (!args.renderOnlyRoI && !roi.contains(tile.rect)) ) {
+        return true;
+    }
+    const RectI& rect = args.renderOnlyRoI ? roi : static_cast<const RectI&>(tile.rect);
+    if ( !canUseViewerKernels(rect, args, false) ) {
+        return false;
+    }
+
+    const int dstRowElements = args.renderOnlyRoI ? tile.rect.width() * 4 : args.tileRowElements;
+    float* dst_pixels;
+    if (args.renderOnlyRoI) {
+        dst_pixels = tileBuffer + (roi.y1 - tile.rect.y1) * dstRowElements + (roi.x1 - tile.rect.x1) * 4;
+    } else {
+        dst_pixels = tileBuffer + (tile.rect.y1 - tile.rectRounded.y1) * dstRowElements + (tile.rect.x1 - tile.rectRounded.x1) * 4;
+    }
+
+    Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
+    const float* src_pixels = (const float*)acc.pixelAt(rect.x1, rect.y1);
+    assert(src_pixels);
+    const int srcRowElements = (int)args.inputImage->getRowElements();
+
+    ViewerRowTo32BitsArgs rowArgs;
+    rowArgs.width = rect.width();
+    rowArgs.opaque = args.srcPremult == eImagePremultiplicationOpaque;
+    rowArgs.matteChannel = (args.matteImage && args.alphaChannelIndex >= 0) ? args.alphaChannelIndex : -1;
+    for (int y = rect.y1; y < rect.y2; ++y, src_pixels += srcRowElements, dst_pixels += dstRowElements) {
+        rowArgs.src = src_pixels;
+        rowArgs.dst = dst_pixels;
+        ViewerKernels::rowTo32Bits(rowArgs);
+    }
+
+    return true;
+} // scaleToTexture32bitsWithKernels
+
 void
 scaleToTexture32bits(const RectI& roi,
                      const RenderViewerArgs & args,
@@ -2885,6 +2999,9 @@ scaleToTexture32bits(const RectI& roi,
                      float *output)
 {
     assert(output);
+    if ( scaleToTexture32bitsWithKernels(roi, args, tile, output) ) {
+        return;
+    }
 
     switch ( args.inputImage->getBitDepth() ) {
     case eImageBitDepthFloat:
@@ -2904,6 +3021,47 @@ scaleToTexture32bits(const RectI& roi,
     }
 } // scaleToTexture32bits
 
+void
+scaleToTexture16bits(const RectI& roi,
+                     const RenderViewerArgs & args,
+                     const UpdateViewerParams::CachedTile& tile,
+                     unsigned short *output)
+{
+    assert(output);
+    if ( (args.renderOnlyRoI && !tile.rect.contains(roi)) || (!args.renderOnlyRoI && !roi.contains(tile.rect)) ) {
+        return;
+    }
+    const RectI& rect = args.renderOnlyRoI ? roi : static_cast<const RectI&>(tile.rect);
+    if ( rect.isNull() ) {
+        return;
+    }
+
+    // Render the 32-bit texture of the rectangle only, in a temporary buffer
+    const int rectRowElements = rect.width() * 4;
+    std::vector<float> floatBuffer( (std::size_t)rectRowElements * rect.height() );
+    UpdateViewerParams::CachedTile floatTile;
+    floatTile.rect.set(rect);
+    floatTile.rectRounded = rect;
+    RenderViewerArgs floatArgs = args;
+    floatArgs.bitDepth = eImageBitDepthFloat;
+    floatArgs.renderOnlyRoI = true;
+    floatArgs.tileRowElements = rectRowElements;
+    scaleToTexture32bits(rect, floatArgs, floatTile, &floatBuffer[0]);
+
+    // Convert it to half-float in the tile, same layout as scaleToTexture32bitsGeneric
+    const int dstRowElements = args.renderOnlyRoI ? tile.rect.width() * 4 : args.tileRowElements;
+    unsigned short* dst_pixels;
+    if (args.renderOnlyRoI) {
+        dst_pixels = output + (roi.y1 - tile.rect.y1) * dstRowElements + (roi.x1 - tile.rect.x1) * 4;
+    } else {
+        dst_pixels = output + (tile.rect.y1 - tile.rectRounded.y1) * dstRowElements + (tile.rect.x1 - tile.rectRounded.x1) * 4;
+    }
+    const float* src_pixels = &floatBuffer[0];
+    for (int y = rect.y1; y < rect.y2; ++y, src_pixels += rectRowElements, dst_pixels += dstRowElements) {
+        ViewerKernels::floatToHalf(src_pixels, dst_pixels, rectRowElements);
+    }
+} // scaleToTexture16bits
+
 void
 ViewerInstance::ViewerInstancePrivate::updateViewer(UpdateViewerParamsPtr params)
 {
@@ -2934,7 +3092,57 @@ ViewerInstance::ViewerInstancePrivate::updateViewer(UpdateViewerParamsPtr params
 
         TexturePtr texture;
         bool isFirstTile = true;
-        for (std::list<UpdateViewerParams::CachedTile>::iterator it = params->tiles.begin(); it != params->tiles.end(); ++it) {
+
+        // When painting, if the texture was made from the same buffer, only transfer the area rendered since its last upload
+        RectI dirtyRect;
+        bool uploadPaintDirtyRect = false;
+        if ( !params->isPartialRect && (params->tiles.size() == 1) ) {
+            bool isPaintBuffer = false;
+            {
+                QMutexLocker k(&lastRenderParamsMutex);
+                if (lastRenderParams[params->textureIndex] == params) {
+                    isPaintBuffer = true;
+                    dirtyRect = paintDirtyRect[params->textureIndex];
+                    paintDirtyRect[params->textureIndex].clear();
+                }
+            }
+            uploadPaintDirtyRect = isPaintBuffer && params->updateOnlyPaintDirtyRect && paintTextureUploaded[params->textureIndex] &&
+                                   paintTextureRoI[params->textureIndex] == params->roi &&
+                                   paintTextureDepth[params->textureIndex] == params->depth &&
+                                   paintTextureMipMapLevel[params->textureIndex] == params->mipMapLevel;
+            paintTextureUploaded[params->textureIndex] = isPaintBuffer;
+            paintTextureRoI[params->textureIndex] = params->roi;
+            paintTextureDepth[params->textureIndex] = params->depth;
+            paintTextureMipMapLevel[params->textureIndex] = params->mipMapLevel;
+        } else if (!params->isPartialRect) {
+            paintTextureUploaded[params->textureIndex] = false;
+        }
+
+        if (uploadPaintDirtyRect) {
+            const UpdateViewerParams::CachedTile& tile = params->tiles.front();
+            if ( tile.ramBuffer && dirtyRect.intersect(tile.rectRounded, &dirtyRect) ) {
+                // Gather the rows of the area in a contiguous buffer
+                std::size_t pixelDepth = getSizeOfForBitDepth(params->depth);
+                std::size_t dirtyRowSize = dirtyRect.width() * 4 * pixelDepth;
+                std::size_t tileRowSize = tile.rect.width() * 4 * pixelDepth;
+                std::vector<unsigned char> dirtyBuffer(dirtyRowSize * dirtyRect.height());
+                const unsigned char* srcPixels = getTexPixel(dirtyRect.x1, dirtyRect.y1, tile.rect, pixelDepth, tile.ramBuffer);
+                assert(srcPixels);
+                unsigned char* dstPixels = &dirtyBuffer[0];
+                for (int y = dirtyRect.y1; y < dirtyRect.y2; ++y, srcPixels += tileRowSize, dstPixels += dirtyRowSize) {
+                    std::memcpy(dstPixels, srcPixels, dirtyRowSize);
+                }
+
+                TextureRect texRect;
+                texRect.par = tile.rect.par;
+                texRect.closestPo2 = tile.rect.closestPo2;
+                texRect.set(dirtyRect);
+                // Not the first tile: the texture keeps its size and its content outside of the area
+                uiContext->transferBufferFromRAMtoGPU(&dirtyBuffer[0], dirtyBuffer.size(), params->roi, params->roiNotRoundedToTileSize, texRect, params->textureIndex, false, false, &texture);
+            }
+        }
+
+        for (std::list<UpdateViewerParams::CachedTile>::iterator it = params->tiles.begin(); !uploadPaintDirtyRect && it != params->tiles.end(); ++it) {
             if (!it->ramBuffer) {
                 continue;
             }
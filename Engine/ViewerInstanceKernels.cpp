@@ -0,0 +1,723 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ViewerInstanceKernels.h"
+
+#include <algorithm> // min
+#include <cstring> // memcpy
+#include <cassert>
+#include <limits>
+
+#ifdef NATRON_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// 4x4 Bayer matrix scaled to [0,255], centered like the 0x80 initial error of the error diffusion
+const int kDither4x4[4][4] = {
+    {   8, 136,  40, 168 },
+    { 200,  72, 232, 104 },
+    {  56, 184,  24, 152 },
+    { 248, 120, 216,  88 }
+};
+
+// The last entry of the LUT (a negative NaN) is never read, so that the AVX2 gather reading
+// 32 bits at each entry stays within the table.
+const unsigned int kMaxLutIndex = 0xfffe;
+
+// Same as Color::floatToInt<256>, NaN maps to 0
+inline int
+toByteLinear(float v)
+{
+    if ( !(v > 0.f) ) {
+        return 0;
+    } else if (v >= 1.f) {
+        return 255;
+    }
+
+    return (int)(v * 255.f + 0.5f);
+}
+
+// Same as the hipart() used to index the Lut tables, on any endianness
+inline unsigned int
+lutIndex(float v)
+{
+    unsigned int bits;
+
+    std::memcpy( &bits, &v, sizeof(bits) );
+
+    return std::min(bits >> 16, kMaxLutIndex);
+}
+
+inline U32
+pixelTo8Bits(const float* p,
+             int dither,
+             const ViewerRowTo8BitsArgs& args)
+{
+    float v[4];
+
+    v[0] = p[0] * args.gain + args.offset;
+    v[1] = p[1] * args.gain + args.offset;
+    v[2] = p[2] * args.gain + args.offset;
+    v[3] = args.opaque ? 1.f : p[3];
+
+    int r, g, b;
+    if (args.lut) {
+        r = (args.lut[lutIndex(v[0])] + dither) >> 8;
+        g = (args.lut[lutIndex(v[1])] + dither) >> 8;
+        b = (args.lut[lutIndex(v[2])] + dither) >> 8;
+    } else {
+        r = toByteLinear(v[0]);
+        g = toByteLinear(v[1]);
+        b = toByteLinear(v[2]);
+    }
+    int a = toByteLinear(v[3]);
+
+    if (args.matteChannel >= 0) {
+        float m = v[args.matteChannel];
+        int matteA = args.lut ? ( (args.lut[lutIndex(m)] + 0x80) >> 8 ) / 2 : toByteLinear(m) / 2;
+        r = std::min(r + matteA, 255);
+    }
+
+    return (U32)( (a << 24) | (r << 16) | (g << 8) | b );
+}
+
+void
+rowTo8Bits_scalar(const ViewerRowTo8BitsArgs& args)
+{
+    const int* dither = kDither4x4[args.y & 3];
+
+    for (int i = 0; i < args.width; ++i) {
+        args.dst[i] = pixelTo8Bits(args.src + 4 * i, dither[(args.x + i) & 3], args);
+    }
+}
+
+inline void
+pixelTo32Bits(const float* p,
+              float* dst,
+              const ViewerRowTo32BitsArgs& args)
+{
+    float v[4];
+
+    v[0] = p[0];
+    v[1] = p[1];
+    v[2] = p[2];
+    v[3] = args.opaque ? 1.f : p[3];
+    if (args.matteChannel >= 0) {
+        v[0] += v[args.matteChannel] * 0.5f;
+    }
+    // do not clamp! values may be more than 1 or less than 0
+    dst[0] = v[0];
+    dst[1] = v[1];
+    dst[2] = v[2];
+    dst[3] = v[3];
+}
+
+void
+rowTo32Bits_scalar(const ViewerRowTo32BitsArgs& args)
+{
+    for (int i = 0; i < args.width; ++i) {
+        pixelTo32Bits(args.src + 4 * i, args.dst + 4 * i, args);
+    }
+}
+
+// Round-to-nearest-even, NaNs keep their sign and the high bits of their payload: same as the F16C instructions
+inline unsigned short
+toHalf(float v)
+{
+    U32 bits;
+
+    std::memcpy( &bits, &v, sizeof(bits) );
+
+    U32 sign = (bits >> 16) & 0x8000;
+    U32 absBits = bits & 0x7fffffff;
+    if (absBits >= 0x7f800000) {
+        // infinity or NaN
+        return (unsigned short)( sign | 0x7c00 | ( (absBits > 0x7f800000) ? ( 0x200 | ( (absBits >> 13) & 0x3ff ) ) : 0 ) );
+    } else if (absBits >= 0x477ff000) {
+        // 65520 and above round to infinity
+        return (unsigned short)(sign | 0x7c00);
+    } else if (absBits < 0x38800000) {
+        // below the smallest normal half (2^-14): the mantissa is rounded by shifting it to its denormal position
+        if (absBits < 0x33000000) {
+            // below half of the smallest denormal half (2^-25), also rounds 2^-25 to 0 (even)
+            return (unsigned short)sign;
+        }
+        int exponent = absBits >> 23;
+        U32 mantissa = (absBits & 0x7fffff) | 0x800000;
+        int shift = 126 - exponent; // in [14,24]
+        U32 half = mantissa >> shift;
+        U32 remainder = mantissa & ( (1u << shift) - 1 );
+        U32 halfway = 1u << (shift - 1);
+        if ( (remainder > halfway) || ( (remainder == halfway) && (half & 1) ) ) {
+            ++half;
+        }
+
+        return (unsigned short)(sign | half);
+    }
+
+    // normal half: rebias the exponent, the carry of the rounding may increment the exponent
+    absBits += ( (U32)(15 - 127) << 23 ) + 0xfff + ( (absBits >> 13) & 1 );
+
+    return (unsigned short)( sign | (absBits >> 13) );
+}
+
+void
+floatToHalf_scalar(const float* src,
+                   unsigned short* dst,
+                   int count)
+{
+    for (int i = 0; i < count; ++i) {
+        dst[i] = toHalf(src[i]);
+    }
+}
+
+// Same as findAutoContrastVminVmax_generic for the components missing in the source
+inline void
+loadRGBA(const float* p,
+         int nComps,
+         float* rgba)
+{
+    switch (nComps) {
+    case 4:
+        rgba[0] = p[0];
+        rgba[1] = p[1];
+        rgba[2] = p[2];
+        rgba[3] = p[3];
+        break;
+    case 3:
+        rgba[0] = p[0];
+        rgba[1] = p[1];
+        rgba[2] = p[2];
+        rgba[3] = 1.f;
+        break;
+    case 2:
+        rgba[0] = p[0];
+        rgba[1] = p[1];
+        rgba[2] = 0.f;
+        rgba[3] = 1.f;
+        break;
+    case 1:
+        rgba[0] = rgba[1] = rgba[2] = 0.f;
+        rgba[3] = p[0];
+        break;
+    default:
+        rgba[0] = rgba[1] = rgba[2] = rgba[3] = 0.f;
+        break;
+    }
+}
+
+// Rec.601 luma, in the same order of operations as the vectorized kernels
+inline float
+luminance(float r,
+          float g,
+          float b)
+{
+    return (r * 0.299f + g * 0.587f) + b * 0.114f;
+}
+
+inline void
+accumulateMinMax(float v,
+                 float* vmin,
+                 float* vmax)
+{
+    // false for NaN
+    if (v < *vmin) {
+        *vmin = v;
+    }
+    if (v > *vmax) {
+        *vmax = v;
+    }
+}
+
+void
+rowMinMax_scalar(const ViewerRowMinMaxArgs& args,
+                 float* vmin,
+                 float* vmax)
+{
+    for (int i = 0; i < args.width; ++i) {
+        float rgba[4];
+        loadRGBA(args.src + i * args.nComps, args.nComps, rgba);
+        switch (args.channels) {
+        case eDisplayChannelsRGB:
+            accumulateMinMax(rgba[0], vmin, vmax);
+            accumulateMinMax(rgba[1], vmin, vmax);
+            accumulateMinMax(rgba[2], vmin, vmax);
+            break;
+        case eDisplayChannelsR:
+            accumulateMinMax(rgba[0], vmin, vmax);
+            break;
+        case eDisplayChannelsG:
+            accumulateMinMax(rgba[1], vmin, vmax);
+            break;
+        case eDisplayChannelsB:
+            accumulateMinMax(rgba[2], vmin, vmax);
+            break;
+        case eDisplayChannelsA:
+            accumulateMinMax(rgba[3], vmin, vmax);
+            break;
+        case eDisplayChannelsY:
+            accumulateMinMax(luminance(rgba[0], rgba[1], rgba[2]), vmin, vmax);
+            break;
+        default:
+            accumulateMinMax(0.f, vmin, vmax);
+            break;
+        }
+    }
+}
+
+// Returns -1 if the value is out of the histogram range or NaN
+inline int
+histogramBin(float v,
+             const ViewerRowHistogramArgs& args)
+{
+    float f = (v - args.vmin) * args.scale;
+
+    if ( (f >= 0.f) && ( f < (float)args.binsCount ) ) {
+        return (int)f;
+    }
+
+    return -1;
+}
+
+inline void
+addToHistograms(const float* rgba,
+                const ViewerRowHistogramArgs& args)
+{
+    for (int k = 0; k < args.histogramsCount; ++k) {
+        int c = args.channels[k];
+        int bin = histogramBin(c == 4 ? luminance(rgba[0], rgba[1], rgba[2]) : rgba[c], args);
+        if (bin >= 0) {
+            ++args.histograms[k][bin];
+        }
+    }
+}
+
+void
+rowHistogram_scalar(const ViewerRowHistogramArgs& args)
+{
+    for (int i = 0; i < args.width; ++i) {
+        float rgba[4];
+        loadRGBA(args.src + i * args.nComps, args.nComps, rgba);
+        addToHistograms(rgba, args);
+    }
+}
+
+#ifdef NATRON_KERNELS_X86
+
+// One pixel per register
+NATRON_TARGET_SSE41
+void
+rowTo8Bits_SSE41(const ViewerRowTo8BitsArgs& args)
+{
+    const __m128 gain = _mm_setr_ps(args.gain, args.gain, args.gain, 1.f);
+    const __m128 offset = _mm_setr_ps(args.offset, args.offset, args.offset, 0.f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 scale = _mm_set1_ps(255.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i maxIndex = _mm_set1_epi32(kMaxLutIndex);
+    // int32 R,G,B,A -> bytes B,G,R,A
+    const __m128i toBGRA = _mm_setr_epi8(8, 4, 0, 12, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128);
+    const int* dither = kDither4x4[args.y & 3];
+
+    for (int i = 0; i < args.width; ++i) {
+        __m128 v = _mm_add_ps( _mm_mul_ps(_mm_loadu_ps(args.src + 4 * i), gain), offset );
+        if (args.opaque) {
+            v = _mm_blend_ps(v, one, 0x8);
+        }
+        // _mm_max_ps returns its second operand if the first is NaN, hence NaN maps to 0 as in toByteLinear()
+        __m128i lin = _mm_cvttps_epi32( _mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(v, zero), one), scale), half) );
+        __m128i q = lin;
+        __m128i h = _mm_setzero_si128();
+        if (args.lut) {
+            h = _mm_min_epi32(_mm_srli_epi32(_mm_castps_si128(v), 16), maxIndex);
+            __m128i l = _mm_setr_epi32(args.lut[_mm_extract_epi32(h, 0)], args.lut[_mm_extract_epi32(h, 1)], args.lut[_mm_extract_epi32(h, 2)], 0);
+            l = _mm_srli_epi32(_mm_add_epi32( l, _mm_set1_epi32(dither[(args.x + i) & 3]) ), 8);
+            // keep the linear alpha
+            q = _mm_blend_epi16(l, lin, 0xC0);
+        }
+        if (args.matteChannel >= 0) {
+            int linValues[4], indices[4];
+            _mm_storeu_si128( (__m128i*)linValues, lin );
+            _mm_storeu_si128( (__m128i*)indices, h );
+            int matteA = args.lut ? ( (args.lut[indices[args.matteChannel]] + 0x80) >> 8 ) / 2 : linValues[args.matteChannel] / 2;
+            q = _mm_insert_epi32(q, std::min(_mm_extract_epi32(q, 0) + matteA, 255), 0);
+        }
+        args.dst[i] = (U32)_mm_cvtsi128_si32( _mm_shuffle_epi8(q, toBGRA) );
+    }
+} // rowTo8Bits_SSE41
+
+// Two pixels per register, the LUT lookups are gathered
+NATRON_TARGET_AVX2
+void
+rowTo8Bits_AVX2(const ViewerRowTo8BitsArgs& args)
+{
+    const __m256 gain = _mm256_setr_ps(args.gain, args.gain, args.gain, 1.f, args.gain, args.gain, args.gain, 1.f);
+    const __m256 offset = _mm256_setr_ps(args.offset, args.offset, args.offset, 0.f, args.offset, args.offset, args.offset, 0.f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256 scale = _mm256_set1_ps(255.f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i maxIndex = _mm256_set1_epi32(kMaxLutIndex);
+    const __m256i lowMask = _mm256_set1_epi32(0xffff);
+    const __m256i maxByte = _mm256_set1_epi32(255);
+    const __m256i toBGRA = _mm256_setr_epi8(8, 4, 0, 12, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128,
+                                            8, 4, 0, 12, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128);
+    const int* dither = kDither4x4[args.y & 3];
+    int i = 0;
+
+    for (; i + 2 <= args.width; i += 2) {
+        __m256 v = _mm256_add_ps( _mm256_mul_ps(_mm256_loadu_ps(args.src + 4 * i), gain), offset );
+        if (args.opaque) {
+            v = _mm256_blend_ps(v, one, 0x88);
+        }
+        __m256i lin = _mm256_cvttps_epi32( _mm256_add_ps(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(v, zero), one), scale), half) );
+        __m256i q = lin;
+        __m256i h = _mm256_setzero_si256();
+        if (args.lut) {
+            h = _mm256_min_epi32(_mm256_srli_epi32(_mm256_castps_si256(v), 16), maxIndex);
+            // Reads 32 bits at each unsigned short entry, the high half belongs to the next entry
+            __m256i l = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(args.lut), h, 2), lowMask);
+            int d0 = dither[(args.x + i) & 3];
+            int d1 = dither[(args.x + i + 1) & 3];
+            l = _mm256_srli_epi32(_mm256_add_epi32( l, _mm256_setr_epi32(d0, d0, d0, 0, d1, d1, d1, 0) ), 8);
+            q = _mm256_blend_epi32(l, lin, 0x88);
+        }
+        if (args.matteChannel >= 0) {
+            int linValues[8], indices[8];
+            _mm256_storeu_si256( (__m256i*)linValues, lin );
+            _mm256_storeu_si256( (__m256i*)indices, h );
+            int matteA[2];
+            for (int p = 0; p < 2; ++p) {
+                int c = p * 4 + args.matteChannel;
+                matteA[p] = args.lut ? ( (args.lut[indices[c]] + 0x80) >> 8 ) / 2 : linValues[c] / 2;
+            }
+            q = _mm256_min_epi32(_mm256_add_epi32( q, _mm256_setr_epi32(matteA[0], 0, 0, 0, matteA[1], 0, 0, 0) ), maxByte);
+        }
+        __m256i packed = _mm256_shuffle_epi8(q, toBGRA);
+        args.dst[i] = (U32)_mm_cvtsi128_si32( _mm256_castsi256_si128(packed) );
+        args.dst[i + 1] = (U32)_mm_cvtsi128_si32( _mm256_extracti128_si256(packed, 1) );
+    }
+    for (; i < args.width; ++i) {
+        args.dst[i] = pixelTo8Bits(args.src + 4 * i, dither[(args.x + i) & 3], args);
+    }
+} // rowTo8Bits_AVX2
+
+NATRON_TARGET_SSE41
+void
+rowTo32Bits_SSE41(const ViewerRowTo32BitsArgs& args)
+{
+    const __m128 one = _mm_set1_ps(1.f);
+
+    for (int i = 0; i < args.width; ++i) {
+        __m128 v = _mm_loadu_ps(args.src + 4 * i);
+        if (args.opaque) {
+            v = _mm_blend_ps(v, one, 0x8);
+        }
+        if (args.matteChannel >= 0) {
+            float values[4];
+            _mm_storeu_ps(values, v);
+            // only the red channel is modified
+            v = _mm_add_ss( v, _mm_set_ss(values[args.matteChannel] * 0.5f) );
+        }
+        _mm_storeu_ps(args.dst + 4 * i, v);
+    }
+}
+
+NATRON_TARGET_SSE41
+void
+reduceMinMax(__m128 minimum,
+             __m128 maximum,
+             int firstLane,
+             int lastLane,
+             float* vmin,
+             float* vmax)
+{
+    float minValues[4], maxValues[4];
+
+    _mm_storeu_ps(minValues, minimum);
+    _mm_storeu_ps(maxValues, maximum);
+    for (int c = firstLane; c <= lastLane; ++c) {
+        *vmin = std::min(*vmin, minValues[c]);
+        *vmax = std::max(*vmax, maxValues[c]);
+    }
+}
+
+// Four pixels at a time for the luminance, otherwise one pixel per register
+NATRON_TARGET_SSE41
+void
+rowMinMax_SSE41(const ViewerRowMinMaxArgs& args,
+                float* vmin,
+                float* vmax)
+{
+    if ( (args.nComps != 4) || (args.channels == eDisplayChannelsMatte) ) {
+        rowMinMax_scalar(args, vmin, vmax);
+
+        return;
+    }
+
+    // _mm_min_ps and _mm_max_ps return their second operand if the first is NaN: NaNs are ignored
+    __m128 minimum = _mm_set1_ps( std::numeric_limits<float>::infinity() );
+    __m128 maximum = _mm_set1_ps( -std::numeric_limits<float>::infinity() );
+    const float* src = args.src;
+    int i = 0;
+    if (args.channels == eDisplayChannelsY) {
+        const __m128 cr = _mm_set1_ps(0.299f);
+        const __m128 cg = _mm_set1_ps(0.587f);
+        const __m128 cb = _mm_set1_ps(0.114f);
+        for (; i + 4 <= args.width; i += 4, src += 16) {
+            __m128 r = _mm_loadu_ps(src);
+            __m128 g = _mm_loadu_ps(src + 4);
+            __m128 b = _mm_loadu_ps(src + 8);
+            __m128 a = _mm_loadu_ps(src + 12);
+            _MM_TRANSPOSE4_PS(r, g, b, a);
+            __m128 y = _mm_add_ps( _mm_add_ps( _mm_mul_ps(r, cr), _mm_mul_ps(g, cg) ), _mm_mul_ps(b, cb) );
+            minimum = _mm_min_ps(y, minimum);
+            maximum = _mm_max_ps(y, maximum);
+        }
+        reduceMinMax(minimum, maximum, 0, 3, vmin, vmax);
+    } else {
+        for (; i < args.width; ++i, src += 4) {
+            __m128 v = _mm_loadu_ps(src);
+            minimum = _mm_min_ps(v, minimum);
+            maximum = _mm_max_ps(v, maximum);
+        }
+        int firstChannel = (args.channels == eDisplayChannelsRGB) ? 0 : (int)args.channels - (int)eDisplayChannelsR;
+        int lastChannel = (args.channels == eDisplayChannelsRGB) ? 2 : firstChannel;
+        reduceMinMax(minimum, maximum, firstChannel, lastChannel, vmin, vmax);
+    }
+
+    ViewerRowMinMaxArgs tail = args;
+    tail.src = src;
+    tail.width = args.width - i;
+    rowMinMax_scalar(tail, vmin, vmax);
+} // rowMinMax_SSE41
+
+// The bins of the 4 channels of a pixel are computed at once, the counters are incremented one by one
+NATRON_TARGET_SSE41
+void
+rowHistogram_SSE41(const ViewerRowHistogramArgs& args)
+{
+    if (args.nComps != 4) {
+        rowHistogram_scalar(args);
+
+        return;
+    }
+
+    const __m128 vmin = _mm_set1_ps(args.vmin);
+    const __m128 scale = _mm_set1_ps(args.scale);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 binsCount = _mm_set1_ps( (float)args.binsCount );
+    const float* src = args.src;
+    for (int i = 0; i < args.width; ++i, src += 4) {
+        __m128 f = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(src), vmin), scale);
+        // false for NaN, as in histogramBin()
+        int inRange = _mm_movemask_ps( _mm_and_ps( _mm_cmpge_ps(f, zero), _mm_cmplt_ps(f, binsCount) ) );
+        // clamped so that the conversion of the values out of range does not raise FE_INVALID, NaN maps to 0
+        int bins[4];
+        _mm_storeu_si128( (__m128i*)bins, _mm_cvttps_epi32( _mm_min_ps(_mm_max_ps(f, zero), binsCount) ) );
+        for (int k = 0; k < args.histogramsCount; ++k) {
+            int c = args.channels[k];
+            if (c == 4) {
+                int bin = histogramBin(luminance(src[0], src[1], src[2]), args);
+                if (bin >= 0) {
+                    ++args.histograms[k][bin];
+                }
+            } else if ( inRange & (1 << c) ) {
+                ++args.histograms[k][bins[c]];
+            }
+        }
+    }
+}
+
+// Two pixels per instruction
+NATRON_TARGET_F16C
+void
+floatToHalf_F16C(const float* src,
+                 unsigned short* dst,
+                 int count)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128( (__m128i*)(dst + i), h );
+    }
+    for (; i < count; ++i) {
+        dst[i] = toHalf(src[i]);
+    }
+}
+
+#endif // NATRON_KERNELS_X86
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+namespace ViewerKernels {
+
+KernelsISAEnum
+getSupportedISA()
+{
+    return getSupportedKernelsISA();
+}
+
+void
+rowTo8Bits(const ViewerRowTo8BitsArgs& args,
+           KernelsISAEnum isa)
+{
+    assert(isa <= getSupportedISA());
+    switch (isa) {
+#ifdef NATRON_KERNELS_X86
+    case eKernelsISAAVX2:
+        rowTo8Bits_AVX2(args);
+        break;
+    case eKernelsISASSE41:
+        rowTo8Bits_SSE41(args);
+        break;
+#endif
+    default:
+        rowTo8Bits_scalar(args);
+        break;
+    }
+}
+
+void
+rowTo32Bits(const ViewerRowTo32BitsArgs& args,
+            KernelsISAEnum isa)
+{
+    assert(isa <= getSupportedISA());
+    switch (isa) {
+#ifdef NATRON_KERNELS_X86
+    case eKernelsISAAVX2:
+    case eKernelsISASSE41:
+        // Copying 4 floats per pixel does not benefit from wider registers
+        rowTo32Bits_SSE41(args);
+        break;
+#endif
+    default:
+        rowTo32Bits_scalar(args);
+        break;
+    }
+}
+
+void
+floatToHalf(const float* src,
+            unsigned short* dst,
+            int count,
+            KernelsISAEnum isa)
+{
+    assert(isa <= getSupportedISA());
+    switch (isa) {
+#ifdef NATRON_KERNELS_X86
+    case eKernelsISAAVX2:
+        floatToHalf_F16C(src, dst, count);
+        break;
+#endif
+    default:
+        floatToHalf_scalar(src, dst, count);
+        break;
+    }
+}
+
+void
+rowMinMax(const ViewerRowMinMaxArgs& args,
+          float* vmin,
+          float* vmax,
+          KernelsISAEnum isa)
+{
+    assert(isa <= getSupportedISA());
+    switch (isa) {
+#ifdef NATRON_KERNELS_X86
+    case eKernelsISAAVX2:
+    case eKernelsISASSE41:
+        // The scan is bound by the memory bandwidth: wider registers do not help
+        rowMinMax_SSE41(args, vmin, vmax);
+        break;
+#endif
+    default:
+        rowMinMax_scalar(args, vmin, vmax);
+        break;
+    }
+}
+
+void
+rowHistogram(const ViewerRowHistogramArgs& args,
+             KernelsISAEnum isa)
+{
+    assert(isa <= getSupportedISA());
+    switch (isa) {
+#ifdef NATRON_KERNELS_X86
+    case eKernelsISAAVX2:
+    case eKernelsISASSE41:
+        // The counters are incremented one at a time anyway
+        rowHistogram_SSE41(args);
+        break;
+#endif
+    default:
+        rowHistogram_scalar(args);
+        break;
+    }
+}
+
+void
+rowTo8Bits(const ViewerRowTo8BitsArgs& args)
+{
+    rowTo8Bits( args, getSupportedISA() );
+}
+
+void
+rowTo32Bits(const ViewerRowTo32BitsArgs& args)
+{
+    rowTo32Bits( args, getSupportedISA() );
+}
+
+void
+floatToHalf(const float* src,
+            unsigned short* dst,
+            int count)
+{
+    floatToHalf( src, dst, count, getSupportedISA() );
+}
+
+void
+rowMinMax(const ViewerRowMinMaxArgs& args,
+          float* vmin,
+          float* vmax)
+{
+    rowMinMax( args, vmin, vmax, getSupportedISA() );
+}
+
+void
+rowHistogram(const ViewerRowHistogramArgs& args)
+{
+    rowHistogram( args, getSupportedISA() );
+}
+
+} // namespace ViewerKernels
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,144 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_ViewerInstanceKernels_h
+#define Natron_Engine_ViewerInstanceKernels_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+#include "Engine/KernelsISA.h"
+
+NATRON_NAMESPACE_ENTER
+
+/*
+   Row kernels filling the viewer textures from float RGBA images.
+
+   They cover the common case of the viewer: a float RGBA image in linear colorspace,
+   displayed with its RGB channels, no gamma, an optional sRGB/Rec709 output LUT and an
+   optional matte overlay taken from the same image.
+   All other cases go through the generic templated code in ViewerInstance.cpp.
+
+   The vectorized variants produce exactly the same output as the scalar ones: they are
+   selected at runtime depending on the instruction sets supported by the CPU.
+   The 8-bit output uses a 4x4 ordered dither, which stays within 1 LSB of the error-diffused
+   output of the generic code.
+   The half-float textures are made from the 32-bit output, converted with round-to-nearest-even.
+
+   The same file holds the row kernels scanning the viewer images for the auto-contrast and the
+   histograms. They read float images with any number of components, the missing components
+   are taken as in the generic code (0 for the colors, 1 for the alpha of RGB images), and only
+   RGBA images are vectorized. NaNs are ignored.
+ */
+
+struct ViewerRowTo8BitsArgs
+{
+    const float* src; // RGBA pixels
+    U32* dst; // BGRA pixels
+    int width;
+    int x, y; // coordinates of the first pixel, used to index the dither matrix
+    float gain, offset;
+    const unsigned short* lut; // Color::Lut::getUint8xxTable() or NULL for linear output
+    bool opaque;
+    int matteChannel; // channel of the source used as matte overlay, or -1
+};
+
+struct ViewerRowTo32BitsArgs
+{
+    const float* src; // RGBA pixels
+    float* dst; // RGBA pixels
+    int width;
+    bool opaque;
+    int matteChannel; // channel of the source used as matte overlay, or -1
+};
+
+struct ViewerRowMinMaxArgs
+{
+    const float* src;
+    int width;
+    int nComps;
+    DisplayChannelsEnum channels; // the matte channels count as 0
+};
+
+struct ViewerRowHistogramArgs
+{
+    const float* src;
+    int width;
+    int nComps;
+    float vmin;
+    float scale; // a value v falls in the bin (int)( (v - vmin) * scale ), if in [0, binsCount)
+    int binsCount;
+    int histogramsCount; // 1 to 3
+    int channels[3]; // channel counted in each histogram: 0 to 3 for R,G,B,A, 4 for the luminance
+    unsigned int* histograms[3]; // binsCount counters each
+};
+
+namespace ViewerKernels {
+
+/**
+ * @brief Returns getSupportedKernelsISA(): the viewer has kernels for all the instruction sets.
+ **/
+KernelsISAEnum getSupportedISA();
+
+/**
+ * @brief Fill a row of the 8-bit texture with the best kernel supported by the CPU.
+ **/
+void rowTo8Bits(const ViewerRowTo8BitsArgs& args);
+
+/**
+ * @brief Fill a row of the 32-bit texture with the best kernel supported by the CPU.
+ **/
+void rowTo32Bits(const ViewerRowTo32BitsArgs& args);
+
+/**
+ * @brief Convert count floats to IEEE half-floats, as uploaded to GL_HALF_FLOAT textures.
+ **/
+void floatToHalf(const float* src, unsigned short* dst, int count);
+
+/**
+ * @brief Lowers vmin and raises vmax to the extrema of the displayed channels of a row.
+ **/
+void rowMinMax(const ViewerRowMinMaxArgs& args, float* vmin, float* vmax);
+
+/**
+ * @brief Adds the pixels of a row to the histograms.
+ **/
+void rowHistogram(const ViewerRowHistogramArgs& args);
+
+/**
+ * @brief Same as above with an explicit instruction set, which must be supported.
+ **/
+void rowTo8Bits(const ViewerRowTo8BitsArgs& args, KernelsISAEnum isa);
+void rowTo32Bits(const ViewerRowTo32BitsArgs& args, KernelsISAEnum isa);
+void floatToHalf(const float* src, unsigned short* dst, int count, KernelsISAEnum isa);
+void rowMinMax(const ViewerRowMinMaxArgs& args, float* vmin, float* vmax, KernelsISAEnum isa);
+void rowHistogram(const ViewerRowHistogramArgs& args, KernelsISAEnum isa);
+
+} // namespace ViewerKernels
+
+NATRON_NAMESPACE_EXIT
+
+#endif // Natron_Engine_ViewerInstanceKernels_h
@@ -147,6 +147,7 @@ public:
         , gammaLookup()
         , lastRenderParamsMutex()
         , lastRenderParams()
+        , paintDirtyRect()
         , partialUpdateRects()
         , viewportCenter()
         , viewportCenterSet(false)
@@ -161,6 +162,9 @@ public:
             displayAge[i] = 0;
             isViewerPaused[i] = false;
             viewerParamsChannels[i] = eDisplayChannelsRGB;
+            paintTextureUploaded[i] = false;
+            paintTextureDepth[i] = eImageBitDepthNone;
+            paintTextureMipMapLevel[i] = 0;
         }
     }
 
@@ -402,6 +406,16 @@ public:
     mutable QMutex lastRenderParamsMutex;
     UpdateViewerParamsPtr lastRenderParams[2];
 
+    // The area of the paint buffer of lastRenderParams rendered since it was last uploaded to the texture, protected by lastRenderParamsMutex
+    RectI paintDirtyRect[2];
+
+    // Only accessed from MT: the RoI, bit depth and mipmap level of the last paint buffer uploaded to each texture, if it was not
+    // replaced since by another image
+    bool paintTextureUploaded[2];
+    RectI paintTextureRoI[2];
+    ImageBitDepthEnum paintTextureDepth[2];
+    unsigned int paintTextureMipMapLevel[2];
+
     /*
      * @brief If this list is not empty, this is the list of canonical rectangles we should update on the viewer, completely
      * disregarding the RoI. This is protected by viewerParamsMutex
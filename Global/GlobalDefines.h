@@ -107,9 +107,17 @@ typedef OfxRangeD RangeD;
 #define kBgProcessServerCreatedShort "--bg_server_created"
 
 //Increment this to wipe all disk cache structure and ensure that the user has a clean cache when starting the next version of Natron
+//The keys stored in the cache depend on the Hash64 algorithm: the legacy CRC64 build (NATRON_HASH64_CRC) keeps reading version 4 caches
+#ifdef NATRON_HASH64_CRC
 #define NATRON_CACHE_VERSION 4
+#else
+#define NATRON_CACHE_VERSION 5
+#endif
 #define kNatronCacheVersionSettingsKey "NatronCacheVersionSettingsKey"
 
+//Upper bound of the number of shards (each with its own lock and LRU list) the entries of a cache can be split into
+#define NATRON_CACHE_MAX_SHARDS 256
+
 
 #define kNodeGraphObjectName "nodeGraph"
 #define kCurveEditorObjectName "curveEditor"
@@ -235,6 +235,17 @@ CurveGui::nextPointForSegment(const double x, // < in curve coordinates
 
 } // nextPointForSegment
 
+void
+CurveGui::evaluateSamples(bool useExpr,
+                          const std::vector<double>& x,
+                          std::vector<double>* y) const
+{
+    y->resize( x.size() );
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        (*y)[i] = evaluate(useExpr, x[i]);
+    }
+}
+
 Curve::YRange
 CurveGui::getCurveYRange() const
 {
@@ -344,27 +355,42 @@ CurveGui::drawCurve(int curveIndex,
             KeyFrame x1Key;
             KeyFrameSet::const_iterator lastUpperIt = keyframes.end();
 
+            // Collect the points first so that the curve is evaluated in a single call
+            std::vector<double> xs, ys;
+            std::vector<std::size_t> evaluatedPoints;
             while ( x1 < (widgetWidth - 1) ) {
-                double x, y;
+                double x, y = 0.;
                 if (!isX1AKey) {
                     x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                    y = evaluate(false, x);
+                    evaluatedPoints.push_back( xs.size() );
                 } else {
                     x = x1Key.getTime();
                     y = x1Key.getValue();
                 }
 
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
+                xs.push_back(x);
+                ys.push_back(y);
                 nextPointForSegment(x, keyframes, isPeriodic, parametricRange.first, parametricRange.second,  &lastUpperIt, &x2, &x1Key, &isX1AKey);
                 x1 = x2;
             }
             //also add the last point
-            {
-                double x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                double y = evaluate(false, x);
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
+            evaluatedPoints.push_back( xs.size() );
+            xs.push_back( _curveWidget->toZoomCoordinates(x1, 0).x() );
+            ys.push_back(0.);
+
+            std::vector<double> evaluatedXs( evaluatedPoints.size() ), evaluatedYs;
+            for (std::size_t i = 0; i < evaluatedPoints.size(); ++i) {
+                evaluatedXs[i] = xs[evaluatedPoints[i]];
+            }
+            evaluateSamples(false, evaluatedXs, &evaluatedYs);
+            for (std::size_t i = 0; i < evaluatedPoints.size(); ++i) {
+                ys[evaluatedPoints[i]] = evaluatedYs[i];
+            }
+
+            vertices.reserve( 2 * xs.size() );
+            for (std::size_t i = 0; i < xs.size(); ++i) {
+                vertices.push_back( (float)xs[i] );
+                vertices.push_back( (float)ys[i] );
             }
         } catch (...) {
         }
@@ -676,6 +702,30 @@ KnobCurveGui::evaluate(bool useExpr,
     }
 }
 
+void
+KnobCurveGui::evaluateSamples(bool useExpr,
+                              const std::vector<double>& x,
+                              std::vector<double>* y) const
+{
+    KnobIPtr knob = getInternalKnob();
+
+    y->resize( x.size() );
+    if ( x.empty() ) {
+        return;
+    }
+
+    KnobParametric* isParametric = dynamic_cast<KnobParametric*>( knob.get() );
+    if (isParametric) {
+        isParametric->getParametricCurve(_dimension)->getValuesAt(&x[0], &(*y)[0], (int)x.size(), false);
+    } else if (useExpr) {
+        CurveGui::evaluateSamples(useExpr, x, y);
+    } else {
+        assert(_internalCurve);
+
+        _internalCurve->getValuesAt(&x[0], &(*y)[0], (int)x.size(), false);
+    }
+}
+
 CurvePtr
 KnobCurveGui::getInternalCurve() const
 {
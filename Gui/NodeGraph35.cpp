@@ -40,6 +40,7 @@ CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
 #include "Engine/KnobSerialization.h" // createDefaultValueForParam
+#include "Engine/MemoryInfo.h" // getBufferPoolRAM
 #include "Engine/Node.h"
 #include "Engine/Project.h"
 #include "Engine/Settings.h"
@@ -261,9 +262,12 @@ NodeGraph::updateCacheSizeText()
     QString oldText = _imp->_cacheSizeText->text();
     quint64 cacheSize = appPTR->getCachesTotalMemorySize();
     QString cacheSizeStr = QDirModelPrivate_size(cacheSize);
+    std::size_t poolUsedSize, poolIdleSize;
+    getBufferPoolRAM(&poolUsedSize, &poolIdleSize);
+    QString poolIdleSizeStr = QDirModelPrivate_size(poolIdleSize);
     quint64 diskSize = appPTR->getCachesTotalDiskSize();
     QString diskCacheSizeStr = QDirModelPrivate_size(diskSize);
-    QString newText = tr("Memory cache: %1 / Disk cache: %2").arg(cacheSizeStr).arg(diskCacheSizeStr);
+    QString newText = tr("Memory cache: %1 (%2 kept for reuse) / Disk cache: %3").arg(cacheSizeStr).arg(poolIdleSizeStr).arg(diskCacheSizeStr);
     if (newText != oldText) {
         _imp->_cacheSizeText->setText(newText);
     }
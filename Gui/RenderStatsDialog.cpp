@@ -65,8 +65,9 @@
 #define COL_NB_CACHE_HIT 13
 #define COL_NB_CACHE_HIT_DOWNSCALED 14
 #define COL_NB_CACHE_MISS 15
+#define COL_EXPRESSIONS_TIME 16
 
-#define NUM_COLS 16
+#define NUM_COLS 17
 
 NATRON_NAMESPACE_ENTER
 
@@ -77,6 +78,8 @@ enum ItemsRoleEnum
     eItemsRoleIdentityTilesInfo = 102,
     eItemsRoleRenderedTilesNb = 103,
     eItemsRoleRenderedTilesInfo = 104,
+    eItemsRoleExpressionsTime = 105,
+    eItemsRoleExpressionsNb = 106,
 };
 
 struct RowInfo
@@ -111,6 +114,9 @@ struct StatRowsCompare
         case COL_TIME:
 
             return lhs.item->data( (int)eItemsRoleTime ).toDouble() < rhs.item->data( (int)eItemsRoleTime ).toDouble();
+        case COL_EXPRESSIONS_TIME:
+
+            return lhs.item->data( (int)eItemsRoleExpressionsTime ).toDouble() < rhs.item->data( (int)eItemsRoleExpressionsTime ).toDouble();
         default:
 
             return lhs.item->text() < rhs.item->text();
@@ -646,6 +652,43 @@ public:
                 }
             }
         }
+        {
+            TableItem* item = 0;
+            double timeSoFar = 0.;
+            int nbSoFar = 0;
+            if (exists) {
+                item = view->item(row, COL_EXPRESSIONS_TIME);
+                if (item) {
+                    timeSoFar = item->data( (int)eItemsRoleExpressionsTime ).toDouble();
+                    nbSoFar = item->data( (int)eItemsRoleExpressionsNb ).toInt();
+                }
+            } else {
+                item = new TableItem;
+                QString tt = NATRON_NAMESPACE::convertFromPlainText(tr("The time spent evaluating the expressions of the parameters of this node across all threads, "
+                                                                       "and the number of evaluations."), NATRON_NAMESPACE::WhiteSpaceNormal);
+                item->setToolTip(tt);
+                item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            }
+            assert(item);
+            if (item) {
+                int nbEvaluations;
+                double timeSpent;
+                stats.getExpressionsInfos(&nbEvaluations, &timeSpent);
+                timeSoFar += timeSpent;
+                nbSoFar += nbEvaluations;
+
+                if (nodeUi) {
+                    item->setTextColor(Qt::black);
+                    item->setBackgroundColor(c);
+                }
+                item->setData( (int)eItemsRoleExpressionsTime, timeSoFar );
+                item->setData( (int)eItemsRoleExpressionsNb, nbSoFar );
+                item->setText( QString::fromUtf8("%1 (%2)").arg( Timer::printAsTime(timeSoFar, false) ).arg(nbSoFar) );
+                if (!exists) {
+                    view->setItem(row, COL_EXPRESSIONS_TIME, item);
+                }
+            }
+        }
         if (!exists) {
             rows.push_back(node);
         }
@@ -891,7 +934,8 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
         << tr("Rendered Planes")
         << tr("Cache Hits")
         << tr("Cache Hits Higher Scale")
-        << tr("Cache Misses");
+        << tr("Cache Misses")
+        << tr("Expressions");
 
     _imp->view->setColumnCount( dimensionNames.size() );
     _imp->view->setHorizontalHeaderLabels(dimensionNames);
@@ -1591,8 +1591,9 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
     Texture::DataTypeEnum dataType;
     if (bd == eImageBitDepthByte) {
         dataType = Texture::eDataTypeByte;
+    } else if (bd == eImageBitDepthHalf) {
+        dataType = Texture::eDataTypeHalf;
     } else {
-        //do 32bit fp textures either way, don't bother with half float. We might support it further on.
         dataType = Texture::eDataTypeFloat;
     }
     assert(textureIndex == 0 || textureIndex == 1);
@@ -1604,6 +1605,8 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
         int format, internalFormat, glType;
         if (dataType == Texture::eDataTypeFloat) {
             Texture::getRecommendedTexParametersForRGBAFloatTexture(&format, &internalFormat, &glType);
+        } else if (dataType == Texture::eDataTypeHalf) {
+            Texture::getRecommendedTexParametersForRGBAHalfTexture(&format, &internalFormat, &glType);
         } else {
             Texture::getRecommendedTexParametersForRGBAByteTexture(&format, &internalFormat, &glType);
         }
@@ -1616,6 +1619,8 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
             int format, internalFormat, glType;
             if (dataType == Texture::eDataTypeFloat) {
                 Texture::getRecommendedTexParametersForRGBAFloatTexture(&format, &internalFormat, &glType);
+            } else if (dataType == Texture::eDataTypeHalf) {
+                Texture::getRecommendedTexParametersForRGBAHalfTexture(&format, &internalFormat, &glType);
             } else {
                 Texture::getRecommendedTexParametersForRGBAByteTexture(&format, &internalFormat, &glType);
             }
@@ -4027,7 +4032,7 @@ ViewerGL::getTextureColorAt(int x,
         *b = (double)blue * (1. / 255);
         *a = (double)alpha * (1. / 255);
         glCheckError();
-    } else if (type == Texture::eDataTypeFloat) {
+    } else if ( (type == Texture::eDataTypeFloat) || (type == Texture::eDataTypeHalf) ) {
         GLfloat pixel[4];
         glReadPixels(pos.x(), height() - pos.y(), 1, 1, GL_RGBA, GL_FLOAT, pixel);
         *r = (double)pixel[0];
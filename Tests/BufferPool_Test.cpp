@@ -0,0 +1,108 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstring> // memset
+#include <limits>
+#include <gtest/gtest.h>
+
+#include "Engine/BufferPool.h"
+#include "Engine/CacheEntry.h"
+
+NATRON_NAMESPACE_USING
+
+// A size no other test allocates, so that the buffers of this class are ours
+#define kTestBufferSize (3 * 1024 * 1024 + 123)
+
+TEST(BufferPool, ReusesBuffersOfTheSameClass)
+{
+    BufferPool::setMaximumIdleSize(NATRON_BUFFER_POOL_DEFAULT_MAX_IDLE_SIZE);
+
+    void* a = BufferPool::allocate(kTestBufferSize);
+    ASSERT_TRUE(a);
+    std::memset(a, 1, kTestBufferSize);
+    BufferPool::deallocate(a, kTestBufferSize);
+
+    // A buffer of the same size class is handed out again
+    BufferPoolStats before;
+    BufferPool::getStats(&before);
+    void* b = BufferPool::allocate(kTestBufferSize + 1000);
+    EXPECT_EQ(a, b);
+    BufferPoolStats after;
+    BufferPool::getStats(&after);
+    EXPECT_EQ(before.nReused + 1, after.nReused);
+    EXPECT_EQ(before.nAllocated, after.nAllocated);
+    BufferPool::deallocate(b, kTestBufferSize + 1000);
+
+    // Small buffers are not pooled
+    void* small = BufferPool::allocate(16);
+    ASSERT_TRUE(small);
+    BufferPool::deallocate(small, 16);
+}
+
+TEST(BufferPool, IdleMemoryIsBounded)
+{
+    BufferPool::releaseIdleMemory( std::numeric_limits<std::size_t>::max() );
+    EXPECT_EQ( (std::size_t)0, BufferPool::getIdleSize() );
+
+    // Only one buffer fits in the idle budget, the second one is given back to the system
+    BufferPool::setMaximumIdleSize(kTestBufferSize + NATRON_BUFFER_POOL_SIZE_CLASS_GRANULARITY);
+    void* a = BufferPool::allocate(kTestBufferSize);
+    void* b = BufferPool::allocate(kTestBufferSize);
+    BufferPool::deallocate(a, kTestBufferSize);
+    BufferPool::deallocate(b, kTestBufferSize);
+    std::size_t idle = BufferPool::getIdleSize();
+    EXPECT_GE(idle, (std::size_t)kTestBufferSize);
+    EXPECT_LE(idle, (std::size_t)kTestBufferSize + NATRON_BUFFER_POOL_SIZE_CLASS_GRANULARITY);
+
+    EXPECT_EQ( idle, BufferPool::releaseIdleMemory(1) );
+    EXPECT_EQ( (std::size_t)0, BufferPool::getIdleSize() );
+
+    BufferPool::setMaximumIdleSize(NATRON_BUFFER_POOL_DEFAULT_MAX_IDLE_SIZE);
+}
+
+TEST(BufferPool, RamBufferRecyclesItsMemory)
+{
+    BufferPool::setMaximumIdleSize(NATRON_BUFFER_POOL_DEFAULT_MAX_IDLE_SIZE);
+
+    const float* first;
+    {
+        RamBuffer<float> buffer;
+        buffer.resize(kTestBufferSize / sizeof(float));
+        first = buffer.getData();
+        // Resizing to the same size gives back the buffer and takes it again
+        buffer.resize(kTestBufferSize / sizeof(float));
+        EXPECT_EQ( first, buffer.getData() );
+    }
+    RamBuffer<float> other;
+    other.resize(kTestBufferSize / sizeof(float));
+    EXPECT_EQ( first, other.getData() );
+    EXPECT_EQ( (U64)(kTestBufferSize / sizeof(float)), other.size() );
+    other.clear();
+    EXPECT_EQ( (U64)0, other.size() );
+    EXPECT_FALSE( other.getData() );
+}
@@ -0,0 +1,134 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <climits>
+#include <list>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "Engine/CLArgs.h"
+
+NATRON_NAMESPACE_USING
+
+typedef std::list<std::pair<int, std::pair<int, int> > > FrameRangesList;
+
+static std::pair<int, std::pair<int, int> >
+frameRange(int step,
+           int first,
+           int last)
+{
+    return std::make_pair( step, std::make_pair(first, last) );
+}
+
+TEST(CLArgs, ParseFrameRanges)
+{
+    FrameRangesList ranges;
+
+    // A single frame or a range without a step have the step INT_MIN
+    ASSERT_TRUE( CLArgs::parseFrameRanges(QString::fromUtf8("7"), &ranges) );
+    ASSERT_EQ(1U, ranges.size());
+    EXPECT_EQ(frameRange(INT_MIN, 7, 7), ranges.front());
+
+    ranges.clear();
+    ASSERT_TRUE( CLArgs::parseFrameRanges(QString::fromUtf8("-5"), &ranges) );
+    ASSERT_EQ(1U, ranges.size());
+    EXPECT_EQ(frameRange(INT_MIN, -5, -5), ranges.front());
+
+    ranges.clear();
+    ASSERT_TRUE( CLArgs::parseFrameRanges(QString::fromUtf8("1-10:2,20,30 - 40"), &ranges) );
+    ASSERT_EQ(3U, ranges.size());
+    FrameRangesList::const_iterator it = ranges.begin();
+    EXPECT_EQ(frameRange(2, 1, 10), *it);
+    ++it;
+    EXPECT_EQ(frameRange(INT_MIN, 20, 20), *it);
+    ++it;
+    EXPECT_EQ(frameRange(INT_MIN, 30, 40), *it);
+
+    // Ranges are appended
+    ASSERT_TRUE( CLArgs::parseFrameRanges(QString::fromUtf8("50-60:5"), &ranges) );
+    ASSERT_EQ(4U, ranges.size());
+    EXPECT_EQ(frameRange(5, 50, 60), ranges.back());
+
+    // The malformed ranges of a list are skipped
+    ranges.clear();
+    ASSERT_TRUE( CLArgs::parseFrameRanges(QString::fromUtf8("1-3,a-b,5"), &ranges) );
+    ASSERT_EQ(2U, ranges.size());
+    EXPECT_EQ(frameRange(INT_MIN, 1, 3), ranges.front());
+    EXPECT_EQ(frameRange(INT_MIN, 5, 5), ranges.back());
+}
+
+TEST(CLArgs, ParseMalformedFrameRanges)
+{
+    const char* malformed[] = { "", "abc", "1-", "-", "1-2-3", "1-10:", "1-10:x", "1:2", "x-10", ",", 0 };
+
+    for (int i = 0; malformed[i]; ++i) {
+        FrameRangesList ranges;
+        EXPECT_FALSE( CLArgs::parseFrameRanges(QString::fromUtf8(malformed[i]), &ranges) ) << malformed[i];
+        EXPECT_TRUE( ranges.empty() ) << malformed[i];
+    }
+}
+
+static int
+parseError(const char* const* argv)
+{
+    QStringList args;
+
+    for (int i = 0; argv[i]; ++i) {
+        args << QString::fromUtf8(argv[i]);
+    }
+    CLArgs cl(args, true);
+
+    return cl.getError();
+}
+
+TEST(CLArgs, ServerRejectsWriters)
+{
+    const char* writer[] = { "NatronRenderer", "--server", "MyRenderSlot", "-w", "MyWriter", "MyProject.ntp", 0 };
+    EXPECT_NE( 0, parseError(writer) );
+
+    // Whatever the order of the options
+    const char* output[] = { "NatronRenderer", "-o", "/tmp/out###.exr", "1-10", "--server", "MyRenderSlot", "MyProject.ntp", 0 };
+    const char* outputNoServer[] = { "NatronRenderer", "-o", "/tmp/out###.exr", "1-10", "MyProject.ntp", 0 };
+    EXPECT_EQ( 0, parseError(outputNoServer) );
+    EXPECT_NE( 0, parseError(output) );
+}
+
+TEST(CLArgs, ServerRejectsFrameRangeAndReaders)
+{
+    const char* range[] = { "NatronRenderer", "--server", "MyRenderSlot", "1-10", "MyProject.ntp", 0 };
+    EXPECT_NE( 0, parseError(range) );
+
+    const char* reader[] = { "NatronRenderer", "-i", "MyReader", "/tmp/in.exr", "--server", "MyRenderSlot", "MyProject.ntp", 0 };
+    EXPECT_NE( 0, parseError(reader) );
+
+    const char* server[] = { "NatronRenderer", "--server", "MyRenderSlot", "MyProject.ntp", 0 };
+    EXPECT_EQ( 0, parseError(server) );
+}
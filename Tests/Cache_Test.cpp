@@ -0,0 +1,293 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+#include <algorithm> // max
+#include <iterator> // istreambuf_iterator
+#include <list>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+
+#include "Global/FStreamsSupport.h"
+
+#include "Engine/Cache.h"
+#include "Engine/CacheJournal.h"
+#include "Engine/Image.h"
+#include "Engine/ImagePlaneDesc.h"
+#include "Engine/Timer.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_USING
+
+// Number of distinct entries the threads are looking up: most getOrCreate calls hit the cache
+#define CACHE_TEST_N_KEYS 512
+#define CACHE_TEST_N_LOOKUPS_PER_THREAD 20000
+
+namespace {
+
+class CacheHammerThread
+    : public QThread
+{
+    const Cache<Image>* _cache;
+    ImageParamsPtr _params;
+    unsigned int _seed;
+
+public:
+
+    int nHits;
+
+    CacheHammerThread(const Cache<Image>* cache,
+                      const ImageParamsPtr& params,
+                      unsigned int seed)
+        : QThread()
+        , _cache(cache)
+        , _params(params)
+        , _seed(seed)
+        , nHits(0)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        // A simple LCG so that all threads do not share rand()'s state
+        unsigned int state = _seed;
+
+        for (int i = 0; i < CACHE_TEST_N_LOOKUPS_PER_THREAD; ++i) {
+            state = state * 1664525u + 1013904223u;
+            U64 nodeHash = (state >> 8) % CACHE_TEST_N_KEYS;
+            ImageKey key = Image::makeKey(0, nodeHash, false, 0, ViewIdx(0), false, false);
+            ImagePtr entry;
+            if ( _cache->getOrCreate(key, _params, 0, &entry) ) {
+                ++nHits;
+            }
+        }
+    }
+};
+
+double
+hammerCache(std::size_t nShards,
+            int nThreads,
+            int* nHits)
+{
+    // Entries are never allocated, so nothing gets evicted
+    Cache<Image> cache("CacheTest", NATRON_CACHE_VERSION, (U64)1024 * 1024 * 1024, 1., nShards);
+    ImageParamsPtr params = Image::makeParams(RectD(0, 0, 16, 16), 1., 0, false, ImagePlaneDesc::getRGBAComponents(),
+                                              eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+    std::vector<CacheHammerThread*> threads;
+
+    for (int i = 0; i < nThreads; ++i) {
+        threads.push_back( new CacheHammerThread(&cache, params, i + 1) );
+    }
+
+    TimeLapse timer;
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->start();
+    }
+    *nHits = 0;
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->wait();
+        *nHits += threads[i]->nHits;
+        delete threads[i];
+    }
+    double elapsed = timer.getTimeSinceCreation();
+
+    cache.clear();
+    cache.waitForDeleterThread();
+
+    return elapsed;
+}
+
+} // anon namespace
+
+TEST(Cache, ShardedGetOrCreate)
+{
+    Cache<Image> cache("CacheTest", NATRON_CACHE_VERSION, (U64)1024 * 1024 * 1024, 1., 16);
+    ImageParamsPtr params = Image::makeParams(RectD(0, 0, 16, 16), 1., 0, false, ImagePlaneDesc::getRGBAComponents(),
+                                              eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+
+    ASSERT_EQ( (std::size_t)16, cache.getNumShards() );
+
+    std::vector<ImagePtr> created;
+    for (int i = 0; i < 100; ++i) {
+        ImageKey key = Image::makeKey(0, i, false, 0, ViewIdx(0), false, false);
+        ImagePtr entry;
+        EXPECT_FALSE( cache.getOrCreate(key, params, 0, &entry) ) << "A fresh key must create a new entry";
+        ASSERT_TRUE(entry);
+        created.push_back(entry);
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        ImageKey key = Image::makeKey(0, i, false, 0, ViewIdx(0), false, false);
+        ImagePtr entry;
+        EXPECT_TRUE( cache.getOrCreate(key, params, 0, &entry) ) << "A known key must be found in its shard";
+        EXPECT_EQ(created[i], entry);
+
+        std::list<ImagePtr> found;
+        EXPECT_TRUE( cache.get(key, &found) );
+        EXPECT_EQ( (std::size_t)1, found.size() );
+    }
+
+    std::list<ImagePtr> copy;
+    cache.getCopy(&copy);
+    EXPECT_EQ( (std::size_t)100, copy.size() );
+
+    cache.removeEntry(created[0]);
+    copy.clear();
+    cache.getCopy(&copy);
+    EXPECT_EQ( (std::size_t)99, copy.size() );
+
+    created.clear();
+    copy.clear();
+    cache.clear();
+    cache.waitForDeleterThread();
+}
+
+TEST(Cache, ConcurrentLookups)
+{
+    int nThreads = std::max(4, QThread::idealThreadCount() * 2);
+    std::size_t shardsToTest[] = { 1, 16 };
+
+    for (std::size_t i = 0; i < sizeof(shardsToTest) / sizeof(shardsToTest[0]); ++i) {
+        int nHits = 0;
+        hammerCache(shardsToTest[i], nThreads, &nHits);
+
+        // Every key is created at most once, all other lookups must be hits
+        EXPECT_GE(nHits, nThreads * CACHE_TEST_N_LOOKUPS_PER_THREAD - CACHE_TEST_N_KEYS);
+    }
+}
+
+// Timing of many threads hammering getOrCreate with a single lock vs. sharded locks, recorded as test properties.
+// Run with --gtest_also_run_disabled_tests --gtest_filter=Cache.DISABLED_ContentionBenchmark --gtest_output=xml
+TEST(Cache, DISABLED_ContentionBenchmark)
+{
+    int nThreads = std::max(4, QThread::idealThreadCount() * 2);
+    std::size_t shardsToTest[] = { 1, 4, 16, 64 };
+    const char* properties[] = { "seconds_1_shard", "seconds_4_shards", "seconds_16_shards", "seconds_64_shards" };
+
+    for (std::size_t i = 0; i < sizeof(shardsToTest) / sizeof(shardsToTest[0]); ++i) {
+        int nHits = 0;
+        double elapsed = hammerCache(shardsToTest[i], nThreads, &nHits);
+        ::testing::Test::RecordProperty( properties[i], QString::number(elapsed).toStdString() );
+    }
+}
+
+TEST(Cache, JournalReplay)
+{
+    std::string journalFilePath = QDir::temp().absoluteFilePath( QString::fromUtf8("NatronCacheJournalTest.bin") ).toStdString();
+    std::list<CacheJournal::Record> entries;
+
+    QFile::remove( QString::fromUtf8( journalFilePath.c_str() ) );
+    EXPECT_EQ( CacheJournal::eReadStatusMissing, CacheJournal::read(journalFilePath, NATRON_CACHE_VERSION, &entries) );
+
+    {
+        CacheJournal journal;
+        std::list<CacheJournal::Record> initialEntries(1);
+        initialEntries.front().filePath = "a";
+        initialEntries.front().payload = "a1";
+        ASSERT_TRUE( journal.reset(journalFilePath, NATRON_CACHE_VERSION, initialEntries) );
+        journal.appendEntryAdded("b", 0, "b1");
+        journal.appendEntryAdded("c", 0, "c1");
+        journal.appendEntryRemoved("a", 0);
+        journal.appendEntryAdded("b", 0, "b2");
+        journal.appendEntryAdded("c", 4096, "c2");
+    }
+
+    ASSERT_EQ( CacheJournal::eReadStatusOK, CacheJournal::read(journalFilePath, NATRON_CACHE_VERSION, &entries) );
+    ASSERT_EQ( (std::size_t)3, entries.size() );
+    std::list<CacheJournal::Record>::const_iterator it = entries.begin();
+    EXPECT_EQ( std::string("c1"), it->payload );
+    ++it;
+    EXPECT_EQ( std::string("b2"), it->payload );
+    ++it;
+    EXPECT_EQ( std::string("c2"), it->payload );
+    EXPECT_EQ( (std::size_t)4096, it->dataOffset );
+
+    entries.clear();
+    EXPECT_EQ( CacheJournal::eReadStatusInvalid, CacheJournal::read(journalFilePath, NATRON_CACHE_VERSION + 1, &entries) );
+
+    // Simulate a crash while the last record was being written: the replay stops before it
+    {
+        FStreamsSupport::ifstream ifile;
+        FStreamsSupport::open(&ifile, journalFilePath, std::ios_base::in | std::ios_base::binary);
+        std::string data( (std::istreambuf_iterator<char>(ifile)), std::istreambuf_iterator<char>() );
+        ifile.close();
+        FStreamsSupport::ofstream ofile;
+        FStreamsSupport::open(&ofile, journalFilePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        ofile.write( data.data(), data.size() - 3 );
+    }
+    entries.clear();
+    ASSERT_EQ( CacheJournal::eReadStatusOK, CacheJournal::read(journalFilePath, NATRON_CACHE_VERSION, &entries) );
+    ASSERT_EQ( (std::size_t)2, entries.size() );
+    EXPECT_EQ( std::string("b2"), entries.back().payload );
+
+    QFile::remove( QString::fromUtf8( journalFilePath.c_str() ) );
+}
+
+TEST(Cache, JournalKeepsRecordsAppendedDuringReset)
+{
+    std::string journalFilePath = QDir::temp().absoluteFilePath( QString::fromUtf8("NatronCacheJournalResetTest.bin") ).toStdString();
+    std::list<CacheJournal::Record> entries;
+
+    QFile::remove( QString::fromUtf8( journalFilePath.c_str() ) );
+    {
+        CacheJournal journal;
+        std::list<CacheJournal::Record> initialEntries(2);
+        initialEntries.front().filePath = "a";
+        initialEntries.front().payload = "a1";
+        initialEntries.back().filePath = "b";
+        initialEntries.back().payload = "b1";
+        ASSERT_TRUE( journal.reset(journalFilePath, NATRON_CACHE_VERSION, initialEntries) );
+
+        // Compaction: the changes made while the entries are listed must survive the reset
+        journal.beginReset();
+        EXPECT_TRUE( journal.isAppendable() );
+        journal.appendEntryAdded("c", 0, "c1");
+        journal.appendEntryRemoved("b", 0);
+        std::list<CacheJournal::Record> listedEntries;
+        listedEntries.push_back( initialEntries.front() );
+        listedEntries.push_back( initialEntries.back() );
+        ASSERT_TRUE( journal.reset(journalFilePath, NATRON_CACHE_VERSION, listedEntries) );
+        journal.appendEntryAdded("d", 0, "d1");
+    }
+
+    ASSERT_EQ( CacheJournal::eReadStatusOK, CacheJournal::read(journalFilePath, NATRON_CACHE_VERSION, &entries) );
+    ASSERT_EQ( (std::size_t)3, entries.size() );
+    std::list<CacheJournal::Record>::const_iterator it = entries.begin();
+    EXPECT_EQ( std::string("a1"), it->payload );
+    ++it;
+    EXPECT_EQ( std::string("c1"), it->payload );
+    ++it;
+    EXPECT_EQ( std::string("d1"), it->payload );
+
+    QFile::remove( QString::fromUtf8( journalFilePath.c_str() ) );
+}
@@ -25,12 +25,14 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
 #include <gtest/gtest.h>
 
 #include <QtCore/QString>
 #include <QtCore/QDir>
 
 #include "Engine/Curve.h"
+#include "Engine/Hash64.h"
 
 NATRON_NAMESPACE_USING
 
@@ -124,4 +126,156 @@ TEST(Curve, Basic)
     KeyFrame k2(1., 20.);
 }
 
+namespace {
 
+U64
+curveHash(const Curve& c)
+{
+    Hash64 h;
+
+    c.appendToHash(&h);
+    h.computeHash();
+
+    return h.value();
+}
+}
+
+TEST(Curve, ContentHash)
+{
+    Curve a, b;
+
+    EXPECT_EQ( curveHash(a), curveHash(b) );
+
+    EXPECT_TRUE( a.addKeyFrame( KeyFrame(0., 10.) ) );
+    EXPECT_TRUE( a.addKeyFrame( KeyFrame(5., 20.) ) );
+    EXPECT_NE( curveHash(a), curveHash(b) );
+
+    // The same keyframes, added in another order, produce the same hash
+    EXPECT_TRUE( b.addKeyFrame( KeyFrame(5., 20.) ) );
+    EXPECT_TRUE( b.addKeyFrame( KeyFrame(0., 10.) ) );
+    EXPECT_EQ( curveHash(a), curveHash(b) );
+
+    // Any change to a keyframe changes the hash
+    b.addKeyFrame( KeyFrame(5., 21.) );
+    EXPECT_NE( curveHash(a), curveHash(b) );
+}
+
+TEST(Curve, KeyFramesFromIndex)
+{
+    Curve c;
+
+    EXPECT_TRUE( c.getKeyFramesFromIndex_mt_safe(0).empty() );
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE( c.addKeyFrame( KeyFrame(i, 2. * i) ) );
+    }
+
+    EXPECT_EQ( c.getKeyFrames_mt_safe(), c.getKeyFramesFromIndex_mt_safe(0) );
+    EXPECT_EQ( c.getKeyFrames_mt_safe(), c.getKeyFramesFromIndex_mt_safe(-1) );
+    EXPECT_TRUE( c.getKeyFramesFromIndex_mt_safe(10).empty() );
+
+    KeyFrameSet last = c.getKeyFramesFromIndex_mt_safe(7);
+    ASSERT_EQ( (std::size_t)3, last.size() );
+    EXPECT_EQ( 7., last.begin()->getTime() );
+    EXPECT_EQ( 18., last.rbegin()->getValue() );
+}
+
+TEST(Curve, BatchEvaluation)
+{
+    Curve c;
+
+    c.addKeyFrame( KeyFrame(0., 5.) );
+    c.addKeyFrame( KeyFrame(10., 0.) );
+    c.addKeyFrame( KeyFrame(15., 20., 0., 0., eKeyframeTypeLinear) );
+    c.addKeyFrame( KeyFrame(30., -3., 0., 0., eKeyframeTypeConstant) );
+
+    // Increasing times reuse the previous keyframes interval, the other ones look it up again
+    std::vector<double> times;
+    for (double t = -5.; t <= 35.; t += 0.25) {
+        times.push_back(t);
+    }
+    times.push_back(12.);
+    times.push_back(-1.);
+    times.push_back(30.);
+    times.push_back(15.);
+
+    std::vector<double> values( times.size() );
+    c.getValuesAt(&times[0], &values[0], (int)times.size(), false);
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ(c.getValueAt(times[i], false), values[i]) << "t = " << times[i];
+    }
+    EXPECT_EQ( 5., c.getValueAt(0.) );
+    EXPECT_EQ( 20., c.getValueAt(15.) );
+
+    // The values change as soon as the curve does
+    c.addKeyFrame( KeyFrame(15., 40., 0., 0., eKeyframeTypeLinear) );
+    EXPECT_EQ( 40., c.getValueAt(15.) );
+    c.setYRange(-1., 10.);
+    EXPECT_EQ( 10., c.getValueAt(15.) );
+    EXPECT_EQ( 40., c.getValueAt(15., false) );
+    c.clearKeyFrames();
+    EXPECT_EQ( 0., c.getValueAt(15.) );
+}
+
+TEST(Curve, BatchEvaluationPeriodic)
+{
+    Curve c;
+
+    c.setPeriodic(true);
+    c.setXRange(0., 1.);
+    c.addKeyFrame( KeyFrame(0.2, 1.) );
+    c.addKeyFrame( KeyFrame(0.5, 3.) );
+    c.addKeyFrame( KeyFrame(0.9, 2.) );
+
+    std::vector<double> times;
+    for (double t = -2.; t <= 2.; t += 0.01) {
+        times.push_back(t);
+    }
+    std::vector<double> values( times.size() );
+    c.getValuesAt(&times[0], &values[0], (int)times.size(), false);
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ(c.getValueAt(times[i], false), values[i]) << "t = " << times[i];
+    }
+    EXPECT_DOUBLE_EQ( c.getValueAt(0.5), c.getValueAt(1.5) );
+}
+
+TEST(Curve, LUT)
+{
+    Curve c;
+
+    c.addKeyFrame( KeyFrame(0., 0.) );
+    c.addKeyFrame( KeyFrame(0.3, 0.6) );
+    c.addKeyFrame( KeyFrame(1., 1.) );
+
+    // No table without a finite X range
+    EXPECT_FALSE( c.getLUT() );
+
+    c.setXRange(0., 1.);
+    CurveLUTPtr lut = c.getLUT();
+    ASSERT_TRUE(lut);
+    EXPECT_EQ(NATRON_CURVE_LUT_SIZE, (int)lut->values.size());
+    EXPECT_EQ( lut, c.getLUT() );
+    EXPECT_EQ( c.getValueAt(0.), lut->values.front() );
+    EXPECT_EQ( c.getValueAt(1.), lut->values.back() );
+    for (double t = 0.; t <= 1.; t += 0.001) {
+        EXPECT_NEAR(c.getValueAt(t), c.getValueAtFromLUT(t), 1e-5) << "t = " << t;
+    }
+    // Out of the X range, the curve is evaluated
+    EXPECT_EQ( c.getValueAt(1.5), c.getValueAtFromLUT(1.5) );
+    EXPECT_EQ( c.getValueAt(-2.), c.getValueAtFromLUT(-2.) );
+
+    // A new table is baked when the curve changes, the previous one is left untouched
+    std::vector<double> previousValues = lut->values;
+    c.addKeyFrame( KeyFrame(0.5, 2.) );
+    CurveLUTPtr newLUT = c.getLUT();
+    ASSERT_TRUE(newLUT);
+    EXPECT_NE(lut, newLUT);
+    EXPECT_TRUE(previousValues == lut->values);
+    EXPECT_NEAR(2., c.getValueAtFromLUT(0.5), 1e-5);
+    c.setYRange(0., 1.5);
+    EXPECT_EQ( 1.5, c.getValueAtFromLUT(0.5) );
+
+    // Steps cannot be interpolated
+    c.addKeyFrame( KeyFrame(0.7, 0.2, 0., 0., eKeyframeTypeConstant) );
+    EXPECT_FALSE( c.getLUT() );
+    EXPECT_EQ( c.getValueAt(0.8), c.getValueAtFromLUT(0.8) );
+}
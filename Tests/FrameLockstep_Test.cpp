@@ -0,0 +1,99 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <map>
+#include <gtest/gtest.h>
+
+#include "Engine/FrameLockstep.h"
+#include "Engine/RenderStats.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(FrameLockstep, RendersStayInterleaved)
+{
+    FrameLockstep lockstep(0);
+    int a = 0, b = 0;
+
+    lockstep.addParticipant(&a, 1);
+    lockstep.addParticipant(&b, 1);
+
+    EXPECT_TRUE( lockstep.waitForFrame(&a, 1, 0) );
+    // a may not get ahead of b
+    EXPECT_FALSE( lockstep.waitForFrame(&a, 2, 0) );
+    EXPECT_TRUE( lockstep.waitForFrame(&b, 1, 0) );
+    EXPECT_TRUE( lockstep.waitForFrame(&a, 2, 0) );
+
+    // A render that stopped no longer holds the others back
+    lockstep.removeParticipant(&b);
+    EXPECT_TRUE( lockstep.waitForFrame(&a, 3, 0) );
+    EXPECT_TRUE( lockstep.waitForFrame(&a, 10, 0) );
+}
+
+TEST(FrameLockstep, WindowAndFrameSteps)
+{
+    FrameLockstep lockstep(2);
+    int a = 0, b = 0;
+
+    lockstep.addParticipant(&a, 1);
+    lockstep.addParticipant(&b, 5);
+
+    // b starts later in the sequence: it waits for a to be close enough
+    EXPECT_FALSE( lockstep.waitForFrame(&b, 5, 0) );
+    EXPECT_TRUE( lockstep.waitForFrame(&a, 1, 0) );
+    EXPECT_TRUE( lockstep.waitForFrame(&a, 2, 0) );
+    EXPECT_TRUE( lockstep.waitForFrame(&b, 5, 0) );
+
+    // a jumps ahead and waits, but b, the render the furthest behind, is never blocked
+    EXPECT_TRUE( lockstep.waitForFrame(&a, 3, 0) );
+    EXPECT_TRUE( lockstep.waitForFrame(&a, 6, 0) );
+    EXPECT_FALSE( lockstep.waitForFrame(&a, 16, 0) );
+    EXPECT_TRUE( lockstep.waitForFrame(&b, 6, 0) );
+}
+
+TEST(FrameLockstep, SharedWorkStats)
+{
+    FrameLockstep lockstep;
+    int a = 0, b = 0;
+    std::map<NodePtr, NodeRenderStats> computed, fromCache;
+
+    computed[NodePtr()].addCacheAccessInfo(true, false);
+    computed[NodePtr()].addTimeSpentRendering(2.);
+    fromCache[NodePtr()].addCacheAccessInfo(false, false);
+
+    lockstep.addFrameStats(&a, 1, computed);
+    lockstep.addFrameStats(&b, 1, fromCache);
+    // Found in the cache, but from an other frame
+    lockstep.addFrameStats(&b, 2, fromCache);
+
+    int nbNodeRenders, nbSharedNodeRenders;
+    double timeSaved;
+    lockstep.getSharedWorkStats(&nbNodeRenders, &nbSharedNodeRenders, &timeSaved);
+    EXPECT_EQ(3, nbNodeRenders);
+    EXPECT_EQ(1, nbSharedNodeRenders);
+    EXPECT_EQ(2., timeSaved);
+}
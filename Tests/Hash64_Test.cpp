@@ -26,9 +26,16 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <vector>
+#include <algorithm> // for std::for_each, std::sort, std::adjacent_find
 #include <gtest/gtest.h>
 
+#include <boost/crc.hpp>
+
+#include <QtCore/QString>
+
 #include "Engine/Hash64.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_USING
 
@@ -91,3 +98,120 @@ TEST(Hash64,
     EXPECT_NE(hash1, hash2);
 } // TEST
 
+TEST(Hash64,
+     IncrementalCompute)
+{
+    Hash64 hash1, hash2;
+
+    for (int i = 0; i < 10; ++i) {
+        hash1.append<double>(i * 0.5);
+    }
+    hash1.computeHash();
+    U64 partial = hash1.value();
+    for (int i = 10; i < 20; ++i) {
+        hash1.append<double>(i * 0.5);
+    }
+    hash1.computeHash();
+    EXPECT_NE( partial, hash1.value() ) << "Values appended after computeHash() must be taken into account";
+
+    for (int i = 0; i < 20; ++i) {
+        hash2.append<double>(i * 0.5);
+    }
+    hash2.computeHash();
+    EXPECT_EQ(hash1, hash2) << "Computing the hash in the middle of the stream must not change the result";
+
+    // Strings
+    Hash64 s1, s2, s3;
+    Hash64_appendQString( &s1, QString::fromUtf8("Blur1") );
+    Hash64_appendQString( &s2, QString::fromUtf8("Blur1") );
+    Hash64_appendQString( &s3, QString::fromUtf8("Blur2") );
+    s1.computeHash();
+    s2.computeHash();
+    s3.computeHash();
+    EXPECT_EQ(s1, s2);
+    EXPECT_NE(s1, s3);
+
+    Hash64 a, b;
+    Hash64_appendStdString( &a, std::string("ab") );
+    Hash64_appendStdString( &a, std::string("c") );
+    Hash64_appendStdString( &b, std::string("a") );
+    Hash64_appendStdString( &b, std::string("bc") );
+    a.computeHash();
+    b.computeHash();
+    EXPECT_NE(a, b) << "Consecutive strings must not alias each other";
+}
+
+// The hashes of nodes differing by their values are all distinct
+TEST(Hash64,
+     DistinctNodes)
+{
+    const int nNodes = 500;
+    const int nValuesPerNode = 200;
+    const QString scriptName = QString::fromUtf8("ColorCorrect_Master_Shot042");
+    std::vector<U64> hashes;
+
+    for (int n = 0; n < nNodes; ++n) {
+        Hash64 hash;
+        for (int i = 0; i < nValuesPerNode; ++i) {
+            hash.append<double>(n + i * 0.25);
+        }
+        Hash64_appendQString(&hash, scriptName);
+        hash.computeHash();
+        ASSERT_TRUE( hash.valid() );
+        hashes.push_back( hash.value() );
+    }
+    std::sort( hashes.begin(), hashes.end() );
+    EXPECT_TRUE( std::adjacent_find( hashes.begin(), hashes.end() ) == hashes.end() );
+}
+
+// Timing of what a knob change in a large comp hashes, with Hash64 and with the legacy buffered byte-wise CRC64
+// for reference, recorded as test properties.
+// Run with --gtest_also_run_disabled_tests --gtest_filter=Hash64.DISABLED_Benchmark --gtest_output=xml
+TEST(Hash64,
+     DISABLED_Benchmark)
+{
+    const int nNodes = 500;
+    const int nValuesPerNode = 200;
+    const int nIterations = 20;
+    const QString scriptName = QString::fromUtf8("ColorCorrect_Master_Shot042");
+
+    U64 hash64Check = 0;
+    TimeLapse timer;
+    for (int it = 0; it < nIterations; ++it) {
+        for (int n = 0; n < nNodes; ++n) {
+            Hash64 hash;
+            for (int i = 0; i < nValuesPerNode; ++i) {
+                hash.append<double>(n + i * 0.25);
+            }
+            Hash64_appendQString(&hash, scriptName);
+            hash.computeHash();
+            hash64Check ^= hash.value();
+        }
+    }
+    double hash64Time = timer.getTimeSinceCreation();
+
+    U64 crcCheck = 0;
+    TimeLapse crcTimer;
+    for (int it = 0; it < nIterations; ++it) {
+        for (int n = 0; n < nNodes; ++n) {
+            std::vector<U64> values;
+            for (int i = 0; i < nValuesPerNode; ++i) {
+                values.push_back( Hash64::toU64<double>(n + i * 0.25) );
+            }
+            Q_FOREACH (QChar ch, scriptName) {
+                values.push_back( Hash64::toU64<unsigned short>( ch.unicode() ) );
+            }
+            const unsigned char* data = reinterpret_cast<const unsigned char*>( &values.front() );
+            boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> crc_64;
+            crc_64 = std::for_each( data, data + values.size() * sizeof(values[0]), crc_64 );
+            crcCheck ^= crc_64();
+        }
+    }
+    double crcTime = crcTimer.getTimeSinceCreation();
+
+    // Each node is hashed an even number of times, to the same value every time, so the checks cancel out
+    EXPECT_EQ( (U64)0, hash64Check );
+    EXPECT_EQ( (U64)0, crcCheck );
+    ::testing::Test::RecordProperty( "hash64_seconds", QString::number(hash64Time).toStdString() );
+    ::testing::Test::RecordProperty( "crc64_seconds", QString::number(crcTime).toStdString() );
+}
@@ -25,10 +25,21 @@
 
 #include "Global/Macros.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
+#include <list>
+#include <string>
+#include <vector>
 #include <gtest/gtest.h>
 
+#include <QtCore/QString>
+
 #include "Engine/Image.h"
+#include "Engine/ImageMipMapKernels.h"
+#include "Engine/ImagePlaneDesc.h"
+#include "Engine/Timer.h"
 #include "Engine/ViewIdx.h"
 
 NATRON_NAMESPACE_USING
@@ -52,8 +63,11 @@ TEST(BitmapTest,
     ASSERT_TRUE(rod == nonRenderedRectsUnion);
 
     ///assert that the "underlying" bitmap is clean
-    const char* map = bm.getBitmap();
-    ASSERT_TRUE( !std::memchr( map, 1, rod.area() ) );
+    std::vector<char> map( rod.area() );
+    for (int y = rod.y1; y < rod.y2; ++y) {
+        bm.getRow(rod.x1, rod.x2, y, &map[(y - rod.y1) * rod.width()]);
+    }
+    ASSERT_TRUE( !std::memchr( &map[0], 1, rod.area() ) );
     ASSERT_TRUE( bm.isNonMarked(rod) );
 
     RectI halfRoD(0, 0, 100, 50);
@@ -69,13 +83,16 @@ TEST(BitmapTest,
 
 
     ///assert that the underlying bitmap is marked as expected
-    const char* start = map;
+    for (int y = rod.y1; y < rod.y2; ++y) {
+        bm.getRow(rod.x1, rod.x2, y, &map[(y - rod.y1) * rod.width()]);
+    }
+    const char* start = &map[0];
 
     ///check that there are only ones in the rendered half
     ASSERT_TRUE( !memchr( start, 0, halfRoD.area() ) );
 
     ///check that there are only 0s in the non rendered half
-    start = map + halfRoD.area();
+    start = &map[0] + halfRoD.area();
     ASSERT_TRUE( !memchr( start, 1, halfRoD.area() ) );
 
     ///mark for renderer the other half of the rod
@@ -85,7 +102,10 @@ TEST(BitmapTest,
     nonRenderedRects.clear();
     bm.minimalNonMarkedRects(rod, nonRenderedRects);
     ASSERT_TRUE( nonRenderedRects.empty() );
-    ASSERT_TRUE( !memchr( map, 0, rod.area() ) );
+    for (int y = rod.y1; y < rod.y2; ++y) {
+        bm.getRow(rod.x1, rod.x2, y, &map[(y - rod.y1) * rod.width()]);
+    }
+    ASSERT_TRUE( !memchr( &map[0], 0, rod.area() ) );
 
     ///More complex example where A,B,C,D are not rendered check that both trimap & bitmap yield the same result
     // BBBBBBBBBBBBBB
@@ -117,6 +137,482 @@ TEST(BitmapTest,
     EXPECT_TRUE(nonRenderedRects.size() == 3);
 } // TEST
 
+TEST(BitmapTest, CopyBetweenBounds)
+{
+    // The bitmaps do not start at the same x, so the copies are not aligned on the words of the rows
+    Bitmap src( RectI(-37, 0, 300, 4) );
+    Bitmap dst( RectI(5, 0, 200, 4) );
+
+    src.markForRendered( RectI(10, 1, 100, 2) );
+    src.markForRendering( RectI(100, 1, 120, 2) );
+    dst.setTo1();
+    dst.copyRowPortion(8, 150, 1, src);
+    for (int x = 5; x < 200; ++x) {
+        char expected = (x < 8 || x >= 150) ? 1 : ( (x >= 10 && x < 100) ? 1 : ( (x >= 100 && x < 120) ? 2 : 0 ) );
+        EXPECT_EQ( expected, dst.getValueAt(x, 1) ) << "x = " << x;
+        EXPECT_EQ( 1, dst.getValueAt(x, 0) );
+    }
+
+    dst.copyBitmapPortion(RectI(5, 0, 200, 4), src);
+    EXPECT_TRUE( dst.isNonMarked( RectI(5, 2, 200, 4) ) );
+    EXPECT_FALSE( dst.isNonMarked( RectI(5, 1, 200, 2) ) );
+    EXPECT_EQ( RectI(5, 0, 200, 4), dst.minimalNonMarkedBbox( RectI(5, 0, 200, 4) ) );
+    EXPECT_EQ( RectI(5, 1, 160, 2), dst.minimalNonMarkedBbox( RectI(5, 1, 160, 2) ) );
+    EXPECT_TRUE( dst.minimalNonMarkedBbox( RectI(10, 1, 100, 2) ).isNull() );
+
+    // Pixels being rendered elsewhere are left to render without the trimap
+    EXPECT_EQ( RectI(100, 1, 120, 2), dst.minimalNonMarkedBbox( RectI(10, 1, 120, 2) ) );
+    bool isBeingRenderedElsewhere = false;
+    EXPECT_TRUE( dst.minimalNonMarkedBbox_trimap(RectI(10, 1, 120, 2), &isBeingRenderedElsewhere).isNull() );
+    EXPECT_TRUE(isBeingRenderedElsewhere);
+}
+
+// The state of a pixel being rendered elsewhere, PIXEL_UNAVAILABLE in Image.cpp
+static const char kPixelUnavailable = 2;
+
+/*
+ * A bitmap with one char per pixel, as Bitmap was before it packed the pixels in 64-bit words:
+ * the searches below are the previous implementation of minimalNonMarkedBbox() and minimalNonMarkedRects().
+ */
+struct ReferenceBitmap
+{
+    RectI bounds;
+    std::vector<char> map;
+
+    ReferenceBitmap(const RectI& b)
+        : bounds(b)
+        , map( (std::size_t)b.area(), 0 )
+    {
+    }
+
+    char at(int x,
+            int y) const
+    {
+        return map[(std::size_t)(y - bounds.y1) * bounds.width() + (x - bounds.x1)];
+    }
+
+    void markFor(const RectI& roi,
+                 char value)
+    {
+        for (int y = std::max(roi.y1, bounds.y1); y < std::min(roi.y2, bounds.y2); ++y) {
+            for (int x = std::max(roi.x1, bounds.x1); x < std::min(roi.x2, bounds.x2); ++x) {
+                map[(std::size_t)(y - bounds.y1) * bounds.width() + (x - bounds.x1)] = value;
+            }
+        }
+    }
+
+    void copyBitmapPortion(const RectI& roi,
+                           const ReferenceBitmap& other)
+    {
+        for (int y = roi.y1; y < roi.y2; ++y) {
+            for (int x = roi.x1; x < roi.x2; ++x) {
+                map[(std::size_t)(y - bounds.y1) * bounds.width() + (x - bounds.x1)] = other.at(x, y);
+            }
+        }
+    }
+
+    bool isNonMarked(const RectI& roi) const
+    {
+        for (int y = std::max(roi.y1, bounds.y1); y < std::min(roi.y2, bounds.y2); ++y) {
+            for (int x = std::max(roi.x1, bounds.x1); x < std::min(roi.x2, bounds.x2); ++x) {
+                if ( at(x, y) ) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Whether the pixels [x1,x2) of the row y (or [y1,y2) of the column x) are all rendered, unavailable pixels
+    // counting as rendered with the trimap
+    template <int trimap>
+    bool isLineMarked(bool row,
+                      int pos,
+                      int start,
+                      int end,
+                      bool* metUnavailablePixel) const
+    {
+        *metUnavailablePixel = false;
+        for (int i = start; i < end; ++i) {
+            char v = row ? at(i, pos) : at(pos, i);
+            if ( !v || ( !trimap && (v == kPixelUnavailable) ) ) {
+                return false;
+            } else if (v == kPixelUnavailable) {
+                *metUnavailablePixel = true;
+            }
+        }
+
+        return true;
+    }
+
+    // Whether the pixels of the line are all non rendered, an unavailable pixel stopping the search with the trimap
+    template <int trimap>
+    bool isLineNonMarked(bool row,
+                         int pos,
+                         int start,
+                         int end,
+                         bool* metUnavailablePixel) const
+    {
+        *metUnavailablePixel = false;
+        for (int i = start; i < end; ++i) {
+            char v = row ? at(i, pos) : at(pos, i);
+            if (v == 1) {
+                return false;
+            } else if ( trimap && (v == kPixelUnavailable) ) {
+                *metUnavailablePixel = true;
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template <int trimap>
+    RectI minimalNonMarkedBbox(const RectI& roi,
+                               bool* isBeingRenderedElsewhere) const
+    {
+        RectI bbox = roi;
+        bool met;
+
+        while ( bbox.y1 < bbox.y2 && isLineMarked<trimap>(true, bbox.y1, bbox.x1, bbox.x2, &met) ) {
+            if (trimap && met) {
+                *isBeingRenderedElsewhere = true;
+            }
+            ++bbox.y1;
+        }
+        while ( bbox.y2 > bbox.y1 && isLineMarked<trimap>(true, bbox.y2 - 1, bbox.x1, bbox.x2, &met) ) {
+            if (trimap && met) {
+                *isBeingRenderedElsewhere = true;
+            }
+            --bbox.y2;
+        }
+        if ( bbox.isNull() ) {
+            return bbox;
+        }
+        while ( bbox.x1 < bbox.x2 && isLineMarked<trimap>(false, bbox.x1, bbox.y1, bbox.y2, &met) ) {
+            if (trimap && met) {
+                *isBeingRenderedElsewhere = true;
+            }
+            ++bbox.x1;
+        }
+        while ( bbox.x2 > bbox.x1 && isLineMarked<trimap>(false, bbox.x2 - 1, bbox.y1, bbox.y2, &met) ) {
+            if (trimap && met) {
+                *isBeingRenderedElsewhere = true;
+            }
+            --bbox.x2;
+        }
+
+        return bbox;
+    }
+
+    template <int trimap>
+    void minimalNonMarkedRects(const RectI& roi,
+                               std::list<RectI>& ret,
+                               bool* isBeingRenderedElsewhere) const
+    {
+        RectI intersection;
+
+        roi.intersect(bounds, &intersection);
+        if (roi != intersection) {
+            if ( (bounds.x1 > roi.x1) && (bounds.y2 > bounds.y1) ) {
+                ret.push_back( RectI(roi.x1, bounds.y1, bounds.x1, bounds.y2) );
+            }
+            if ( (roi.x2 > roi.x1) && (bounds.y1 > roi.y1) ) {
+                ret.push_back( RectI(roi.x1, roi.y1, roi.x2, bounds.y1) );
+            }
+            if ( (roi.x2 > bounds.x2) && (bounds.y2 > bounds.y1) ) {
+                ret.push_back( RectI(bounds.x2, bounds.y1, roi.x2, bounds.y2) );
+            }
+            if ( (roi.x2 > roi.x1) && (roi.y2 > bounds.y2) ) {
+                ret.push_back( RectI(roi.x1, bounds.y2, roi.x2, roi.y2) );
+            }
+        }
+        if ( intersection.isNull() ) {
+            return;
+        }
+
+        RectI bboxM = minimalNonMarkedBbox<trimap>(intersection, isBeingRenderedElsewhere);
+        if ( bboxM.isNull() ) {
+            return;
+        }
+
+        // The non rendered rows below and above, then the columns on the left and on the right of what is left
+        RectI bboxX = bboxM;
+        bool met = false;
+        RectI bboxA = bboxX;
+        bboxA.y2 = bboxX.y1;
+        while ( bboxX.y1 < bboxX.y2 && isLineNonMarked<trimap>(true, bboxX.y1, bboxX.x1, bboxX.x2, &met) ) {
+            ++bboxX.y1;
+            bboxA.y2 = bboxX.y1;
+        }
+        if (met) {
+            *isBeingRenderedElsewhere = true;
+        }
+        if ( !bboxA.isNull() ) {
+            ret.push_back(bboxA);
+        }
+
+        RectI bboxB = bboxX;
+        bboxB.y1 = bboxX.y2;
+        met = false;
+        while ( bboxX.y2 > bboxX.y1 && isLineNonMarked<trimap>(true, bboxX.y2 - 1, bboxX.x1, bboxX.x2, &met) ) {
+            --bboxX.y2;
+            bboxB.y1 = bboxX.y2;
+        }
+        if (met) {
+            *isBeingRenderedElsewhere = true;
+        }
+        if ( !bboxB.isNull() ) {
+            ret.push_back(bboxB);
+        }
+
+        RectI bboxC = bboxX;
+        bboxC.x2 = bboxX.x1;
+        if (bboxX.y1 < bboxX.y2) {
+            met = false;
+            while ( bboxX.x1 < bboxX.x2 && isLineNonMarked<trimap>(false, bboxX.x1, bboxX.y1, bboxX.y2, &met) ) {
+                ++bboxX.x1;
+                bboxC.x2 = bboxX.x1;
+            }
+            if (met) {
+                *isBeingRenderedElsewhere = true;
+            }
+        }
+        if ( !bboxC.isNull() ) {
+            ret.push_back(bboxC);
+        }
+
+        RectI bboxD = bboxX;
+        bboxD.x1 = bboxX.x2;
+        if (bboxX.y1 < bboxX.y2) {
+            met = false;
+            while ( bboxX.x2 > bboxX.x1 && isLineNonMarked<trimap>(false, bboxX.x2 - 1, bboxX.y1, bboxX.y2, &met) ) {
+                --bboxX.x2;
+                bboxD.x1 = bboxX.x2;
+            }
+            if (met) {
+                *isBeingRenderedElsewhere = true;
+            }
+        }
+        if ( !bboxD.isNull() ) {
+            ret.push_back(bboxD);
+        }
+
+        bboxX = minimalNonMarkedBbox<trimap>(bboxX, isBeingRenderedElsewhere);
+        if ( !bboxX.isNull() ) {
+            ret.push_back(bboxX);
+        }
+    }
+};
+
+// A random rectangle within bounds, or that may go out of it (or not even intersect it) if outside is true
+static RectI
+randomRect(const RectI& bounds,
+           bool outside)
+{
+    int margin = outside ? 40 : 0;
+    // coverity[dont_call]
+    int x1 = bounds.x1 - margin + rand() % (bounds.width() + margin);
+    // coverity[dont_call]
+    int y1 = bounds.y1 - margin / 8 + rand() % (bounds.height() + margin / 8);
+    // coverity[dont_call]
+    int x2 = x1 + 1 + rand() % (bounds.x2 + margin - x1);
+    // coverity[dont_call]
+    int y2 = y1 + 1 + rand() % (bounds.y2 + margin / 8 - y1);
+
+    return RectI(x1, y1, x2, y2);
+}
+
+static RectI
+randomBitmapBounds()
+{
+    // coverity[dont_call]
+    int x1 = rand() % 141 - 70;
+    // coverity[dont_call]
+    int y1 = rand() % 11 - 5;
+
+    // coverity[dont_call]
+    return RectI( x1, y1, x1 + 1 + rand() % 200, y1 + 1 + rand() % 8 );
+}
+
+// Applies a random operation to both bitmaps
+static void
+applyRandomOperation(Bitmap* bm,
+                     ReferenceBitmap* ref)
+{
+    const RectI& bounds = bm->getBounds();
+    // coverity[dont_call]
+    int op = rand() % 8;
+
+    if (op < 2) {
+        RectI r = randomRect(bounds, false);
+        bm->markForRendered(r);
+        ref->markFor(r, 1);
+    } else if (op < 4) {
+        RectI r = randomRect(bounds, false);
+        bm->markForRendering(r);
+        ref->markFor(r, kPixelUnavailable);
+    } else if (op < 6) {
+        RectI r = randomRect(bounds, false);
+        bm->clear(r);
+        ref->markFor(r, 0);
+    } else if (op == 6) {
+        bm->setTo1();
+        ref->markFor(bounds, 1);
+    } else {
+        // Copy from a bitmap starting at another x, so that the words of the rows are not aligned
+        RectI otherBounds = randomBitmapBounds();
+        Bitmap other(otherBounds);
+        ReferenceBitmap otherRef(otherBounds);
+        for (int i = 0; i < 4; ++i) {
+            RectI r = randomRect(otherBounds, false);
+            // coverity[dont_call]
+            char value = (char)(rand() % 3);
+            if (value == 1) {
+                other.markForRendered(r);
+            } else if (value == kPixelUnavailable) {
+                other.markForRendering(r);
+            } else {
+                other.clear(r);
+            }
+            otherRef.markFor(r, value);
+        }
+        RectI common;
+        if ( bounds.intersect(otherBounds, &common) ) {
+            RectI r = randomRect(common, false);
+            bm->copyBitmapPortion(r, other);
+            ref->copyBitmapPortion(r, otherRef);
+        }
+    }
+}
+
+// Random sequences of marks, clears and copies between bitmaps with unaligned x origins, checked pixel by pixel
+// and through all the searches, with and without the trimap, against the one char per pixel bitmap
+TEST(BitmapTest, MatchesReferenceModel)
+{
+    srand(2000);
+    for (int seq = 0; seq < 2000; ++seq) {
+        RectI bounds = randomBitmapBounds();
+        Bitmap bm(bounds);
+        ReferenceBitmap ref(bounds);
+
+        // coverity[dont_call]
+        int nOps = 1 + rand() % 6;
+        for (int i = 0; i < nOps; ++i) {
+            applyRandomOperation(&bm, &ref);
+        }
+
+        for (int y = bounds.y1; y < bounds.y2; ++y) {
+            for (int x = bounds.x1; x < bounds.x2; ++x) {
+                ASSERT_EQ( ref.at(x, y), bm.getValueAt(x, y) ) << "sequence " << seq << ", pixel " << x << " " << y;
+            }
+        }
+
+        for (int i = 0; i < 4; ++i) {
+            RectI roi = randomRect(bounds, false);
+            EXPECT_EQ( ref.isNonMarked(roi), bm.isNonMarked(roi) ) << "sequence " << seq;
+
+            bool refElsewhere = false;
+            EXPECT_EQ( ref.minimalNonMarkedBbox<0>(roi, &refElsewhere), bm.minimalNonMarkedBbox(roi) ) << "sequence " << seq;
+            refElsewhere = false;
+            bool elsewhere = false;
+            EXPECT_EQ( ref.minimalNonMarkedBbox<1>(roi, &refElsewhere), bm.minimalNonMarkedBbox_trimap(roi, &elsewhere) ) << "sequence " << seq;
+            EXPECT_EQ(refElsewhere, elsewhere) << "sequence " << seq;
+
+            // The rectangles may go out of the bounds
+            roi = randomRect(bounds, true);
+            std::list<RectI> refRects, rects;
+            refElsewhere = false;
+            ref.minimalNonMarkedRects<0>(roi, refRects, &refElsewhere);
+            bm.minimalNonMarkedRects(roi, rects);
+            EXPECT_TRUE(refRects == rects) << "sequence " << seq;
+
+            refRects.clear();
+            rects.clear();
+            refElsewhere = false;
+            elsewhere = false;
+            ref.minimalNonMarkedRects<1>(roi, refRects, &refElsewhere);
+            bm.minimalNonMarkedRects_trimap(roi, rects, &elsewhere);
+            EXPECT_TRUE(refRects == rects) << "sequence " << seq;
+            EXPECT_EQ(refElsewhere, elsewhere) << "sequence " << seq;
+        }
+    }
+}
+
+// Typical partial renders of a 4K image: a pan to the right, a zoom-out and a paint stroke
+static void
+makePartialRenderBitmap(int i,
+                        Bitmap* bm,
+                        RectI* expectedBbox,
+                        std::size_t* expectedRects)
+{
+    const RectI& bounds = bm->getBounds();
+
+    if (i == 0) {
+        bm->markForRendered( RectI(0, 0, 3440, 2160) );
+        *expectedBbox = RectI(3440, 0, 3840, 2160);
+        *expectedRects = 1;
+    } else if (i == 1) {
+        bm->markForRendered( RectI(960, 540, 2880, 1620) );
+        *expectedBbox = bounds;
+        *expectedRects = 4;
+    } else {
+        bm->setTo1();
+        bm->clear( RectI(1900, 1000, 1964, 1064) );
+        *expectedBbox = RectI(1900, 1000, 1964, 1064);
+        *expectedRects = 1;
+    }
+}
+
+TEST(BitmapTest, PartialRenders)
+{
+    const RectI bounds(0, 0, 3840, 2160);
+
+    for (int i = 0; i < 3; ++i) {
+        Bitmap bm(bounds);
+        RectI expectedBbox;
+        std::size_t expectedRects;
+        makePartialRenderBitmap(i, &bm, &expectedBbox, &expectedRects);
+
+        std::list<RectI> rects;
+        bool isBeingRenderedElsewhere = false;
+        bm.minimalNonMarkedRects_trimap(bounds, rects, &isBeingRenderedElsewhere);
+        EXPECT_EQ( expectedRects, rects.size() );
+        EXPECT_FALSE(isBeingRenderedElsewhere);
+        EXPECT_EQ( expectedBbox, bm.minimalNonMarkedBbox(bounds) );
+        EXPECT_EQ( (std::size_t)bounds.height() * ( (bounds.width() + 31) / 32 ) * sizeof(U64), bm.getMemorySize() );
+    }
+}
+
+// Timing of minimalNonMarkedRects_trimap() on the bitmaps of BitmapTest.PartialRenders, recorded as test properties.
+// Run with --gtest_also_run_disabled_tests --gtest_filter=BitmapTest.DISABLED_Benchmark --gtest_output=xml
+TEST(BitmapTest, DISABLED_Benchmark)
+{
+    const RectI bounds(0, 0, 3840, 2160);
+    const char* names[] = { "pan", "zoom_out", "paint_stroke" };
+
+    for (int i = 0; i < 3; ++i) {
+        Bitmap bm(bounds);
+        RectI expectedBbox;
+        std::size_t expectedRects;
+        makePartialRenderBitmap(i, &bm, &expectedBbox, &expectedRects);
+
+        const int nIterations = 20;
+        std::list<RectI> rects;
+        bool isBeingRenderedElsewhere = false;
+        TimeLapse timer;
+        for (int j = 0; j < nIterations; ++j) {
+            rects.clear();
+            bm.minimalNonMarkedRects_trimap(bounds, rects, &isBeingRenderedElsewhere);
+        }
+        double elapsed = timer.getTimeSinceCreation() / nIterations;
+        EXPECT_EQ( expectedRects, rects.size() );
+        ::testing::Test::RecordProperty( std::string(names[i]) + "_ms", QString::number(elapsed * 1000.).toStdString() );
+    }
+}
+
 TEST(ImageKeyTest, Equality) {
     srand(2000);
     // coverity[dont_call]
@@ -160,3 +656,320 @@ TEST(ImageKeyTest, Difference) {
     ASSERT_TRUE(keyHash1 != keyHash2);
 }
 
+
+static ImagePtr
+makeRandomImage(const ImagePlaneDesc& components,
+                ImageBitDepthEnum depth,
+                const RectI& bounds)
+{
+    ImagePtr image = boost::make_shared<Image>( components, RectD(bounds.x1, bounds.y1, bounds.x2, bounds.y2), bounds, 0, 1., depth,
+                                                eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, true );
+    Image::WriteAccess acc( image.get() );
+    std::size_t rowSize = bounds.width() * components.getNumComponents() * getSizeOfForBitDepth(depth);
+
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        unsigned char* row = acc.pixelAt(bounds.x1, y);
+        if (depth == eImageBitDepthFloat) {
+            float* pix = (float*)row;
+            for (std::size_t i = 0; i < rowSize / sizeof(float); ++i) {
+                // coverity[dont_call]
+                pix[i] = (float)rand() / RAND_MAX * 2.f - 0.5f;
+            }
+        } else {
+            for (std::size_t i = 0; i < rowSize; ++i) {
+                // coverity[dont_call]
+                row[i] = (unsigned char)rand();
+            }
+        }
+    }
+
+    return image;
+}
+
+// The level-by-level box filter of an aligned RoI, as done by Image::halveRoI()
+template <typename PIX, typename SUM>
+static std::vector<PIX>
+halveReference(const std::vector<PIX>& src,
+               int width,
+               int height,
+               int nComps)
+{
+    std::vector<PIX> dst( (width / 2) * (height / 2) * nComps );
+
+    for (int y = 0; y < height / 2; ++y) {
+        for (int x = 0; x < width / 2; ++x) {
+            for (int k = 0; k < nComps; ++k) {
+                SUM a = src[( (2 * y) * width + 2 * x ) * nComps + k];
+                SUM b = src[( (2 * y) * width + 2 * x + 1 ) * nComps + k];
+                SUM c = src[( (2 * y + 1) * width + 2 * x ) * nComps + k];
+                SUM d = src[( (2 * y + 1) * width + 2 * x + 1 ) * nComps + k];
+                dst[(y * (width / 2) + x) * nComps + k] = PIX( (a + b + c + d) / 4 );
+            }
+        }
+    }
+
+    return dst;
+}
+
+template <typename PIX, typename SUM>
+static void
+checkMipMapForDepth(const ImagePlaneDesc& components,
+                    ImageBitDepthEnum depth)
+{
+    const unsigned int level = 3;
+    const int nComps = components.getNumComponents();
+    // Large enough to be split across threads
+    const RectI bounds(0, 0, 1024, 520);
+    ImagePtr src = makeRandomImage(components, depth, bounds);
+    const RectI renderedRect(0, 0, 1024, 300);
+    src->markForRendered(renderedRect);
+
+    RectI dstBounds = bounds.downscalePowerOfTwoSmallestEnclosing(level);
+    ImagePtr dst = boost::make_shared<Image>( components, src->getRoD(), dstBounds, level, 1., depth,
+                                              eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, true );
+    src->downscaleMipMap(src->getRoD(), bounds, 0, level, true, dst.get() );
+
+    std::vector<PIX> expected( bounds.area() * nComps );
+    {
+        Image::ReadAccess acc( src.get() );
+        for (int y = bounds.y1; y < bounds.y2; ++y) {
+            std::memcpy( &expected[y * bounds.width() * nComps], acc.pixelAt(bounds.x1, y), bounds.width() * nComps * sizeof(PIX) );
+        }
+    }
+    int width = bounds.width();
+    int height = bounds.height();
+    for (unsigned int i = 0; i < level; ++i) {
+        expected = halveReference<PIX, SUM>(expected, width, height, nComps);
+        width /= 2;
+        height /= 2;
+    }
+
+    Image::ReadAccess acc( dst.get() );
+    int nMismatches = 0;
+    int nBitmapMismatches = 0;
+    for (int y = dstBounds.y1; y < dstBounds.y2; ++y) {
+        const PIX* pix = (const PIX*)acc.pixelAt(dstBounds.x1, y);
+        nMismatches += std::memcmp( pix, &expected[y * width * nComps], width * nComps * sizeof(PIX) ) != 0;
+        // A pixel is rendered if all the source pixels it covers are
+        bool rendered = ( (y + 1) << level ) <= renderedRect.y2;
+        for (int x = dstBounds.x1; x < dstBounds.x2; ++x) {
+            nBitmapMismatches += ( acc.bitmapValueAt(x, y) == 1 ) != rendered;
+        }
+    }
+    EXPECT_EQ(0, nMismatches);
+    EXPECT_EQ(0, nBitmapMismatches);
+}
+
+// Downscales an image whose bounds are negative, odd or even, and compares it with a box filter computed in
+// absolute coordinates: pixel x of a level covers the pixels 2x and 2x+1 of the previous level.
+template <typename PIX, typename SUM>
+static void
+checkMipMapNegativeBoundsForDepth(ImageBitDepthEnum depth,
+                                  const RectI& bounds)
+{
+    const unsigned int level = 2;
+    const ImagePlaneDesc& components = ImagePlaneDesc::getRGBAComponents();
+    const int nComps = components.getNumComponents();
+    ImagePtr src = makeRandomImage(components, depth, bounds);
+
+    RectI levelBounds = bounds;
+    RectI computed = bounds;
+    std::vector<PIX> expected( bounds.area() * nComps );
+    {
+        Image::ReadAccess acc( src.get() );
+        for (int y = bounds.y1; y < bounds.y2; ++y) {
+            std::memcpy( &expected[(y - bounds.y1) * bounds.width() * nComps], acc.pixelAt(bounds.x1, y), bounds.width() * nComps * sizeof(PIX) );
+        }
+    }
+    for (unsigned int i = 1; i <= level; ++i) {
+        const RectI prevBounds = levelBounds;
+        const RectI halvedRect = (i == 1) ? computed : prevBounds;
+        levelBounds = prevBounds.downscalePowerOfTwoSmallestEnclosing(1);
+        computed.x1 = (int)std::ceil(halvedRect.x1 / 2.);
+        computed.y1 = (int)std::ceil(halvedRect.y1 / 2.);
+        computed.x2 = std::max( (int)std::floor(halvedRect.x2 / 2.), computed.x1 );
+        computed.y2 = std::max( (int)std::floor(halvedRect.y2 / 2.), computed.y1 );
+        std::vector<PIX> halved(levelBounds.area() * nComps, PIX(0));
+        for (int y = computed.y1; y < computed.y2; ++y) {
+            for (int x = computed.x1; x < computed.x2; ++x) {
+                for (int k = 0; k < nComps; ++k) {
+                    SUM a = expected[( (2 * y - prevBounds.y1) * prevBounds.width() + 2 * x - prevBounds.x1 ) * nComps + k];
+                    SUM b = expected[( (2 * y - prevBounds.y1) * prevBounds.width() + 2 * x + 1 - prevBounds.x1 ) * nComps + k];
+                    SUM c = expected[( (2 * y + 1 - prevBounds.y1) * prevBounds.width() + 2 * x - prevBounds.x1 ) * nComps + k];
+                    SUM d = expected[( (2 * y + 1 - prevBounds.y1) * prevBounds.width() + 2 * x + 1 - prevBounds.x1 ) * nComps + k];
+                    halved[( (y - levelBounds.y1) * levelBounds.width() + x - levelBounds.x1 ) * nComps + k] = PIX( (a + b + c + d) / 4 );
+                }
+            }
+        }
+        expected.swap(halved);
+    }
+
+    ASSERT_EQ( bounds.downscalePowerOfTwoSmallestEnclosing(level), levelBounds );
+    ImagePtr dst = boost::make_shared<Image>( components, src->getRoD(), levelBounds, level, 1., depth,
+                                              eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, true );
+    src->downscaleMipMap(src->getRoD(), bounds, 0, level, false, dst.get() );
+
+    Image::ReadAccess acc( dst.get() );
+    int nMismatches = 0;
+    for (int y = levelBounds.y1; y < levelBounds.y2; ++y) {
+        nMismatches += std::memcmp( acc.pixelAt(levelBounds.x1, y), &expected[(y - levelBounds.y1) * levelBounds.width() * nComps],
+                                    levelBounds.width() * nComps * sizeof(PIX) ) != 0;
+    }
+    EXPECT_EQ(0, nMismatches) << "bounds " << bounds.x1 << " " << bounds.y1 << " " << bounds.x2 << " " << bounds.y2;
+}
+
+TEST(ImageBounds, GrowsToTiles)
+{
+    const RectI rodBounds(-100, -100, 2000, 1000);
+    ImagePtr image = boost::make_shared<Image>( ImagePlaneDesc::getRGBAComponents(), RectD(rodBounds.x1, rodBounds.y1, rodBounds.x2, rodBounds.y2),
+                                                RectI(10, 10, 20, 20), 0, 1., eImageBitDepthFloat,
+                                                eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, true );
+    image->markForRendered( image->getBounds() );
+
+    // Growing snaps to the tile grid, clipped to the RoD
+    ASSERT_TRUE( image->ensureBounds( RectI(-50, 10, 300, 20) ) );
+    const int tile = 1 << NATRON_IMAGE_TILE_SIZE_LOG2;
+    EXPECT_EQ( RectI(-100, 0, 2 * tile, tile), image->getBounds() );
+
+    // Small extensions within the grown area do not reallocate
+    EXPECT_FALSE( image->ensureBounds( RectI(-80, 0, 400, 200) ) );
+
+    // The area added by the growth is not marked as rendered, the old content is
+    std::list<RectI> rest;
+    image->getRestToRender(RectI(10, 10, 20, 20), rest);
+    EXPECT_TRUE( rest.empty() );
+    rest.clear();
+    image->getRestToRender(RectI(100, 100, 200, 200), rest);
+    EXPECT_FALSE( rest.empty() );
+
+    // Images without a bitmap keep their exact size
+    ImagePtr noBitmap = boost::make_shared<Image>( ImagePlaneDesc::getRGBAComponents(), RectD(rodBounds.x1, rodBounds.y1, rodBounds.x2, rodBounds.y2),
+                                                   RectI(10, 10, 20, 20), 0, 1., eImageBitDepthFloat,
+                                                   eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, false );
+    ASSERT_TRUE( noBitmap->ensureBounds( RectI(-50, 10, 300, 20) ) );
+    EXPECT_EQ( RectI(-50, 10, 300, 20), noBitmap->getBounds() );
+
+    // Nor do images whose added pixels are marked as rendered, as the paint strokes do
+    ImagePtr paint = boost::make_shared<Image>( ImagePlaneDesc::getRGBAComponents(), RectD(rodBounds.x1, rodBounds.y1, rodBounds.x2, rodBounds.y2),
+                                                RectI(10, 10, 20, 20), 0, 1., eImageBitDepthFloat,
+                                                eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, true );
+    ASSERT_TRUE( paint->ensureBounds(RectI(-50, 10, 300, 20), true, true) );
+    EXPECT_EQ( RectI(-50, 10, 300, 20), paint->getBounds() );
+    ImagePtr paintCopy;
+    ASSERT_TRUE( paint->copyAndResizeIfNeeded(RectI(-60, 5, 310, 20), true, true, &paintCopy) );
+    EXPECT_EQ( RectI(-60, 5, 310, 20), paintCopy->getBounds() );
+}
+
+TEST(ImageMipMap, MatchesLevelByLevelHalving)
+{
+    srand(2000);
+    checkMipMapForDepth<unsigned char, int>(ImagePlaneDesc::getRGBAComponents(), eImageBitDepthByte);
+    checkMipMapForDepth<unsigned short, int>(ImagePlaneDesc::getRGBAComponents(), eImageBitDepthShort);
+    checkMipMapForDepth<float, float>(ImagePlaneDesc::getRGBAComponents(), eImageBitDepthFloat);
+    checkMipMapForDepth<unsigned char, int>(ImagePlaneDesc::getRGBComponents(), eImageBitDepthByte);
+    checkMipMapForDepth<float, float>(ImagePlaneDesc::getAlphaComponents(), eImageBitDepthFloat);
+}
+
+TEST(ImageMipMap, NegativeBounds)
+{
+    // Odd and even negative bounds, on both sides of the origin or entirely below it
+    const RectI bounds[] = { RectI(-7, -6, 9, 10), RectI(-10, -9, 13, 6), RectI(-23, -18, -3, -2), RectI(-22, -17, -4, -1) };
+
+    srand(2000);
+    for (int i = 0; i < 4; ++i) {
+        checkMipMapNegativeBoundsForDepth<unsigned char, int>(eImageBitDepthByte, bounds[i]);
+        checkMipMapNegativeBoundsForDepth<float, float>(eImageBitDepthFloat, bounds[i]);
+    }
+}
+
+TEST(ImageMipMap, KernelsMatchScalar)
+{
+    if (MipMapKernels::getSupportedISA() == eKernelsISAScalar) {
+        // No vectorized kernel supported by this CPU
+        return;
+    }
+
+    srand(2000);
+    const ImageBitDepthEnum depths[] = { eImageBitDepthByte, eImageBitDepthShort, eImageBitDepthFloat };
+    const int width = 37; // not a multiple of the vector width
+    for (int i = 0; i < 3; ++i) {
+        for (int nComps = 1; nComps <= 4; ++nComps) {
+            std::size_t rowSize = 2 * width * nComps * getSizeOfForBitDepth(depths[i]);
+            std::vector<unsigned char> src0(rowSize), src1(rowSize), dstScalar(rowSize / 2), dstVector(rowSize / 2);
+            for (std::size_t j = 0; j < rowSize; ++j) {
+                // coverity[dont_call]
+                src0[j] = (unsigned char)rand();
+                // coverity[dont_call]
+                src1[j] = (unsigned char)rand();
+            }
+            if (depths[i] == eImageBitDepthFloat) {
+                // Random bytes may be NaNs, which do not compare equal
+                for (std::size_t j = 0; j < rowSize / sizeof(float); ++j) {
+                    // coverity[dont_call]
+                    ( (float*)&src0[0] )[j] = (float)rand() / RAND_MAX;
+                    // coverity[dont_call]
+                    ( (float*)&src1[0] )[j] = (float)rand() / RAND_MAX;
+                }
+            }
+
+            MipMapHalveRowArgs args;
+            args.src0 = &src0[0];
+            args.src1 = &src1[0];
+            args.width = width;
+            args.nComps = nComps;
+            args.depth = depths[i];
+            args.dst = &dstScalar[0];
+            MipMapKernels::halveRow(args, eKernelsISAScalar);
+            args.dst = &dstVector[0];
+            MipMapKernels::halveRow(args, eKernelsISASSE41);
+            EXPECT_EQ(dstScalar, dstVector) << "depth " << depths[i] << ", " << nComps << " components";
+        }
+    }
+}
+
+// Timing of a 6K plate downscaled to level 3, as when rendering a proxy, level by level and in a single pass,
+// recorded as test properties. The results are compared by ImageMipMap.MatchesLevelByLevelHalving.
+// Run with --gtest_also_run_disabled_tests --gtest_filter=ImageMipMap.DISABLED_Benchmark --gtest_output=xml
+TEST(ImageMipMap, DISABLED_Benchmark)
+{
+    const unsigned int level = 3;
+    const RectI bounds(0, 0, 6144, 3160);
+    const ImageBitDepthEnum depths[] = { eImageBitDepthByte, eImageBitDepthShort, eImageBitDepthFloat };
+    const char* depthNames[] = { "byte", "short", "float" };
+
+    srand(2000);
+    for (int i = 0; i < 3; ++i) {
+        ImagePtr src = makeRandomImage(ImagePlaneDesc::getRGBAComponents(), depths[i], bounds);
+        RectI dstBounds = bounds.downscalePowerOfTwoSmallestEnclosing(level);
+
+        // One intermediate image and one pass per level, like the level-by-level halving
+        TimeLapse levelByLevelTimer;
+        ImagePtr levelImg = src;
+        for (unsigned int l = 1; l <= level; ++l) {
+            RectI levelBounds = bounds.downscalePowerOfTwoSmallestEnclosing(l);
+            ImagePtr halved = boost::make_shared<Image>( ImagePlaneDesc::getRGBAComponents(), src->getRoD(), levelBounds, l, 1., depths[i],
+                                                         eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, true );
+            levelImg->downscaleMipMap(src->getRoD(), levelImg->getBounds(), l - 1, l, false, halved.get() );
+            levelImg = halved;
+        }
+        double levelByLevel = levelByLevelTimer.getTimeSinceCreation();
+
+        TimeLapse fusedTimer;
+        ImagePtr fused = boost::make_shared<Image>( ImagePlaneDesc::getRGBAComponents(), src->getRoD(), dstBounds, level, 1., depths[i],
+                                                    eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, true );
+        src->downscaleMipMap(src->getRoD(), bounds, 0, level, false, fused.get() );
+        double single = fusedTimer.getTimeSinceCreation();
+
+        ::testing::Test::RecordProperty( std::string(depthNames[i]) + "_level_by_level_seconds", QString::number(levelByLevel).toStdString() );
+        ::testing::Test::RecordProperty( std::string(depthNames[i]) + "_single_pass_seconds", QString::number(single).toStdString() );
+
+        Image::ReadAccess accLevel( levelImg.get() );
+        Image::ReadAccess accFused( fused.get() );
+        std::size_t rowSize = dstBounds.width() * 4 * getSizeOfForBitDepth(depths[i]);
+        int nMismatches = 0;
+        for (int y = dstBounds.y1; y < dstBounds.y2; ++y) {
+            nMismatches += std::memcmp(accLevel.pixelAt(dstBounds.x1, y), accFused.pixelAt(dstBounds.x1, y), rowSize) != 0;
+        }
+        EXPECT_EQ(0, nMismatches);
+    }
+}
@@ -25,9 +25,13 @@
 
 #include "Global/Macros.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <limits>
+#include <vector>
 #include <gtest/gtest.h>
 #include "Engine/Lut.h"
+#include "Engine/ViewerInstanceKernels.h"
 
 NATRON_NAMESPACE_USING
 using namespace NATRON_NAMESPACE::Color;
@@ -52,3 +56,182 @@ TEST(Lut, IntConversions) {
         EXPECT_EQ( i, uint8xxToChar( charToUint8xx(i) ) );
     }
 }
+
+// The vectorized viewer kernels must produce exactly the output of the scalar kernel,
+// which must stay within 1 LSB of the undithered conversion.
+TEST(Lut, ViewerKernels) {
+    const Lut* srgb = LutManager::sRGBLut();
+    srgb->validate();
+
+    const int width = 67; // not a multiple of the vector sizes
+    std::vector<float> src(width * 4);
+    srand(2000);
+    for (int i = 0; i < width * 4; ++i) {
+        // coverity[dont_call]
+        src[i] = (rand() % 1400) / 1000.f - 0.2f;
+    }
+
+    for (int useLut = 0; useLut < 2; ++useLut) {
+        for (int opaque = 0; opaque < 2; ++opaque) {
+            for (int matteChannel = -1; matteChannel < 4; ++matteChannel) {
+                ViewerRowTo8BitsArgs args;
+                args.src = &src[0];
+                args.width = width;
+                args.x = 5;
+                args.y = 3;
+                args.gain = 1.2f;
+                args.offset = 0.01f;
+                args.lut = useLut ? srgb->getUint8xxTable() : 0;
+                args.opaque = opaque;
+                args.matteChannel = matteChannel;
+
+                std::vector<U32> scalar(width);
+                args.dst = &scalar[0];
+                ViewerKernels::rowTo8Bits(args, eKernelsISAScalar);
+
+                for (int isa = eKernelsISASSE41; isa <= (int)ViewerKernels::getSupportedISA(); ++isa) {
+                    std::vector<U32> vectorized(width);
+                    args.dst = &vectorized[0];
+                    ViewerKernels::rowTo8Bits(args, (KernelsISAEnum)isa);
+                    EXPECT_EQ(scalar, vectorized) << "isa " << isa << " lut " << useLut << " opaque " << opaque << " matte " << matteChannel;
+                }
+
+                if (useLut && matteChannel == -1) {
+                    for (int i = 0; i < width; ++i) {
+                        int exact = srgb->toColorSpaceUint8FromLinearFloatFast(src[i * 4] * args.gain + args.offset);
+                        int dithered = (scalar[i] >> 16) & 0xff;
+                        EXPECT_LE(std::abs(exact - dithered), 1);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(Lut, ViewerHalfKernels) {
+    // 1, -2, 65504 (max half), 65520 (rounds to infinity), 2^-24 (smallest denormal), 2^-25 (rounds to 0, even), 1 + 2^-11 (rounds to 1, even)
+    const float values[] = { 1.f, -2.f, 65504.f, 65520.f, 5.9604644775390625e-8f, 2.98023223876953125e-8f, 1.00048828125f };
+    const unsigned short expected[] = { 0x3c00, 0xc000, 0x7bff, 0x7c00, 0x0001, 0x0000, 0x3c00 };
+    const int nValues = sizeof(values) / sizeof(values[0]);
+
+    const int count = 67 * 4; // not a multiple of the vector sizes
+    std::vector<float> src(count);
+    srand(2000);
+    for (int i = 0; i < count; ++i) {
+        // coverity[dont_call]
+        src[i] = i < nValues ? values[i] : ( (rand() % 200000) - 100000 ) / 997.f;
+    }
+
+    std::vector<unsigned short> scalar(count);
+    ViewerKernels::floatToHalf(&src[0], &scalar[0], count, eKernelsISAScalar);
+    for (int i = 0; i < nValues; ++i) {
+        EXPECT_EQ(expected[i], scalar[i]) << "value " << values[i];
+    }
+
+    for (int isa = eKernelsISASSE41; isa <= (int)ViewerKernels::getSupportedISA(); ++isa) {
+        std::vector<unsigned short> vectorized(count);
+        ViewerKernels::floatToHalf(&src[0], &vectorized[0], count, (KernelsISAEnum)isa);
+        EXPECT_EQ(scalar, vectorized) << "isa " << isa;
+    }
+}
+
+// The auto-contrast and histogram kernels must match the scalar kernels, which ignore NaNs.
+TEST(Lut, ViewerMinMaxKernels) {
+    const int width = 67; // not a multiple of the vector sizes
+    std::vector<float> src(width * 4);
+    srand(2000);
+    for (int i = 0; i < width * 4; ++i) {
+        // coverity[dont_call]
+        src[i] = (rand() % 4000) / 1000.f - 1.f;
+    }
+    src[9] = std::numeric_limits<float>::quiet_NaN();
+
+    float rgbMin = std::numeric_limits<float>::infinity();
+    float rgbMax = -std::numeric_limits<float>::infinity();
+    for (int i = 0; i < width * 4; ++i) {
+        if ( (i % 4 != 3) && (i != 9) ) {
+            rgbMin = std::min(rgbMin, src[i]);
+            rgbMax = std::max(rgbMax, src[i]);
+        }
+    }
+
+    for (int nComps = 1; nComps <= 4; ++nComps) {
+        for (int channels = eDisplayChannelsRGB; channels <= eDisplayChannelsMatte; ++channels) {
+            ViewerRowMinMaxArgs args;
+            args.src = &src[0];
+            args.width = width * 4 / nComps;
+            args.nComps = nComps;
+            args.channels = (DisplayChannelsEnum)channels;
+
+            float scalarMin = std::numeric_limits<float>::infinity();
+            float scalarMax = -std::numeric_limits<float>::infinity();
+            ViewerKernels::rowMinMax(args, &scalarMin, &scalarMax, eKernelsISAScalar);
+            if ( (nComps == 4) && (channels == eDisplayChannelsRGB) ) {
+                EXPECT_EQ(rgbMin, scalarMin);
+                EXPECT_EQ(rgbMax, scalarMax);
+            }
+
+            for (int isa = eKernelsISASSE41; isa <= (int)ViewerKernels::getSupportedISA(); ++isa) {
+                float vmin = std::numeric_limits<float>::infinity();
+                float vmax = -std::numeric_limits<float>::infinity();
+                ViewerKernels::rowMinMax(args, &vmin, &vmax, (KernelsISAEnum)isa);
+                EXPECT_EQ(scalarMin, vmin) << "isa " << isa << " nComps " << nComps << " channels " << channels;
+                EXPECT_EQ(scalarMax, vmax) << "isa " << isa << " nComps " << nComps << " channels " << channels;
+            }
+        }
+    }
+}
+
+TEST(Lut, ViewerHistogramKernels) {
+    const int width = 67;
+    const int binsCount = 50;
+    std::vector<float> src(width * 4);
+    srand(2000);
+    for (int i = 0; i < width * 4; ++i) {
+        // coverity[dont_call]
+        src[i] = (rand() % 1400) / 1000.f - 0.2f;
+    }
+    src[9] = std::numeric_limits<float>::quiet_NaN();
+
+    // RGB, then the luminance and the alpha
+    const int channelSets[2][3] = { { 0, 1, 2 }, { 4, 3, -1 } };
+    for (int set = 0; set < 2; ++set) {
+        ViewerRowHistogramArgs args;
+        args.src = &src[0];
+        args.width = width;
+        args.nComps = 4;
+        args.vmin = 0.f;
+        args.scale = binsCount / 1.f;
+        args.binsCount = binsCount;
+        args.histogramsCount = set == 0 ? 3 : 2;
+
+        std::vector<unsigned int> scalar(3 * binsCount, 0);
+        for (int k = 0; k < 3; ++k) {
+            args.channels[k] = channelSets[set][k];
+            args.histograms[k] = &scalar[k * binsCount];
+        }
+        ViewerKernels::rowHistogram(args, eKernelsISAScalar);
+
+        if (set == 0) {
+            // Only the values in [0,1) are counted
+            unsigned int expectedCount = 0;
+            for (int i = 0; i < width * 4; ++i) {
+                expectedCount += (i % 4 != 3) && (src[i] >= 0.f) && (src[i] < 1.f);
+            }
+            unsigned int count = 0;
+            for (std::size_t i = 0; i < scalar.size(); ++i) {
+                count += scalar[i];
+            }
+            EXPECT_EQ(expectedCount, count);
+        }
+
+        for (int isa = eKernelsISASSE41; isa <= (int)ViewerKernels::getSupportedISA(); ++isa) {
+            std::vector<unsigned int> vectorized(3 * binsCount, 0);
+            for (int k = 0; k < 3; ++k) {
+                args.histograms[k] = &vectorized[k * binsCount];
+            }
+            ViewerKernels::rowHistogram(args, (KernelsISAEnum)isa);
+            EXPECT_EQ(scalar, vectorized) << "isa " << isa << " set " << set;
+        }
+    }
+}
@@ -0,0 +1,191 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "BaseTest.h"
+
+#include "Engine/NativeExpression.h"
+
+NATRON_NAMESPACE_USING
+
+static bool
+evaluateNative(const std::string& expr,
+               double time,
+               double* ret)
+{
+    NativeExpressionPtr native = NativeExpression::compile(expr, KnobIPtr(), 0);
+
+    if (!native) {
+        return false;
+    }
+
+    return native->evaluate(time, ViewIdx(0), ret);
+}
+
+static bool
+isSupported(const std::string& expr)
+{
+    return (bool)NativeExpression::compile(expr, KnobIPtr(), 0);
+}
+
+TEST_F(BaseTest, NativeExpressionArithmetic)
+{
+    double ret = 0.;
+
+    ASSERT_TRUE( evaluateNative("frame * 2 + 1", 10, &ret) );
+    EXPECT_EQ(21., ret);
+    ASSERT_TRUE( evaluateNative("-2 ** 2", 0, &ret) );
+    EXPECT_EQ(-4., ret);
+    ASSERT_TRUE( evaluateNative("2 ** -1", 0, &ret) );
+    EXPECT_EQ(0.5, ret);
+    ASSERT_TRUE( evaluateNative("-7 // 2", 0, &ret) );
+    EXPECT_EQ(-4., ret);
+    ASSERT_TRUE( evaluateNative("-7 % 3", 0, &ret) );
+    EXPECT_EQ(2., ret);
+    ASSERT_TRUE( evaluateNative("7.5 % -2", 0, &ret) );
+    EXPECT_EQ(-0.5, ret);
+    ASSERT_TRUE( evaluateNative("(frame - 1) * .5e1", 3, &ret) );
+    EXPECT_EQ(10., ret);
+    ASSERT_TRUE( evaluateNative("view + dimension", 0, &ret) );
+    EXPECT_EQ(0., ret);
+    ASSERT_TRUE( evaluateNative("max(1, frame, 3) + min(4, 2.5)", 2.5, &ret) );
+    EXPECT_EQ(5.5, ret);
+    ASSERT_TRUE( evaluateNative("sqrt(16) + sin(0) + abs(-2) + int(2.7)", 0, &ret) );
+    EXPECT_EQ(8., ret);
+    ASSERT_TRUE( evaluateNative("cos(pi)", 0, &ret) );
+    EXPECT_DOUBLE_EQ(-1., ret);
+    ASSERT_TRUE( evaluateNative("log(e)", 0, &ret) );
+    EXPECT_DOUBLE_EQ(1., ret);
+}
+
+TEST_F(BaseTest, NativeExpressionErrors)
+{
+    double ret = 0.;
+
+    // Errors are reported by Python
+    EXPECT_FALSE( evaluateNative("1 / (frame - 1)", 1, &ret) );
+    EXPECT_FALSE( evaluateNative("sqrt(frame)", -1, &ret) );
+    EXPECT_FALSE( evaluateNative("(-8) ** (1 / 3.)", 0, &ret) );
+    EXPECT_FALSE( evaluateNative("10 ** 100", 0, &ret) );
+
+    // Not supported
+    EXPECT_FALSE( isSupported("random()") );
+    EXPECT_FALSE( isSupported("frame if frame > 1 else 0") );
+    EXPECT_FALSE( isSupported("\"frame\"") );
+    EXPECT_FALSE( isSupported("0x10 + 1L") );
+    EXPECT_FALSE( isSupported("thisParam.get()") );
+    EXPECT_FALSE( isSupported("unknownFunction(frame)") );
+    EXPECT_FALSE( isSupported("frame.real") );
+    EXPECT_FALSE( isSupported("(1, 2)") );
+    EXPECT_FALSE( isSupported("1 +") );
+}
+
+TEST_F(BaseTest, NativeExpressionKnobReferences)
+{
+    NodePtr generator = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(generator);
+    EffectInstancePtr effect = generator->getEffectInstance();
+    KnobDoublePtr a = effect->createDoubleKnob("a", "a", 2);
+    KnobIntPtr b = effect->createIntKnob("b", "b", 1);
+    KnobDoublePtr result = effect->createDoubleKnob("result", "result", 2);
+    ASSERT_TRUE(a && b && result);
+    a->setValue(1.5, ViewSpec::all(), 0);
+    a->setValue(4., ViewSpec::all(), 1);
+    b->setValue(3);
+
+    // Another knob and another dimension of the same node
+    const std::string exprX = "thisNode.a.get()[1] * 2 + thisNode.b.get()";
+    const std::string exprY = "thisNode.a.getValue(0) + thisParam.getValue(0)";
+    EXPECT_TRUE( NativeExpression::compile(exprX, result, 0) );
+    EXPECT_TRUE( NativeExpression::compile(exprY, result, 1) );
+    result->setExpression(0, exprX, false, true);
+    result->setExpression(1, exprY, false, true);
+    EXPECT_EQ( 11., result->getValue(0) );
+    EXPECT_EQ( 12.5, result->getValue(1) );
+
+    // The results must follow the referenced knobs
+    a->setValue(2., ViewSpec::all(), 1);
+    EXPECT_EQ( 7., result->getValue(0) );
+    EXPECT_EQ( 8.5, result->getValue(1) );
+    b->setValue(-1);
+    EXPECT_EQ( 3., result->getValue(0) );
+    a->setValue(0.5, ViewSpec::all(), 0);
+    EXPECT_EQ( 3.5, result->getValue(1) );
+
+    // A knob of another node, referenced by its script name
+    NodePtr other = createNode(_generatorPluginID);
+    ASSERT_TRUE(other);
+    KnobDoublePtr c = other->getEffectInstance()->createDoubleKnob("c", "c", 1);
+    ASSERT_TRUE(c);
+    c->setValue(10.);
+    const std::string exprOther = generator->getScriptName_mt_safe() + ".a.get().x + frame";
+    EXPECT_TRUE( NativeExpression::compile(exprOther, c, 0) );
+    c->setExpression(0, exprOther, false, true);
+    EXPECT_EQ( 5.5, c->getValueAtTime(5., 0) );
+    a->setValue(-1., ViewSpec::all(), 0);
+    EXPECT_EQ( 4., c->getValueAtTime(5., 0) );
+}
+
+TEST_F(BaseTest, NativeExpressionPythonFallback)
+{
+    NodePtr generator = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(generator);
+    EffectInstancePtr effect = generator->getEffectInstance();
+    KnobDoublePtr a = effect->createDoubleKnob("a", "a", 1);
+    KnobDoublePtr result = effect->createDoubleKnob("result", "result", 1);
+    ASSERT_TRUE(a && result);
+    a->setValue(2.);
+
+    // Not in the native subset: Python must evaluate it, and the result must still follow the referenced knob
+    const std::string expr = "thisNode.a.get() * 3 if frame > 1 else -1";
+    EXPECT_FALSE( NativeExpression::compile(expr, result, 0) );
+    result->setExpression(0, expr, false, true);
+    EXPECT_EQ( -1., result->getValueAtTime(1., 0) );
+    EXPECT_EQ( 6., result->getValueAtTime(2., 0) );
+    a->setValue(5.);
+    EXPECT_EQ( 15., result->getValueAtTime(2., 0) );
+
+    // A multi-line expression with a ret variable is never compiled natively
+    result->setExpression(0, "x = thisNode.a.get()\nret = x + frame", true, true);
+    EXPECT_EQ( 8., result->getValueAtTime(3., 0) );
+
+    // Evaluation errors of a native expression are reported by Python and invalidate the expression
+    KnobDoublePtr error = effect->createDoubleKnob("error", "error", 1);
+    ASSERT_TRUE(error);
+    error->setValue(4.);
+    a->setValue(1.);
+    const std::string exprError = "1 / (thisNode.a.get() - 1)";
+    EXPECT_TRUE( NativeExpression::compile(exprError, error, 0) );
+    error->setExpression(0, exprError, false, false);
+    EXPECT_EQ( 4., error->getValueAtTime(1., 0) );
+    EXPECT_FALSE( error->isExpressionValid(0, 0) );
+}
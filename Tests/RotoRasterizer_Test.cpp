@@ -0,0 +1,270 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <cairo/cairo.h>
+
+#include "Engine/RotoContextPrivate.h"
+#include "Engine/RotoRasterizer.h"
+
+NATRON_NAMESPACE_USING
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846264338327950288   /* pi             */
+#endif
+
+static void
+makeFeatheredEllipse(double cx,
+                     double cy,
+                     double rx,
+                     double ry,
+                     double featherDist,
+                     int nVertices,
+                     std::vector<Point>* polygon,
+                     std::vector<RotoFeatherQuad>* feather)
+{
+    // The patches of RotoContextPrivate::computeFeatherQuads(): from the previous vertex to the current one
+    for (int i = 0; i < nVertices; ++i) {
+        double a0 = 2. * M_PI * (i - 1) / nVertices;
+        double a1 = 2. * M_PI * i / nVertices;
+        Point p;
+        p.x = cx + rx * std::cos(a1);
+        p.y = cy + ry * std::sin(a1);
+        polygon->push_back(p);
+
+        RotoFeatherQuad quad;
+        quad.p[0].x = cx + rx * std::cos(a0);
+        quad.p[0].y = cy + ry * std::sin(a0);
+        quad.p[1].x = cx + (rx + featherDist) * std::cos(a0);
+        quad.p[1].y = cy + (ry + featherDist) * std::sin(a0);
+        quad.p[2].x = cx + (rx + featherDist) * std::cos(a1);
+        quad.p[2].y = cy + (ry + featherDist) * std::sin(a1);
+        quad.p[3] = p;
+        feather->push_back(quad);
+    }
+}
+
+// Renders the shape as RotoContextPrivate::renderBezier() does by default, without ROTO_RENDER_TRIANGLES_ONLY
+static void
+renderWithCairo(const RectI& roi,
+                const std::vector<Point>& polygon,
+                const std::vector<RotoFeatherQuad>& feather,
+                double fallOff,
+                std::vector<float>* mask)
+{
+    cairo_surface_t* surface = cairo_image_surface_create( CAIRO_FORMAT_A8, roi.width(), roi.height() );
+
+    cairo_surface_set_device_offset(surface, -roi.x1, -roi.y1);
+    cairo_t* cr = cairo_create(surface);
+    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+
+    cairo_new_path(cr);
+    for (std::size_t i = 0; i < polygon.size(); ++i) {
+        if (i == 0) {
+            cairo_move_to(cr, polygon[i].x, polygon[i].y);
+        } else {
+            cairo_line_to(cr, polygon[i].x, polygon[i].y);
+        }
+    }
+    cairo_close_path(cr);
+    cairo_fill(cr);
+
+    cairo_pattern_t* mesh = cairo_pattern_create_mesh();
+    double shapeColor[3] = {1., 1., 1.};
+    RotoContextPrivate::renderFeatherQuads_cairo(feather, shapeColor, fallOff, mesh);
+    RotoContextPrivate::applyAndDestroyMask(cr, mesh);
+    cairo_surface_flush(surface);
+
+    const unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    mask->resize( (std::size_t)roi.width() * roi.height() );
+    for (int y = 0; y < roi.height(); ++y) {
+        for (int x = 0; x < roi.width(); ++x) {
+            (*mask)[(std::size_t)y * roi.width() + x] = data[y * stride + x] / 255.f;
+        }
+    }
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+}
+
+TEST(RotoRasterizer, ExactCoverage)
+{
+    // A square covering a quarter of its corner pixels
+    std::vector<Point> polygon(4);
+    polygon[0].x = 2.5;
+    polygon[0].y = 2.5;
+    polygon[1].x = 7.5;
+    polygon[1].y = 2.5;
+    polygon[2].x = 7.5;
+    polygon[2].y = 7.5;
+    polygon[3].x = 2.5;
+    polygon[3].y = 7.5;
+
+    RotoRasterizer rasterizer;
+    rasterizer.addShape( polygon, std::vector<RotoFeatherQuad>(), 1. );
+
+    RectI tile(0, 0, 10, 10);
+    std::vector<float> mask(100);
+    rasterizer.renderTile(tile, &mask[0]);
+    for (int y = 0; y < 10; ++y) {
+        for (int x = 0; x < 10; ++x) {
+            float cx = (x < 2 || x > 7) ? 0.f : ( (x == 2 || x == 7) ? 0.5f : 1.f );
+            float cy = (y < 2 || y > 7) ? 0.f : ( (y == 2 || y == 7) ? 0.5f : 1.f );
+            EXPECT_NEAR(cx * cy, mask[y * 10 + x], 1e-6);
+        }
+    }
+
+    // The same polygon in the other direction
+    std::vector<Point> reversed(polygon.rbegin(), polygon.rend());
+    RotoRasterizer reversedRasterizer;
+    reversedRasterizer.addShape( reversed, std::vector<RotoFeatherQuad>(), 1. );
+    std::vector<float> reversedMask(100);
+    reversedRasterizer.renderTile(tile, &reversedMask[0]);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_NEAR(mask[i], reversedMask[i], 1e-6);
+    }
+}
+
+TEST(RotoRasterizer, TilesMatchFullRender)
+{
+    std::vector<Point> polygon;
+    std::vector<RotoFeatherQuad> feather;
+
+    makeFeatheredEllipse(60.3, 45.7, 50., 30., 12., 64, &polygon, &feather);
+
+    RotoRasterizer rasterizer;
+    rasterizer.addShape(polygon, feather, 0.5);
+    // A second motion-blur sample
+    polygon.clear();
+    feather.clear();
+    makeFeatheredEllipse(70.1, 48.2, 50., 30., 12., 64, &polygon, &feather);
+    rasterizer.addShape(polygon, feather, 0.5);
+    // An anti-aliased shape, larger than the roi
+    polygon.clear();
+    for (int i = 0; i < 7; ++i) {
+        Point p;
+        p.x = 65. + 90. * std::cos(6. * M_PI * i / 7);
+        p.y = 50. + 70. * std::sin(6. * M_PI * i / 7);
+        polygon.push_back(p);
+    }
+    rasterizer.addShape( polygon, std::vector<RotoFeatherQuad>(), 1. );
+
+    RectI roi(-7, -5, 140, 100);
+    std::vector<float> full( (std::size_t)roi.width() * roi.height() );
+    rasterizer.renderTile(roi, &full[0]);
+
+    // Odd tile sizes so that edges cross the tile borders everywhere
+    for (int ty = roi.y1; ty < roi.y2; ty += 17) {
+        for (int tx = roi.x1; tx < roi.x2; tx += 13) {
+            RectI tile( tx, ty, std::min(tx + 13, roi.x2), std::min(ty + 17, roi.y2) );
+            std::vector<float> mask( (std::size_t)tile.width() * tile.height() );
+            rasterizer.renderTile(tile, &mask[0]);
+            for (int y = tile.y1; y < tile.y2; ++y) {
+                for (int x = tile.x1; x < tile.x2; ++x) {
+                    ASSERT_NEAR(full[(y - roi.y1) * roi.width() + (x - roi.x1)], mask[(y - tile.y1) * tile.width() + (x - tile.x1)], 1e-5);
+                }
+            }
+        }
+    }
+}
+
+TEST(RotoRasterizer, SamplesAreAveraged)
+{
+    RectI roi(0, 0, 120, 90);
+    std::size_t nPixels = (std::size_t)roi.width() * roi.height();
+    RotoRasterizer rasterizer;
+    std::vector<std::vector<float> > sampleMasks;
+
+    for (int i = 0; i < 3; ++i) {
+        std::vector<Point> polygon;
+        std::vector<RotoFeatherQuad> feather;
+        makeFeatheredEllipse(40.4 + 15. * i, 45.1, 30., 25., 8., 48, &polygon, &feather);
+        rasterizer.addShape(polygon, feather, 1.);
+
+        RotoRasterizer sampleRasterizer;
+        sampleRasterizer.addShape(polygon, feather, 1.);
+        sampleMasks.push_back( std::vector<float>(nPixels) );
+        sampleRasterizer.renderTile(roi, &sampleMasks.back()[0]);
+    }
+    ASSERT_EQ( (std::size_t)3, rasterizer.getShapesCount() );
+
+    std::vector<float> mask(nPixels);
+    rasterizer.renderTile(roi, &mask[0]);
+
+    // The samples accumulated in separate buffers, as done by the threads of render()
+    std::vector<float> firstSum(nPixels, 0.f);
+    std::vector<float> lastSum(nPixels, 0.f);
+    rasterizer.accumulateTile(roi, 0, 1, &firstSum[0]);
+    rasterizer.accumulateTile(roi, 1, 3, &lastSum[0]);
+
+    for (std::size_t p = 0; p < nPixels; ++p) {
+        float average = (sampleMasks[0][p] + sampleMasks[1][p] + sampleMasks[2][p]) / 3.f;
+        ASSERT_NEAR(average, mask[p], 1e-5);
+        ASSERT_NEAR(average, (firstSum[p] + lastSum[p]) / 3.f, 1e-5);
+    }
+}
+
+TEST(RotoRasterizer, MatchesCairo)
+{
+    const double fallOffs[3] = {0.5, 1., 2.};
+
+    for (int f = 0; f < 3; ++f) {
+        std::vector<Point> polygon;
+        std::vector<RotoFeatherQuad> feather;
+        makeFeatheredEllipse(100.2, 80.6, 70., 50., 20., 128, &polygon, &feather);
+
+        RotoRasterizer rasterizer;
+        rasterizer.addShape(polygon, feather, fallOffs[f]);
+
+        RectI roi(0, 0, 200, 160);
+        std::vector<float> mask( (std::size_t)roi.width() * roi.height() );
+        rasterizer.renderTile(roi, &mask[0]);
+
+        std::vector<float> cairoMask;
+        renderWithCairo(roi, polygon, feather, fallOffs[f], &cairoMask);
+        ASSERT_EQ( mask.size(), cairoMask.size() );
+
+        // The difference comes from the 8 bits of the cairo image and the subdivision of the mesh patches
+        double sumError = 0.;
+        int nLargeErrors = 0;
+        for (std::size_t i = 0; i < mask.size(); ++i) {
+            double error = std::abs(mask[i] - cairoMask[i]);
+            sumError += error;
+            if (error > 4. / 255) {
+                ++nLargeErrors;
+            }
+        }
+        EXPECT_LT(sumError / mask.size(), 2. / 255);
+        EXPECT_LT( nLargeErrors, (int)mask.size() / 100 );
+    }
+}
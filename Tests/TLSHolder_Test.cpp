@@ -0,0 +1,207 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <map>
+#include <vector>
+#include <algorithm> // max
+#include <gtest/gtest.h>
+
+#include <boost/make_shared.hpp>
+
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QString>
+#include <QtCore/QThread>
+
+#include "BaseTest.h"
+
+#include "Engine/AppManager.h"
+#include "Engine/Project.h"
+#include "Engine/Timer.h"
+#include "Engine/TLSHolder.h"
+
+NATRON_NAMESPACE_USING
+
+#define TLS_TEST_N_CALLS_PER_THREAD 1000000
+
+namespace {
+
+typedef TLSHolder<Project::ProjectTLSData> ProjectTLSHolder;
+
+// Replicates the lookup done by TLSHolder::getTLSData() before the per-thread cache:
+// the spawned threads map and the per-thread data map are looked up under read locks
+class LockedTLS
+{
+public:
+
+    LockedTLS()
+        : _spawnsMutex()
+        , _spawns()
+        , _mutex()
+        , _data()
+    {
+    }
+
+    Project::ProjectDataTLSPtr getOrCreateTLSData()
+    {
+        const QThread* curThread = QThread::currentThread();
+        {
+            QReadLocker k(&_spawnsMutex);
+            if ( _spawns.find(curThread) != _spawns.end() ) {
+                return Project::ProjectDataTLSPtr();
+            }
+        }
+        {
+            QReadLocker k(&_mutex);
+            std::map<const QThread*, Project::ProjectDataTLSPtr>::const_iterator found = _data.find(curThread);
+            if ( found != _data.end() ) {
+                return found->second;
+            }
+        }
+        Project::ProjectDataTLSPtr ret = boost::make_shared<Project::ProjectTLSData>();
+        QWriteLocker k(&_mutex);
+        _data[curThread] = ret;
+
+        return ret;
+    }
+
+private:
+
+    QReadWriteLock _spawnsMutex;
+    std::map<const QThread*, const QThread*> _spawns;
+    QReadWriteLock _mutex;
+    std::map<const QThread*, Project::ProjectDataTLSPtr> _data;
+};
+
+template <typename TLS>
+class TLSLookupThread
+    : public QThread
+{
+    TLS* _tls;
+
+public:
+
+    bool sameValue;
+
+    TLSLookupThread(TLS* tls)
+        : QThread()
+        , _tls(tls)
+        , sameValue(true)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        Project::ProjectDataTLSPtr first = _tls->getOrCreateTLSData();
+
+        for (int i = 0; i < TLS_TEST_N_CALLS_PER_THREAD; ++i) {
+            if (_tls->getOrCreateTLSData() != first) {
+                sameValue = false;
+            }
+        }
+        cleanup(_tls);
+    }
+
+    static void cleanup(LockedTLS* /*tls*/)
+    {
+    }
+
+    static void cleanup(ProjectTLSHolder* /*tls*/)
+    {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
+};
+
+// Returns the average time of a call in nanoseconds
+template <typename TLS>
+double
+lookupTLS(TLS* tls,
+          int nThreads)
+{
+    std::vector<TLSLookupThread<TLS>*> threads;
+
+    for (int i = 0; i < nThreads; ++i) {
+        threads.push_back( new TLSLookupThread<TLS>(tls) );
+    }
+    TimeLapse timer;
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->start();
+    }
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->wait();
+        EXPECT_TRUE(threads[i]->sameValue);
+        delete threads[i];
+    }
+
+    return timer.getTimeSinceCreation() * 1e9 / TLS_TEST_N_CALLS_PER_THREAD;
+}
+
+} // anon namespace
+
+TEST_F(BaseTest, TLSHolderPerThreadData)
+{
+    boost::shared_ptr<ProjectTLSHolder> holder = boost::make_shared<ProjectTLSHolder>();
+
+    EXPECT_FALSE( holder->getTLSData() );
+    Project::ProjectDataTLSPtr data = holder->getOrCreateTLSData();
+    ASSERT_TRUE(data);
+    EXPECT_EQ( data, holder->getTLSData() );
+    EXPECT_EQ( data, holder->getOrCreateTLSData() );
+
+    // Another holder must not see the data of the first one
+    boost::shared_ptr<ProjectTLSHolder> otherHolder = boost::make_shared<ProjectTLSHolder>();
+    EXPECT_FALSE( otherHolder->getTLSData() );
+
+    // Other threads have their own data
+    TLSLookupThread<ProjectTLSHolder> thread( holder.get() );
+    thread.start();
+    thread.wait();
+    EXPECT_TRUE(thread.sameValue);
+    EXPECT_EQ( data, holder->getTLSData() );
+
+    appPTR->getAppTLS()->cleanupTLSForThread();
+    EXPECT_FALSE( holder->getTLSData() );
+    EXPECT_NE( data, holder->getOrCreateTLSData() );
+    appPTR->getAppTLS()->cleanupTLSForThread();
+}
+
+// Cost of a TLS lookup with the per-thread cache and with the previous locked lookup, recorded as test properties.
+// Run with --gtest_also_run_disabled_tests --gtest_filter=BaseTest.DISABLED_TLSHolderBenchmark --gtest_output=xml
+TEST_F(BaseTest, DISABLED_TLSHolderBenchmark)
+{
+    int nThreads = std::max(1, QThread::idealThreadCount());
+    boost::shared_ptr<ProjectTLSHolder> holder = boost::make_shared<ProjectTLSHolder>();
+    LockedTLS lockedTLS;
+
+    double lockedTime = lookupTLS(&lockedTLS, nThreads);
+    double cachedTime = lookupTLS(holder.get(), nThreads);
+
+    RecordProperty( "locked_ns_per_call", QString::number(lockedTime).toStdString() );
+    RecordProperty( "cached_ns_per_call", QString::number(cachedTime).toStdString() );
+}
@@ -44,11 +44,19 @@ SOURCES += \
     google-test/src/gtest-all.cc \
     google-mock/src/gmock-all.cc \
     BaseTest.cpp \
+    BufferPool_Test.cpp \
+    Cache_Test.cpp \
+    CLArgs_Test.cpp \
     Hash64_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
     KnobFile_Test.cpp \
     Curve_Test.cpp \
+    FrameLockstep_Test.cpp \
+    NativeExpression_Test.cpp \
+    RotoRasterizer_Test.cpp \
+    ThreadPool_Test.cpp \
+    TLSHolder_Test.cpp \
     Tracker_Test.cpp \
     wmain.cpp
 
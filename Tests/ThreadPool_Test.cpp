@@ -0,0 +1,246 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+#include <ctime> // clock
+#include <string>
+#include <stdexcept>
+#include <algorithm> // max
+#include <gtest/gtest.h>
+
+#include <QtCore/QString>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
+#include "Engine/ThreadPool.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+// Shape of the simulated graph: effects rendered concurrently (e.g. parallel renders of the output scheduler),
+// each split in tiles (host frame threading), each tile split in slices (OpenFX multi-thread suite)
+#define THREADPOOL_TEST_N_EFFECTS 4
+#define THREADPOOL_TEST_N_TILES 8
+#define THREADPOOL_TEST_N_SLICES 8
+#define THREADPOOL_TEST_SLICE_WORK 20000
+
+namespace {
+
+TaskScheduler* gScheduler = 0;
+
+int
+renderSlice(int slice)
+{
+    volatile double x = 0.;
+
+    for (int i = 0; i < THREADPOOL_TEST_SLICE_WORK; ++i) {
+        x = x + i * 0.5;
+    }
+
+    return slice + 1;
+}
+
+std::vector<int>
+makeIndexes(int n)
+{
+    std::vector<int> ret(n);
+
+    for (int i = 0; i < n; ++i) {
+        ret[i] = i;
+    }
+
+    return ret;
+}
+
+int
+sum(const std::vector<int>& values)
+{
+    int ret = 0;
+
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        ret += values[i];
+    }
+
+    return ret;
+}
+
+int
+sum(const QList<int>& values)
+{
+    int ret = 0;
+
+    Q_FOREACH (int value, values) {
+        ret += value;
+    }
+
+    return ret;
+}
+
+// Expected result of one effect: the sum over the tiles of the sum of the slices
+int
+expectedEffectResult()
+{
+    return THREADPOOL_TEST_N_TILES * (THREADPOOL_TEST_N_SLICES * (THREADPOOL_TEST_N_SLICES + 1) / 2);
+}
+
+int
+renderTileWithScheduler(int /*tile*/)
+{
+    std::vector<int> results;
+
+    gScheduler->blockingMapped(makeIndexes(THREADPOOL_TEST_N_SLICES), &renderSlice, &results);
+
+    return sum(results);
+}
+
+int
+renderEffectWithScheduler(int /*effect*/)
+{
+    std::vector<int> results;
+
+    gScheduler->blockingMapped(makeIndexes(THREADPOOL_TEST_N_TILES), &renderTileWithScheduler, &results);
+
+    return sum(results);
+}
+
+int
+renderTileWithQtConcurrent(int /*tile*/)
+{
+    QFuture<int> future = QtConcurrent::mapped(makeIndexes(THREADPOOL_TEST_N_SLICES), &renderSlice);
+
+    future.waitForFinished();
+
+    return sum( future.results() );
+}
+
+int
+renderEffectWithQtConcurrent(int /*effect*/)
+{
+    QFuture<int> future = QtConcurrent::mapped(makeIndexes(THREADPOOL_TEST_N_TILES), &renderTileWithQtConcurrent);
+
+    future.waitForFinished();
+
+    return sum( future.results() );
+}
+
+void
+throwOnThirdInput(int i)
+{
+    if (i == 3) {
+        throw std::runtime_error("task failed");
+    }
+}
+
+// Prints the wall time and the share of the cores that was kept busy
+void
+recordUtilisation(const char* name,
+                  double wallTime,
+                  std::clock_t cpuTime)
+{
+    double cpuSeconds = (double)cpuTime / CLOCKS_PER_SEC;
+    int nCores = std::max(1, QThread::idealThreadCount());
+
+    ::testing::Test::RecordProperty( std::string(name) + "_seconds", QString::number(wallTime).toStdString() );
+    ::testing::Test::RecordProperty( std::string(name) + "_cpu_percent", QString::number( 100. * cpuSeconds / ( std::max(wallTime, 1e-9) * nCores ) ).toStdString() );
+}
+
+} // anon namespace
+
+TEST(ThreadPool, NestedBlockingMapped)
+{
+    int threadCounts[] = { 0, 1, 4 };
+
+    for (std::size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); ++i) {
+        TaskScheduler scheduler(threadCounts[i]);
+        gScheduler = &scheduler;
+
+        std::vector<int> results;
+        scheduler.blockingMapped(makeIndexes(THREADPOOL_TEST_N_EFFECTS), &renderEffectWithScheduler, &results);
+        ASSERT_EQ( (std::size_t)THREADPOOL_TEST_N_EFFECTS, results.size() );
+        for (std::size_t e = 0; e < results.size(); ++e) {
+            EXPECT_EQ(expectedEffectResult(), results[e]) << "with " << threadCounts[i] << " worker(s)";
+        }
+
+        // Changing the number of workers between loops must not lose tasks
+        scheduler.setMaxThreadCount(2);
+        EXPECT_EQ( 2, scheduler.getMaxThreadCount() );
+        scheduler.blockingMapped(makeIndexes(100), &renderSlice, &results);
+        EXPECT_EQ( 100 * 101 / 2, sum(results) );
+
+        gScheduler = 0;
+    }
+}
+
+TEST(ThreadPool, TaskException)
+{
+    TaskScheduler scheduler(2);
+
+    EXPECT_THROW(scheduler.blockingMap(makeIndexes(8), &throwOnThirdInput), std::runtime_error);
+
+    // The scheduler is still usable afterwards
+    std::vector<int> results;
+    scheduler.blockingMapped(makeIndexes(8), &renderSlice, &results);
+    EXPECT_EQ( 8 * 9 / 2, sum(results) );
+}
+
+// Wall time and CPU utilisation of the nested parallel loops of a render (effects -> tiles -> multi-thread suite slices)
+// with nested QtConcurrent calls vs. the task scheduler, recorded as test properties.
+// Run with --gtest_also_run_disabled_tests --gtest_filter=ThreadPool.DISABLED_NestedRenderBenchmark --gtest_output=xml
+TEST(ThreadPool, DISABLED_NestedRenderBenchmark)
+{
+    int nThreads = QThread::idealThreadCount();
+    {
+        QThreadPool::globalInstance()->setMaxThreadCount(nThreads);
+        std::clock_t cpuStart = std::clock();
+        TimeLapse timer;
+        QFuture<int> future = QtConcurrent::mapped(makeIndexes(THREADPOOL_TEST_N_EFFECTS), &renderEffectWithQtConcurrent);
+        future.waitForFinished();
+        double elapsed = timer.getTimeSinceCreation();
+        recordUtilisation("qtconcurrent", elapsed, std::clock() - cpuStart);
+
+        Q_FOREACH (int result, future.results()) {
+            EXPECT_EQ(expectedEffectResult(), result);
+        }
+    }
+    {
+        // The thread calling blockingMapped works too
+        TaskScheduler scheduler(nThreads - 1);
+        gScheduler = &scheduler;
+        std::clock_t cpuStart = std::clock();
+        TimeLapse timer;
+        std::vector<int> results;
+        scheduler.blockingMapped(makeIndexes(THREADPOOL_TEST_N_EFFECTS), &renderEffectWithScheduler, &results);
+        double elapsed = timer.getTimeSinceCreation();
+        recordUtilisation("taskscheduler", elapsed, std::clock() - cpuStart);
+
+        for (std::size_t e = 0; e < results.size(); ++e) {
+            EXPECT_EQ(expectedEffectResult(), results[e]);
+        }
+        gScheduler = 0;
+    }
+}
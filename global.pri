@@ -43,6 +43,12 @@ run-without-python {
     QMAKE_CXXFLAGS += -include Python.h
 }
 
+# To hash nodes and cache entries with the legacy CRC64 (keeps the disk caches written by older versions valid)
+hash64-crc {
+    message("Natron will use the legacy CRC64 hash")
+    DEFINES += NATRON_HASH64_CRC
+}
+
 *g++* | *clang* | *xcode* {
 #See https://bugreports.qt.io/browse/QTBUG-35776 we cannot use
 # QMAKE_CFLAGS_RELEASE_WITH_DEBUGINFO
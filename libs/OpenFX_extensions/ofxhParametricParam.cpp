@@ -348,6 +348,16 @@ OfxStatus  ParametricInstance::deleteAllControlPoints(int /*curveIndex*/)
     return kOfxStatErrMissingHostFeature;
 }
 
+OfxStatus ParametricInstance::getLUT(int /*curveIndex*/,
+                                     double /*time*/,
+                                     const double** /*table*/,
+                                     int* /*tableSize*/,
+                                     double* /*rangeMin*/,
+                                     double* /*rangeMax*/)
+{
+    return kOfxStatFailed;
+}
+
 
 
 /** @brief Evaluates a parametric parameter
@@ -1131,6 +1141,57 @@ static OfxStatus parametricParamDeleteAllControlPoints(OfxParamHandle param,
     return stat;
 }
 
+/** @brief Natron extension: returns the table a curve of a parametric param is baked into for the render in progress
+
+             \arg param                 handle to the parametric parameter
+             \arg curveIndex            which dimension to get
+             \arg time                  the time to get the table at
+             \arg table                 pointer where the address of the values is returned
+             \arg tableSize             pointer where the number of values is returned
+             \arg rangeMin              pointer where the parametric position of the first value is returned
+             \arg rangeMax              pointer where the parametric position of the last value is returned
+
+             @returns
+             - ::kOfxStatOK            - all was fine
+             - ::kOfxStatErrBadHandle  - if the paramter handle was invalid
+             - ::kOfxStatErrBadIndex   - the curve index was invalid
+             - ::kOfxStatFailed        - the curve cannot be baked or no render is in progress
+             */
+static OfxStatus parametricParamGetLUT(OfxParamHandle param,
+                                       int curveIndex,
+                                       OfxTime time,
+                                       const double** table,
+                                       int* tableSize,
+                                       double* rangeMin,
+                                       double* rangeMax)
+{
+#   ifdef OFX_DEBUG_PARAMETERS
+    std::cout << "OFX: parametricParamGetLUT - " << param << " ...";
+#   endif
+    Param::Base *base = reinterpret_cast<Param::Base*>(param);
+    if(!base || !base->verifyMagic()) {
+#       ifdef OFX_DEBUG_PARAMETERS
+        std::cout << ' ' << StatStr(kOfxStatErrBadHandle) << std::endl;
+#       endif
+        return kOfxStatErrBadHandle;
+    }
+
+    ParametricInstance* instance = dynamic_cast<ParametricInstance*>(base);
+    if(!instance || !instance->isInitialized() || !table || !tableSize || !rangeMin || !rangeMax) {
+#       ifdef OFX_DEBUG_PARAMETERS
+        std::cout << ' ' << StatStr(kOfxStatErrBadHandle) << std::endl;
+#       endif
+        return kOfxStatErrBadHandle;
+    }
+
+    OfxStatus stat = instance->getLUT(curveIndex, time, table, tableSize, rangeMin, rangeMax);
+
+#   ifdef OFX_DEBUG_PARAMETERS
+    std::cout << ' ' << StatStr(stat) << std::endl;
+#   endif
+    return stat;
+}
+
 static OfxParametricParameterSuiteV1 gSuite = {
     parametricParamGetValue,
     parametricParamGetNControlPoints,
@@ -1169,6 +1230,19 @@ void *GetSuite(int version)
     return NULL;
 }
 
+static NatronOfxParametricParameterLUTSuiteV1 gLUTSuite = {
+    parametricParamGetLUT
+};
+
+/// return the Natron suite that gives access to the baked parametric params
+void *GetLUTSuite(int version)
+{
+    if (version == 1) {
+        return (void *)(&gLUTSuite);
+    }
+    return NULL;
+}
+
 } //namespace ParametricParam
 
 } //namespace Host
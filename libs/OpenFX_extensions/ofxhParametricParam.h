@@ -33,6 +33,31 @@
 
 #include "ofxhParam.h"
 
+/** @brief Natron extension: a suite giving plug-ins direct access to the table a parametric curve is baked into.
+
+    The table holds tableSize values of the curve, evenly spaced from rangeMin to rangeMax (both included),
+    to be interpolated linearly. It is only available during the render action, and the pointer stays
+    valid until the render action returns.
+ */
+#define kNatronOfxParametricParameterLUTSuite "NatronOfxParametricParameterLUTSuite"
+
+typedef struct NatronOfxParametricParameterLUTSuiteV1 {
+  /** @brief Returns the table curveIndex is baked into for the render in progress
+   @returns
+   - ::kOfxStatOK            - all was fine
+   - ::kOfxStatErrBadHandle  - if the paramter handle was invalid
+   - ::kOfxStatErrBadIndex   - the curve index was invalid
+   - ::kOfxStatFailed        - the curve cannot be baked or no render is in progress, use parametricParamGetValue
+   */
+  OfxStatus (*parametricParamGetLUT)(OfxParamHandle param,
+                                     int curveIndex,
+                                     OfxTime time,
+                                     const double** table,
+                                     int* tableSize,
+                                     double* rangeMin,
+                                     double* rangeMax);
+} NatronOfxParametricParameterLUTSuiteV1;
+
 namespace OFX {
 
 namespace Host {
@@ -275,6 +300,21 @@ public:
      */
     virtual OfxStatus  deleteAllControlPoints(int   curveIndex);
 
+    /** @brief Natron extension: returns the table curveIndex is baked into for the render in progress.
+     \arg curveIndex            which dimension to get
+     \arg time                  the time to get the table at
+     \arg table                 pointer where the address of the values is returned
+     \arg tableSize             pointer where the number of values is returned
+     \arg rangeMin              pointer where the parametric position of the first value is returned
+     \arg rangeMax              pointer where the parametric position of the last value is returned
+     */
+    virtual OfxStatus getLUT(int curveIndex,
+                             double time,
+                             const double** table,
+                             int* tableSize,
+                             double* rangeMin,
+                             double* rangeMax);
+
 
 };
 
@@ -283,6 +323,9 @@ public:
 /// fetch the parametric params suite
 void *GetSuite(int version);
 
+/// fetch the Natron parametric params LUT suite
+void *GetLUTSuite(int version);
+
 } //namespace ParametricParam
 
 } //namespace Host